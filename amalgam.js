@@ -17,9 +17,6 @@ const quickjs_h = loadFile("quickjs.h")
 const quickjs_libc_c = loadFile("quickjs-libc.c")
 const quickjs_libc_h = loadFile("quickjs-libc.h")
 const quickjs_opcode_h = loadFile("quickjs-opcode.h")
-const gen_builtin_array_fromasync_h = loadFile("builtin-array-fromasync.h")
-const gen_builtin_iterator_zip_h = loadFile("builtin-iterator-zip.h")
-const gen_builtin_iterator_zip_keyed_h = loadFile("builtin-iterator-zip-keyed.h")
 
 let source = "#if defined(QJS_BUILD_LIBC) && defined(__linux__) && !defined(_GNU_SOURCE)\n"
            + "#define _GNU_SOURCE\n"
@@ -43,11 +40,5 @@ let source = "#if defined(QJS_BUILD_LIBC) && defined(__linux__) && !defined(_GNU
 source = source.replace(/#include "quickjs-atom.h"/g, quickjs_atom_h)
 source = source.replace(/#include "quickjs-opcode.h"/g, quickjs_opcode_h)
 source = source.replace(/#include "libregexp-opcode.h"/g, libregexp_opcode_h)
-source = source.replace(/#include "builtin-array-fromasync.h"/g,
-                        gen_builtin_array_fromasync_h)
-source = source.replace(/#include "builtin-iterator-zip.h"/g,
-                        gen_builtin_iterator_zip_h)
-source = source.replace(/#include "builtin-iterator-zip-keyed.h"/g,
-                        gen_builtin_iterator_zip_keyed_h)
 source = source.replace(/#include "[^"]+"/g, "")
 writeFile(execArgv[2] ?? "quickjs-amalgam.c", source)
@@ -382,6 +382,71 @@ static void module_serde(void)
     JS_FreeRuntime(rt);
 }
 
+/* return true if a lazy function was compiled since the tracing started */
+static bool lazy_compiled(JSRuntime *rt)
+{
+    char buf[4096];
+    size_t len;
+    FILE *f;
+
+    f = tmpfile();
+    assert(f != NULL);
+    assert(0 == JS_WriteTrace(rt, f));
+    rewind(f);
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+    assert(0 == JS_StopTracing(rt));
+    return strstr(buf, "{\"name\":\"compile_lazy\",") != NULL;
+}
+
+static void lazy_function_serde(void)
+{
+    static const char code[] =
+        "export function g(x) { function h(y) { return x + y; } return h(1); }\n"
+        "globalThis.r = g(41);";
+    static const int flags[] = { 0, JS_WRITE_OBJ_STRIP_SOURCE };
+    JSContext *ctx1;
+    JSValue mod, ret;
+    uint8_t *buf;
+    size_t len, i;
+    int32_t r;
+
+    for (i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        JSRuntime *rt = JS_NewRuntime();
+        JSContext *ctx = JS_NewContext(rt);
+        mod = JS_Eval(ctx, code, strlen(code), "m",
+                      JS_EVAL_TYPE_MODULE|JS_EVAL_FLAG_COMPILE_ONLY);
+        assert(!JS_IsException(mod));
+        /* 'g' is written as is unless its source is stripped */
+        assert(0 == JS_StartTracing(rt, 0));
+        buf = JS_WriteObject(ctx, &len, mod, JS_WRITE_OBJ_BYTECODE|flags[i]);
+        assert(buf);
+        assert(lazy_compiled(rt) == (flags[i] != 0));
+        JS_FreeValue(ctx, mod);
+
+        JSRuntime *rt2 = JS_NewRuntime();
+        JSContext *ctx2 = JS_NewContext(rt2);
+        mod = JS_ReadObject(ctx2, buf, len, JS_READ_OBJ_BYTECODE);
+        js_free(ctx, buf);
+        JS_FreeContext(ctx);
+        JS_FreeRuntime(rt);
+        assert(!JS_IsException(mod));
+        assert(0 == JS_StartTracing(rt2, 0));
+        ret = JS_EvalFunction(ctx2, mod);
+        assert(!JS_IsException(ret));
+        JS_FreeValue(ctx2, ret);
+        assert(0 <= JS_ExecutePendingJobs(rt2, -1, -1, &ctx1));
+        assert(lazy_compiled(rt2) == (flags[i] == 0));
+        ret = eval(ctx2, "r");
+        assert(0 == JS_ToInt32(ctx2, &r, ret));
+        assert(r == 42);
+        JS_FreeValue(ctx2, ret);
+        JS_FreeContext(ctx2);
+        JS_FreeRuntime(rt2);
+    }
+}
+
 static void runtime_cstring_free(void)
 {
     JSRuntime *rt = JS_NewRuntime();
@@ -702,7 +767,9 @@ static void dump_memory_usage(void)
     "globalThis.count = 0;"
     "globalThis.actual = undefined;" // set by promise_hook_cb
     "globalThis.expected = new Promise(resolve => resolve());"
-    "expected.then(_ => count++)";
+    "expected.then(_ => count++);"
+    "globalThis.objs = [new Uint8Array(8), new DataView(new ArrayBuffer(8)),"
+    "                   (function*() {})(), new Map([[1, 2]]), new Set([3])];";
 
     JSValue evalVal = JS_Eval(ctx, code, strlen(code), "<input>", 0);
     JS_FreeValue(ctx, evalVal);
@@ -905,6 +972,647 @@ static void immutable_array_buffer(void)
     JS_FreeRuntime(rt);
 }
 
+static JSValue sum_job(JSContext *ctx, int argc, JSValueConst *argv)
+{
+    JSValue global;
+    int i, v, sum, ret;
+
+    sum = 0;
+    for (i = 0; i < argc; i++) {
+        assert(0 == JS_ToInt32(ctx, &v, argv[i]));
+        sum += v;
+    }
+    global = JS_GetGlobalObject(ctx);
+    ret = JS_SetPropertyStr(ctx, global, "sum", JS_NewInt32(ctx, sum));
+    JS_FreeValue(ctx, global);
+    return ret < 0 ? JS_EXCEPTION : JS_UNDEFINED;
+}
+
+static void pending_jobs(void)
+{
+    JSValue ret, args[8];
+    JSMemoryUsage stats;
+    JSContext *ctx1;
+    int i, v;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    ret = eval(ctx, "var n = 0;"
+                    "function f(depth) { n++; if (depth > 0) {"
+                    "    queueMicrotask(() => f(depth - 1));"
+                    "    queueMicrotask(() => f(depth - 1)); } }"
+                    "for (var i = 0; i < 100; i++) queueMicrotask(() => n++);"
+                    "f(10);");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    assert(10 == JS_ExecutePendingJobs(rt, 10, -1, &ctx1));
+    assert(ctx1 == ctx);
+    assert(JS_IsJobPending(rt));
+    /* the jobs enqueued by the executed jobs are executed too */
+    assert(100 + 2046 - 10 == JS_ExecutePendingJobs(rt, -1, -1, &ctx1));
+    assert(!JS_IsJobPending(rt));
+    /* the buffer which grew for these jobs is freed */
+    JS_ComputeMemoryUsage(rt, &stats);
+    assert(stats.job_count == 0);
+    assert(stats.job_queue_size == 0);
+    assert(0 == JS_ExecutePendingJobs(rt, -1, 0, &ctx1));
+    assert(ctx1 == NULL);
+    ret = eval(ctx, "n");
+    assert(0 == JS_ToInt32(ctx, &v, ret));
+    assert(v == 100 + 2047);
+    JS_FreeValue(ctx, ret);
+    /* more arguments than stored inline */
+    for (i = 0; i < 8; i++)
+        args[i] = JS_NewInt32(ctx, i + 1);
+    assert(0 == JS_EnqueueJob(ctx, sum_job, 8, args));
+    assert(0 == JS_EnqueueJob(ctx, sum_job, 2, args));
+    assert(1 == JS_ExecutePendingJobs(rt, 1, -1, &ctx1));
+    ret = eval(ctx, "sum");
+    assert(0 == JS_ToInt32(ctx, &v, ret));
+    assert(v == 36);
+    JS_FreeValue(ctx, ret);
+    assert(1 == JS_ExecutePendingJob(rt, &ctx1));
+    ret = eval(ctx, "sum");
+    assert(0 == JS_ToInt32(ctx, &v, ret));
+    assert(v == 3);
+    JS_FreeValue(ctx, ret);
+    /* an exception stops the execution */
+    ret = eval(ctx, "queueMicrotask(() => { throw 1; }); queueMicrotask(() => {})");
+    JS_FreeValue(ctx, ret);
+    assert(-1 == JS_ExecutePendingJobs(rt, -1, -1, &ctx1));
+    assert(ctx1 == ctx);
+    assert(JS_HasException(ctx));
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    assert(JS_IsJobPending(rt));
+    /* the pending jobs are freed with the runtime */
+    assert(0 == JS_EnqueueJob(ctx, sum_job, 8, args));
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+static void cpu_profiler(void)
+{
+    char buf[4096];
+    size_t len;
+    FILE *f;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    assert(-1 == JS_StopProfiling(rt, NULL, JS_PROFILE_COLLAPSED));
+    assert(0 == JS_StartProfiling(rt, 1));
+    assert(-1 == JS_StartProfiling(rt, 1));
+    JSValue ret = eval(ctx, "function busy() {"
+                            "    var t = Date.now(), n = 0;"
+                            "    while (Date.now() - t < 20) n++;"
+                            "    return n;"
+                            "}"
+                            "busy();");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    f = tmpfile();
+    assert(f != NULL);
+    assert(0 == JS_StopProfiling(rt, f, JS_PROFILE_COLLAPSED));
+    rewind(f);
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+    assert(strstr(buf, "<eval> (<input>:1:1);busy (<input>:1:1)"));
+    assert(-1 == JS_StopProfiling(rt, NULL, JS_PROFILE_COLLAPSED));
+    /* pprof output */
+    assert(0 == JS_StartProfiling(rt, 1));
+    ret = eval(ctx, "busy();");
+    JS_FreeValue(ctx, ret);
+    f = tmpfile();
+    assert(f != NULL);
+    assert(0 == JS_StopProfiling(rt, f, JS_PROFILE_PPROF));
+    rewind(f);
+    len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    /* the first entry of the string table is the empty string */
+    assert(len > 2 && buf[0] == 0x32 && buf[1] == 0);
+    /* the profile is freed with the runtime */
+    assert(0 == JS_StartProfiling(rt, 0));
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+static void alloc_profiler(void)
+{
+    char buf[4096];
+    size_t len;
+    FILE *f;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    assert(-1 == JS_StopAllocProfiling(rt, NULL, JS_PROFILE_COLLAPSED));
+    /* sample every allocation */
+    assert(0 == JS_StartAllocProfiling(rt, 1));
+    assert(-1 == JS_StartAllocProfiling(rt, 1));
+    JSValue ret = eval(ctx, "function alloc() {"
+                            "    var a = [];"
+                            "    for (var i = 0; i < 1000; i++) a.push({ i });"
+                            "    return a;"
+                            "}"
+                            "alloc();");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    f = tmpfile();
+    assert(f != NULL);
+    assert(0 == JS_StopAllocProfiling(rt, f, JS_PROFILE_COLLAPSED));
+    rewind(f);
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+    assert(strstr(buf, "<eval> (<input>:1:1);alloc (<input>:1:1) "));
+    assert(strstr(buf, "<eval> (<input>:1:1);alloc (<input>:1:1);push (native) "));
+    assert(-1 == JS_StopAllocProfiling(rt, NULL, JS_PROFILE_COLLAPSED));
+    /* pprof output */
+    assert(0 == JS_StartAllocProfiling(rt, 64));
+    ret = eval(ctx, "globalThis.kept = alloc(); alloc();");
+    JS_FreeValue(ctx, ret);
+    f = tmpfile();
+    assert(f != NULL);
+    assert(0 == JS_StopAllocProfiling(rt, f, JS_PROFILE_PPROF));
+    rewind(f);
+    len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    /* the first entry of the string table is the empty string */
+    assert(len > 2 && buf[0] == 0x32 && buf[1] == 0);
+    /* the profile is freed with the runtime */
+    assert(0 == JS_StartAllocProfiling(rt, 1));
+    ret = eval(ctx, "alloc();");
+    JS_FreeValue(ctx, ret);
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+static void tracing(void)
+{
+    JSContext *ctx1;
+    char buf[4096];
+    size_t len;
+    FILE *f;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    f = tmpfile();
+    assert(f != NULL);
+    assert(-1 == JS_WriteTrace(rt, f));
+    assert(-1 == JS_StopTracing(rt));
+    assert(0 == JS_StartTracing(rt, 0));
+    assert(-1 == JS_StartTracing(rt, 0));
+    JSValue ret = eval(ctx, "function f() { return 1 }"
+                            "Promise.resolve().then(f);");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    assert(1 == JS_ExecutePendingJobs(rt, -1, -1, &ctx1));
+    JS_RunGC(rt);
+    assert(0 == JS_WriteTrace(rt, f));
+    rewind(f);
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+    assert(!strncmp(buf, "{\"traceEvents\":[\n", 17));
+    assert(strstr(buf, "{\"name\":\"JS_Eval\",\"cat\":\"eval\",\"ph\":\"X\""));
+    assert(strstr(buf, "\"args\":{\"file\":\"<input>\"}"));
+    assert(strstr(buf, "{\"name\":\"compile_lazy\","));
+    assert(strstr(buf, "\"args\":{\"function\":\"f\"}"));
+    assert(strstr(buf, "{\"name\":\"job\","));
+    assert(strstr(buf, "\"args\":{\"jobs\":1}"));
+    assert(strstr(buf, "{\"name\":\"gc_scan\","));
+    assert(strstr(buf, "{\"name\":\"gc\","));
+    assert(0 == JS_StopTracing(rt));
+    /* the jobs run before an exception are recorded */
+    assert(0 == JS_StartTracing(rt, 0));
+    ret = eval(ctx, "queueMicrotask(f); queueMicrotask(() => { throw 1; });");
+    JS_FreeValue(ctx, ret);
+    assert(-1 == JS_ExecutePendingJobs(rt, -1, -1, &ctx1));
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    f = tmpfile();
+    assert(f != NULL);
+    assert(0 == JS_WriteTrace(rt, f));
+    rewind(f);
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+    assert(strstr(buf, "\"args\":{\"jobs\":2}"));
+    assert(!strstr(buf, "\"jobs\":-1"));
+    assert(0 == JS_StopTracing(rt));
+    /* the ring buffer only keeps the last events */
+    assert(0 == JS_StartTracing(rt, 4));
+    ret = eval(ctx, "f()");
+    JS_FreeValue(ctx, ret);
+    JS_RunGC(rt);
+    f = tmpfile();
+    assert(f != NULL);
+    assert(0 == JS_WriteTrace(rt, f));
+    rewind(f);
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+    assert(!strstr(buf, "JS_Eval"));
+    assert(strstr(buf, "{\"name\":\"gc_decref\","));
+    assert(strstr(buf, "{\"name\":\"gc\","));
+    /* the events are freed with the runtime */
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+static void heap_snapshot(void)
+{
+    char *buf;
+    long len;
+    FILE *f;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    JSValue ret = eval(ctx, "class Foo { constructor() { this.s = 'a'.repeat(64) + 'b'; } }"
+                            "globalThis.foo = new Foo();"
+                            "globalThis.cycle = {}; cycle.self = cycle;"
+                            "globalThis.lone = 'x\\ud800y'.repeat(2);");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    f = tmpfile();
+    assert(f != NULL);
+    assert(0 == JS_WriteHeapSnapshot(rt, f));
+    len = ftell(f);
+    assert(len > 0);
+    rewind(f);
+    buf = malloc(len + 1);
+    assert(buf != NULL);
+    assert(len == (long)fread(buf, 1, len, f));
+    buf[len] = '\0';
+    fclose(f);
+    assert(!strncmp(buf, "{\"snapshot\":{\"meta\":", 20));
+    /* the class name, the property names and the string content */
+    assert(strstr(buf, "\n\"Foo\""));
+    assert(strstr(buf, "\n\"s\""));
+    assert(strstr(buf, "\n\"self\""));
+    assert(strstr(buf, "\n\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab\""));
+    /* unpaired surrogates are escaped to keep the output valid UTF-8 */
+    assert(strstr(buf, "\n\"x\\ud800yx\\ud800y\""));
+    assert(!memchr(buf, 0xed, len));
+    assert(buf[len - 2] == '}');
+    free(buf);
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+static int object_class_id(JSContext *ctx, const char *code)
+{
+    JSValue obj = eval(ctx, code);
+    int class_id;
+
+    assert(JS_IsObject(obj));
+    class_id = JS_GetClassID(obj);
+    JS_FreeValue(ctx, obj);
+    return class_id;
+}
+
+static void object_memory_usage(void)
+{
+    JSObjectMemoryUsage *all, *tab1, *tab2;
+    JSMemoryUsage stats;
+    JSContext *ctx;
+    int n, obj_id, map_id, buf_id;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx1 = JS_NewContext(rt);
+    JSContext *ctx2 = JS_NewContext(rt);
+    map_id = object_class_id(ctx1, "globalThis.a = [];"
+                                   "for (let i = 0; i < 100; i++) a.push(new Map([[i, {}]]));"
+                                   "a[0]");
+    buf_id = object_class_id(ctx2, "globalThis.b = new ArrayBuffer(1 << 20); b");
+    obj_id = object_class_id(ctx2, "({})");
+    JS_FreeValue(ctx2, eval(ctx2, "Promise.resolve().then(() => {})"));
+    n = JS_ComputeObjectMemoryUsage(rt, NULL, NULL, 0);
+    assert(n > map_id && n > buf_id);
+    all = calloc(n, sizeof(*all));
+    tab1 = calloc(n, sizeof(*tab1));
+    tab2 = calloc(n, sizeof(*tab2));
+    assert(all && tab1 && tab2);
+    assert(n == JS_ComputeObjectMemoryUsage(rt, NULL, all, n));
+    assert(n == JS_ComputeObjectMemoryUsage(rt, ctx1, tab1, n));
+    assert(n == JS_ComputeObjectMemoryUsage(rt, ctx2, tab2, n));
+    assert(tab1[map_id].count == 100);
+    assert(tab2[map_id].count == 0);
+    assert(all[map_id].count == 100);
+    assert(tab2[buf_id].count == 1);
+    assert(tab2[buf_id].size > 1 << 20);
+    assert(tab1[buf_id].size == 0);
+    /* the {} values are ordinary objects of ctx1 */
+    assert(tab1[obj_id].count >= 100 + tab2[obj_id].count);
+    assert(all[obj_id].count >= tab1[obj_id].count + tab2[obj_id].count);
+    free(all);
+    free(tab1);
+    free(tab2);
+
+    JS_ComputeMemoryUsage(rt, &stats);
+    assert(stats.shape_hash_size > 0);
+    assert(stats.atom_hash_size > 0);
+    assert(stats.atom_size > stats.atom_hash_size);
+    assert(stats.job_count == 1);
+    assert(stats.job_queue_size > 0);
+    assert(stats.fast_array_unused_size > 0);
+    assert(JS_ExecutePendingJob(rt, &ctx) == 1);
+    assert(ctx == ctx2);
+    JS_FreeContext(ctx1);
+    JS_FreeContext(ctx2);
+    JS_FreeRuntime(rt);
+}
+
+static int64_t object_count(JSRuntime *rt, int class_id)
+{
+    JSObjectMemoryUsage tab[256];
+
+    assert(class_id < 256);
+    JS_ComputeObjectMemoryUsage(rt, NULL, tab, 256);
+    return tab[class_id].count;
+}
+
+static void map_direct_enum(void)
+{
+    JSValue ret;
+    int iter_id;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    iter_id = object_class_id(ctx, "new Map().entries()");
+    /* the first loop instantiates the 'next' method */
+    ret = eval(ctx, "var m = new Map([[1, 1], [2, 2]]);"
+                    "for (const x of m);"
+                    "var p = new Promise(() => {});"
+                    "async function f() { for (const x of m) await p; }"
+                    "f();");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    /* the suspended for-of loop enumerates the Map without iterator */
+    assert(object_count(rt, iter_id) == 0);
+    /* a nested enumeration uses an iterator */
+    JS_FreeValue(ctx, eval(ctx, "f();"));
+    assert(object_count(rt, iter_id) == 1);
+    /* freeing the suspended async functions ends the enumerations */
+    JS_FreeValue(ctx, eval(ctx, "p = null;"));
+    JS_RunGC(rt);
+    assert(object_count(rt, iter_id) == 0);
+    JS_FreeValue(ctx, eval(ctx, "p = new Promise(() => {}); f();"));
+    assert(object_count(rt, iter_id) == 0);
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+/* an uncatchable error does not close the enumerations of the frame */
+static void map_direct_enum_interrupt(void)
+{
+    JSValue ret;
+    int iter_id, time;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    iter_id = object_class_id(ctx, "new Map().entries()");
+    ret = eval(ctx, "var m = new Map([[1, 1], [2, 2]]);"
+                    "for (const x of m);");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    time = 0;
+    JS_SetInterruptHandler(rt, timeout_interrupt_handler, &time);
+    ret = eval(ctx, "for (const x of m) { while (true) {} }");
+    assert(JS_IsException(ret));
+    ret = JS_GetException(ctx);
+    assert(JS_IsUncatchableError(ret));
+    JS_FreeValue(ctx, ret);
+    JS_SetInterruptHandler(rt, NULL, NULL);
+    /* the next loop still enumerates the Map without iterator */
+    ret = eval(ctx, "var p = new Promise(() => {});"
+                    "async function f() { for (const x of m) await p; }"
+                    "f();");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    assert(object_count(rt, iter_id) == 0);
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+static void object_template_shape(void)
+{
+    JSMemoryUsage stats;
+    int64_t shape_count;
+    JSValue ret;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    ret = eval(ctx, "var a = [], i, o;"
+                    "function f(i) { return { x: i, y: 2, z: 3 }; }"
+                    "a.push(f(0));");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    /* free the shapes of the garbage left by the compilation */
+    JS_RunGC(rt);
+    JS_ComputeMemoryUsage(rt, &stats);
+    shape_count = stats.shape_count;
+    /* the objects created from the template share its shape, which is
+       also the one of an object built by adding the same properties */
+    ret = eval(ctx, "for (i = 1; i < 1000; i++) a.push(f(i));"
+                    "o = {}; o.x = 1000; o.y = 2; o.z = 3; a.push(o);");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    JS_RunGC(rt);
+    JS_ComputeMemoryUsage(rt, &stats);
+    assert(stats.shape_count == shape_count);
+    ret = eval(ctx, "a.every((o, i) => Object.keys(o).join() == 'x,y,z' &&"
+                    "                  o.x === i && o.y === 2 && o.z === 3)");
+    assert(JS_IsBool(ret) && JS_ToBool(ctx, ret));
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+static void eval_cache_gc(void)
+{
+    JSMemoryUsage stats;
+    JSValue ret;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    JS_SetGCThreshold(rt, 256 * 1024);
+    /* the cycles are only freed by the automatic collections */
+    ret = eval(ctx, "var geval = eval;"
+                    "for (var i = 0; i < 1000; i++) {"
+                    "    var a = { data: new Array(1000).fill(i) }; a.self = a;"
+                    "    geval('1 + 1');"
+                    "}");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    JS_ComputeMemoryUsage(rt, &stats);
+    assert(stats.malloc_size < 8 * 1024 * 1024);
+    /* the cache survives them */
+    assert(stats.eval_cache_miss_count == 1);
+    assert(stats.eval_cache_hit_count == 999);
+    assert(stats.eval_cache_count == 1);
+    /* but not an explicit collection */
+    JS_RunGC(rt);
+    JS_ComputeMemoryUsage(rt, &stats);
+    assert(stats.eval_cache_count == 0);
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+static void frame_reuse(void)
+{
+    JSContext *ctx1;
+    JSValue ret;
+    char buf[64];
+    int i, v;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    /* functions with n local variables which check that they are
+       undefined on entry and keep their value across a suspension.
+       The largest frames exceed the cached size classes. */
+    ret = eval(ctx, "var GeneratorFunction = Object.getPrototypeOf(function *() {}).constructor;"
+                    "var AsyncFunction = Object.getPrototypeOf(async function () {}).constructor;"
+                    "var bad = 0, done = 0;"
+                    "function make(ctor, n, suspend) {"
+                    "    var names = [];"
+                    "    for (var i = 0; i < n; i++) names.push('v' + i);"
+                    "    var list = '[' + names.join(',') + ']';"
+                    "    return new ctor('tag', 'var ' + names.join(',') + ';'"
+                    "        + 'if (!' + list + '.every(v => v === undefined)) bad++;'"
+                    "        + names.map(v => v + ' = tag;').join('')"
+                    "        + suspend + ';'"
+                    "        + 'if (!' + list + '.every(v => v === tag)) bad++;'"
+                    "        + 'done++;');"
+                    "}"
+                    "var sizes = [1, 10, 30, 100, 500, 1000, 1100];"
+                    "var gens = sizes.map(n => make(GeneratorFunction, n, 'yield'));"
+                    "var asyncs = sizes.map(n => make(AsyncFunction, n, 'await null'));"
+                    "function step(round) {"
+                    "    var live = [];"
+                    "    for (var i = 0; i < sizes.length; i++) {"
+                    "        var g = gens[i]('g' + round + '_' + i);"
+                    "        g.next();"
+                    "        live.push(g);"
+                    "        asyncs[sizes.length - 1 - i]('a' + round + '_' + i);"
+                    "    }"
+                    "    /* complete one generator out of two and free the others"
+                    "       while they are suspended */"
+                    "    live.forEach((g, i) => { if (i & 1) g.next(); });"
+                    "}");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    for (i = 0; i < 6; i++) {
+        snprintf(buf, sizeof(buf), "step(%d)", i);
+        ret = eval(ctx, buf);
+        assert(!JS_IsException(ret));
+        JS_FreeValue(ctx, ret);
+        /* the async functions of two steps are suspended together */
+        if (i & 1)
+            assert(JS_ExecutePendingJobs(rt, -1, -1, &ctx1) >= 0);
+    }
+    ret = eval(ctx, "bad");
+    assert(0 == JS_ToInt32(ctx, &v, ret));
+    assert(v == 0);
+    ret = eval(ctx, "done");
+    assert(0 == JS_ToInt32(ctx, &v, ret));
+    assert(v == 6 * (3 + 7));
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
+/* memory used by 1000 suspended generators with 'n' local variables */
+static int64_t suspended_generators_size(int n)
+{
+    JSMemoryUsage stats;
+    JSValue ret;
+    char buf[256];
+    int64_t size;
+
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    snprintf(buf, sizeof(buf),
+             "var names = [];"
+             "for (var i = 0; i < %d; i++) names.push('v' + i);"
+             "var g = new (Object.getPrototypeOf(function *() {}).constructor)("
+             "    'var ' + names.join(',') + '; yield;');"
+             "var live = [];", n);
+    ret = eval(ctx, buf);
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    JS_RunGC(rt);
+    JS_ComputeMemoryUsage(rt, &stats);
+    size = stats.malloc_size;
+    ret = eval(ctx, "for (var i = 0; i < 1000; i++) {"
+                    "    var it = g(); it.next(); live.push(it);"
+                    "}");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    JS_RunGC(rt);
+    JS_ComputeMemoryUsage(rt, &stats);
+    size = stats.malloc_size - size;
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+    return size;
+}
+
+static void suspended_frame_size(void)
+{
+    int64_t size40, size60;
+
+    /* the frames are not rounded up to a power of two number of values:
+       20 more variables take about 20 more values per generator */
+    size40 = suspended_generators_size(40);
+    size60 = suspended_generators_size(60);
+    assert(size60 - size40 > 1000 * 15 * sizeof(JSValue));
+    assert(size60 - size40 < 1000 * 25 * sizeof(JSValue));
+}
+
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+static void dump_exec_counters(JSRuntime *rt, char *buf, size_t size)
+{
+    size_t len;
+    FILE *f;
+
+    f = tmpfile();
+    assert(f != NULL);
+    assert(0 == JS_DumpExecCounters(rt, f));
+    rewind(f);
+    len = fread(buf, 1, size - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+}
+#endif
+
+static void exec_counters(void)
+{
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    char buf[4096];
+
+    assert(0 == JS_ResetExecCounters(rt));
+    JSValue ret = eval(ctx, "function f(n) { return n < 2 ? n : f(n - 1) + f(n - 2); }"
+                            "f(5);");
+    assert(!JS_IsException(ret));
+    JS_FreeValue(ctx, ret);
+    dump_exec_counters(rt, buf, sizeof(buf));
+    assert(strstr(buf, "  call1\n"));
+    assert(strstr(buf, "           15  f (<input>:1:1)\n"));
+    /* the counters outlive the functions */
+    JS_FreeContext(ctx);
+    ctx = JS_NewContext(rt);
+    dump_exec_counters(rt, buf, sizeof(buf));
+    assert(strstr(buf, "           15  f (<input>:1:1)\n"));
+    assert(0 == JS_ResetExecCounters(rt));
+    dump_exec_counters(rt, buf, sizeof(buf));
+    assert(!strstr(buf, "call1"));
+    assert(!strstr(buf, " f (<input>:1:1)"));
+#else
+    assert(-1 == JS_ResetExecCounters(rt));
+    assert(-1 == JS_DumpExecCounters(rt, stdout));
+#endif
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+}
+
 int main(void)
 {
     cfunctions();
@@ -914,6 +1622,7 @@ int main(void)
     raw_context_global_var();
     is_array();
     module_serde();
+    lazy_function_serde();
     runtime_cstring_free();
     utf16_string();
     weak_map_gc_check();
@@ -923,5 +1632,18 @@ int main(void)
     global_object_prototype();
     slice_string_tocstring();
     immutable_array_buffer();
+    pending_jobs();
+    cpu_profiler();
+    alloc_profiler();
+    tracing();
+    exec_counters();
+    heap_snapshot();
+    object_memory_usage();
+    map_direct_enum();
+    map_direct_enum_interrupt();
+    object_template_shape();
+    eval_cache_gc();
+    frame_reuse();
+    suspended_frame_size();
     return 0;
 }
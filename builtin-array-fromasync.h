@@ -1,118 +0,0 @@
-/* File generated automatically by the QuickJS-ng compiler. */
-
-#include <inttypes.h>
-
-const uint32_t qjsc_builtin_array_fromasync_size = 871;
-
-const uint8_t qjsc_builtin_array_fromasync[871] = {
- 0x17, 0x0e, 0x01, 0x28, 0x53, 0x79, 0x6d, 0x62,
- 0x6f, 0x6c, 0xb7, 0x61, 0x73, 0x79, 0x6e, 0x63,
- 0x49, 0x74, 0x65, 0x72, 0x61, 0x74, 0x6f, 0x72,
- 0x01, 0x2a, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74,
- 0xb7, 0x64, 0x65, 0x66, 0x69, 0x6e, 0x65, 0x50,
- 0x72, 0x6f, 0x70, 0x65, 0x72, 0x74, 0x79, 0x01,
- 0x1e, 0x53, 0x79, 0x6d, 0x62, 0x6f, 0x6c, 0xb7,
- 0x69, 0x74, 0x65, 0x72, 0x61, 0x74, 0x6f, 0x72,
- 0x01, 0x12, 0x61, 0x72, 0x72, 0x61, 0x79, 0x4c,
- 0x69, 0x6b, 0x65, 0x01, 0x0a, 0x6d, 0x61, 0x70,
- 0x46, 0x6e, 0x01, 0x0e, 0x74, 0x68, 0x69, 0x73,
- 0x41, 0x72, 0x67, 0x01, 0x0c, 0x72, 0x65, 0x73,
- 0x75, 0x6c, 0x74, 0x01, 0x02, 0x69, 0x01, 0x1a,
- 0x69, 0x73, 0x43, 0x6f, 0x6e, 0x73, 0x74, 0x72,
- 0x75, 0x63, 0x74, 0x6f, 0x72, 0x01, 0x08, 0x73,
- 0x79, 0x6e, 0x63, 0x01, 0x0c, 0x6d, 0x65, 0x74,
- 0x68, 0x6f, 0x64, 0x01, 0x08, 0x69, 0x74, 0x65,
- 0x72, 0x01, 0x1c, 0x6e, 0x6f, 0x74, 0x20, 0x61,
- 0x20, 0x66, 0x75, 0x6e, 0x63, 0x74, 0x69, 0x6f,
- 0x6e, 0x01, 0x08, 0x63, 0x61, 0x6c, 0x6c, 0x0c,
- 0x00, 0x02, 0x00, 0xa2, 0x01, 0x00, 0x01, 0x00,
- 0x01, 0x00, 0x00, 0x01, 0x04, 0x01, 0xa4, 0x01,
- 0x00, 0x00, 0x00, 0x0c, 0x43, 0x02, 0x01, 0x00,
- 0x05, 0x00, 0x05, 0x01, 0x05, 0x00, 0x01, 0x03,
- 0x05, 0xae, 0x02, 0x00, 0x01, 0x40, 0x03, 0xa4,
- 0x03, 0x00, 0x01, 0x40, 0x00, 0xca, 0x03, 0x00,
- 0x01, 0x40, 0x01, 0xcc, 0x03, 0x00, 0x01, 0x40,
- 0x04, 0xce, 0x03, 0x00, 0x01, 0x40, 0x02, 0x0c,
- 0x60, 0x02, 0x01, 0xf8, 0x01, 0x03, 0x0e, 0x01,
- 0x06, 0x00, 0x05, 0x00, 0x86, 0x04, 0x11, 0xd0,
- 0x03, 0x00, 0x01, 0x00, 0xd2, 0x03, 0x00, 0x01,
- 0x00, 0xd4, 0x03, 0x00, 0x01, 0x00, 0xd0, 0x03,
- 0x01, 0xff, 0xff, 0xff, 0xff, 0x0f, 0x20, 0xd2,
- 0x03, 0x01, 0x01, 0x20, 0xd4, 0x03, 0x01, 0x02,
- 0x20, 0xd6, 0x03, 0x02, 0x00, 0x20, 0xd8, 0x03,
- 0x02, 0x04, 0x20, 0xda, 0x03, 0x02, 0x05, 0x20,
- 0xdc, 0x03, 0x02, 0x06, 0x20, 0xde, 0x03, 0x02,
- 0x07, 0x20, 0x64, 0x06, 0x08, 0x20, 0x82, 0x01,
- 0x07, 0x09, 0x20, 0xe0, 0x03, 0x0a, 0x08, 0x30,
- 0x82, 0x01, 0x0d, 0x0b, 0x20, 0xd4, 0x01, 0x0d,
- 0x0c, 0x20, 0x10, 0x00, 0x01, 0x00, 0xa4, 0x03,
- 0x01, 0x01, 0xca, 0x03, 0x02, 0x01, 0xce, 0x03,
- 0x04, 0x01, 0xae, 0x02, 0x00, 0x01, 0xcc, 0x03,
- 0x03, 0x01, 0x08, 0xc2, 0x0d, 0x60, 0x02, 0x00,
- 0x60, 0x01, 0x00, 0x60, 0x00, 0x00, 0xd1, 0xc9,
- 0xd2, 0x11, 0xf2, 0xea, 0x08, 0x0e, 0x38, 0x46,
- 0x00, 0x00, 0x00, 0xda, 0xca, 0xd3, 0x11, 0xf2,
- 0xea, 0x08, 0x0e, 0x38, 0x46, 0x00, 0x00, 0x00,
- 0xdb, 0xcb, 0x60, 0x07, 0x00, 0x60, 0x06, 0x00,
- 0x60, 0x05, 0x00, 0x60, 0x04, 0x00, 0x60, 0x03,
- 0x00, 0xd2, 0x38, 0x46, 0x00, 0x00, 0x00, 0xae,
- 0xea, 0x16, 0xd2, 0x96, 0x04, 0x1b, 0x00, 0x00,
- 0x00, 0xae, 0xea, 0x0c, 0xdd, 0x11, 0x04, 0xf1,
- 0x00, 0x00, 0x00, 0x21, 0x01, 0x00, 0x30, 0x06,
- 0xcc, 0xb4, 0xc2, 0x04, 0xc1, 0x0d, 0xf5, 0xc2,
- 0x05, 0x09, 0xc2, 0x06, 0xd1, 0xde, 0x46, 0xc2,
- 0x07, 0x61, 0x07, 0x00, 0x07, 0xab, 0xea, 0x0f,
- 0x0a, 0x11, 0x62, 0x06, 0x00, 0x0e, 0xd1, 0xdf,
- 0x46, 0x11, 0x62, 0x07, 0x00, 0x0e, 0x61, 0x07,
- 0x00, 0x07, 0xab, 0x68, 0xa6, 0x00, 0x00, 0x00,
- 0x60, 0x08, 0x00, 0x06, 0x11, 0xf2, 0xeb, 0x0c,
- 0x6f, 0x41, 0x32, 0x00, 0x00, 0x00, 0xc2, 0x08,
- 0x0e, 0xec, 0x05, 0x0e, 0xd1, 0xec, 0xf2, 0x61,
- 0x08, 0x00, 0x8c, 0x11, 0xeb, 0x03, 0x0e, 0xb4,
- 0x11, 0x62, 0x08, 0x00, 0x0e, 0x61, 0x05, 0x00,
- 0xea, 0x0c, 0xc1, 0x0d, 0x11, 0x61, 0x08, 0x00,
- 0x21, 0x01, 0x00, 0xec, 0x06, 0xe0, 0x61, 0x08,
- 0x00, 0xef, 0x11, 0x62, 0x03, 0x00, 0x0e, 0x61,
- 0x04, 0x00, 0x61, 0x08, 0x00, 0xa5, 0x68, 0x2a,
- 0x01, 0x00, 0x00, 0x60, 0x09, 0x00, 0xd1, 0x61,
- 0x04, 0x00, 0x46, 0xc2, 0x09, 0x61, 0x06, 0x00,
- 0xea, 0x0a, 0x61, 0x09, 0x00, 0x8a, 0x11, 0x62,
- 0x09, 0x00, 0x0e, 0xd2, 0xea, 0x17, 0xd2, 0x41,
- 0xf2, 0x00, 0x00, 0x00, 0xd3, 0x61, 0x09, 0x00,
- 0x61, 0x04, 0x00, 0x24, 0x03, 0x00, 0x8a, 0x11,
- 0x62, 0x09, 0x00, 0x0e, 0x5d, 0x04, 0x00, 0x61,
- 0x03, 0x00, 0x61, 0x04, 0x00, 0x90, 0x62, 0x04,
- 0x00, 0x0b, 0x61, 0x09, 0x00, 0x4b, 0x41, 0x00,
- 0x00, 0x00, 0x0a, 0x4b, 0x3e, 0x00, 0x00, 0x00,
- 0x0a, 0x4b, 0x3f, 0x00, 0x00, 0x00, 0xf1, 0x0e,
- 0xec, 0x9e, 0x60, 0x0a, 0x00, 0x61, 0x07, 0x00,
- 0x41, 0xf2, 0x00, 0x00, 0x00, 0xd1, 0x24, 0x01,
- 0x00, 0xc2, 0x0a, 0x61, 0x05, 0x00, 0xea, 0x09,
- 0xc1, 0x0d, 0x11, 0x21, 0x00, 0x00, 0xec, 0x03,
- 0xe0, 0xee, 0x11, 0x62, 0x03, 0x00, 0x0e, 0x6b,
- 0x8c, 0x00, 0x00, 0x00, 0x60, 0x0c, 0x00, 0x60,
- 0x0b, 0x00, 0x06, 0x11, 0xf2, 0xeb, 0x13, 0x6f,
- 0x41, 0x41, 0x00, 0x00, 0x00, 0xc2, 0x0b, 0x41,
- 0x6a, 0x00, 0x00, 0x00, 0xc2, 0x0c, 0x0e, 0xec,
- 0x10, 0x0e, 0x61, 0x0a, 0x00, 0x41, 0x6b, 0x00,
- 0x00, 0x00, 0x24, 0x00, 0x00, 0x8a, 0xec, 0xe0,
- 0x61, 0x0c, 0x00, 0xeb, 0x4e, 0x61, 0x06, 0x00,
- 0xea, 0x0a, 0x61, 0x0b, 0x00, 0x8a, 0x11, 0x62,
- 0x0b, 0x00, 0x0e, 0xd2, 0xea, 0x17, 0xd2, 0x41,
- 0xf2, 0x00, 0x00, 0x00, 0xd3, 0x61, 0x0b, 0x00,
- 0x61, 0x04, 0x00, 0x24, 0x03, 0x00, 0x8a, 0x11,
- 0x62, 0x0b, 0x00, 0x0e, 0x5d, 0x04, 0x00, 0x61,
- 0x03, 0x00, 0x61, 0x04, 0x00, 0x90, 0x62, 0x04,
- 0x00, 0x0b, 0x61, 0x0b, 0x00, 0x4b, 0x41, 0x00,
- 0x00, 0x00, 0x0a, 0x4b, 0x3e, 0x00, 0x00, 0x00,
- 0x0a, 0x4b, 0x3f, 0x00, 0x00, 0x00, 0xf1, 0x0e,
- 0xec, 0x83, 0x0e, 0x06, 0x6c, 0x0d, 0x00, 0x00,
- 0x00, 0x0e, 0xec, 0x1e, 0x6c, 0x05, 0x00, 0x00,
- 0x00, 0x30, 0x61, 0x0a, 0x00, 0x40, 0x06, 0x00,
- 0x00, 0x00, 0xea, 0x0d, 0x61, 0x0a, 0x00, 0x41,
- 0x06, 0x00, 0x00, 0x00, 0x24, 0x00, 0x00, 0x0e,
- 0x6d, 0x61, 0x03, 0x00, 0x61, 0x04, 0x00, 0x42,
- 0x32, 0x00, 0x00, 0x00, 0x61, 0x03, 0x00, 0x2f,
- 0xbf, 0x00, 0x28, 0xbf, 0x00, 0xcd, 0x28,
-};
-
@@ -1,332 +0,0 @@
-/* File generated automatically by the QuickJS-ng compiler. */
-
-#include <inttypes.h>
-
-const uint32_t qjsc_builtin_iterator_zip_keyed_size = 2578;
-
-const uint8_t qjsc_builtin_iterator_zip_keyed[2578] = {
- 0x17, 0x2b, 0x01, 0x1c, 0x49, 0x74, 0x65, 0x72,
- 0x61, 0x74, 0x6f, 0x72, 0x48, 0x65, 0x6c, 0x70,
- 0x65, 0x72, 0x01, 0x08, 0x63, 0x61, 0x6c, 0x6c,
- 0x01, 0x24, 0x68, 0x61, 0x73, 0x4f, 0x77, 0x6e,
- 0x45, 0x6e, 0x75, 0x6d, 0x50, 0x72, 0x6f, 0x70,
- 0x65, 0x72, 0x74, 0x79, 0x01, 0x24, 0x67, 0x65,
- 0x74, 0x4f, 0x77, 0x6e, 0x50, 0x72, 0x6f, 0x70,
- 0x65, 0x72, 0x74, 0x79, 0x4b, 0x65, 0x79, 0x73,
- 0x01, 0x1e, 0x53, 0x79, 0x6d, 0x62, 0x6f, 0x6c,
- 0xb7, 0x69, 0x74, 0x65, 0x72, 0x61, 0x74, 0x6f,
- 0x72, 0x01, 0x0a, 0x63, 0x68, 0x65, 0x63, 0x6b,
- 0x01, 0x0a, 0x63, 0x6c, 0x6f, 0x73, 0x65, 0x01,
- 0x10, 0x63, 0x6c, 0x6f, 0x73, 0x65, 0x61, 0x6c,
- 0x6c, 0x01, 0x02, 0x76, 0x01, 0x02, 0x73, 0x01,
- 0x08, 0x69, 0x74, 0x65, 0x72, 0x01, 0x0c, 0x6d,
- 0x65, 0x74, 0x68, 0x6f, 0x64, 0x01, 0x02, 0x65,
- 0x01, 0x0a, 0x69, 0x74, 0x65, 0x72, 0x73, 0x01,
- 0x0a, 0x63, 0x6f, 0x75, 0x6e, 0x74, 0x01, 0x04,
- 0x65, 0x78, 0x01, 0x02, 0x69, 0x01, 0x12, 0x69,
- 0x74, 0x65, 0x72, 0x61, 0x62, 0x6c, 0x65, 0x73,
- 0x01, 0x0e, 0x6f, 0x70, 0x74, 0x69, 0x6f, 0x6e,
- 0x73, 0x01, 0x08, 0x6d, 0x6f, 0x64, 0x65, 0x01,
- 0x0e, 0x70, 0x61, 0x64, 0x64, 0x69, 0x6e, 0x67,
- 0x01, 0x0a, 0x6e, 0x65, 0x78, 0x74, 0x73, 0x01,
- 0x08, 0x70, 0x61, 0x64, 0x73, 0x01, 0x06, 0x6b,
- 0x65, 0x79, 0x01, 0x06, 0x64, 0x65, 0x6c, 0x01,
- 0x02, 0x6a, 0x01, 0x0a, 0x73, 0x74, 0x61, 0x74,
- 0x65, 0x01, 0x0a, 0x61, 0x6c, 0x69, 0x76, 0x65,
- 0x01, 0x0a, 0x64, 0x6f, 0x6e, 0x65, 0x73, 0x01,
- 0x0e, 0x72, 0x65, 0x73, 0x75, 0x6c, 0x74, 0x73,
- 0x01, 0x0c, 0x72, 0x65, 0x73, 0x75, 0x6c, 0x74,
- 0x01, 0x1c, 0x72, 0x75, 0x6e, 0x6e, 0x69, 0x6e,
- 0x67, 0x20, 0x7a, 0x69, 0x70, 0x70, 0x65, 0x72,
- 0x01, 0x06, 0x62, 0x75, 0x67, 0x01, 0x0e, 0x6c,
- 0x6f, 0x6e, 0x67, 0x65, 0x73, 0x74, 0x01, 0x0c,
- 0x73, 0x74, 0x72, 0x69, 0x63, 0x74, 0x01, 0x22,
- 0x6d, 0x69, 0x73, 0x6d, 0x61, 0x74, 0x63, 0x68,
- 0x65, 0x64, 0x20, 0x69, 0x6e, 0x70, 0x75, 0x74,
- 0x73, 0x01, 0x10, 0x73, 0x68, 0x6f, 0x72, 0x74,
- 0x65, 0x73, 0x74, 0x01, 0x16, 0x62, 0x75, 0x67,
- 0x3a, 0x20, 0x73, 0x74, 0x61, 0x74, 0x65, 0x3d,
- 0x01, 0x1a, 0x62, 0x61, 0x64, 0x20, 0x69, 0x74,
- 0x65, 0x72, 0x61, 0x62, 0x6c, 0x65, 0x73, 0x01,
- 0x16, 0x62, 0x61, 0x64, 0x20, 0x6f, 0x70, 0x74,
- 0x69, 0x6f, 0x6e, 0x73, 0x01, 0x10, 0x62, 0x61,
- 0x64, 0x20, 0x6d, 0x6f, 0x64, 0x65, 0x01, 0x16,
- 0x62, 0x61, 0x64, 0x20, 0x70, 0x61, 0x64, 0x64,
- 0x69, 0x6e, 0x67, 0x01, 0x18, 0x62, 0x61, 0x64,
- 0x20, 0x69, 0x74, 0x65, 0x72, 0x61, 0x74, 0x6f,
- 0x72, 0x0c, 0x00, 0x02, 0x00, 0xa2, 0x01, 0x00,
- 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x04, 0x01,
- 0xa4, 0x01, 0x00, 0x00, 0x00, 0x0c, 0x43, 0x02,
- 0x00, 0x00, 0x07, 0x03, 0x07, 0x01, 0x0a, 0x00,
- 0x04, 0x0c, 0x0a, 0xca, 0x03, 0x00, 0x01, 0x40,
- 0x09, 0xa8, 0x03, 0x00, 0x01, 0x40, 0x03, 0xa4,
- 0x03, 0x00, 0x01, 0x40, 0x00, 0xcc, 0x03, 0x00,
- 0x01, 0x40, 0x01, 0xce, 0x03, 0x00, 0x01, 0x40,
- 0x07, 0xd0, 0x03, 0x00, 0x01, 0x40, 0x06, 0xd2,
- 0x03, 0x00, 0x01, 0x40, 0x08, 0xd4, 0x03, 0x00,
- 0x00, 0x40, 0x05, 0xd6, 0x03, 0x00, 0x01, 0x40,
- 0x02, 0xd8, 0x03, 0x00, 0x02, 0x40, 0x04, 0x0c,
- 0x43, 0x02, 0x00, 0xd4, 0x03, 0x02, 0x00, 0x02,
- 0x03, 0x00, 0x01, 0x00, 0x17, 0x02, 0xda, 0x03,
- 0x00, 0x01, 0x00, 0xdc, 0x03, 0x00, 0x01, 0x00,
- 0xa4, 0x03, 0x02, 0x01, 0xd1, 0x96, 0x04, 0x4a,
- 0x00, 0x00, 0x00, 0xad, 0xea, 0x07, 0xd1, 0x07,
- 0xae, 0xea, 0x02, 0x29, 0xdd, 0x11, 0xd2, 0x21,
- 0x01, 0x00, 0x30, 0x0c, 0x43, 0x02, 0x00, 0xd6,
- 0x03, 0x01, 0x02, 0x01, 0x04, 0x00, 0x01, 0x00,
- 0x2e, 0x03, 0xde, 0x03, 0x00, 0x01, 0x00, 0xe0,
- 0x03, 0x02, 0x00, 0x20, 0xe2, 0x03, 0x05, 0x00,
- 0x03, 0xcc, 0x03, 0x03, 0x01, 0x6b, 0x23, 0x00,
- 0x00, 0x00, 0x60, 0x00, 0x00, 0xd1, 0x95, 0xea,
- 0x04, 0x06, 0x6e, 0x28, 0xd1, 0x40, 0x06, 0x00,
- 0x00, 0x00, 0xc9, 0x61, 0x00, 0x00, 0xea, 0x08,
- 0xdd, 0xd1, 0x61, 0x00, 0x00, 0xf0, 0x0e, 0x0e,
- 0x29, 0xca, 0x6b, 0x07, 0x00, 0x00, 0x00, 0xc6,
- 0x6e, 0x28, 0x30, 0x0c, 0x43, 0x02, 0x00, 0xd8,
- 0x03, 0x02, 0x04, 0x02, 0x03, 0x00, 0x01, 0x00,
- 0x55, 0x06, 0xe4, 0x03, 0x00, 0x01, 0x00, 0xe6,
- 0x03, 0x00, 0x01, 0x00, 0xe8, 0x03, 0x01, 0x00,
- 0x20, 0xea, 0x03, 0x02, 0x01, 0x20, 0xde, 0x03,
- 0x03, 0x02, 0x20, 0xe2, 0x03, 0x03, 0x03, 0x20,
- 0xd6, 0x03, 0x01, 0x00, 0x60, 0x00, 0x00, 0x38,
- 0x46, 0x00, 0x00, 0x00, 0xc9, 0x60, 0x01, 0x00,
- 0xd2, 0xca, 0x61, 0x01, 0x00, 0x8f, 0x62, 0x01,
- 0x00, 0xb4, 0xa7, 0xea, 0x39, 0x60, 0x03, 0x00,
- 0x60, 0x02, 0x00, 0xd1, 0x61, 0x01, 0x00, 0x46,
- 0xcb, 0xd1, 0x61, 0x01, 0x00, 0x1b, 0x11, 0xaf,
- 0xeb, 0x04, 0x1b, 0x70, 0x1b, 0x1b, 0x38, 0x46,
- 0x00, 0x00, 0x00, 0x1b, 0x70, 0x1b, 0x48, 0xdd,
- 0x61, 0x02, 0x00, 0xef, 0xcc, 0x61, 0x00, 0x00,
- 0x95, 0xea, 0xc8, 0x61, 0x03, 0x00, 0x11, 0x62,
- 0x00, 0x00, 0x0e, 0xec, 0xbe, 0x61, 0x00, 0x00,
- 0x28, 0x0c, 0x41, 0x02, 0x00, 0xaa, 0x02, 0x02,
- 0x15, 0x01, 0x06, 0x08, 0x09, 0x02, 0xc9, 0x05,
- 0x17, 0xec, 0x03, 0x00, 0x01, 0x00, 0xee, 0x03,
- 0x00, 0x01, 0x00, 0xec, 0x03, 0x01, 0xff, 0xff,
- 0xff, 0xff, 0x0f, 0x20, 0xee, 0x03, 0x01, 0x01,
- 0x20, 0xf0, 0x03, 0x02, 0x00, 0x60, 0x04, 0xf2,
- 0x03, 0x02, 0x03, 0x20, 0x60, 0x02, 0x04, 0x60,
- 0x02, 0xe6, 0x03, 0x02, 0x05, 0x60, 0x01, 0xe4,
- 0x03, 0x02, 0x06, 0x60, 0x03, 0xf4, 0x03, 0x02,
- 0x07, 0x60, 0x06, 0xf6, 0x03, 0x02, 0x08, 0x60,
- 0x05, 0xf8, 0x03, 0x09, 0x15, 0x20, 0xea, 0x03,
- 0x0b, 0x15, 0x20, 0xfa, 0x03, 0x0c, 0x0b, 0x20,
- 0xf8, 0x03, 0x0c, 0x0c, 0x20, 0xde, 0x03, 0x0e,
- 0x0d, 0x20, 0xe0, 0x03, 0x10, 0x0e, 0x20, 0xfc,
- 0x03, 0x14, 0x0d, 0x20, 0xea, 0x03, 0x19, 0x15,
- 0x20, 0xea, 0x03, 0x1b, 0x15, 0x20, 0xe2, 0x03,
- 0x1c, 0x15, 0x03, 0xfe, 0x03, 0x02, 0x09, 0x60,
- 0x00, 0x80, 0x04, 0x02, 0x14, 0x60, 0x07, 0xa4,
- 0x03, 0x02, 0x01, 0xa8, 0x03, 0x01, 0x01, 0xcc,
- 0x03, 0x03, 0x01, 0xd8, 0x03, 0x02, 0x00, 0xd4,
- 0x03, 0x00, 0x00, 0xd0, 0x03, 0x05, 0x01, 0xce,
- 0x03, 0x04, 0x01, 0xd2, 0x03, 0x06, 0x01, 0xca,
- 0x03, 0x00, 0x01, 0x0c, 0x42, 0x03, 0x00, 0x00,
- 0x00, 0x09, 0x00, 0x05, 0x00, 0x0c, 0x00, 0xf7,
- 0x04, 0x09, 0x82, 0x04, 0x01, 0x00, 0x20, 0xd8,
- 0x01, 0x01, 0x01, 0x20, 0x84, 0x04, 0x01, 0x02,
- 0x20, 0xea, 0x03, 0x03, 0x03, 0x20, 0xf8, 0x03,
- 0x04, 0x04, 0x20, 0xde, 0x03, 0x04, 0x05, 0x20,
- 0x86, 0x04, 0x04, 0x06, 0x20, 0xe2, 0x03, 0x09,
- 0x07, 0x03, 0xe8, 0x03, 0x10, 0x07, 0x20, 0xfe,
- 0x03, 0x13, 0x10, 0xa4, 0x03, 0x00, 0x02, 0xa8,
- 0x03, 0x01, 0x02, 0xe6, 0x03, 0x05, 0x10, 0x60,
- 0x04, 0x10, 0xe4, 0x03, 0x06, 0x10, 0xf0, 0x03,
- 0x02, 0x10, 0xf6, 0x03, 0x08, 0x10, 0xcc, 0x03,
- 0x02, 0x02, 0xf4, 0x03, 0x07, 0x10, 0x80, 0x04,
- 0x14, 0x10, 0xd8, 0x03, 0x03, 0x02, 0x60, 0x02,
- 0x00, 0x60, 0x01, 0x00, 0x60, 0x00, 0x00, 0x64,
- 0x00, 0x00, 0x11, 0xb4, 0xad, 0xeb, 0x06, 0x11,
- 0xb5, 0xad, 0xea, 0x09, 0xb6, 0x11, 0x65, 0x00,
- 0x00, 0x0e, 0xec, 0x33, 0x11, 0xb6, 0xad, 0xea,
- 0x0c, 0xde, 0x11, 0x04, 0x04, 0x01, 0x00, 0x00,
- 0x21, 0x01, 0x00, 0x30, 0x11, 0xb7, 0xad, 0xea,
- 0x13, 0x0b, 0x38, 0x46, 0x00, 0x00, 0x00, 0x4b,
- 0x41, 0x00, 0x00, 0x00, 0x0a, 0x4b, 0x6a, 0x00,
- 0x00, 0x00, 0x28, 0xdf, 0x11, 0x04, 0x05, 0x01,
- 0x00, 0x00, 0x21, 0x01, 0x00, 0x30, 0x0e, 0xb4,
- 0xc9, 0xb4, 0xca, 0x0c, 0x07, 0xcb, 0x60, 0x03,
- 0x00, 0xb4, 0xcc, 0x61, 0x03, 0x00, 0x64, 0x03,
- 0x00, 0xa5, 0x68, 0xdd, 0x01, 0x00, 0x00, 0x60,
- 0x06, 0x00, 0x60, 0x05, 0x00, 0x60, 0x04, 0x00,
- 0x64, 0x04, 0x00, 0x61, 0x03, 0x00, 0x46, 0xc2,
- 0x04, 0x64, 0x05, 0x00, 0x61, 0x03, 0x00, 0x46,
- 0xc2, 0x05, 0x61, 0x05, 0x00, 0x95, 0xea, 0x34,
- 0x64, 0x06, 0x00, 0x04, 0x06, 0x01, 0x00, 0x00,
- 0xae, 0xea, 0x0c, 0xdf, 0x11, 0x04, 0x05, 0x01,
- 0x00, 0x00, 0x21, 0x01, 0x00, 0x30, 0x61, 0x02,
- 0x00, 0x61, 0x04, 0x00, 0x1b, 0x11, 0xaf, 0xeb,
- 0x04, 0x1b, 0x70, 0x1b, 0x1b, 0x64, 0x07, 0x00,
- 0x61, 0x03, 0x00, 0x46, 0x1b, 0x70, 0x1b, 0x48,
- 0xed, 0x7c, 0x01, 0x06, 0xc2, 0x06, 0x6b, 0x1a,
- 0x00, 0x00, 0x00, 0x5d, 0x08, 0x00, 0x61, 0x05,
- 0x00, 0x64, 0x09, 0x00, 0x61, 0x03, 0x00, 0x46,
- 0xf0, 0x11, 0x62, 0x06, 0x00, 0x0e, 0x0e, 0xec,
- 0x35, 0xc2, 0x07, 0x6b, 0x30, 0x00, 0x00, 0x00,
- 0xb4, 0x11, 0x65, 0x0a, 0x00, 0x0e, 0x64, 0x05,
- 0x00, 0x61, 0x03, 0x00, 0x1b, 0x11, 0xaf, 0xeb,
- 0x04, 0x1b, 0x70, 0x1b, 0x1b, 0x38, 0x46, 0x00,
- 0x00, 0x00, 0x1b, 0x70, 0x1b, 0x48, 0x5d, 0x0b,
- 0x00, 0x64, 0x05, 0x00, 0x64, 0x03, 0x00, 0xf0,
- 0x0e, 0xc1, 0x07, 0x30, 0x30, 0x61, 0x06, 0x00,
- 0x40, 0x6a, 0x00, 0x00, 0x00, 0x95, 0xea, 0x4f,
- 0x64, 0x06, 0x00, 0x04, 0x07, 0x01, 0x00, 0x00,
- 0xad, 0xea, 0x1e, 0x61, 0x00, 0x00, 0xb4, 0xa7,
- 0xea, 0x17, 0x5d, 0x0b, 0x00, 0x64, 0x05, 0x00,
- 0x64, 0x03, 0x00, 0xf0, 0x0e, 0xde, 0x11, 0x04,
- 0x08, 0x01, 0x00, 0x00, 0x21, 0x01, 0x00, 0x30,
- 0x61, 0x02, 0x00, 0x61, 0x04, 0x00, 0x1b, 0x11,
- 0xaf, 0xeb, 0x04, 0x1b, 0x70, 0x1b, 0x1b, 0x61,
- 0x06, 0x00, 0x40, 0x41, 0x00, 0x00, 0x00, 0x1b,
- 0x70, 0x1b, 0x48, 0x61, 0x01, 0x00, 0x90, 0x62,
- 0x01, 0x00, 0x0e, 0xed, 0xd1, 0x00, 0x64, 0x0a,
- 0x00, 0x8f, 0x65, 0x0a, 0x00, 0x0e, 0x61, 0x00,
- 0x00, 0x90, 0x62, 0x00, 0x00, 0x0e, 0x64, 0x05,
- 0x00, 0x61, 0x03, 0x00, 0x1b, 0x11, 0xaf, 0xeb,
- 0x04, 0x1b, 0x70, 0x1b, 0x1b, 0x38, 0x46, 0x00,
- 0x00, 0x00, 0x1b, 0x70, 0x1b, 0x48, 0x64, 0x06,
- 0x00, 0x60, 0x08, 0x00, 0x11, 0x04, 0x09, 0x01,
- 0x00, 0x00, 0xad, 0xea, 0x2e, 0x5d, 0x0b, 0x00,
- 0x64, 0x05, 0x00, 0x64, 0x03, 0x00, 0xf0, 0xc2,
- 0x08, 0x61, 0x08, 0x00, 0xea, 0x05, 0x61, 0x08,
- 0x00, 0x30, 0xb7, 0x11, 0x65, 0x00, 0x00, 0x0e,
- 0x0b, 0x38, 0x46, 0x00, 0x00, 0x00, 0x4b, 0x41,
- 0x00, 0x00, 0x00, 0x0a, 0x4b, 0x6a, 0x00, 0x00,
- 0x00, 0x28, 0x11, 0x04, 0x06, 0x01, 0x00, 0x00,
- 0xad, 0xea, 0x3c, 0x64, 0x0a, 0x00, 0xb5, 0xa5,
- 0xea, 0x19, 0xb7, 0x11, 0x65, 0x00, 0x00, 0x0e,
- 0x0b, 0x38, 0x46, 0x00, 0x00, 0x00, 0x4b, 0x41,
- 0x00, 0x00, 0x00, 0x0a, 0x4b, 0x6a, 0x00, 0x00,
- 0x00, 0x28, 0x61, 0x02, 0x00, 0x61, 0x04, 0x00,
- 0x1b, 0x11, 0xaf, 0xeb, 0x04, 0x1b, 0x70, 0x1b,
- 0x1b, 0x64, 0x07, 0x00, 0x61, 0x03, 0x00, 0x46,
- 0x1b, 0x70, 0x1b, 0x48, 0xec, 0x27, 0x11, 0x04,
- 0x07, 0x01, 0x00, 0x00, 0xad, 0xea, 0x1e, 0x61,
- 0x01, 0x00, 0xb4, 0xa7, 0xea, 0x17, 0x5d, 0x0b,
- 0x00, 0x64, 0x05, 0x00, 0x64, 0x03, 0x00, 0xf0,
- 0x0e, 0xde, 0x11, 0x04, 0x08, 0x01, 0x00, 0x00,
- 0x21, 0x01, 0x00, 0x30, 0x0e, 0x61, 0x03, 0x00,
- 0x90, 0x62, 0x03, 0x00, 0x0e, 0xed, 0x1d, 0xfe,
- 0x61, 0x01, 0x00, 0xb4, 0xad, 0xea, 0x19, 0xb7,
- 0x11, 0x65, 0x00, 0x00, 0x0e, 0x0b, 0x38, 0x46,
- 0x00, 0x00, 0x00, 0x4b, 0x41, 0x00, 0x00, 0x00,
- 0x0a, 0x4b, 0x6a, 0x00, 0x00, 0x00, 0x28, 0xb5,
- 0x11, 0x65, 0x00, 0x00, 0x0e, 0x0b, 0x61, 0x02,
- 0x00, 0x4b, 0x41, 0x00, 0x00, 0x00, 0x09, 0x4b,
- 0x6a, 0x00, 0x00, 0x00, 0x28, 0x0c, 0x42, 0x03,
- 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x06,
- 0x00, 0x88, 0x01, 0x01, 0xe8, 0x03, 0x01, 0x00,
- 0x20, 0xfe, 0x03, 0x13, 0x10, 0xa4, 0x03, 0x00,
- 0x02, 0xa8, 0x03, 0x01, 0x02, 0xd8, 0x03, 0x03,
- 0x02, 0xe4, 0x03, 0x06, 0x10, 0xe6, 0x03, 0x05,
- 0x10, 0x60, 0x00, 0x00, 0x64, 0x00, 0x00, 0x11,
- 0xb4, 0xad, 0xea, 0x09, 0xb7, 0x11, 0x65, 0x00,
- 0x00, 0x0e, 0xec, 0x4b, 0x11, 0xb5, 0xad, 0xea,
- 0x09, 0xb6, 0x11, 0x65, 0x00, 0x00, 0x0e, 0xec,
- 0x3e, 0x11, 0xb6, 0xad, 0xea, 0x0c, 0xde, 0x11,
- 0x04, 0x04, 0x01, 0x00, 0x00, 0x21, 0x01, 0x00,
- 0x30, 0x11, 0xb7, 0xad, 0xea, 0x13, 0x0b, 0x38,
- 0x46, 0x00, 0x00, 0x00, 0x4b, 0x41, 0x00, 0x00,
- 0x00, 0x0a, 0x4b, 0x6a, 0x00, 0x00, 0x00, 0x28,
- 0xdf, 0x11, 0x04, 0x0a, 0x01, 0x00, 0x00, 0x41,
- 0x5d, 0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x24,
- 0x01, 0x00, 0x21, 0x01, 0x00, 0x30, 0x0e, 0xe0,
- 0x64, 0x04, 0x00, 0x64, 0x05, 0x00, 0xf0, 0xc9,
- 0x61, 0x00, 0x00, 0xea, 0x05, 0x61, 0x00, 0x00,
- 0x30, 0xb7, 0x11, 0x65, 0x00, 0x00, 0x0e, 0x0b,
- 0x38, 0x46, 0x00, 0x00, 0x00, 0x4b, 0x41, 0x00,
- 0x00, 0x00, 0x0a, 0x4b, 0x6a, 0x00, 0x00, 0x00,
- 0x28, 0x60, 0x01, 0x00, 0x60, 0x00, 0x00, 0xd1,
- 0xc9, 0xd2, 0x11, 0xf2, 0xea, 0x08, 0x0e, 0x38,
- 0x46, 0x00, 0x00, 0x00, 0xda, 0xca, 0x60, 0x14,
- 0x00, 0x60, 0x13, 0x00, 0x60, 0x08, 0x00, 0x60,
- 0x07, 0x00, 0x60, 0x06, 0x00, 0x60, 0x05, 0x00,
- 0x60, 0x04, 0x00, 0x60, 0x03, 0x00, 0x60, 0x02,
- 0x00, 0x5d, 0x04, 0x00, 0xd1, 0x04, 0x0b, 0x01,
- 0x00, 0x00, 0xf0, 0x0e, 0xd2, 0x38, 0x46, 0x00,
- 0x00, 0x00, 0xad, 0xea, 0x06, 0x0c, 0x07, 0xd6,
- 0xec, 0x0c, 0x5d, 0x04, 0x00, 0xd2, 0x04, 0x0c,
- 0x01, 0x00, 0x00, 0xf0, 0x0e, 0xd2, 0x40, 0xf8,
- 0x00, 0x00, 0x00, 0xcb, 0x61, 0x02, 0x00, 0x38,
- 0x46, 0x00, 0x00, 0x00, 0xad, 0xea, 0x0b, 0x04,
- 0x09, 0x01, 0x00, 0x00, 0x11, 0x62, 0x02, 0x00,
- 0x0e, 0x61, 0x02, 0x00, 0x04, 0x07, 0x01, 0x00,
- 0x00, 0xad, 0x11, 0xeb, 0x18, 0x0e, 0x61, 0x02,
- 0x00, 0x04, 0x06, 0x01, 0x00, 0x00, 0xad, 0x11,
- 0xeb, 0x0b, 0x0e, 0x61, 0x02, 0x00, 0x04, 0x09,
- 0x01, 0x00, 0x00, 0xad, 0x95, 0xea, 0x0c, 0xdd,
- 0x11, 0x04, 0x0d, 0x01, 0x00, 0x00, 0x21, 0x01,
- 0x00, 0x30, 0x38, 0x46, 0x00, 0x00, 0x00, 0xcc,
- 0x61, 0x02, 0x00, 0x04, 0x06, 0x01, 0x00, 0x00,
- 0xad, 0xea, 0x24, 0xd2, 0x40, 0xf9, 0x00, 0x00,
- 0x00, 0x11, 0x62, 0x03, 0x00, 0x0e, 0x61, 0x03,
- 0x00, 0x38, 0x46, 0x00, 0x00, 0x00, 0xae, 0xea,
- 0x0e, 0x5d, 0x04, 0x00, 0x61, 0x03, 0x00, 0x04,
- 0x0e, 0x01, 0x00, 0x00, 0xf0, 0x0e, 0x26, 0x00,
- 0x00, 0xc2, 0x04, 0xb4, 0xc2, 0x05, 0x26, 0x00,
- 0x00, 0xc2, 0x06, 0x26, 0x00, 0x00, 0xc2, 0x07,
- 0x26, 0x00, 0x00, 0xc2, 0x08, 0x60, 0x09, 0x00,
- 0x5d, 0x05, 0x00, 0xd1, 0xef, 0x7d, 0xec, 0x1d,
- 0xc2, 0x09, 0x61, 0x04, 0x00, 0x61, 0x05, 0x00,
- 0x90, 0x62, 0x05, 0x00, 0x1b, 0x11, 0xaf, 0xeb,
- 0x04, 0x1b, 0x70, 0x1b, 0x1b, 0x61, 0x09, 0x00,
- 0x1b, 0x70, 0x1b, 0x48, 0x80, 0x00, 0xea, 0xe1,
- 0x0e, 0x83, 0x6b, 0x7d, 0x01, 0x00, 0x00, 0x60,
- 0x0a, 0x00, 0xb4, 0xc2, 0x0a, 0x61, 0x0a, 0x00,
- 0x61, 0x05, 0x00, 0xa5, 0x68, 0xf0, 0x00, 0x00,
- 0x00, 0x60, 0x0c, 0x00, 0x60, 0x0b, 0x00, 0x0a,
- 0xc2, 0x0b, 0x61, 0x04, 0x00, 0x61, 0x0a, 0x00,
- 0x46, 0xc2, 0x0c, 0x5d, 0x06, 0x00, 0xd1, 0x61,
- 0x0c, 0x00, 0xf0, 0xea, 0x78, 0x60, 0x0d, 0x00,
- 0xd1, 0x61, 0x0c, 0x00, 0x46, 0xc2, 0x0d, 0x61,
- 0x0d, 0x00, 0x38, 0x46, 0x00, 0x00, 0x00, 0xae,
- 0xea, 0x63, 0x60, 0x0e, 0x00, 0x5d, 0x04, 0x00,
- 0x61, 0x0d, 0x00, 0x04, 0x0f, 0x01, 0x00, 0x00,
- 0xf0, 0x0e, 0x61, 0x0d, 0x00, 0x5d, 0x07, 0x00,
- 0x46, 0xc2, 0x0e, 0x61, 0x0e, 0x00, 0xea, 0x0e,
- 0xdf, 0x61, 0x0d, 0x00, 0x61, 0x0e, 0x00, 0xf0,
- 0x11, 0x62, 0x0d, 0x00, 0x0e, 0x61, 0x06, 0x00,
- 0x61, 0x0a, 0x00, 0x1b, 0x11, 0xaf, 0xeb, 0x04,
- 0x1b, 0x70, 0x1b, 0x1b, 0x61, 0x0d, 0x00, 0x1b,
- 0x70, 0x1b, 0x48, 0x61, 0x07, 0x00, 0x61, 0x0a,
- 0x00, 0x1b, 0x11, 0xaf, 0xeb, 0x04, 0x1b, 0x70,
- 0x1b, 0x1b, 0x61, 0x0d, 0x00, 0x40, 0x6b, 0x00,
- 0x00, 0x00, 0x1b, 0x70, 0x1b, 0x48, 0x09, 0x11,
- 0x62, 0x0b, 0x00, 0x0e, 0x61, 0x0b, 0x00, 0xea,
- 0x4a, 0x60, 0x0f, 0x00, 0x61, 0x0a, 0x00, 0xb5,
- 0x9c, 0xc2, 0x0f, 0x61, 0x0f, 0x00, 0x61, 0x05,
- 0x00, 0xa5, 0xea, 0x27, 0x61, 0x04, 0x00, 0x61,
- 0x0f, 0x00, 0xb5, 0x9d, 0x1b, 0x11, 0xaf, 0xeb,
- 0x04, 0x1b, 0x70, 0x1b, 0x1b, 0x61, 0x04, 0x00,
- 0x61, 0x0f, 0x00, 0x46, 0x1b, 0x70, 0x1b, 0x48,
- 0x61, 0x0f, 0x00, 0x90, 0x62, 0x0f, 0x00, 0x0e,
- 0xec, 0xd2, 0x61, 0x05, 0x00, 0x8f, 0x62, 0x05,
- 0x00, 0x0e, 0x61, 0x0a, 0x00, 0x8f, 0x62, 0x0a,
- 0x00, 0x0e, 0x61, 0x0a, 0x00, 0x90, 0x62, 0x0a,
- 0x00, 0x0e, 0xed, 0x0a, 0xff, 0x61, 0x02, 0x00,
- 0x04, 0x06, 0x01, 0x00, 0x00, 0xad, 0xea, 0x6e,
- 0x61, 0x03, 0x00, 0xea, 0x38, 0x60, 0x10, 0x00,
- 0xb4, 0xc2, 0x10, 0x61, 0x10, 0x00, 0x61, 0x05,
- 0x00, 0xa5, 0xea, 0x5a, 0x61, 0x08, 0x00, 0x61,
- 0x10, 0x00, 0x1b, 0x11, 0xaf, 0xeb, 0x04, 0x1b,
- 0x70, 0x1b, 0x1b, 0x61, 0x03, 0x00, 0x61, 0x04,
- 0x00, 0x61, 0x10, 0x00, 0x46, 0x46, 0x1b, 0x70,
- 0x1b, 0x48, 0x61, 0x10, 0x00, 0x90, 0x62, 0x10,
- 0x00, 0x0e, 0xec, 0xd0, 0x60, 0x11, 0x00, 0xb4,
- 0xc2, 0x11, 0x61, 0x11, 0x00, 0x61, 0x05, 0x00,
- 0xa5, 0xea, 0x23, 0x61, 0x08, 0x00, 0x61, 0x11,
- 0x00, 0x1b, 0x11, 0xaf, 0xeb, 0x04, 0x1b, 0x70,
- 0x1b, 0x1b, 0x38, 0x46, 0x00, 0x00, 0x00, 0x1b,
- 0x70, 0x1b, 0x48, 0x61, 0x11, 0x00, 0x90, 0x62,
- 0x11, 0x00, 0x0e, 0xec, 0xd6, 0x0e, 0xec, 0x15,
- 0xc2, 0x12, 0x6b, 0x10, 0x00, 0x00, 0x00, 0xe0,
- 0x61, 0x06, 0x00, 0x61, 0x05, 0x00, 0xf0, 0x0e,
- 0xc1, 0x12, 0x30, 0x30, 0xb4, 0xc2, 0x13, 0x61,
- 0x05, 0x00, 0xc2, 0x14, 0x0b, 0x5d, 0x08, 0x00,
- 0x4e, 0xbf, 0x00, 0x53, 0x6b, 0x00, 0x00, 0x00,
- 0x04, 0xbf, 0x01, 0x53, 0x06, 0x00, 0x00, 0x00,
- 0x04, 0x28, 0xbf, 0x00, 0xc9, 0xbf, 0x01, 0xca,
- 0xbf, 0x02, 0xcb, 0xbf, 0x03, 0x28, 0xbf, 0x00,
- 0xcd, 0x28,
-};
-
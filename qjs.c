@@ -104,10 +104,27 @@ static JSValue load_standalone_module(JSContext *ctx)
     return JS_GetModuleNamespace(ctx, m);
 }
 
+/* evaluate a module compiled with JS_EVAL_FLAG_COMPILE_ONLY */
+static JSValue eval_module(JSContext *ctx, JSValue val, const char *filename)
+{
+    bool use_realpath;
+
+    if (!JS_IsException(val)) {
+        // ex. "<cmdline>" pr "/dev/stdin"
+        use_realpath =
+            !(*filename == '<' || !strncmp(filename, "/dev/", 5));
+        if (js_module_set_import_meta(ctx, val, use_realpath, true) < 0) {
+            JS_FreeValue(ctx, val);
+            return JS_EXCEPTION;
+        }
+        val = JS_EvalFunction(ctx, val);
+    }
+    return js_std_await(ctx, val);
+}
+
 static int eval_buf(JSContext *ctx, const void *buf, int buf_len,
                     const char *filename, int eval_flags)
 {
-    bool use_realpath;
     JSValue val;
     int ret;
 
@@ -116,18 +133,7 @@ static int eval_buf(JSContext *ctx, const void *buf, int buf_len,
            import.meta */
         val = JS_Eval(ctx, buf, buf_len, filename,
                       eval_flags | JS_EVAL_FLAG_COMPILE_ONLY);
-        if (!JS_IsException(val)) {
-            // ex. "<cmdline>" pr "/dev/stdin"
-            use_realpath =
-                !(*filename == '<' || !strncmp(filename, "/dev/", 5));
-            if (js_module_set_import_meta(ctx, val, use_realpath, true) < 0) {
-                js_std_dump_error(ctx);
-                ret = -1;
-                goto end;
-            }
-            val = JS_EvalFunction(ctx, val);
-        }
-        val = js_std_await(ctx, val);
+        val = eval_module(ctx, val, filename);
     } else {
         val = JS_Eval(ctx, buf, buf_len, filename, eval_flags);
     }
@@ -137,16 +143,19 @@ static int eval_buf(JSContext *ctx, const void *buf, int buf_len,
     } else {
         ret = 0;
     }
-end:
     JS_FreeValue(ctx, val);
     return ret;
 }
 
-static int eval_file(JSContext *ctx, const char *filename, int module)
+/* 'compile_threads' > 0: compile the modules imported by a module
+   file in parallel */
+static int eval_file(JSContext *ctx, const char *filename, int module,
+                     int compile_threads)
 {
     uint8_t *buf;
     int ret, eval_flags;
     size_t buf_len;
+    JSValue val;
 
     buf = js_load_file(ctx, &buf_len, filename);
     if (!buf) {
@@ -158,6 +167,20 @@ static int eval_file(JSContext *ctx, const char *filename, int module)
         module = (js__has_suffix(filename, ".mjs") ||
                   JS_DetectModule((const char *)buf, buf_len));
     }
+    if (module && compile_threads > 0) {
+        val = js_std_compile_module_graph(ctx, filename, compile_threads);
+        if (!JS_IsUndefined(val)) {
+            js_free(ctx, buf);
+            val = eval_module(ctx, val, filename);
+            ret = 0;
+            if (JS_IsException(val)) {
+                js_std_dump_error(ctx);
+                ret = -1;
+            }
+            JS_FreeValue(ctx, val);
+            return ret;
+        }
+    }
     if (module)
         eval_flags = JS_EVAL_TYPE_MODULE;
     else
@@ -196,6 +219,59 @@ static int64_t parse_limit(const char *arg) {
     return (int64_t)(d * unit);
 }
 
+/* 'stop' is JS_StopProfiling or JS_StopAllocProfiling. The format is
+   selected by the extension: pprof for .pb and .pprof, collapsed
+   stacks otherwise */
+static void write_profile(JSRuntime *rt, const char *filename,
+                          int (*stop)(JSRuntime *rt, FILE *fp,
+                                      JSProfileFormatEnum format))
+{
+    JSProfileFormatEnum format;
+    FILE *f;
+
+    format = JS_PROFILE_COLLAPSED;
+    if (js__has_suffix(filename, ".pb") || js__has_suffix(filename, ".pprof"))
+        format = JS_PROFILE_PPROF;
+    f = fopen(filename, "wb");
+    if (!f) {
+        perror(filename);
+        stop(rt, NULL, format);
+        return;
+    }
+    if (stop(rt, f, format))
+        fprintf(stderr, "qjs: could not write the profile to %s\n", filename);
+    fclose(f);
+}
+
+static void write_trace(JSRuntime *rt, const char *filename)
+{
+    FILE *f;
+
+    f = fopen(filename, "w");
+    if (!f) {
+        perror(filename);
+    } else {
+        if (JS_WriteTrace(rt, f))
+            fprintf(stderr, "qjs: could not write the trace events to %s\n", filename);
+        fclose(f);
+    }
+    JS_StopTracing(rt);
+}
+
+static void write_exec_counters(JSRuntime *rt, const char *filename)
+{
+    FILE *f;
+
+    f = fopen(filename, "w");
+    if (!f) {
+        perror(filename);
+        return;
+    }
+    if (JS_DumpExecCounters(rt, f))
+        fprintf(stderr, "qjs: could not write the execution counters to %s\n", filename);
+    fclose(f);
+}
+
 static JSValue js_gc(JSContext *ctx, JSValueConst this_val,
                      int argc, JSValueConst *argv)
 {
@@ -391,6 +467,19 @@ void help(void)
            "    --exe          select the executable to use as the base, defaults to the current one\n"
            "    --memory-limit n       limit the memory usage to 'n' Kbytes\n"
            "    --stack-size n         limit the stack size to 'n' Kbytes\n"
+           "    --module-cache DIR     cache the bytecode of the imported modules in DIR\n"
+           "    --compile-threads n    compile the imported modules on 'n' threads\n"
+           "    --cpu-prof FILE        write a CPU profile to FILE (pprof if FILE ends\n"
+           "                           with .pb or .pprof, collapsed stacks otherwise)\n"
+           "    --cpu-prof-interval n  sample the CPU profile every 'n' microseconds\n"
+           "    --alloc-prof FILE      write an allocation profile to FILE (pprof if FILE\n"
+           "                           ends with .pb or .pprof, collapsed stacks otherwise)\n"
+           "    --alloc-prof-interval n\n"
+           "                           sample an allocation every 'n' Kbytes on average\n"
+           "    --trace-events FILE    write the GC, compilation, module and job events to\n"
+           "                           FILE in the Chrome trace event format\n"
+           "    --exec-counters FILE   write the executed opcode and function counts to FILE\n"
+           "                           (requires a build with QJS_ENABLE_EXEC_COUNTERS)\n"
            "-q  --quit         just instantiate the interpreter and quit\n", JS_GetVersion());
     exit(1);
 }
@@ -410,6 +499,11 @@ int main(int argc, char **argv)
     char *expr = NULL;
     char *dump_flags_str = NULL;
     char *out = NULL;
+    char *module_cache_dir = NULL;
+    char *cpu_prof = NULL;
+    char *alloc_prof = NULL;
+    char *trace_events = NULL;
+    char *exec_counters = NULL;
     int standalone = 0;
     int interactive = 0;
     int dump_memory = 0;
@@ -422,6 +516,9 @@ int main(int argc, char **argv)
     int i, include_count = 0;
     int64_t memory_limit = -1;
     int64_t stack_size = -1;
+    int compile_threads = 0;
+    int cpu_prof_interval = 0;
+    int64_t alloc_prof_interval = 0;
 
     /* save for later */
     qjs__argc = argc;
@@ -545,6 +642,94 @@ int main(int argc, char **argv)
                 stack_size = parse_limit(optarg);
                 break;
             }
+            if (!strcmp(longopt, "compile-threads")) {
+                if (!optarg) {
+                    if (optind >= argc) {
+                        fprintf(stderr, "qjs: missing number for --compile-threads\n");
+                        exit(1);
+                    }
+                    optarg = argv[optind++];
+                }
+                compile_threads = atoi(optarg);
+                break;
+            }
+            if (!strcmp(longopt, "cpu-prof")) {
+                if (!optarg) {
+                    if (optind >= argc) {
+                        fprintf(stderr, "qjs: missing file for --cpu-prof\n");
+                        exit(1);
+                    }
+                    optarg = argv[optind++];
+                }
+                cpu_prof = optarg;
+                break;
+            }
+            if (!strcmp(longopt, "cpu-prof-interval")) {
+                if (!optarg) {
+                    if (optind >= argc) {
+                        fprintf(stderr, "qjs: missing number for --cpu-prof-interval\n");
+                        exit(1);
+                    }
+                    optarg = argv[optind++];
+                }
+                cpu_prof_interval = atoi(optarg);
+                break;
+            }
+            if (!strcmp(longopt, "alloc-prof")) {
+                if (!optarg) {
+                    if (optind >= argc) {
+                        fprintf(stderr, "qjs: missing file for --alloc-prof\n");
+                        exit(1);
+                    }
+                    optarg = argv[optind++];
+                }
+                alloc_prof = optarg;
+                break;
+            }
+            if (!strcmp(longopt, "alloc-prof-interval")) {
+                if (!optarg) {
+                    if (optind >= argc) {
+                        fprintf(stderr, "qjs: missing number for --alloc-prof-interval\n");
+                        exit(1);
+                    }
+                    optarg = argv[optind++];
+                }
+                alloc_prof_interval = parse_limit(optarg);
+                break;
+            }
+            if (!strcmp(longopt, "trace-events")) {
+                if (!optarg) {
+                    if (optind >= argc) {
+                        fprintf(stderr, "qjs: missing file for --trace-events\n");
+                        exit(1);
+                    }
+                    optarg = argv[optind++];
+                }
+                trace_events = optarg;
+                break;
+            }
+            if (!strcmp(longopt, "exec-counters")) {
+                if (!optarg) {
+                    if (optind >= argc) {
+                        fprintf(stderr, "qjs: missing file for --exec-counters\n");
+                        exit(1);
+                    }
+                    optarg = argv[optind++];
+                }
+                exec_counters = optarg;
+                break;
+            }
+            if (!strcmp(longopt, "module-cache")) {
+                if (!optarg) {
+                    if (optind >= argc) {
+                        fprintf(stderr, "qjs: missing directory for --module-cache\n");
+                        exit(1);
+                    }
+                    optarg = argv[optind++];
+                }
+                module_cache_dir = optarg;
+                break;
+            }
             if (opt == 'c' || !strcmp(longopt, "compile")) {
                 if (!optarg) {
                     if (optind >= argc) {
@@ -614,6 +799,8 @@ start:
         JS_SetDumpFlags(rt, dump_flags);
     js_std_set_worker_new_context_func(JS_NewCustomContext);
     js_std_init_handlers(rt);
+    if (module_cache_dir)
+        js_std_set_module_cache_dir(rt, module_cache_dir);
     ctx = JS_NewCustomContext(rt);
     if (!ctx) {
         fprintf(stderr, "qjs: cannot allocate JS context\n");
@@ -623,6 +810,17 @@ start:
     /* loader for ES6 modules */
     JS_SetModuleLoaderFunc2(rt, NULL, js_module_loader, js_module_check_attributes, NULL);
 
+    if (cpu_prof)
+        JS_StartProfiling(rt, cpu_prof_interval > 0 ? cpu_prof_interval : 0);
+    if (alloc_prof)
+        JS_StartAllocProfiling(rt, alloc_prof_interval > 0 ? alloc_prof_interval : 0);
+    if (trace_events)
+        JS_StartTracing(rt, 0);
+    if (exec_counters && JS_ResetExecCounters(rt)) {
+        fprintf(stderr, "qjs: execution counters are not enabled in this build\n");
+        exit(1);
+    }
+
     /* exit on unhandled promise rejections */
     JS_SetHostPromiseRejectionTracker(rt, js_std_promise_rejection_tracker, NULL);
 
@@ -642,7 +840,7 @@ start:
         }
 
         for(i = 0; i < include_count; i++) {
-            if (eval_file(ctx, include_list[i], 0))
+            if (eval_file(ctx, include_list[i], 0, 0))
                 goto fail;
         }
 
@@ -683,7 +881,7 @@ start:
         } else {
             const char *filename;
             filename = argv[optind];
-            if (eval_file(ctx, filename, module))
+            if (eval_file(ctx, filename, module, compile_threads))
                 goto fail;
         }
         if (interactive) {
@@ -706,6 +904,14 @@ start:
         }
     }
 
+    if (cpu_prof)
+        write_profile(rt, cpu_prof, JS_StopProfiling);
+    if (alloc_prof)
+        write_profile(rt, alloc_prof, JS_StopAllocProfiling);
+    if (trace_events)
+        write_trace(rt, trace_events);
+    if (exec_counters)
+        write_exec_counters(rt, exec_counters);
     if (dump_memory) {
         JSMemoryUsage stats;
         JS_ComputeMemoryUsage(rt, &stats);
@@ -741,6 +947,14 @@ start:
     }
     return 0;
  fail:
+    if (cpu_prof)
+        write_profile(rt, cpu_prof, JS_StopProfiling);
+    if (alloc_prof)
+        write_profile(rt, alloc_prof, JS_StopAllocProfiling);
+    if (trace_events)
+        write_trace(rt, trace_events);
+    if (exec_counters)
+        write_exec_counters(rt, exec_counters);
     js_std_free_handlers(rt);
     JS_FreeContext(ctx);
     JS_FreeRuntime(rt);
@@ -124,6 +124,14 @@ typedef struct {
     JSValue rw_func[2];
 } JSOSRWHandler;
 
+/* module compiled by js_std_compile_module_graph() */
+typedef struct {
+    struct list_head link;
+    char *module_name;
+    uint8_t *buf; /* output of JS_WriteObject(), NULL if not compiled */
+    size_t buf_len;
+} JSPrecompiledModule;
+
 typedef struct {
     struct list_head link;
     int sig_num;
@@ -197,6 +205,8 @@ typedef struct JSThreadState {
 #endif // USE_WORKER
     JSClassID std_file_class_id;
     JSClassID worker_class_id;
+    char *module_cache_dir; /* bytecode cache of the module loader or NULL */
+    struct list_head precompiled_modules; /* list of JSPrecompiledModule.link */
 } JSThreadState;
 
 static uint64_t os_pending_signals;
@@ -875,6 +885,244 @@ int js_module_test_json(JSContext *ctx, JSValueConst attributes)
     return res;
 }
 
+/* Module bytecode cache. Each cache file contains a header followed
+   by the output of JS_WriteObject(). The file name is derived from the
+   engine version and the module name. The header repeats them and
+   contains the size, modification time and hash of the source so that
+   a stale or foreign file is never used. The bytecode is not validated
+   by JS_ReadObject(), so its hash is also stored to detect corrupted
+   files. The files are written to a temporary file then renamed so
+   that concurrent processes never see a partial file. */
+
+#define MODULE_CACHE_MAGIC "QJSMODC1"
+#define MODULE_CACHE_HASH_INIT 0xcbf29ce484222325
+
+typedef struct {
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t hash;
+} JSModuleCacheKey;
+
+static uint64_t module_cache_hash(uint64_t h, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    size_t i;
+
+    /* FNV-1a */
+    for(i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3;
+    }
+    return h;
+}
+
+static void module_cache_get_filename(char *buf, size_t buf_size,
+                                      const char *dir, const char *module_name)
+{
+    const char *version = JS_GetVersion();
+    uint64_t h;
+
+    h = module_cache_hash(MODULE_CACHE_HASH_INIT, version, strlen(version) + 1);
+    h = module_cache_hash(h, module_name, strlen(module_name));
+    snprintf(buf, buf_size, "%s/%016" PRIx64 ".qbc", dir, h);
+}
+
+static int module_cache_put_str(DynBuf *s, const char *str)
+{
+    size_t len = strlen(str);
+    if (dbuf_put_u32(s, len))
+        return -1;
+    return dbuf_put(s, (const uint8_t *)str, len);
+}
+
+static bool module_cache_get_str(const uint8_t **pp, const uint8_t *end,
+                                 const char *str)
+{
+    const uint8_t *p = *pp;
+    size_t len = strlen(str);
+
+    if (end - p < 4 || get_u32(p) != len)
+        return false;
+    p += 4;
+    if (end - p < len || memcmp(p, str, len))
+        return false;
+    *pp = p + len;
+    return true;
+}
+
+/* return the compiled module or JS_UNDEFINED if no valid cache entry
+   is found */
+static JSValue module_cache_read(JSContext *ctx, const char *filename,
+                                 const char *module_name,
+                                 const JSModuleCacheKey *key)
+{
+    uint8_t *buf;
+    const uint8_t *p, *end;
+    size_t buf_len, len;
+    JSValue obj;
+
+    buf = js_load_file(ctx, &buf_len, filename);
+    if (!buf)
+        return JS_UNDEFINED;
+    p = buf;
+    end = buf + buf_len;
+    obj = JS_UNDEFINED;
+    len = strlen(MODULE_CACHE_MAGIC);
+    if (end - p < len || memcmp(p, MODULE_CACHE_MAGIC, len))
+        goto done;
+    p += len;
+    if (!module_cache_get_str(&p, end, JS_GetVersion()) ||
+        !module_cache_get_str(&p, end, module_name))
+        goto done;
+    if (end - p < 40 ||
+        get_u64(p) != key->size ||
+        get_u64(p + 8) != key->mtime ||
+        get_u64(p + 16) != key->hash ||
+        get_u64(p + 24) != end - p - 40 ||
+        get_u64(p + 32) != module_cache_hash(MODULE_CACHE_HASH_INIT, p + 40,
+                                             end - p - 40))
+        goto done;
+    p += 40;
+    obj = JS_ReadObject(ctx, p, end - p, JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(obj)) {
+        /* corrupted file or incompatible bytecode: recompile */
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        obj = JS_UNDEFINED;
+    } else if (JS_VALUE_GET_TAG(obj) != JS_TAG_MODULE) {
+        JS_FreeValue(ctx, obj);
+        obj = JS_UNDEFINED;
+    }
+ done:
+    js_free(ctx, buf);
+    return obj;
+}
+
+/* errors are ignored: the cache is only an optimization */
+static void module_cache_write(JSContext *ctx, const char *filename,
+                               const char *module_name,
+                               const JSModuleCacheKey *key,
+                               JSValueConst func_val)
+{
+    char tmp_filename[JS__PATH_MAX + 64];
+    uint8_t *bc;
+    size_t bc_len;
+    DynBuf dbuf;
+    FILE *f;
+    int ret;
+
+    bc = JS_WriteObject(ctx, &bc_len, func_val, JS_WRITE_OBJ_BYTECODE);
+    if (!bc) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return;
+    }
+    js_std_dbuf_init(ctx, &dbuf);
+    dbuf_put(&dbuf, (const uint8_t *)MODULE_CACHE_MAGIC,
+             strlen(MODULE_CACHE_MAGIC));
+    module_cache_put_str(&dbuf, JS_GetVersion());
+    module_cache_put_str(&dbuf, module_name);
+    dbuf_put_u64(&dbuf, key->size);
+    dbuf_put_u64(&dbuf, key->mtime);
+    dbuf_put_u64(&dbuf, key->hash);
+    dbuf_put_u64(&dbuf, bc_len);
+    dbuf_put_u64(&dbuf, module_cache_hash(MODULE_CACHE_HASH_INIT, bc, bc_len));
+    dbuf_put(&dbuf, bc, bc_len);
+    js_free(ctx, bc);
+    if (dbuf_error(&dbuf))
+        goto done;
+
+#if defined(_WIN32)
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.%lu.%p.tmp", filename,
+             (unsigned long)GetCurrentProcessId(), (void *)&dbuf);
+#else
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.%ld.%p.tmp", filename,
+             (long)getpid(), (void *)&dbuf);
+#endif
+    f = fopen(tmp_filename, "wb");
+    if (!f)
+        goto done;
+    ret = (fwrite(dbuf.buf, 1, dbuf.size, f) == dbuf.size);
+    if (fclose(f))
+        ret = 0;
+#if defined(_WIN32)
+    if (ret)
+        ret = MoveFileExA(tmp_filename, filename, MOVEFILE_REPLACE_EXISTING);
+#else
+    if (ret)
+        ret = !rename(tmp_filename, filename);
+#endif
+    if (!ret)
+        remove(tmp_filename);
+ done:
+    dbuf_free(&dbuf);
+}
+
+static void free_precompiled_module(JSPrecompiledModule *pm)
+{
+    list_del(&pm->link);
+    free(pm->module_name);
+    free(pm->buf);
+    free(pm);
+}
+
+/* compile a module, using the modules compiled by
+   js_std_compile_module_graph() or the bytecode cache if enabled */
+static JSValue js_module_compile(JSContext *ctx, const uint8_t *buf,
+                                 size_t buf_len, const char *module_name)
+{
+    JSThreadState *ts = js_get_thread_state(JS_GetRuntime(ctx));
+    char filename[JS__PATH_MAX];
+    JSModuleCacheKey key;
+    struct stat st;
+    struct list_head *el;
+    JSValue func_val;
+
+    list_for_each(el, &ts->precompiled_modules) {
+        JSPrecompiledModule *pm = list_entry(el, JSPrecompiledModule, link);
+        if (!strcmp(pm->module_name, module_name)) {
+            func_val = JS_UNDEFINED;
+            if (pm->buf) {
+                func_val = JS_ReadObject(ctx, pm->buf, pm->buf_len,
+                                         JS_READ_OBJ_BYTECODE);
+            }
+            /* a module is only loaded once */
+            free_precompiled_module(pm);
+            if (!JS_IsUndefined(func_val))
+                return func_val;
+            break;
+        }
+    }
+
+    if (!ts->module_cache_dir || stat(module_name, &st) < 0)
+        return JS_Eval(ctx, (const char *)buf, buf_len, module_name,
+                       JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    key.size = buf_len;
+    key.mtime = st.st_mtime;
+    key.hash = module_cache_hash(MODULE_CACHE_HASH_INIT, buf, buf_len);
+    module_cache_get_filename(filename, sizeof(filename),
+                              ts->module_cache_dir, module_name);
+    func_val = module_cache_read(ctx, filename, module_name, &key);
+    if (!JS_IsUndefined(func_val))
+        return func_val;
+    func_val = JS_Eval(ctx, (const char *)buf, buf_len, module_name,
+                       JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    if (!JS_IsException(func_val))
+        module_cache_write(ctx, filename, module_name, &key, func_val);
+    return func_val;
+}
+
+void js_std_set_module_cache_dir(JSRuntime *rt, const char *dir)
+{
+    JSThreadState *ts = js_get_thread_state(rt);
+
+    js_free_rt(rt, ts->module_cache_dir);
+    ts->module_cache_dir = NULL;
+    if (dir) {
+        ts->module_cache_dir = js_malloc_rt(rt, strlen(dir) + 1);
+        if (ts->module_cache_dir)
+            strcpy(ts->module_cache_dir, dir);
+    }
+}
+
 JSModuleDef *js_module_loader(JSContext *ctx,
                               const char *module_name, void *opaque,
                               JSValueConst attributes)
@@ -910,8 +1158,7 @@ JSModuleDef *js_module_loader(JSContext *ctx,
         } else {
             JSValue func_val;
             /* compile the module */
-            func_val = JS_Eval(ctx, (char *)buf, buf_len, module_name,
-                               JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+            func_val = js_module_compile(ctx, buf, buf_len, module_name);
             js_free(ctx, buf);
             if (JS_IsException(func_val))
                 return NULL;
@@ -927,6 +1174,252 @@ JSModuleDef *js_module_loader(JSContext *ctx,
     return m;
 }
 
+#if JS_HAVE_THREADS
+
+/* Parallel compilation of the static import graph of a module. Each
+   thread compiles modules in a scratch runtime, serializes them with
+   JS_WriteObject() and adds their imports to the list of modules to
+   compile. js_module_loader() then reads the bytecode instead of
+   compiling the source. */
+
+typedef struct {
+    js_mutex_t mutex;
+    js_cond_t cond;
+    struct list_head modules; /* list of JSPrecompiledModule.link */
+    struct list_head *next; /* next module to compile */
+    int nb_busy; /* number of threads compiling a module */
+} JSModuleGraphCompiler;
+
+typedef struct {
+    JSModuleGraphCompiler *mgc;
+    char **names; /* modules imported by the module being compiled */
+    int nb_names;
+} JSModuleGraphThread;
+
+static int module_graph_stub_init(JSContext *ctx, JSModuleDef *m)
+{
+    return 0;
+}
+
+/* only record the imported modules: they are compiled later */
+static JSModuleDef *module_graph_loader(JSContext *ctx,
+                                        const char *module_name, void *opaque,
+                                        JSValueConst attributes)
+{
+    JSModuleGraphThread *mt = opaque;
+    char **names;
+    int res;
+
+    res = js_module_test_json(ctx, attributes);
+    if (res < 0)
+        return NULL;
+    if (!res && !js__has_suffix(module_name, ".json") &&
+        !js__has_suffix(module_name, QJS_NATIVE_MODULE_SUFFIX)) {
+        names = realloc(mt->names, (mt->nb_names + 1) * sizeof(mt->names[0]));
+        if (!names)
+            goto oom;
+        mt->names = names;
+        mt->names[mt->nb_names] = strdup(module_name);
+        if (!mt->names[mt->nb_names])
+            goto oom;
+        mt->nb_names++;
+    }
+    return JS_NewCModule(ctx, module_name, module_graph_stub_init);
+ oom:
+    JS_ThrowOutOfMemory(ctx);
+    return NULL;
+}
+
+/* errors are ignored: the module is compiled again by js_module_loader() */
+static void module_graph_compile(JSRuntime *rt, JSPrecompiledModule *pm)
+{
+    JSContext *ctx;
+    JSValue func_val;
+    uint8_t *buf, *bc;
+    size_t buf_len, bc_len;
+
+    ctx = JS_NewContext(rt);
+    if (!ctx)
+        return;
+    buf = js_load_file(ctx, &buf_len, pm->module_name);
+    if (!buf)
+        goto done;
+    func_val = JS_Eval(ctx, (char *)buf, buf_len, pm->module_name,
+                       JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    js_free(ctx, buf);
+    if (JS_IsException(func_val))
+        goto done;
+    bc = JS_WriteObject(ctx, &bc_len, func_val, JS_WRITE_OBJ_BYTECODE);
+    if (bc) {
+        pm->buf = malloc(bc_len);
+        if (pm->buf) {
+            memcpy(pm->buf, bc, bc_len);
+            pm->buf_len = bc_len;
+        }
+        js_free(ctx, bc);
+    }
+    JS_ResolveModule(ctx, func_val);
+    JS_FreeValue(ctx, func_val);
+ done:
+    JS_FreeContext(ctx);
+}
+
+static JSPrecompiledModule *module_graph_add(JSModuleGraphCompiler *mgc,
+                                             char *module_name)
+{
+    JSPrecompiledModule *pm;
+    struct list_head *el;
+
+    list_for_each(el, &mgc->modules) {
+        pm = list_entry(el, JSPrecompiledModule, link);
+        if (!strcmp(pm->module_name, module_name)) {
+            free(module_name);
+            return pm;
+        }
+    }
+    pm = calloc(1, sizeof(*pm));
+    if (!pm) {
+        free(module_name);
+        return NULL;
+    }
+    pm->module_name = module_name;
+    list_add_tail(&pm->link, &mgc->modules);
+    if (mgc->next == &mgc->modules)
+        mgc->next = &pm->link;
+    return pm;
+}
+
+static void module_graph_thread(void *opaque)
+{
+    JSModuleGraphThread *mt = opaque;
+    JSModuleGraphCompiler *mgc = mt->mgc;
+    JSPrecompiledModule *pm;
+    JSRuntime *rt;
+    int i;
+
+    rt = JS_NewRuntime();
+    if (rt)
+        JS_SetModuleLoaderFunc2(rt, NULL, module_graph_loader,
+                                js_module_check_attributes, mt);
+    js_mutex_lock(&mgc->mutex);
+    for(;;) {
+        if (mgc->next == &mgc->modules) {
+            if (mgc->nb_busy == 0 || !rt)
+                break;
+            js_cond_wait(&mgc->cond, &mgc->mutex);
+            continue;
+        }
+        pm = list_entry(mgc->next, JSPrecompiledModule, link);
+        mgc->next = mgc->next->next;
+        mgc->nb_busy++;
+        js_mutex_unlock(&mgc->mutex);
+
+        module_graph_compile(rt, pm);
+
+        js_mutex_lock(&mgc->mutex);
+        for(i = 0; i < mt->nb_names; i++)
+            module_graph_add(mgc, mt->names[i]);
+        mt->nb_names = 0;
+        mgc->nb_busy--;
+        js_cond_broadcast(&mgc->cond);
+    }
+    /* wake up the threads waiting for more modules */
+    js_cond_broadcast(&mgc->cond);
+    js_mutex_unlock(&mgc->mutex);
+    if (rt)
+        JS_FreeRuntime(rt);
+}
+
+JSValue js_std_compile_module_graph(JSContext *ctx, const char *module_name,
+                                    int nb_threads)
+{
+    JSThreadState *ts = js_get_thread_state(JS_GetRuntime(ctx));
+    JSModuleGraphCompiler mgc_s, *mgc = &mgc_s;
+    JSModuleGraphThread *mt;
+    JSPrecompiledModule *pm;
+    js_thread_t *threads;
+    struct list_head *el, *el1;
+    JSValue func_val;
+    char *name;
+    int i, n;
+
+    if (nb_threads < 1)
+        nb_threads = 1;
+    js_mutex_init(&mgc->mutex);
+    js_cond_init(&mgc->cond);
+    init_list_head(&mgc->modules);
+    mgc->next = &mgc->modules;
+    mgc->nb_busy = 0;
+    threads = js_mallocz(ctx, nb_threads * sizeof(threads[0]));
+    mt = js_mallocz(ctx, nb_threads * sizeof(mt[0]));
+    name = strdup(module_name);
+    if (!threads || !mt || !name)
+        goto oom;
+    pm = module_graph_add(mgc, name);
+    if (!pm)
+        goto oom;
+
+    n = 0;
+    for(i = 0; i < nb_threads; i++) {
+        mt[i].mgc = mgc;
+        if (js_thread_create(&threads[n], module_graph_thread, &mt[i], 0))
+            break;
+        n++;
+    }
+    if (n == 0) {
+        /* compile on the current thread */
+        module_graph_thread(&mt[0]);
+    }
+    for(i = 0; i < n; i++)
+        js_thread_join(threads[i]);
+
+    /* the main module is returned to the caller. Reading it loads its
+       imports, so the other modules must be available before. */
+    list_del(&pm->link);
+    list_for_each_safe(el, el1, &mgc->modules) {
+        JSPrecompiledModule *pm1 = list_entry(el, JSPrecompiledModule, link);
+        list_del(&pm1->link);
+        list_add_tail(&pm1->link, &ts->precompiled_modules);
+    }
+    func_val = JS_UNDEFINED;
+    if (pm->buf) {
+        func_val = JS_ReadObject(ctx, pm->buf, pm->buf_len,
+                                 JS_READ_OBJ_BYTECODE);
+        if (JS_IsException(func_val)) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+            func_val = JS_UNDEFINED;
+        }
+    }
+    free(pm->module_name);
+    free(pm->buf);
+    free(pm);
+    for(i = 0; i < nb_threads; i++)
+        free(mt[i].names);
+    js_free(ctx, threads);
+    js_free(ctx, mt);
+    js_cond_destroy(&mgc->cond);
+    js_mutex_destroy(&mgc->mutex);
+    return func_val;
+ oom:
+    free(name);
+    js_free(ctx, threads);
+    js_free(ctx, mt);
+    js_cond_destroy(&mgc->cond);
+    js_mutex_destroy(&mgc->mutex);
+    return JS_ThrowOutOfMemory(ctx);
+}
+
+#else
+
+JSValue js_std_compile_module_graph(JSContext *ctx, const char *module_name,
+                                    int nb_threads)
+{
+    /* the modules are compiled when they are loaded */
+    return JS_UNDEFINED;
+}
+
+#endif /* JS_HAVE_THREADS */
+
 static JSValue js_std_exit(JSContext *ctx, JSValueConst this_val,
                            int argc, JSValueConst *argv)
 {
@@ -4599,6 +5092,7 @@ static void js_std_finalize(JSRuntime *rt, void *arg)
 {
     JSThreadState *ts = arg;
     js_set_thread_state(rt, NULL);
+    js_free_rt(rt, ts->module_cache_dir);
     js_free_rt(rt, ts);
 }
 
@@ -4616,6 +5110,7 @@ void js_std_init_handlers(JSRuntime *rt)
     init_list_head(&ts->os_timers);
     init_list_head(&ts->port_list);
     init_list_head(&ts->rejected_promise_list);
+    init_list_head(&ts->precompiled_modules);
 
     ts->next_timer_id = 1;
 
@@ -4668,6 +5163,11 @@ void js_std_free_handlers(JSRuntime *rt)
         free_rp(rt, rp);
     }
 
+    list_for_each_safe(el, el1, &ts->precompiled_modules) {
+        JSPrecompiledModule *pm = list_entry(el, JSPrecompiledModule, link);
+        free_precompiled_module(pm);
+    }
+
 #ifdef USE_WORKER
     /* XXX: free port_list ? */
     js_free_message_pipe(ts->recv_pipe);
@@ -4785,14 +5285,9 @@ int js_std_loop(JSContext *ctx)
 
     for(;;) {
         /* execute the pending jobs */
-        for(;;) {
-            err = JS_ExecutePendingJob(JS_GetRuntime(ctx), &ctx1);
-            if (err <= 0) {
-                if (err < 0)
-                    goto done;
-                break;
-            }
-        }
+        err = JS_ExecutePendingJobs(rt, -1, -1, &ctx1);
+        if (err < 0)
+            goto done;
 
         js_std_promise_rejection_check(ctx);
 
@@ -4811,13 +5306,9 @@ int js_std_loop_once(JSContext *ctx)
     int err, min_delay;
 
     /* execute all pending jobs */
-    for(;;) {
-        err = JS_ExecutePendingJob(rt, &ctx1);
-        if (err < 0)
-            return -2; /* error */
-        if (err == 0)
-            break;
-    }
+    err = JS_ExecutePendingJobs(rt, -1, -1, &ctx1);
+    if (err < 0)
+        return -2; /* error */
 
     /* run at most one expired timer */
     if (js_os_run_timers(rt, ctx, ts, &min_delay) < 0)
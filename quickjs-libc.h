@@ -58,6 +58,21 @@ JS_LIBC_EXTERN JSModuleDef *js_module_loader(JSContext *ctx,
 JS_LIBC_EXTERN int js_module_check_attributes(JSContext *ctx, void *opaque,
                                               JSValueConst attributes);
 JS_LIBC_EXTERN int js_module_test_json(JSContext *ctx, JSValueConst attributes);
+// Enable the bytecode cache of js_module_loader: the compiled modules
+// are stored in the directory 'dir', which must exist, and reused as
+// long as their source is unchanged. NULL disables the cache.
+// Call after js_std_init_handlers.
+JS_LIBC_EXTERN void js_std_set_module_cache_dir(JSRuntime *rt, const char *dir);
+// Compile the modules statically imported by the module 'module_name',
+// directly or indirectly, on 'nb_threads' threads. js_module_loader
+// then loads their bytecode instead of compiling them. Return the
+// module 'module_name', as JS_Eval() with JS_EVAL_TYPE_MODULE and
+// JS_EVAL_FLAG_COMPILE_ONLY, JS_UNDEFINED if it could not be compiled
+// (the caller compiles it to report the error) or JS_EXCEPTION if out of
+// memory. The other modules which cannot be compiled are ignored.
+JS_LIBC_EXTERN JSValue js_std_compile_module_graph(JSContext *ctx,
+                                                   const char *module_name,
+                                                   int nb_threads);
 JS_LIBC_EXTERN void js_std_eval_binary(JSContext *ctx, const uint8_t *buf,
                                        size_t buf_len, int flags);
 JS_LIBC_EXTERN void js_std_promise_rejection_tracker(JSContext *ctx,
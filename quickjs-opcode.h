@@ -77,6 +77,7 @@ DEF(      push_this, 1, 0, 1, none) /* only used at the start of a function */
 DEF(     push_false, 1, 0, 1, none)
 DEF(      push_true, 1, 0, 1, none)
 DEF(         object, 1, 0, 1, none)
+DEF(object_template, 5, 0, 1, const) /* object literal with static field names */
 DEF( special_object, 2, 0, 1, u8) /* only used at the start of a function */
 DEF(           rest, 3, 0, 1, u16) /* only used at the start of a function */
 
@@ -107,6 +108,10 @@ DEF(    call_method, 3, 2, 1, npop) /* arguments are not counted in n_pop */
 DEF(tail_call_method, 3, 2, 0, npop) /* arguments are not counted in n_pop */
 DEF(     array_from, 3, 0, 1, npop) /* arguments are not counted in n_pop */
 DEF(          apply, 3, 3, 1, u16)
+DEF(apply_arguments, 3, 4, 1, loc) /* this func this_arg arguments -> ret_val */
+DEF(get_arguments_length, 1, 1, 1, none) /* arguments -> length */
+DEF(get_loc_arguments, 3, 0, 1, loc) /* arguments, or its index if not built */
+DEF(get_arguments_el, 1, 2, 1, none) /* arguments prop -> value */
 DEF(         return, 1, 1, 0, none)
 DEF(   return_undef, 1, 0, 0, none)
 DEF(check_ctor_return, 1, 1, 2, none)
@@ -124,10 +129,12 @@ DEF(         regexp, 1, 2, 1, none) /* create a RegExp object from the pattern a
 DEF(      get_super, 1, 1, 1, none)
 DEF(         import, 1, 2, 1, none) /* dynamic module import */
 
-DEF(  get_var_undef, 5, 0, 1, atom) /* push undefined if the variable does not exist */
-DEF(        get_var, 5, 0, 1, atom) /* throw an exception if the variable does not exist */
-DEF(        put_var, 5, 1, 0, atom) /* must come after get_var */
-DEF(   put_var_init, 5, 1, 0, atom) /* must come after put_var. Used to initialize a global lexical variable */
+/* the u16 operand of the global variable accesses is the index of
+   their entry in the global variable cache of the function */
+DEF(  get_var_undef, 7, 0, 1, atom_u16) /* push undefined if the variable does not exist */
+DEF(        get_var, 7, 0, 1, atom_u16) /* throw an exception if the variable does not exist */
+DEF(        put_var, 7, 1, 0, atom_u16) /* must come after get_var */
+DEF(   put_var_init, 7, 1, 0, atom_u16) /* must come after put_var. Used to initialize a global lexical variable */
 
 DEF(  get_ref_value, 1, 2, 3, none)
 DEF(  put_ref_value, 1, 3, 0, none)
@@ -150,6 +157,7 @@ DEF(   put_array_el, 1, 3, 0, none)
 DEF(get_super_value, 1, 3, 1, none) /* this obj prop -> value */
 DEF(put_super_value, 1, 4, 0, none) /* this obj prop value -> */
 DEF(   define_field, 5, 2, 1, atom)
+DEF(define_field_slot, 5, 2, 1, u32) /* obj value -> obj, for object_template objects */
 DEF(       set_name, 5, 1, 1, atom)
 DEF(set_name_computed, 1, 2, 2, none)
 DEF(      set_proto, 1, 2, 1, none)
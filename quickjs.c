@@ -181,11 +181,10 @@ enum {
     JS_CLASS_PROMISE_RESOLVE_FUNCTION,  /* u.promise_function_data */
     JS_CLASS_PROMISE_REJECT_FUNCTION,   /* u.promise_function_data */
     JS_CLASS_ASYNC_FUNCTION,            /* u.func */
-    JS_CLASS_ASYNC_FUNCTION_RESOLVE,    /* u.async_function_data */
-    JS_CLASS_ASYNC_FUNCTION_REJECT,     /* u.async_function_data */
     JS_CLASS_ASYNC_FROM_SYNC_ITERATOR,  /* u.async_from_sync_iterator_data */
     JS_CLASS_ASYNC_GENERATOR_FUNCTION,  /* u.func */
     JS_CLASS_ASYNC_GENERATOR,   /* u.async_generator_data */
+    JS_CLASS_ARRAY_FROM_ASYNC,  /* u.array_from_async_data */
     JS_CLASS_WEAK_REF,
     JS_CLASS_FINALIZATION_REGISTRY,
     JS_CLASS_DOM_EXCEPTION,
@@ -228,6 +227,14 @@ typedef enum JSErrorEnum {
 /* rope depth at which we rebalance */
 #define JS_STRING_ROPE_MAX_DEPTH 60
 
+/* the stack frames of generators and async functions of at most
+   2^(JS_FRAME_CACHE_MIN_BITS + JS_FRAME_CACHE_CLASSES - 1) values are
+   kept in JSRuntime.frame_cache when freed, in a list per size class */
+#define JS_FRAME_CACHE_MIN_BITS 4
+#define JS_FRAME_CACHE_CLASSES 7
+/* maximum number of free frames kept per size class */
+#define JS_FRAME_CACHE_SIZE 8
+
 #define __exception __attribute__((warn_unused_result))
 
 typedef struct JSShape JSShape;
@@ -309,6 +316,18 @@ struct JSRuntime {
 
     JSInterruptHandler *interrupt_handler;
     void *interrupt_opaque;
+    struct JSProfiler *profiler; /* CPU profiler, NULL if not profiling */
+    /* allocation profiler, NULL if not profiling */
+    struct JSAllocProfiler *alloc_profiler;
+    struct JSTracer *tracer; /* event tracer, NULL if not tracing */
+    /* heap snapshot being written, for its mark functions */
+    struct JSHeapSnapshot *heap_snapshot;
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    uint64_t exec_opcode_count[256];
+    struct list_head exec_func_list; /* list of JSExecFuncStats.link */
+    struct JSExecFuncStats *exec_cur_func; /* NULL if no function is running */
+    uint64_t exec_last_time; /* time of the last call or return in ns */
+#endif
 
     JSPromiseHook *promise_hook;
     void *promise_hook_opaque;
@@ -319,7 +338,11 @@ struct JSRuntime {
     JSHostPromiseRejectionTracker *host_promise_rejection_tracker;
     void *host_promise_rejection_tracker_opaque;
 
-    struct list_head job_list; /* list of JSJobEntry.link */
+    /* circular buffer of pending jobs */
+    struct JSJobEntry *job_tab;
+    uint32_t job_size; /* power of two */
+    uint32_t job_head; /* index of the first pending job */
+    uint32_t job_count; /* number of pending jobs */
 
     bool module_normalize_has_attr;
     union {
@@ -342,11 +365,22 @@ struct JSRuntime {
     bool can_block; /* true if Atomics.wait can block */
     uint32_t dump_flags : 24;
 
-    /* Shape hash table */
+    /* Root shape hash table: one empty shape per prototype. The other
+       shared shapes are reached through the shape transitions. */
     int shape_hash_bits;
     int shape_hash_size;
     int shape_hash_count; /* number of hashed shapes */
     JSShape **shape_hash;
+    /* list of JSGCObjectHeader.link. Unreferenced shapes of the
+       transition tree, kept until the next GC so that they can be
+       reused */
+    struct list_head shape_cache_list;
+    int shape_cache_count;
+    bool shape_cache_evicting;
+    /* free stack frames of the generators and async functions, indexed
+       by size class. The most recently freed frame is first. */
+    struct JSFreeFrame *frame_cache[JS_FRAME_CACHE_CLASSES];
+    uint8_t frame_cache_count[JS_FRAME_CACHE_CLASSES];
     void *user_opaque;
     void *libc_opaque;
     JSRuntimeFinalizerState *finalizers;
@@ -368,6 +402,8 @@ typedef struct JSStackFrame {
     JSValue *arg_buf; /* arguments */
     JSValue *var_buf; /* variables */
     struct JSVarRef **var_refs; /* references to arguments or local variables */
+    struct JSVarRefBlock *var_ref_block; /* storage of the var refs, allocated
+                                            on the first capture */
     uint8_t *cur_pc; /* only used in bytecode functions : PC of the
                         instruction after the call */
     uint16_t var_ref_count; /* number of var refs */
@@ -406,22 +442,29 @@ typedef struct JSVarRef {
         struct {
             int __gc_ref_count; /* corresponds to header.ref_count */
             uint8_t __gc_mark; /* corresponds to header.mark/gc_obj_type */
-            uint8_t is_detached;
-            uint8_t is_lexical; /* only used with global variables */
-            uint8_t is_const; /* only used with global variables */
+            uint8_t is_detached : 1;
+            uint8_t is_in_block : 1; /* allocated in a JSVarRefBlock */
+            uint16_t var_ref_idx; /* index in JSStackFrame.var_refs[] */
         };
     };
     JSValue *pvalue; /* pointer to the value, either on the stack or
                         to 'value' */
     union {
         JSValue value; /* used when is_detached = true */
-        struct {
-            uint16_t var_ref_idx; /* index in JSStackFrame.var_refs[] */
-            JSStackFrame *stack_frame;
-        }; /* used when is_detached = false */
+        JSStackFrame *stack_frame; /* used when is_detached = false */
     };
 } JSVarRef;
 
+/* The variable references of a stack frame are allocated together the
+   first time a variable is captured. They are reused by all the
+   closures created in the frame. When the frame returns, the ones
+   still referenced by closures are detached in place and the block is
+   freed with the last of them. */
+typedef struct JSVarRefBlock {
+    int ref_count; /* 1 for the frame + number of detached var refs */
+    JSVarRef var_refs[];
+} JSVarRefBlock;
+
 typedef struct JSRefCountHeader {
     int ref_count;
 } JSRefCountHeader;
@@ -461,14 +504,18 @@ typedef enum {
     JS_AUTOINIT_ID_PROTOTYPE,
     JS_AUTOINIT_ID_MODULE_NS,
     JS_AUTOINIT_ID_PROP,
-    JS_AUTOINIT_ID_BYTECODE,
 } JSAutoInitIDEnum;
 
-enum {
-    JS_BUILTIN_ARRAY_FROMASYNC = 1,
-    JS_BUILTIN_ITERATOR_ZIP,
-    JS_BUILTIN_ITERATOR_ZIP_KEYED,
-};
+/* built-in iterables which for-of loops can enumerate without
+   iterator object */
+typedef enum {
+    JS_DIRECT_ENUM_ARRAY,
+    JS_DIRECT_ENUM_TYPED_ARRAY,
+    JS_DIRECT_ENUM_MAP,
+    JS_DIRECT_ENUM_SET,
+    JS_DIRECT_ENUM_STRING,
+    JS_DIRECT_ENUM_COUNT,
+} JSDirectEnumKindEnum;
 
 /* must be large enough to have a negligible runtime cost and small
    enough to call the interrupt callback often. */
@@ -512,11 +559,19 @@ struct JSContext {
     JSValue iterator_proto;
     JSValue async_iterator_proto;
     JSValue array_proto_values;
+    /* position of the [Symbol.iterator] method of the built-in
+       iterables and of the 'next' method of their iterators in the
+       shape of the prototype holding them (see js_get_direct_enum()) */
+    uint32_t direct_enum_iterator_idx[JS_DIRECT_ENUM_COUNT];
+    uint32_t direct_enum_next_idx[JS_DIRECT_ENUM_COUNT];
     JSValue throw_type_error;
     JSValue eval_obj;
 
     JSValue global_obj; /* global object */
     JSValue global_var_obj; /* contains the global let/const definitions */
+    /* incremented when a global lexical variable is defined: it may
+       shadow a global object property cached by OP_get_var/OP_put_var */
+    uint32_t global_var_gen;
 
     double time_origin;
 
@@ -527,6 +582,13 @@ struct JSContext {
 
     struct list_head loaded_modules; /* list of JSModuleDef.link */
 
+    /* compiled code of the indirect eval and Function constructor
+       calls, least recently used first */
+    struct list_head eval_cache_list; /* list of JSEvalCacheEntry.link */
+    int eval_cache_count;
+    int64_t eval_cache_hit_count;
+    int64_t eval_cache_miss_count;
+
     /* if NULL, RegExp compilation is not supported */
     JSValue (*compile_regexp)(JSContext *ctx, JSValueConst pattern,
                               JSValueConst flags);
@@ -553,32 +615,48 @@ typedef struct JSWeakRefRecord {
     JSWeakRefKindEnum kind;
     struct JSWeakRefRecord *next_weak_ref;
     union {
-        struct JSMapRecord *map_record;
+        struct JSMapState *map; /* the key is the weak reference target */
+        JSValue map_value; /* used in reset_weak_ref() */
         struct JSWeakRefData *weak_ref_data;
         struct JSFinRecEntry *fin_rec_entry;
     } u;
 } JSWeakRefRecord;
 
+#define MAP_NIL UINT32_MAX
+
+/* Map and Set records are stored in insertion order in a dense array.
+   A deleted record is kept as a tombstone (key = JS_UNINITIALIZED)
+   until the array is compacted. */
 typedef struct JSMapRecord {
-    int ref_count; /* used during enumeration to avoid freeing the record */
-    bool empty; /* true if the record is deleted */
-    struct JSMapState *map;
-    struct list_head link;
-    struct list_head hash_link;
     JSValue key;
     JSValue value;
+    uint32_t hash; /* map_hash_key(key) */
+    uint32_t hash_next; /* next record index in the hash bucket or MAP_NIL */
 } JSMapRecord;
 
+/* enumeration position, updated when the records are compacted */
+typedef struct JSMapCursor {
+    struct list_head link; /* in JSMapState.cursors */
+    uint32_t idx; /* index of the next record to visit */
+} JSMapCursor;
+
 typedef struct JSMapState {
     bool is_weak; /* true if WeakSet/WeakMap */
-    struct list_head records; /* list of JSMapRecord.link */
-    uint32_t record_count;
-    struct list_head *hash_table;
-    uint32_t hash_size; /* must be a power of two */
-    uint32_t record_count_threshold; /* count at which a hash table
-                                        resize is needed */
+    uint32_t record_count; /* number of live records */
+    uint32_t record_end; /* number of used records, including tombstones */
+    uint32_t record_size; /* allocated records */
+    JSMapRecord *records;
+    uint32_t *hash_table; /* first record index of each bucket */
+    uint32_t hash_size; /* must be a power of two, 0 if no records */
+    struct list_head cursors; /* list of JSMapCursor.link */
+    /* cursor of the for-of loop enumerating the map without iterator
+       object. Only linked while in use. */
+    JSMapCursor enum_cursor;
 } JSMapState;
 
+#define MAGIC_SET (1 << 0)
+#define MAGIC_WEAK (1 << 1)
+
 enum
 {
     JS_TO_STRING_IS_PROPERTY_KEY = 1 << 0,
@@ -617,6 +695,7 @@ struct JSString {
     uint32_t is_wide_char : 1; /* 0 = 8 bits, 1 = 16 bits characters */
     /* for JS_ATOM_TYPE_SYMBOL: hash = 0, atom_type = 3,
        for JS_ATOM_TYPE_PRIVATE: hash = 1, atom_type = 3
+       for non atoms: cached js_string_hash() or 0 if not computed yet
        XXX: could change encoding to have one more bit in hash */
     uint32_t hash : 28;
     uint32_t kind : 2;
@@ -638,6 +717,7 @@ struct JSStringRope {
     uint32_t len;
     uint8_t is_wide_char; /* 0 = 8 bits, 1 = 16 bits characters */
     uint8_t depth;        /* max depth of the rope tree */
+    uint32_t hash;        /* cached js_string_rope_hash(), 0 if not computed */
     JSValue left;
     JSValue right;        /* might be the empty string */
 };
@@ -764,6 +844,17 @@ typedef enum JSFunctionKindEnum {
     JS_FUNC_ASYNC_GENERATOR = (JS_FUNC_GENERATOR | JS_FUNC_ASYNC),
 } JSFunctionKindEnum;
 
+/* location of a global variable property, valid as long as the
+   property at 'prop_idx' still has the same atom and, for the global
+   object, no global lexical variable was defined since it was cached */
+typedef struct JSGlobalVarCache {
+    uint32_t prop_idx : 31;
+    uint32_t is_lexical : 1; /* property of global_var_obj */
+    uint32_t gen; /* ctx->global_var_gen when cached, 0 if empty */
+} JSGlobalVarCache;
+
+#define JS_GLOBAL_VAR_CACHE_NONE 0xffff
+
 typedef struct JSFunctionBytecode {
     JSGCObjectHeader header; /* must come first */
     uint8_t is_strict_mode : 1;
@@ -778,7 +869,16 @@ typedef struct JSFunctionBytecode {
     uint8_t super_allowed : 1;
     uint8_t arguments_allowed : 1;
     uint8_t backtrace_barrier : 1; /* stop backtrace on this function */
-    /* XXX: 5 bits available */
+    /* true if the bytecode is generated on the first call from 'source'.
+       Only the closure variables and the function properties are set. */
+    uint8_t is_lazy : 1;
+    uint8_t is_lazy_func_expr : 1;
+    uint8_t is_lazy_module : 1;
+    /* XXX: 1 bit available */
+    /* slack tracking: number of instances observed when used as
+       new.target and maximum property count of these instances */
+    uint8_t ctor_instance_count;
+    uint8_t ctor_prop_count;
     uint8_t *byte_code_buf; /* (self pointer) */
     int byte_code_len;
     JSAtom func_name;
@@ -790,16 +890,25 @@ typedef struct JSFunctionBytecode {
     uint16_t stack_size; /* maximum stack size */
     uint16_t var_ref_count; /* number of local variable references */
     uint16_t closure_var_count;
+    uint16_t global_var_cache_count;
+    JSGlobalVarCache *global_var_cache; /* allocated on first use */
     int cpool_count;
     JSContext *realm; /* function realm */
     JSValue *cpool; /* constant pool (self pointer) */
     JSAtom filename;
     int line_num;
     int col_num;
+    int lazy_source_col_num; /* column of 'source' as computed by the
+                                tokenizer (lazy functions only) */
     int source_len;
     int pc2line_len;
     uint8_t *pc2line_buf;
     char *source;
+    /* for lazy functions: bytecode generated on the first call */
+    struct JSFunctionBytecode *lazy_bytecode;
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    struct JSExecFuncStats *exec_stats; /* allocated on first call */
+#endif
 } JSFunctionBytecode;
 
 typedef struct JSBoundFunction {
@@ -825,13 +934,29 @@ typedef enum JSIteratorHelperKindEnum {
     JS_ITERATOR_HELPER_KIND_MAP,
     JS_ITERATOR_HELPER_KIND_SOME,
     JS_ITERATOR_HELPER_KIND_TAKE,
+    JS_ITERATOR_HELPER_KIND_ZIP,
+    JS_ITERATOR_HELPER_KIND_ZIP_KEYED,
 } JSIteratorHelperKindEnum;
 
+typedef struct JSArrayIteratorData {
+    JSValue obj;
+    JSIteratorKindEnum kind;
+    uint32_t idx;
+} JSArrayIteratorData;
+
+typedef struct JSMapIteratorData {
+    JSValue obj;
+    JSIteratorKindEnum kind;
+    JSMapCursor cursor; /* only linked while 'obj' is defined */
+} JSMapIteratorData;
+
 typedef struct JSForInIterator {
     JSValue obj;
     bool is_array;
     uint32_t array_length;
     uint32_t idx;
+    /* if not NULL, enumerate shape->enum_cache */
+    struct JSShape *shape;
 } JSForInIterator;
 
 typedef struct JSRegExp {
@@ -871,6 +996,8 @@ typedef struct JSAsyncFunctionState {
     JSValue this_val; /* 'this' generator argument */
     int argc; /* number of function arguments */
     bool throw_flag; /* used to throw an exception in JS_CallInternal() */
+    /* number of values of frame.arg_buf, 0 if it cannot be cached */
+    uint16_t frame_size;
     JSStackFrame frame;
 } JSAsyncFunctionState;
 
@@ -976,12 +1103,21 @@ struct JSModuleDef {
     JSValue private_value; /* private value for C modules */
 };
 
+/* the jobs enqueued by the engine have at most 5 arguments */
+#define JS_JOB_INLINE_ARGS 5
+#define JS_JOB_TAB_MIN_SIZE 16 /* the job buffer is kept if not larger */
+
 typedef struct JSJobEntry {
-    struct list_head link;
     JSContext *ctx;
     JSJobFunc *job_func;
+    /* if not NULL, the job resumes this async function with argv[0]
+       as awaited value and argv[1] as rejection flag */
+    JSAsyncFunctionData *async_func;
     int argc;
-    JSValue argv[];
+    union {
+        JSValue tab[JS_JOB_INLINE_ARGS]; /* argc <= JS_JOB_INLINE_ARGS */
+        JSValue *ptr; /* argc > JS_JOB_INLINE_ARGS */
+    } argv;
 } JSJobEntry;
 
 typedef struct JSProperty {
@@ -1004,6 +1140,18 @@ typedef struct JSProperty {
 
 #define JS_PROP_INITIAL_SIZE 2
 #define JS_PROP_INITIAL_HASH_SIZE 4 /* must be a power of two */
+/* number of instances observed before the initial property array size
+   of the objects created by a constructor is frozen */
+#define JS_CTOR_SLACK_TRACKING_COUNT 8
+/* objects with more properties leave the shape transition tree and
+   switch to dictionary mode */
+#define JS_SHAPE_MAX_TRANSITION_PROPS 64
+/* maximum number of unreferenced shapes kept in JSRuntime.shape_cache_list */
+#define JS_SHAPE_CACHE_SIZE 128
+/* maximum number of entries of JSContext.eval_cache_list */
+#define JS_EVAL_CACHE_SIZE 64
+/* longer sources are not kept in JSContext.eval_cache_list */
+#define JS_EVAL_CACHE_MAX_SOURCE_LEN 65536
 #define JS_ARRAY_INITIAL_SIZE 2
 
 typedef struct JSShapeProperty {
@@ -1012,19 +1160,47 @@ typedef struct JSShapeProperty {
     JSAtom atom; /* JS_ATOM_NULL = free property entry */
 } JSShapeProperty;
 
+/* enumerable string keys of an object, in for-in order, as returned
+   by JS_GetOwnPropertyNamesInternal(JS_GPN_STRING_MASK |
+   JS_GPN_ENUM_ONLY). The atoms are owned by the shape. */
+typedef struct JSShapeEnumEntry {
+    JSAtom atom;
+    uint32_t prop_idx; /* index in JSShape.prop and JSObject.prop */
+} JSShapeEnumEntry;
+
+typedef struct JSShapeEnumCache {
+    uint32_t count;
+    JSShapeEnumEntry tab[];
+} JSShapeEnumCache;
+
 struct JSShape {
     /* hash table of size hash_mask + 1 before the start of the
        structure (see prop_hash_end()). */
     JSGCObjectHeader header;
-    /* true if the shape is inserted in the shape hash table. If not,
-       JSShape.hash is not valid */
+    /* true if the shape is part of the shape transition tree: it is
+       immutable and may be shared by several objects. If false, the
+       shape is in dictionary mode: it belongs to a single object and
+       is modified in place. */
     uint8_t is_hashed;
-    uint32_t hash; /* current hash value */
+    uint32_t hash; /* hash value, only valid for root shapes */
     uint32_t prop_hash_mask;
     int prop_size; /* allocated properties */
     int prop_count; /* include deleted properties */
     int deleted_prop_count;
     JSShape *shape_hash_next; /* in JSRuntime.shape_hash[h] list */
+    /* shape from which this one was derived by adding its last
+       property. NULL for the root shapes and the dictionary shapes. */
+    JSShape *parent;
+    /* shapes derived from this one by adding a property. They are
+       weak references: each child holds a reference to its parent. */
+    uint32_t transition_count;
+    uint32_t transition_size; /* 0 if the single transition is inline */
+    union {
+        JSShape *transition; /* transition_size == 0 */
+        JSShape **transitions; /* open addressing, transition_size entries */
+    } u;
+    /* lazily built for the shapes of the transition tree */
+    JSShapeEnumCache *enum_cache;
     JSObject *proto;
     JSShapeProperty prop[]; /* prop_size elements */
 };
@@ -1073,9 +1249,9 @@ struct JSObject {
         struct JSProxyData *proxy_data; /* JS_CLASS_PROXY */
         struct JSPromiseData *promise_data; /* JS_CLASS_PROMISE */
         struct JSPromiseFunctionData *promise_function_data; /* JS_CLASS_PROMISE_RESOLVE_FUNCTION, JS_CLASS_PROMISE_REJECT_FUNCTION */
-        struct JSAsyncFunctionData *async_function_data; /* JS_CLASS_ASYNC_FUNCTION_RESOLVE, JS_CLASS_ASYNC_FUNCTION_REJECT */
         struct JSAsyncFromSyncIteratorData *async_from_sync_iterator_data; /* JS_CLASS_ASYNC_FROM_SYNC_ITERATOR */
         struct JSAsyncGeneratorData *async_generator_data; /* JS_CLASS_ASYNC_GENERATOR */
+        struct JSArrayFromAsyncData *array_from_async_data; /* JS_CLASS_ARRAY_FROM_ASYNC */
         struct { /* JS_CLASS_BYTECODE_FUNCTION: 12/24 bytes */
             /* also used by JS_CLASS_GENERATOR_FUNCTION, JS_CLASS_ASYNC_FUNCTION and JS_CLASS_ASYNC_GENERATOR_FUNCTION */
             struct JSFunctionBytecode *function_bytecode;
@@ -1195,6 +1371,10 @@ static JSAtom __JS_NewAtomInit(JSRuntime *rt, const char *str, int len,
                                int atom_type);
 static void JS_FreeAtomStruct(JSRuntime *rt, JSAtomStruct *p);
 static void free_function_bytecode(JSRuntime *rt, JSFunctionBytecode *b);
+#ifndef QJS_DISABLE_PARSER
+static JSFunctionBytecode *js_compile_lazy_function(JSContext *ctx,
+                                                    JSFunctionBytecode *lb);
+#endif
 static JSValue js_call_c_function(JSContext *ctx, JSValueConst func_obj,
                                   JSValueConst this_obj,
                                   int argc, JSValueConst *argv, int flags);
@@ -1305,6 +1485,7 @@ static JSValue js_compile_regexp(JSContext *ctx, JSValueConst pattern,
 static JSValue js_regexp_constructor_internal(JSContext *ctx, JSValueConst ctor,
                                               JSValue pattern, JSValue bc);
 static void gc_decref(JSRuntime *rt);
+static void __JS_RunGC(JSRuntime *rt, bool flush_eval_cache);
 static int JS_NewClass1(JSRuntime *rt, JSClassID class_id,
                         const JSClassDef *class_def, JSAtom name);
 static JSValue js_array_push(JSContext *ctx, JSValueConst this_val,
@@ -1345,7 +1526,10 @@ static int JS_CreateProperty(JSContext *ctx, JSObject *p,
                              JSValueConst getter, JSValueConst setter,
                              int flags);
 static int js_string_memcmp(JSString *p1, JSString *p2, int len);
-static void reset_weak_ref(JSRuntime *rt, JSWeakRefRecord **first_weak_ref);
+static void reset_weak_ref(JSRuntime *rt, JSValueConst key,
+                           JSWeakRefRecord **first_weak_ref);
+static JSMapRecord *map_find_weak_record(JSMapState *s, JSValueConst key);
+static void map_unlink_record(JSMapState *s, JSMapRecord *mr);
 static bool is_valid_weakref_target(JSValueConst val);
 static void insert_weakref_record(JSValueConst target,
                                   struct JSWeakRefRecord *wr);
@@ -1381,10 +1565,12 @@ static JSValue js_call_generator_function(JSContext *ctx, JSValueConst func_obj,
                                           JSValueConst this_obj,
                                           int argc, JSValueConst *argv,
                                           int flags);
-static void js_async_function_resolve_finalizer(JSRuntime *rt,
-                                                JSValueConst val);
-static void js_async_function_resolve_mark(JSRuntime *rt, JSValueConst val,
-                                           JS_MarkFunc *mark_func);
+static void js_async_function_free(JSRuntime *rt,
+                                   JSAsyncFunctionData *s);
+static JSValue js_async_function_await_resume(JSContext *ctx,
+                                              JSAsyncFunctionData *s,
+                                              JSValueConst value,
+                                              bool is_reject);
 static JSValue JS_EvalInternal(JSContext *ctx, JSValueConst this_obj,
                                const char *input, size_t input_len,
                                const char *filename, int line, int flags, int scope_idx);
@@ -1402,6 +1588,9 @@ static __exception int perform_promise_then(JSContext *ctx,
                                             JSValueConst promise,
                                             JSValueConst *resolve_reject,
                                             JSValueConst *cap_resolving_funcs);
+static __exception int perform_promise_await(JSContext *ctx,
+                                             JSValueConst promise,
+                                             JSAsyncFunctionData *s);
 static JSValue js_promise_resolve(JSContext *ctx, JSValueConst this_val,
                                   int argc, JSValueConst *argv, int magic);
 static JSValue js_promise_then(JSContext *ctx, JSValueConst this_val,
@@ -1422,6 +1611,7 @@ static JSValue JS_GetOwnPropertyNames2(JSContext *ctx, JSValueConst obj1,
 static void js_free_desc(JSContext *ctx, JSPropertyDescriptor *desc);
 static void async_func_mark(JSRuntime *rt, JSAsyncFunctionState *s,
                             JS_MarkFunc *mark_func);
+static void js_frame_cache_flush(JSRuntime *rt);
 static void JS_AddIntrinsicBasicObjects(JSContext *ctx);
 static void js_free_shape(JSRuntime *rt, JSShape *sh);
 static void js_free_shape_null(JSRuntime *rt, JSShape *sh);
@@ -1438,11 +1628,46 @@ static void free_arg_list(JSContext *ctx, JSValue *tab, uint32_t len);
 static JSValue *build_arg_list(JSContext *ctx, uint32_t *plen,
                                JSValueConst array_arg);
 static JSValue js_create_array(JSContext *ctx, int len, JSValueConst *tab);
+static int check_function(JSContext *ctx, JSValueConst obj);
 static bool js_get_fast_array(JSContext *ctx, JSValue obj,
                               JSValue **arrpp, uint32_t *countp);
 static int expand_fast_array(JSContext *ctx, JSObject *p, uint32_t new_len);
 static JSValue JS_CreateAsyncFromSyncIterator(JSContext *ctx,
                                               JSValue sync_iter);
+static void js_profile_free(JSRuntime *rt);
+static void js_alloc_profile_free(JSRuntime *rt);
+static void js_alloc_profile_sample(JSRuntime *rt, void *ptr, size_t size);
+static void js_alloc_profile_forget(JSRuntime *rt, void *ptr);
+
+typedef enum JSTraceEventEnum {
+    JS_TRACE_GC,
+    JS_TRACE_GC_DECREF,
+    JS_TRACE_GC_SCAN,
+    JS_TRACE_GC_FREE_CYCLES,
+    JS_TRACE_EVAL,
+    JS_TRACE_EVAL_FUNCTION,
+    JS_TRACE_COMPILE,
+    JS_TRACE_COMPILE_LAZY,
+    JS_TRACE_LOAD_MODULE,
+    JS_TRACE_RUN_JOBS,
+    JS_TRACE_JOB,
+    JS_TRACE_COUNT,
+} JSTraceEventEnum;
+
+/* return the start time of an event, 0 if not tracing */
+static inline uint64_t js_trace_begin(JSRuntime *rt)
+{
+    if (likely(!rt->tracer))
+        return 0;
+    return js__hrtime_ns();
+}
+
+static void js_trace_end(JSRuntime *rt, JSTraceEventEnum type, uint64_t start,
+                         const char *detail, int64_t arg);
+static void js_trace_free(JSRuntime *rt);
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+static void js_exec_free(JSRuntime *rt);
+#endif
 static void js_c_function_data_finalizer(JSRuntime *rt, JSValueConst val);
 static void js_c_function_data_mark(JSRuntime *rt, JSValueConst val,
                                     JS_MarkFunc *mark_func);
@@ -1572,6 +1797,7 @@ JSValue JS_DupValueRT(JSRuntime *rt, JSValueConst v)
 
 static void js_trigger_gc(JSRuntime *rt, size_t size)
 {
+    size_t limit;
     bool force_gc;
 #ifdef FORCE_GC_AT_MALLOC
     force_gc = true;
@@ -1585,7 +1811,10 @@ static void js_trigger_gc(JSRuntime *rt, size_t size)
             printf("GC: size=%zd\n", rt->malloc_state.malloc_size);
         }
 #endif
-        JS_RunGC(rt);
+        /* low memory: more than 3/4 of the limit is used */
+        limit = rt->malloc_state.malloc_limit;
+        __JS_RunGC(rt, limit != 0 && rt->malloc_state.malloc_size + size >
+                   limit - (limit >> 2));
         rt->malloc_gc_threshold = rt->malloc_state.malloc_size +
             (rt->malloc_state.malloc_size >> 1);
     }
@@ -1619,6 +1848,8 @@ void *js_calloc_rt(JSRuntime *rt, size_t count, size_t size)
 
     s->malloc_count++;
     s->malloc_size += rt->mf.js_malloc_usable_size(ptr) + MALLOC_OVERHEAD;
+    if (unlikely(rt->alloc_profiler))
+        js_alloc_profile_sample(rt, ptr, count * size);
     return ptr;
 }
 
@@ -1641,6 +1872,8 @@ void *js_malloc_rt(JSRuntime *rt, size_t size)
 
     s->malloc_count++;
     s->malloc_size += rt->mf.js_malloc_usable_size(ptr) + MALLOC_OVERHEAD;
+    if (unlikely(rt->alloc_profiler))
+        js_alloc_profile_sample(rt, ptr, size);
     return ptr;
 }
 
@@ -1659,6 +1892,8 @@ void js_free_rt(JSRuntime *rt, void *ptr)
     }
     s->malloc_count--;
     s->malloc_size -= free_size;
+    if (unlikely(rt->alloc_profiler))
+        js_alloc_profile_forget(rt, ptr);
     rt->mf.js_free(s->opaque, ptr);
 }
 
@@ -1666,6 +1901,7 @@ void *js_realloc_rt(JSRuntime *rt, void *ptr, size_t size)
 {
     size_t old_size;
     JSMallocState *s;
+    void *new_ptr;
 
     if (!ptr) {
         if (size == 0)
@@ -1682,12 +1918,17 @@ void *js_realloc_rt(JSRuntime *rt, void *ptr, size_t size)
     if (s->malloc_size + size - old_size > s->malloc_limit - 1)
         return NULL;
 
-    ptr = rt->mf.js_realloc(s->opaque, ptr, size);
-    if (!ptr)
+    new_ptr = rt->mf.js_realloc(s->opaque, ptr, size);
+    if (!new_ptr)
         return NULL;
 
-    s->malloc_size += rt->mf.js_malloc_usable_size(ptr) - old_size;
-    return ptr;
+    s->malloc_size += rt->mf.js_malloc_usable_size(new_ptr) - old_size;
+    /* counted as a new allocation */
+    if (unlikely(rt->alloc_profiler)) {
+        js_alloc_profile_forget(rt, ptr);
+        js_alloc_profile_sample(rt, new_ptr, size);
+    }
+    return new_ptr;
 }
 
 size_t js_malloc_usable_size_rt(JSRuntime *rt, const void *ptr)
@@ -1971,11 +2212,14 @@ JSRuntime *JS_NewRuntime2(const JSMallocFunctions *mf, void *opaque)
     init_list_head(&rt->gc_obj_list);
     init_list_head(&rt->gc_zero_ref_count_list);
     rt->gc_phase = JS_GC_PHASE_NONE;
+    init_list_head(&rt->shape_cache_list);
 
 #ifdef ENABLE_DUMPS // JS_DUMP_LEAKS
     init_list_head(&rt->string_list);
 #endif
-    init_list_head(&rt->job_list);
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    init_list_head(&rt->exec_func_list);
+#endif
 
     if (JS_InitAtoms(rt))
         goto fail;
@@ -2122,63 +2366,198 @@ void JS_SetSharedArrayBufferFunctions(JSRuntime *rt,
     rt->sab_funcs = *sf;
 }
 
+static inline JSValue *js_job_argv(JSJobEntry *e)
+{
+    if (e->argc <= JS_JOB_INLINE_ARGS)
+        return e->argv.tab;
+    else
+        return e->argv.ptr;
+}
+
+static void js_free_job_rt(JSRuntime *rt, JSJobEntry *e)
+{
+    JSValue *argv = js_job_argv(e);
+    int i;
+
+    for(i = 0; i < e->argc; i++)
+        JS_FreeValueRT(rt, argv[i]);
+    if (e->argc > JS_JOB_INLINE_ARGS)
+        js_free_rt(rt, argv);
+    if (e->async_func)
+        js_async_function_free(rt, e->async_func);
+}
+
+static no_inline int js_resize_job_tab(JSContext *ctx)
+{
+    JSRuntime *rt = ctx->rt;
+    JSJobEntry *tab;
+    uint32_t new_size, n;
+
+    new_size = max_int(rt->job_size * 2, JS_JOB_TAB_MIN_SIZE);
+    tab = js_malloc(ctx, sizeof(tab[0]) * new_size);
+    if (!tab)
+        return -1;
+    /* move the pending jobs to the start of the new buffer */
+    if (rt->job_count != 0) {
+        n = min_uint32(rt->job_count, rt->job_size - rt->job_head);
+        memcpy(tab, rt->job_tab + rt->job_head, sizeof(tab[0]) * n);
+        memcpy(tab + n, rt->job_tab, sizeof(tab[0]) * (rt->job_count - n));
+    }
+    js_free(ctx, rt->job_tab);
+    rt->job_tab = tab;
+    rt->job_size = new_size;
+    rt->job_head = 0;
+    return 0;
+}
+
 /* return 0 if OK, < 0 if exception */
 int JS_EnqueueJob(JSContext *ctx, JSJobFunc *job_func,
                   int argc, JSValueConst *argv)
 {
     JSRuntime *rt = ctx->rt;
     JSJobEntry *e;
+    JSValue *tab;
     int i;
 
     assert(!rt->in_free);
 
-    e = js_malloc(ctx, sizeof(*e) + argc * sizeof(JSValue));
-    if (!e)
-        return -1;
+    if (unlikely(rt->job_count == rt->job_size)) {
+        if (js_resize_job_tab(ctx))
+            return -1;
+    }
+    if (argc <= JS_JOB_INLINE_ARGS) {
+        tab = NULL;
+    } else {
+        tab = js_malloc(ctx, sizeof(tab[0]) * argc);
+        if (!tab)
+            return -1;
+    }
+    e = &rt->job_tab[(rt->job_head + rt->job_count) & (rt->job_size - 1)];
+    rt->job_count++;
     e->ctx = ctx;
     e->job_func = job_func;
+    e->async_func = NULL;
     e->argc = argc;
+    if (tab)
+        e->argv.ptr = tab;
+    tab = js_job_argv(e);
     for(i = 0; i < argc; i++) {
-        e->argv[i] = js_dup(argv[i]);
+        tab[i] = js_dup(argv[i]);
     }
-    list_add_tail(&e->link, &rt->job_list);
+    return 0;
+}
+
+/* enqueue the resumption of the async function 's' awaiting 'value' */
+static int js_enqueue_await_job(JSContext *ctx, JSAsyncFunctionData *s,
+                                JSValueConst value, bool is_reject)
+{
+    JSRuntime *rt = ctx->rt;
+    JSJobEntry *e;
+
+    if (unlikely(rt->job_count == rt->job_size)) {
+        if (js_resize_job_tab(ctx))
+            return -1;
+    }
+    e = &rt->job_tab[(rt->job_head + rt->job_count) & (rt->job_size - 1)];
+    rt->job_count++;
+    e->ctx = ctx;
+    e->job_func = NULL;
+    e->async_func = s;
+    s->header.ref_count++;
+    e->argc = 2;
+    e->argv.tab[0] = js_dup(value);
+    e->argv.tab[1] = js_bool(is_reject);
     return 0;
 }
 
 bool JS_IsJobPending(JSRuntime *rt)
 {
-    return !list_empty(&rt->job_list);
+    return rt->job_count != 0;
+}
+
+/* execute the first pending job. Return < 0 if exception, 1 otherwise */
+static int js_execute_job(JSRuntime *rt, JSContext **pctx)
+{
+    JSJobEntry e;
+    JSValue res;
+    uint64_t start;
+
+    start = js_trace_begin(rt);
+    /* the job may enqueue other jobs, so it is removed from the
+       buffer before being executed */
+    e = rt->job_tab[rt->job_head];
+    rt->job_head = (rt->job_head + 1) & (rt->job_size - 1);
+    rt->job_count--;
+    /* a burst of jobs does not keep a large buffer allocated */
+    if (rt->job_count == 0 && rt->job_size > JS_JOB_TAB_MIN_SIZE) {
+        js_free_rt(rt, rt->job_tab);
+        rt->job_tab = NULL;
+        rt->job_size = 0;
+        rt->job_head = 0;
+    }
+    if (e.async_func) {
+        res = js_async_function_await_resume(e.ctx, e.async_func,
+                                             e.argv.tab[0],
+                                             JS_VALUE_GET_BOOL(e.argv.tab[1]));
+    } else {
+        res = e.job_func(e.ctx, e.argc, vc(js_job_argv(&e)));
+    }
+    js_free_job_rt(rt, &e);
+    js_trace_end(rt, JS_TRACE_JOB, start, NULL, 0);
+    *pctx = e.ctx;
+    if (JS_IsException(res))
+        return -1;
+    JS_FreeValue(e.ctx, res);
+    return 1;
 }
 
 /* return < 0 if exception, 0 if no job pending, 1 if a job was
    executed successfully. the context of the job is stored in '*pctx' */
 int JS_ExecutePendingJob(JSRuntime *rt, JSContext **pctx)
 {
-    JSContext *ctx;
-    JSJobEntry *e;
-    JSValue res;
-    int i, ret;
-
-    if (list_empty(&rt->job_list)) {
+    if (rt->job_count == 0) {
         *pctx = NULL;
         return 0;
     }
+    return js_execute_job(rt, pctx);
+}
 
-    /* get the first pending job and execute it */
-    e = list_entry(rt->job_list.next, JSJobEntry, link);
-    list_del(&e->link);
-    ctx = e->ctx;
-    res = e->job_func(e->ctx, e->argc, vc(e->argv));
-    for(i = 0; i < e->argc; i++)
-        JS_FreeValue(ctx, e->argv[i]);
-    if (JS_IsException(res))
-        ret = -1;
-    else
-        ret = 1;
-    JS_FreeValue(ctx, res);
-    js_free(ctx, e);
-    *pctx = ctx;
-    return ret;
+/* Execute the pending jobs, including the ones they enqueue, until
+   none is left, 'max_jobs' jobs were executed or 'budget_us'
+   microseconds elapsed. A negative 'max_jobs' or 'budget_us' means no
+   limit. Return < 0 if a job raised an exception, otherwise the number
+   of executed jobs. The context of the last executed job is stored in
+   '*pctx' (NULL if none). */
+int JS_ExecutePendingJobs(JSRuntime *rt, int max_jobs, int64_t budget_us,
+                          JSContext **pctx)
+{
+    uint64_t deadline, start;
+    uint32_t i;
+    int n, ret;
+
+    *pctx = NULL;
+    start = js_trace_begin(rt);
+    deadline = 0;
+    if (budget_us >= 0)
+        deadline = js__hrtime_ns() + budget_us * 1000;
+    n = 0;
+    ret = 0;
+    for(i = 0; n != max_jobs && rt->job_count != 0; i++) {
+        ret = js_execute_job(rt, pctx);
+        /* the number of jobs is not bounded if max_jobs < 0 */
+        if (n < INT32_MAX)
+            n++;
+        if (ret < 0)
+            break;
+        /* reading the clock is not free */
+        if (budget_us >= 0 && (i & 15) == 15 && js__hrtime_ns() >= deadline)
+            break;
+    }
+    if (n != 0)
+        js_trace_end(rt, JS_TRACE_RUN_JOBS, start, NULL, n);
+    if (ret < 0)
+        return -1;
+    return n;
 }
 
 static inline uint32_t atom_get_free(const JSAtomStruct *p)
@@ -2267,19 +2646,35 @@ void JS_SetRuntimeInfo(JSRuntime *rt, const char *s)
 
 void JS_FreeRuntime(JSRuntime *rt)
 {
+#ifdef ENABLE_DUMPS
     struct list_head *el, *el1;
+#endif
     int i;
 
     rt->in_free = true;
     JS_FreeValueRT(rt, rt->current_exception);
 
-    list_for_each_safe(el, el1, &rt->job_list) {
-        JSJobEntry *e = list_entry(el, JSJobEntry, link);
-        for(i = 0; i < e->argc; i++)
-            JS_FreeValueRT(rt, e->argv[i]);
-        js_free_rt(rt, e);
+    while (rt->job_count != 0) {
+        js_free_job_rt(rt, &rt->job_tab[rt->job_head]);
+        rt->job_head = (rt->job_head + 1) & (rt->job_size - 1);
+        rt->job_count--;
     }
-    init_list_head(&rt->job_list);
+    js_free_rt(rt, rt->job_tab);
+    rt->job_tab = NULL;
+    rt->job_size = 0;
+
+    if (rt->profiler)
+        js_profile_free(rt);
+    if (rt->alloc_profiler)
+        js_alloc_profile_free(rt);
+    if (rt->tracer)
+        js_trace_free(rt);
+
+#ifdef ENABLE_DUMPS // JS_DUMP_SHAPES
+    /* the contexts are usually only freed by the final GC */
+    if (check_dump_flag(rt, JS_DUMP_SHAPES))
+        JS_DumpShapes(rt);
+#endif
 
     JS_RunGC(rt);
 
@@ -2325,6 +2720,12 @@ void JS_FreeRuntime(JSRuntime *rt)
 
     assert(list_empty(&rt->gc_obj_list));
 
+    js_frame_cache_flush(rt);
+
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    js_exec_free(rt);
+#endif
+
     /* free the classes */
     for(i = 0; i < rt->class_count; i++) {
         JSClass *cl = &rt->class_array[i];
@@ -2492,6 +2893,7 @@ JSContext *JS_NewContextRaw(JSRuntime *rt)
     ctx->error_prepare_stack = JS_UNDEFINED;
     ctx->error_stack_trace_limit = js_int32(10);
     init_list_head(&ctx->loaded_modules);
+    init_list_head(&ctx->eval_cache_list);
 
     JS_AddIntrinsicBasicObjects(ctx);
     return ctx;
@@ -2582,6 +2984,31 @@ static void js_free_modules(JSContext *ctx, JSFreeModuleEnum flag)
     }
 }
 
+typedef struct JSEvalCacheEntry {
+    struct list_head link;
+    JSValue func_obj; /* function bytecode */
+    uint32_t hash;
+    int flags;
+    size_t len;
+    char source[]; /* not null terminated */
+} JSEvalCacheEntry;
+
+static void js_eval_cache_remove(JSContext *ctx, JSEvalCacheEntry *e)
+{
+    list_del(&e->link);
+    ctx->eval_cache_count--;
+    JS_FreeValue(ctx, e->func_obj);
+    js_free(ctx, e);
+}
+
+static void js_eval_cache_flush(JSContext *ctx)
+{
+    while (!list_empty(&ctx->eval_cache_list)) {
+        js_eval_cache_remove(ctx, list_entry(ctx->eval_cache_list.next,
+                                             JSEvalCacheEntry, link));
+    }
+}
+
 JSContext *JS_DupContext(JSContext *ctx)
 {
     ctx->header.ref_count++;
@@ -2602,6 +3029,11 @@ static void JS_MarkContext(JSRuntime *rt, JSContext *ctx,
         js_mark_module_def(rt, m, mark_func);
     }
 
+    list_for_each(el, &ctx->eval_cache_list) {
+        JSEvalCacheEntry *e = list_entry(el, JSEvalCacheEntry, link);
+        JS_MarkValue(rt, e->func_obj, mark_func);
+    }
+
     JS_MarkValue(rt, ctx->global_obj, mark_func);
     JS_MarkValue(rt, ctx->global_var_obj, mark_func);
 
@@ -2657,10 +3089,6 @@ void JS_FreeContext(JSContext *ctx)
     if (check_dump_flag(rt, JS_DUMP_ATOMS))
         JS_DumpAtoms(ctx->rt);
 #endif
-#ifdef ENABLE_DUMPS // JS_DUMP_SHAPES
-    if (check_dump_flag(rt, JS_DUMP_SHAPES))
-        JS_DumpShapes(ctx->rt);
-#endif
 #ifdef ENABLE_DUMPS // JS_DUMP_OBJECTS
     if (check_dump_flag(rt, JS_DUMP_OBJECTS)) {
         struct list_head *el;
@@ -2683,6 +3111,7 @@ void JS_FreeContext(JSContext *ctx)
 #endif
 
     js_free_modules(ctx, JS_FREE_MODULE_ALL);
+    js_eval_cache_flush(ctx);
 
     JS_FreeValue(ctx, ctx->global_obj);
     JS_FreeValue(ctx, ctx->global_var_obj);
@@ -2867,6 +3296,42 @@ static uint32_t hash_string_rope(JSValueConst val, uint32_t h)
     }
 }
 
+/* Hash of the string contents. It is the same as the hash of the
+   JS_ATOM_TYPE_STRING atom with the same contents, so it is directly
+   available for atoms and lazily computed and cached for the other
+   strings. Return 0 if the hash is not known yet. */
+static inline uint32_t js_string_cached_hash(JSString *p)
+{
+    if (p->atom_type == 0 || p->atom_type == JS_ATOM_TYPE_STRING)
+        return p->hash;
+    return 0;
+}
+
+static uint32_t js_string_hash(JSString *p)
+{
+    uint32_t h;
+
+    h = js_string_cached_hash(p);
+    if (h == 0) {
+        h = hash_string(p, JS_ATOM_TYPE_STRING) & JS_ATOM_HASH_MASK;
+        if (p->atom_type == 0)
+            p->hash = h;
+    }
+    return h;
+}
+
+static uint32_t js_string_rope_hash(JSValueConst val)
+{
+    JSStringRope *r;
+
+    if (JS_VALUE_GET_TAG(val) == JS_TAG_STRING)
+        return js_string_hash(JS_VALUE_GET_STRING(val));
+    r = JS_VALUE_GET_STRING_ROPE(val);
+    if (r->hash == 0)
+        r->hash = hash_string_rope(val, JS_ATOM_TYPE_STRING) & JS_ATOM_HASH_MASK;
+    return r->hash;
+}
+
 static __maybe_unused void JS_DumpString(JSRuntime *rt, JSString *p)
 {
     int i, c, sep;
@@ -3289,7 +3754,7 @@ static void JS_FreeAtomStruct(JSRuntime *rt, JSAtomStruct *p)
     rt->atom_array[i] = atom_set_free(rt->atom_free_index);
     rt->atom_free_index = i;
     if (unlikely(p->first_weak_ref)) {
-        reset_weak_ref(rt, &p->first_weak_ref);
+        reset_weak_ref(rt, JS_MKPTR(JS_TAG_SYMBOL, p), &p->first_weak_ref);
     }
     /* free the string structure */
 #ifdef ENABLE_DUMPS // JS_DUMP_LEAKS
@@ -4644,8 +5109,14 @@ static int js_string_memcmp(JSString *p1, JSString *p2, int len)
 }
 
 static bool js_string_eq(JSString *p1, JSString *p2) {
+    uint32_t h1, h2;
+
     if (p1->len != p2->len)
         return false;
+    h1 = js_string_cached_hash(p1);
+    h2 = js_string_cached_hash(p2);
+    if (h1 != 0 && h2 != 0 && h1 != h2)
+        return false;
     return js_string_memcmp(p1, p2, p1->len) == 0;
 }
 
@@ -4836,6 +5307,7 @@ static JSValue js_new_string_rope(JSContext *ctx, JSValue op1, JSValue op2)
     r->len = len;
     r->is_wide_char = is_wide_char;
     r->depth = depth + 1;
+    r->hash = 0;
     r->left = op1;
     r->right = op2;
     res = JS_MKPTR(JS_TAG_STRING_ROPE, r);
@@ -5056,9 +5528,11 @@ static JSValue JS_ConcatString2(JSContext *ctx, JSValue op1, JSValue op2)
     if (p2->len == 0) {
         goto ret_op1;
     }
-    if (p1->header.ref_count == 1 && p1->is_wide_char == p2->is_wide_char
+    if (p1->header.ref_count == 1 && p1->atom_type == 0
+    &&  p1->is_wide_char == p2->is_wide_char
     &&  js_malloc_usable_size(ctx, p1) >= sizeof(*p1) + ((p1->len + p2->len) << p2->is_wide_char) + 1 - p1->is_wide_char) {
         /* Concatenate in place in available space at the end of p1 */
+        p1->hash = 0; /* invalidate the cached hash */
         if (p1->is_wide_char) {
             memcpy(str16(p1) + p1->len, str16(p2), p2->len << 1);
             p1->len += p2->len;
@@ -5286,6 +5760,11 @@ static no_inline JSShape *js_new_shape2(JSContext *ctx, JSObject *proto,
     sh->prop_size = prop_size;
     sh->prop_count = 0;
     sh->deleted_prop_count = 0;
+    sh->parent = NULL;
+    sh->transition_count = 0;
+    sh->transition_size = 0;
+    sh->u.transition = NULL;
+    sh->enum_cache = NULL;
 
     /* insert in the hash table */
     sh->hash = shape_initial_hash(proto);
@@ -5294,12 +5773,6 @@ static no_inline JSShape *js_new_shape2(JSContext *ctx, JSObject *proto,
     return sh;
 }
 
-static JSShape *js_new_shape(JSContext *ctx, JSObject *proto)
-{
-    return js_new_shape2(ctx, proto, JS_PROP_INITIAL_HASH_SIZE,
-                         JS_PROP_INITIAL_SIZE);
-}
-
 static JSObject *object_or_null(JSValueConst val)
 {
     if (JS_TAG_OBJECT == JS_VALUE_GET_TAG(val))
@@ -5307,23 +5780,23 @@ static JSObject *object_or_null(JSValueConst val)
     return NULL;
 }
 
-static int add_shape_property(JSContext *ctx, JSShape **psh,
-                              JSObject *p, JSAtom atom, int prop_flags);
+static JSShape *js_get_root_shape(JSContext *ctx, JSObject *proto);
+static JSShape *js_shape_transition(JSContext *ctx, JSShape *sh,
+                                    JSAtom atom, int prop_flags);
+static void js_free_shape(JSRuntime *rt, JSShape *sh);
 
 static JSShape *js_new_shape_with2(JSContext *ctx, JSObject *proto,
                                    int prop_count, const JSShapeProperty props[]) {
-    JSShape *sh;
+    JSShape *sh, *new_sh;
     int i;
 
-    sh = js_new_shape2(ctx, proto, JS_PROP_INITIAL_HASH_SIZE, prop_count);
-    if (sh)
-        for (i = 0; i < prop_count; i++)
-            if (add_shape_property(ctx, &sh, NULL, props[i].atom, props[i].flags))
-                goto fail;
+    sh = js_get_root_shape(ctx, proto);
+    for (i = 0; sh && i < prop_count; i++) {
+        new_sh = js_shape_transition(ctx, sh, props[i].atom, props[i].flags);
+        js_free_shape(ctx->rt, sh);
+        sh = new_sh;
+    }
     return sh;
-fail:
-    js_free_shape(ctx->rt, sh);
-    return NULL;
 }
 
 static int js_new_shape_with(JSContext *ctx, JSShape **psh, JSValueConst proto,
@@ -5335,7 +5808,7 @@ static int js_new_shape_with(JSContext *ctx, JSShape **psh, JSValueConst proto,
 }
 
 /* The shape is cloned. The new shape is not inserted in the shape
-   hash table */
+   transition tree */
 static JSShape *js_clone_shape(JSContext *ctx, JSShape *sh1)
 {
     JSShape *sh;
@@ -5355,6 +5828,11 @@ static JSShape *js_clone_shape(JSContext *ctx, JSShape *sh1)
     sh->header.ref_count = 1;
     add_gc_object(ctx->rt, &sh->header, JS_GC_OBJ_TYPE_SHAPE);
     sh->is_hashed = false;
+    sh->parent = NULL;
+    sh->transition_count = 0;
+    sh->transition_size = 0;
+    sh->u.transition = NULL;
+    sh->enum_cache = NULL;
     if (sh->proto) {
         js_dup(JS_MKPTR(JS_TAG_OBJECT, sh->proto));
     }
@@ -5370,14 +5848,19 @@ static JSShape *js_dup_shape(JSShape *sh)
     return sh;
 }
 
+static void js_shape_unlink(JSRuntime *rt, JSShape *sh);
+
 static void js_free_shape0(JSRuntime *rt, JSShape *sh)
 {
     uint32_t i;
     JSShapeProperty *pr;
 
     assert(sh->header.ref_count == 0);
+    assert(sh->transition_count == 0);
     if (sh->is_hashed)
-        js_shape_hash_unlink(rt, sh);
+        js_shape_unlink(rt, sh);
+    if (sh->transition_size != 0)
+        js_free_rt(rt, sh->u.transitions);
     if (sh->proto != NULL) {
         JS_FreeValueRT(rt, JS_MKPTR(JS_TAG_OBJECT, sh->proto));
     }
@@ -5390,10 +5873,67 @@ static void js_free_shape0(JSRuntime *rt, JSShape *sh)
     js_free_rt(rt, get_alloc_from_shape(sh));
 }
 
+/* move a shape from the shape cache back to the GC object list */
+static void js_shape_cache_remove(JSRuntime *rt, JSShape *sh)
+{
+    list_del(&sh->header.link);
+    list_add_tail(&sh->header.link, &rt->gc_obj_list);
+    rt->shape_cache_count--;
+}
+
+static void js_shape_cache_evict(JSRuntime *rt)
+{
+    JSShape *sh;
+
+    /* freeing a shape may put its parent in the cache */
+    sh = list_entry(rt->shape_cache_list.next, JSShape, header.link);
+    js_shape_cache_remove(rt, sh);
+    js_free_shape0(rt, sh);
+}
+
+/* Keep an unreferenced shape of the transition tree so that the next
+   objects built the same way do not have to recreate the shape
+   chain. The cached shapes are not GC objects: the cache is flushed
+   before each GC so that they cannot retain garbage prototypes. */
+static void js_shape_cache_add(JSRuntime *rt, JSShape *sh)
+{
+    list_del(&sh->header.link);
+    list_add_tail(&sh->header.link, &rt->shape_cache_list);
+    rt->shape_cache_count++;
+    if (rt->shape_cache_count > JS_SHAPE_CACHE_SIZE &&
+        !rt->shape_cache_evicting) {
+        rt->shape_cache_evicting = true;
+        while (rt->shape_cache_count > JS_SHAPE_CACHE_SIZE)
+            js_shape_cache_evict(rt);
+        rt->shape_cache_evicting = false;
+    }
+}
+
+static void js_shape_cache_flush(JSRuntime *rt)
+{
+    rt->shape_cache_evicting = true;
+    while (!list_empty(&rt->shape_cache_list))
+        js_shape_cache_evict(rt);
+    rt->shape_cache_evicting = false;
+}
+
+/* return a new reference to a shape of the transition tree */
+static JSShape *js_dup_hashed_shape(JSRuntime *rt, JSShape *sh)
+{
+    if (sh->header.ref_count == 0)
+        js_shape_cache_remove(rt, sh);
+    return js_dup_shape(sh);
+}
+
 static void js_free_shape(JSRuntime *rt, JSShape *sh)
 {
     if (unlikely(--sh->header.ref_count <= 0)) {
-        js_free_shape0(rt, sh);
+        if (sh->is_hashed && !rt->in_free &&
+            rt->gc_phase != JS_GC_PHASE_REMOVE_CYCLES) {
+            js_shape_cache_add(rt, sh);
+        } else {
+            js_free_shape0(rt, sh);
+        }
     }
 }
 
@@ -5538,35 +6078,22 @@ static int compact_properties(JSContext *ctx, JSObject *p)
     return 0;
 }
 
+/* add a property to an unshared shape (dictionary mode or shape being
+   created) */
 static int add_shape_property(JSContext *ctx, JSShape **psh,
                               JSObject *p, JSAtom atom, int prop_flags)
 {
-    JSRuntime *rt = ctx->rt;
     JSShape *sh = *psh;
     JSShapeProperty *pr, *prop;
-    uint32_t hash_mask, new_shape_hash = 0;
+    uint32_t hash_mask;
     intptr_t h;
 
-    /* update the shape hash */
-    if (sh->is_hashed) {
-        js_shape_hash_unlink(rt, sh);
-        new_shape_hash = shape_hash(shape_hash(sh->hash, atom), prop_flags);
-    }
-
+    assert(!sh->is_hashed);
     if (unlikely(sh->prop_count >= sh->prop_size)) {
-        if (resize_properties(ctx, psh, p, sh->prop_count + 1)) {
-            /* in case of error, reinsert in the hash table.
-               sh is still valid if resize_properties() failed */
-            if (sh->is_hashed)
-                js_shape_hash_link(rt, sh);
+        if (resize_properties(ctx, psh, p, sh->prop_count + 1))
             return -1;
-        }
         sh = *psh;
     }
-    if (sh->is_hashed) {
-        sh->hash = new_shape_hash;
-        js_shape_hash_link(rt, sh);
-    }
     /* Initialize the new shape property.
        The object property at p->prop[sh->prop_count] is uninitialized */
     prop = sh->prop;
@@ -5581,9 +6108,10 @@ static int add_shape_property(JSContext *ctx, JSShape **psh,
     return 0;
 }
 
-/* find a hashed empty shape matching the prototype. Return NULL if
-   not found */
-static JSShape *find_hashed_shape_proto(JSRuntime *rt, JSObject *proto)
+/* find a hashed empty shape matching the prototype and the initial
+   property array size. Return NULL if not found */
+static JSShape *find_hashed_shape_proto(JSRuntime *rt, JSObject *proto,
+                                        int prop_size)
 {
     JSShape *sh1;
     uint32_t h, h1;
@@ -5593,55 +6121,224 @@ static JSShape *find_hashed_shape_proto(JSRuntime *rt, JSObject *proto)
     for(sh1 = rt->shape_hash[h1]; sh1 != NULL; sh1 = sh1->shape_hash_next) {
         if (sh1->hash == h &&
             sh1->proto == proto &&
-            sh1->prop_count == 0) {
+            sh1->prop_count == 0 &&
+            sh1->prop_size == prop_size) {
             return sh1;
         }
     }
     return NULL;
 }
 
-/* find a hashed shape matching sh + (prop, prop_flags). Return NULL if
-   not found */
-static JSShape *find_hashed_shape_prop(JSRuntime *rt, JSShape *sh,
-                                       JSAtom atom, int prop_flags)
+/* return a new reference to the root shape for 'proto' whose
+   objects have room for 'prop_size' properties, creating it if
+   necessary. Each size has its own transition tree. Return NULL if
+   memory error. */
+static JSShape *js_get_root_shape2(JSContext *ctx, JSObject *proto,
+                                   int prop_size)
+{
+    JSShape *sh;
+    int hash_size;
+
+    sh = find_hashed_shape_proto(ctx->rt, proto, prop_size);
+    if (likely(sh))
+        return js_dup_hashed_shape(ctx->rt, sh);
+    hash_size = JS_PROP_INITIAL_HASH_SIZE;
+    while (hash_size < prop_size)
+        hash_size *= 2;
+    return js_new_shape2(ctx, proto, hash_size, prop_size);
+}
+
+static JSShape *js_get_root_shape(JSContext *ctx, JSObject *proto)
+{
+    return js_get_root_shape2(ctx, proto, JS_PROP_INITIAL_SIZE);
+}
+
+static inline uint32_t shape_transition_hash(JSAtom atom, int prop_flags)
+{
+    return shape_hash(atom, prop_flags);
+}
+
+/* the property added by the transition leading to 'sh' */
+static inline JSShapeProperty *get_shape_transition_prop(JSShape *sh)
+{
+    return &sh->prop[sh->prop_count - 1];
+}
+
+/* find the shape derived from 'sh' by adding (atom, prop_flags).
+   Return NULL if not found */
+static JSShape *find_shape_transition(JSShape *sh, JSAtom atom,
+                                      int prop_flags)
 {
     JSShape *sh1;
-    uint32_t h, h1, i, n;
+    JSShapeProperty *pr;
+    uint32_t h, mask;
 
-    h = sh->hash;
-    h = shape_hash(h, atom);
-    h = shape_hash(h, prop_flags);
-    h1 = get_shape_hash(h, rt->shape_hash_bits);
-    for(sh1 = rt->shape_hash[h1]; sh1 != NULL; sh1 = sh1->shape_hash_next) {
-        /* we test the hash first so that the rest is done only if the
-           shapes really match */
-        if (sh1->hash == h &&
-            sh1->proto == sh->proto &&
-            sh1->prop_count == ((n = sh->prop_count) + 1)) {
-            for(i = 0; i < n; i++) {
-                if (unlikely(sh1->prop[i].atom != sh->prop[i].atom) ||
-                    unlikely(sh1->prop[i].flags != sh->prop[i].flags))
-                    goto next;
-            }
-            if (unlikely(sh1->prop[n].atom != atom) ||
-                unlikely(sh1->prop[n].flags != prop_flags))
-                goto next;
-            return sh1;
+    if (sh->transition_size == 0) {
+        sh1 = sh->u.transition;
+        if (sh1) {
+            pr = get_shape_transition_prop(sh1);
+            if (pr->atom == atom && pr->flags == prop_flags)
+                return sh1;
         }
-    next: ;
+        return NULL;
+    }
+    mask = sh->transition_size - 1;
+    h = shape_transition_hash(atom, prop_flags) & mask;
+    while ((sh1 = sh->u.transitions[h]) != NULL) {
+        pr = get_shape_transition_prop(sh1);
+        if (pr->atom == atom && pr->flags == prop_flags)
+            return sh1;
+        h = (h + 1) & mask;
     }
     return NULL;
 }
 
-static __maybe_unused void JS_DumpShape(JSRuntime *rt, int i, JSShape *sh)
+static void shape_transition_insert(JSShape **tab, uint32_t mask,
+                                    JSShape *sh1)
+{
+    JSShapeProperty *pr;
+    uint32_t h;
+
+    pr = get_shape_transition_prop(sh1);
+    h = shape_transition_hash(pr->atom, pr->flags) & mask;
+    while (tab[h] != NULL)
+        h = (h + 1) & mask;
+    tab[h] = sh1;
+}
+
+static int resize_shape_transitions(JSContext *ctx, JSShape *sh,
+                                    uint32_t new_size)
+{
+    JSShape **new_tab;
+    uint32_t i;
+
+    new_tab = js_mallocz(ctx, sizeof(new_tab[0]) * new_size);
+    if (!new_tab)
+        return -1;
+    if (sh->transition_size == 0) {
+        if (sh->u.transition)
+            shape_transition_insert(new_tab, new_size - 1, sh->u.transition);
+    } else {
+        for(i = 0; i < sh->transition_size; i++) {
+            if (sh->u.transitions[i])
+                shape_transition_insert(new_tab, new_size - 1,
+                                        sh->u.transitions[i]);
+        }
+        js_free(ctx, sh->u.transitions);
+    }
+    sh->u.transitions = new_tab;
+    sh->transition_size = new_size;
+    return 0;
+}
+
+/* record 'sh1' as derived from 'sh'. The first transition is stored
+   inline, a table is used when there are several. */
+static int add_shape_transition(JSContext *ctx, JSShape *sh, JSShape *sh1)
+{
+    if (sh->transition_size == 0 && sh->u.transition == NULL) {
+        sh->u.transition = sh1;
+    } else {
+        if (2 * (sh->transition_count + 1) > sh->transition_size) {
+            if (resize_shape_transitions(ctx, sh,
+                                         max_int(4, 2 * sh->transition_size)))
+                return -1;
+        }
+        shape_transition_insert(sh->u.transitions, sh->transition_size - 1,
+                                sh1);
+    }
+    sh->transition_count++;
+    return 0;
+}
+
+static void remove_shape_transition(JSShape *sh, JSShape *sh1)
+{
+    JSShapeProperty *pr;
+    JSShape **tab, *sh2;
+    uint32_t i, j, k, mask;
+
+    if (sh->transition_size == 0) {
+        assert(sh->u.transition == sh1);
+        sh->u.transition = NULL;
+    } else {
+        tab = sh->u.transitions;
+        mask = sh->transition_size - 1;
+        pr = get_shape_transition_prop(sh1);
+        i = shape_transition_hash(pr->atom, pr->flags) & mask;
+        while (tab[i] != sh1)
+            i = (i + 1) & mask;
+        /* backward shift deletion: no tombstones are needed */
+        tab[i] = NULL;
+        for(j = (i + 1) & mask; (sh2 = tab[j]) != NULL; j = (j + 1) & mask) {
+            pr = get_shape_transition_prop(sh2);
+            k = shape_transition_hash(pr->atom, pr->flags) & mask;
+            /* move sh2 to the free slot if its home slot 'k' is not
+               cyclically in ]i, j] */
+            if ((i <= j) ? (k <= i || k > j) : (k <= i && k > j)) {
+                tab[i] = sh2;
+                tab[j] = NULL;
+                i = j;
+            }
+        }
+    }
+    sh->transition_count--;
+}
+
+/* remove 'sh' from the transition tree. Its parent may be freed. */
+static void js_shape_unlink(JSRuntime *rt, JSShape *sh)
+{
+    JSShape *parent;
+
+    assert(sh->is_hashed);
+    parent = sh->parent;
+    if (parent) {
+        remove_shape_transition(parent, sh);
+        sh->parent = NULL;
+        js_free_shape(rt, parent);
+    } else {
+        js_shape_hash_unlink(rt, sh);
+    }
+    /* the shape becomes mutable */
+    js_free_rt(rt, sh->enum_cache);
+    sh->enum_cache = NULL;
+    sh->is_hashed = false;
+}
+
+/* return a new reference to the shape derived from the shared shape
+   'sh' by adding the property (atom, prop_flags). The shape is created
+   and inserted in the transition tree if it does not exist. Return
+   NULL if memory error. */
+static JSShape *js_shape_transition(JSContext *ctx, JSShape *sh,
+                                    JSAtom atom, int prop_flags)
+{
+    JSShape *new_sh;
+
+    assert(sh->is_hashed);
+    new_sh = find_shape_transition(sh, atom, prop_flags);
+    if (new_sh)
+        return js_dup_hashed_shape(ctx->rt, new_sh);
+    new_sh = js_clone_shape(ctx, sh);
+    if (!new_sh)
+        return NULL;
+    if (add_shape_property(ctx, &new_sh, NULL, atom, prop_flags) ||
+        add_shape_transition(ctx, sh, new_sh)) {
+        js_free_shape(ctx->rt, new_sh);
+        return NULL;
+    }
+    new_sh->is_hashed = true;
+    new_sh->parent = js_dup_shape(sh);
+    return new_sh;
+}
+
+static __maybe_unused void JS_DumpShape(JSRuntime *rt, JSShape *sh)
 {
     char atom_buf[ATOM_GET_STR_BUF_SIZE];
     int j;
 
     /* XXX: should output readable class prototype */
-    printf("%5d %3d%c %14p %5d %5d", i,
+    printf("%4d%c %5d %14p %5d %5d",
            sh->header.ref_count, " *"[sh->is_hashed],
-           (void *)sh->proto, sh->prop_size, sh->prop_count);
+           sh->transition_count, (void *)sh->proto,
+           sh->prop_size, sh->prop_count);
     for(j = 0; j < sh->prop_count; j++) {
         printf(" %s", JS_AtomGetStrRT(rt, atom_buf, sizeof(atom_buf),
                                       sh->prop[j].atom));
@@ -5651,31 +6348,49 @@ static __maybe_unused void JS_DumpShape(JSRuntime *rt, int i, JSShape *sh)
 
 static __maybe_unused void JS_DumpShapes(JSRuntime *rt)
 {
-    int i;
     JSShape *sh;
     struct list_head *el;
-    JSObject *p;
     JSGCObjectHeader *gp;
+    int tree_count, root_count, dict_count, parent_count, fanout_max;
+    int64_t fanout_total;
 
+    tree_count = root_count = dict_count = parent_count = fanout_max = 0;
+    fanout_total = 0;
     printf("JSShapes: {\n");
-    printf("%5s %4s %14s %5s %5s %s\n", "SLOT", "REFS", "PROTO", "SIZE", "COUNT", "PROPS");
-    for(i = 0; i < rt->shape_hash_size; i++) {
-        for(sh = rt->shape_hash[i]; sh != NULL; sh = sh->shape_hash_next) {
-            JS_DumpShape(rt, i, sh);
-            assert(sh->is_hashed);
-        }
-    }
-    /* dump non-hashed shapes */
+    printf("%5s %5s %14s %5s %5s %s\n", "REFS", "TRANS", "PROTO", "SIZE", "COUNT", "PROPS");
     list_for_each(el, &rt->gc_obj_list) {
         gp = list_entry(el, JSGCObjectHeader, link);
-        if (gp->gc_obj_type == JS_GC_OBJ_TYPE_JS_OBJECT) {
-            p = (JSObject *)gp;
-            if (!p->shape->is_hashed) {
-                JS_DumpShape(rt, -1, p->shape);
-            }
+        if (gp->gc_obj_type != JS_GC_OBJ_TYPE_SHAPE)
+            continue;
+        sh = (JSShape *)gp;
+        JS_DumpShape(rt, sh);
+        if (!sh->is_hashed) {
+            dict_count++;
+            continue;
         }
+        tree_count++;
+        if (!sh->parent)
+            root_count++;
+        if (sh->transition_count != 0) {
+            parent_count++;
+            fanout_total += sh->transition_count;
+            fanout_max = max_int(fanout_max, sh->transition_count);
+        }
+    }
+    /* the cached shapes have no transitions */
+    list_for_each(el, &rt->shape_cache_list) {
+        sh = list_entry(el, JSShape, header.link);
+        JS_DumpShape(rt, sh);
+        tree_count++;
+        if (!sh->parent)
+            root_count++;
     }
     printf("}\n");
+    printf("%d shapes in transition tree (%d roots, %d cached), %d dictionary shapes\n",
+           tree_count, root_count, rt->shape_cache_count, dict_count);
+    printf("transition fan-out: avg %.2f, max %d\n",
+           parent_count ? (double)fanout_total / parent_count : 0.0,
+           fanout_max);
 }
 
 /* 'props[]' is used to initialized the object properties. The number
@@ -5806,14 +6521,9 @@ JSValue JS_NewObjectProtoClass(JSContext *ctx, JSValueConst proto_val,
     JSObject *proto;
 
     proto = object_or_null(proto_val);
-    sh = find_hashed_shape_proto(ctx->rt, proto);
-    if (likely(sh)) {
-        sh = js_dup_shape(sh);
-    } else {
-        sh = js_new_shape(ctx, proto);
-        if (!sh)
-            return JS_EXCEPTION;
-    }
+    sh = js_get_root_shape(ctx, proto);
+    if (!sh)
+        return JS_EXCEPTION;
     return JS_NewObjectFromShape(ctx, sh, class_id, NULL);
 }
 
@@ -5857,45 +6567,57 @@ JSValue JS_NewObjectFrom(JSContext *ctx, int count, const JSAtom *props,
 {
     JSShapeProperty *pr;
     uint32_t *hash;
-    JSRuntime *rt;
     JSObject *p;
-    JSShape *sh;
+    JSShape *sh, *new_sh;
     JSValue obj;
     JSAtom atom;
     intptr_t h;
     int i;
 
-    rt = ctx->rt;
-    obj = JS_NewObject(ctx);
-    if (JS_IsException(obj))
+    sh = js_get_root_shape(ctx, object_or_null(ctx->class_proto[JS_CLASS_OBJECT]));
+    if (!sh)
         return JS_EXCEPTION;
-    if (count > 0) {
-        p = JS_VALUE_GET_OBJ(obj);
-        sh = p->shape;
-        assert(sh->is_hashed);
-        assert(sh->header.ref_count == 1);
-        js_shape_hash_unlink(rt, sh);
-        if (resize_properties(ctx, &sh, p, count)) {
-            js_shape_hash_link(rt, sh);
-            JS_FreeValue(ctx, obj);
-            return JS_EXCEPTION;
-        }
-        p->shape = sh;
+    if (count <= JS_SHAPE_MAX_TRANSITION_PROPS) {
+        /* follow the transition tree so that objects with the same
+           keys share their shape */
         for (i = 0; i < count; i++) {
-            atom = props[i];
-            pr = &sh->prop[i];
-            sh->hash = shape_hash(shape_hash(sh->hash, atom), JS_PROP_C_W_E);
-            h = atom & sh->prop_hash_mask;
-            hash = &prop_hash_end(sh)[-h - 1];
-            pr->hash_next = *hash;
-            *hash = i + 1;
-            pr->atom = JS_DupAtom(ctx, atom);
-            pr->flags = JS_PROP_C_W_E;
-            p->prop[i].u.value = values[i];
+            new_sh = js_shape_transition(ctx, sh, props[i], JS_PROP_C_W_E);
+            js_free_shape(ctx->rt, sh);
+            if (!new_sh)
+                return JS_EXCEPTION;
+            sh = new_sh;
         }
-        js_shape_hash_link(rt, sh);
-        sh->prop_count = count;
+        obj = JS_NewObjectFromShape(ctx, sh, JS_CLASS_OBJECT, NULL);
+        if (JS_IsException(obj))
+            return JS_EXCEPTION;
+        p = JS_VALUE_GET_OBJ(obj);
+        for (i = 0; i < count; i++)
+            p->prop[i].u.value = values[i];
+        return obj;
+    }
+    obj = JS_NewObjectFromShape(ctx, sh, JS_CLASS_OBJECT, NULL);
+    if (JS_IsException(obj))
+        return JS_EXCEPTION;
+    /* too many properties: directly build a dictionary shape */
+    p = JS_VALUE_GET_OBJ(obj);
+    if (js_shape_prepare_update(ctx, p, NULL) ||
+        resize_properties(ctx, &p->shape, p, count)) {
+        JS_FreeValue(ctx, obj);
+        return JS_EXCEPTION;
     }
+    sh = p->shape;
+    for (i = 0; i < count; i++) {
+        atom = props[i];
+        pr = &sh->prop[i];
+        h = atom & sh->prop_hash_mask;
+        hash = &prop_hash_end(sh)[-h - 1];
+        pr->hash_next = *hash;
+        *hash = i + 1;
+        pr->atom = JS_DupAtom(ctx, atom);
+        pr->flags = JS_PROP_C_W_E;
+        p->prop[i].u.value = values[i];
+    }
+    sh->prop_count = count;
     return obj;
 }
 
@@ -5929,6 +6651,30 @@ out:
     return ret;
 }
 
+/* create an object with the shape of the object literal template
+   'tpl' (see js_emit_object_template()). The property values are
+   undefined until set by OP_define_field_slot. */
+static JSValue js_create_from_object_template(JSContext *ctx,
+                                              JSValueConst tpl)
+{
+    JSObject *p;
+    JSShape *sh;
+    JSValue obj;
+    int i;
+
+    /* the parser limits the templates to JS_SHAPE_MAX_TRANSITION_PROPS
+       fields, so the shape is in the transition tree and can be shared */
+    sh = JS_VALUE_GET_OBJ(tpl)->shape;
+    assert(sh->is_hashed);
+    obj = JS_NewObjectFromShape(ctx, js_dup_shape(sh), JS_CLASS_OBJECT, NULL);
+    if (JS_IsException(obj))
+        return obj;
+    p = JS_VALUE_GET_OBJ(obj);
+    for(i = 0; i < sh->prop_count; i++)
+        p->prop[i].u.value = JS_UNDEFINED;
+    return obj;
+}
+
 JSValue JS_NewArray(JSContext *ctx)
 {
     return JS_NewObjectFromShape(ctx, js_dup_shape(ctx->array_shape),
@@ -6401,6 +7147,18 @@ static inline JSShapeProperty *find_own_property(JSProperty **ppr,
     return NULL;
 }
 
+static inline JSVarRefBlock *var_ref_get_block(JSVarRef *var_ref)
+{
+    return container_of(var_ref - var_ref->var_ref_idx, JSVarRefBlock,
+                        var_refs);
+}
+
+static void free_var_ref_block(JSRuntime *rt, JSVarRefBlock *block)
+{
+    if (--block->ref_count == 0)
+        js_free_rt(rt, block);
+}
+
 static void free_var_ref(JSRuntime *rt, JSVarRef *var_ref)
 {
     if (var_ref) {
@@ -6409,9 +7167,16 @@ static void free_var_ref(JSRuntime *rt, JSVarRef *var_ref)
             if (var_ref->is_detached) {
                 JS_FreeValueRT(rt, var_ref->value);
                 remove_gc_object(&var_ref->header);
+                if (var_ref->is_in_block) {
+                    free_var_ref_block(rt, var_ref_get_block(var_ref));
+                    return;
+                }
             } else {
                 JSStackFrame *sf = var_ref->stack_frame;
                 assert(sf->var_refs[var_ref->var_ref_idx] == var_ref);
+                /* still usable by the next closures of the frame */
+                if (var_ref->is_in_block)
+                    return;
                 sf->var_refs[var_ref->var_ref_idx] = NULL;
             }
             js_free_rt(rt, var_ref);
@@ -6554,6 +7319,8 @@ static void js_for_in_iterator_finalizer(JSRuntime *rt, JSValueConst val)
     JSObject *p = JS_VALUE_GET_OBJ(val);
     JSForInIterator *it = p->u.for_in_iterator;
     JS_FreeValueRT(rt, it->obj);
+    if (it->shape)
+        js_free_shape(rt, it->shape);
     js_free_rt(rt, it);
 }
 
@@ -6563,6 +7330,8 @@ static void js_for_in_iterator_mark(JSRuntime *rt, JSValueConst val,
     JSObject *p = JS_VALUE_GET_OBJ(val);
     JSForInIterator *it = p->u.for_in_iterator;
     JS_MarkValue(rt, it->obj, mark_func);
+    if (it->shape)
+        mark_func(rt, &it->shape->header);
 }
 
 static void free_object(JSRuntime *rt, JSObject *p)
@@ -6591,7 +7360,7 @@ static void free_object(JSRuntime *rt, JSObject *p)
     p->prop = NULL;
 
     if (unlikely(p->first_weak_ref)) {
-        reset_weak_ref(rt, &p->first_weak_ref);
+        reset_weak_ref(rt, JS_MKPTR(JS_TAG_OBJECT, p), &p->first_weak_ref);
     }
 
     finalizer = rt->class_array[p->class_id].finalizer;
@@ -6754,17 +7523,19 @@ void JS_MarkValue(JSRuntime *rt, JSValueConst val, JS_MarkFunc *mark_func)
     }
 }
 
-static void mark_weak_map_value(JSRuntime *rt, JSWeakRefRecord *first_weak_ref, JS_MarkFunc *mark_func) {
+static void mark_weak_map_value(JSRuntime *rt, JSValueConst key,
+                                JSWeakRefRecord *first_weak_ref,
+                                JS_MarkFunc *mark_func) {
     JSWeakRefRecord *wr;
     JSMapRecord *mr;
     JSMapState *s;
 
     for (wr = first_weak_ref; wr != NULL; wr = wr->next_weak_ref) {
         if (wr->kind == JS_WEAK_REF_KIND_MAP) {
-            mr = wr->u.map_record;
-            s = mr->map;
+            s = wr->u.map;
             assert(s->is_weak);
-            assert(!mr->empty); /* no iterator on WeakMap/WeakSet */
+            mr = map_find_weak_record(s, key);
+            assert(mr != NULL);
             JS_MarkValue(rt, mr->value, mark_func);
         }
     }
@@ -6810,7 +7581,8 @@ static void mark_children(JSRuntime *rt, JSGCObjectHeader *gp,
             }
 
             if (unlikely(p->first_weak_ref)) {
-                mark_weak_map_value(rt, p->first_weak_ref, mark_func);
+                mark_weak_map_value(rt, JS_MKPTR(JS_TAG_OBJECT, p),
+                                    p->first_weak_ref, mark_func);
             }
 
             if (p->class_id != JS_CLASS_OBJECT) {
@@ -6831,6 +7603,8 @@ static void mark_children(JSRuntime *rt, JSGCObjectHeader *gp,
             }
             if (b->realm)
                 mark_func(rt, &b->realm->header);
+            if (b->lazy_bytecode)
+                mark_func(rt, &b->lazy_bytecode->header);
         }
         break;
     case JS_GC_OBJ_TYPE_VAR_REF:
@@ -6856,6 +7630,9 @@ static void mark_children(JSRuntime *rt, JSGCObjectHeader *gp,
             if (sh->proto != NULL) {
                 mark_func(rt, &sh->proto->header);
             }
+            if (sh->parent != NULL) {
+                mark_func(rt, &sh->parent->header);
+            }
         }
         break;
     case JS_GC_OBJ_TYPE_JS_CONTEXT:
@@ -6989,17 +7766,52 @@ static void gc_free_cycles(JSRuntime *rt)
     init_list_head(&rt->gc_zero_ref_count_list);
 }
 
-void JS_RunGC(JSRuntime *rt)
+/* The compiled code of eval() is only released by the explicit
+   collections and when the memory limit is close: the automatic ones
+   are too frequent in allocation heavy code for the cache to be
+   useful. */
+static void __JS_RunGC(JSRuntime *rt, bool flush_eval_cache)
 {
+    struct list_head *el;
+    uint64_t start, phase_start;
+    size_t malloc_size;
+
+    start = js_trace_begin(rt);
+    malloc_size = rt->malloc_state.malloc_size;
+    /* the cached shapes reference their prototype */
+    js_shape_cache_flush(rt);
+
+    if (flush_eval_cache) {
+        list_for_each(el, &rt->context_list) {
+            JSContext *ctx = list_entry(el, JSContext, link);
+            js_eval_cache_flush(ctx);
+        }
+    }
+
     /* decrement the reference of the children of each object. mark =
        1 after this pass. */
+    phase_start = js_trace_begin(rt);
     gc_decref(rt);
+    js_trace_end(rt, JS_TRACE_GC_DECREF, phase_start, NULL, 0);
 
     /* keep the GC objects with a non zero refcount and their childs */
+    phase_start = js_trace_begin(rt);
     gc_scan(rt);
+    js_trace_end(rt, JS_TRACE_GC_SCAN, phase_start, NULL, 0);
 
     /* free the GC objects in a cycle */
+    phase_start = js_trace_begin(rt);
     gc_free_cycles(rt);
+    js_trace_end(rt, JS_TRACE_GC_FREE_CYCLES, phase_start, NULL, 0);
+
+    js_frame_cache_flush(rt);
+    js_trace_end(rt, JS_TRACE_GC, start, NULL,
+                 (int64_t)malloc_size - (int64_t)rt->malloc_state.malloc_size);
+}
+
+void JS_RunGC(JSRuntime *rt)
+{
+    __JS_RunGC(rt, true);
 }
 
 /* Return false if not an object or if the object has already been
@@ -7039,6 +7851,20 @@ static void compute_jsstring_size(JSString *str, JSMemoryUsage_helper *hp)
     }
 }
 
+static int64_t compute_shape_size(JSShape *sh)
+{
+    int64_t size;
+
+    size = get_shape_size(sh->prop_hash_mask + 1, sh->prop_size);
+    if (sh->transition_size != 0)
+        size += sizeof(sh->u.transitions[0]) * sh->transition_size;
+    if (sh->enum_cache) {
+        size += sizeof(*sh->enum_cache) +
+            sizeof(sh->enum_cache->tab[0]) * sh->enum_cache->count;
+    }
+    return size;
+}
+
 static void compute_bytecode_size(JSFunctionBytecode *b, JSMemoryUsage_helper *hp)
 {
     int memory_used_count, js_func_size, i;
@@ -7058,6 +7884,10 @@ static void compute_bytecode_size(JSFunctionBytecode *b, JSMemoryUsage_helper *h
     if (b->closure_var) {
         js_func_size += b->closure_var_count * sizeof(*b->closure_var);
     }
+    if (b->global_var_cache) {
+        memory_used_count++;
+        js_func_size += b->global_var_cache_count * sizeof(*b->global_var_cache);
+    }
     if (b->byte_code_buf) {
         hp->js_func_code_size += b->byte_code_len;
     }
@@ -7085,6 +7915,83 @@ static void compute_value_size(JSValue val, JSMemoryUsage_helper *hp)
     }
 }
 
+/* size of the object and of the memory blocks it owns */
+static int64_t js_object_self_size(JSRuntime *rt, JSObject *p)
+{
+    int64_t size;
+
+    size = sizeof(*p);
+    if (p->prop)
+        size += p->shape->prop_size * sizeof(*p->prop);
+    switch(p->class_id) {
+    case JS_CLASS_ARRAY:
+        if (p->fast_array)
+            size += p->u.array.u1.size * sizeof(*p->u.array.u.values);
+        break;
+    case JS_CLASS_ARGUMENTS:
+        if (p->fast_array)
+            size += p->u.array.count * sizeof(*p->u.array.u.values);
+        break;
+    case JS_CLASS_BYTECODE_FUNCTION:
+    case JS_CLASS_GENERATOR_FUNCTION:
+    case JS_CLASS_ASYNC_FUNCTION:
+    case JS_CLASS_ASYNC_GENERATOR_FUNCTION:
+        if (p->u.func.var_refs) {
+            size += p->u.func.function_bytecode->closure_var_count *
+                sizeof(*p->u.func.var_refs);
+        }
+        break;
+    case JS_CLASS_BOUND_FUNCTION:
+        size += sizeof(*p->u.bound_function) +
+            p->u.bound_function->argc * sizeof(p->u.bound_function->argv[0]);
+        break;
+    case JS_CLASS_C_FUNCTION_DATA:
+        if (p->u.c_function_data_record) {
+            size += sizeof(*p->u.c_function_data_record) +
+                p->u.c_function_data_record->data_len *
+                sizeof(p->u.c_function_data_record->data[0]);
+        }
+        break;
+    case JS_CLASS_ARRAY_BUFFER:
+    case JS_CLASS_SHARED_ARRAY_BUFFER:
+        if (p->u.array_buffer) {
+            size += sizeof(*p->u.array_buffer);
+            if (p->u.array_buffer->data)
+                size += p->u.array_buffer->byte_length;
+        }
+        break;
+    case JS_CLASS_UINT8C_ARRAY:
+    case JS_CLASS_INT8_ARRAY:
+    case JS_CLASS_UINT8_ARRAY:
+    case JS_CLASS_INT16_ARRAY:
+    case JS_CLASS_UINT16_ARRAY:
+    case JS_CLASS_INT32_ARRAY:
+    case JS_CLASS_UINT32_ARRAY:
+    case JS_CLASS_BIG_INT64_ARRAY:
+    case JS_CLASS_BIG_UINT64_ARRAY:
+    case JS_CLASS_FLOAT16_ARRAY:
+    case JS_CLASS_FLOAT32_ARRAY:
+    case JS_CLASS_FLOAT64_ARRAY:
+    case JS_CLASS_DATAVIEW:
+        if (p->u.typed_array)
+            size += sizeof(*p->u.typed_array);
+        break;
+    case JS_CLASS_MAP:
+    case JS_CLASS_SET:
+    case JS_CLASS_WEAKMAP:
+    case JS_CLASS_WEAKSET:
+        if (p->u.map_state) {
+            JSMapState *ms = p->u.map_state;
+            size += sizeof(*ms) + sizeof(ms->records[0]) * ms->record_size +
+                sizeof(ms->hash_table[0]) * ms->hash_size;
+        }
+        break;
+    default:
+        break;
+    }
+    return size;
+}
+
 void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
 {
     struct list_head *el, *el1;
@@ -7101,18 +8008,19 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
 
     list_for_each(el, &rt->context_list) {
         JSContext *ctx = list_entry(el, JSContext, link);
-        JSShape *sh = ctx->array_shape;
         s->memory_used_count += 2; /* ctx + ctx->class_proto */
         s->memory_used_size += sizeof(JSContext) +
             sizeof(JSValue) * rt->class_count;
         s->binary_object_count += ctx->binary_object_count;
         s->binary_object_size += ctx->binary_object_size;
-
-        /* the hashed shapes are counted separately */
-        if (sh && !sh->is_hashed) {
-            int hash_size = sh->prop_hash_mask + 1;
-            s->shape_count++;
-            s->shape_size += get_shape_size(hash_size, sh->prop_size);
+        s->eval_cache_hit_count += ctx->eval_cache_hit_count;
+        s->eval_cache_miss_count += ctx->eval_cache_miss_count;
+        list_for_each(el1, &ctx->eval_cache_list) {
+            JSEvalCacheEntry *e = list_entry(el1, JSEvalCacheEntry, link);
+            s->eval_cache_count++;
+            s->eval_cache_size += sizeof(*e) + e->len;
+            s->memory_used_count++;
+            s->memory_used_size += sizeof(*e) + e->len;
         }
         list_for_each(el1, &ctx->loaded_modules) {
             JSModuleDef *m = list_entry(el1, JSModuleDef, link);
@@ -7157,6 +8065,10 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
         if (gp->gc_obj_type == JS_GC_OBJ_TYPE_FUNCTION_BYTECODE) {
             compute_bytecode_size((JSFunctionBytecode *)gp, hp);
             continue;
+        } else if (gp->gc_obj_type == JS_GC_OBJ_TYPE_SHAPE) {
+            s->shape_count++;
+            s->shape_size += compute_shape_size((JSShape *)gp);
+            continue;
         } else if (gp->gc_obj_type != JS_GC_OBJ_TYPE_JS_OBJECT) {
             continue;
         }
@@ -7176,12 +8088,6 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
                 prs++;
             }
         }
-        /* the hashed shapes are counted separately */
-        if (!sh->is_hashed) {
-            int hash_size = sh->prop_hash_mask + 1;
-            s->shape_count++;
-            s->shape_size += get_shape_size(hash_size, sh->prop_size);
-        }
 
         switch(p->class_id) {
         case JS_CLASS_ARRAY:             /* u.array | length */
@@ -7190,10 +8096,14 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
             if (p->fast_array) {
                 s->fast_array_count++;
                 if (p->u.array.u.values) {
+                    uint32_t size = p->u.array.count;
+                    if (p->class_id == JS_CLASS_ARRAY)
+                        size = p->u.array.u1.size;
                     s->memory_used_count++;
-                    s->memory_used_size += p->u.array.count *
-                        sizeof(*p->u.array.u.values);
+                    s->memory_used_size += size * sizeof(*p->u.array.u.values);
                     s->fast_array_elements += p->u.array.count;
+                    s->fast_array_unused_size += (size - p->u.array.count) *
+                        sizeof(*p->u.array.u.values);
                     for (i = 0; i < p->u.array.count; i++) {
                         compute_value_size(p->u.array.u.values[i], hp);
                     }
@@ -7295,6 +8205,35 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
                 }
             }
             break;
+        case JS_CLASS_MAP:               /* u.map_state */
+        case JS_CLASS_SET:               /* u.map_state */
+        case JS_CLASS_WEAKMAP:           /* u.map_state */
+        case JS_CLASS_WEAKSET:           /* u.map_state */
+            {
+                JSMapState *ms = p->u.map_state;
+                JSMapRecord *mr;
+                if (ms) {
+                    s->memory_used_count += 1;
+                    s->memory_used_size += sizeof(*ms);
+                    if (ms->records) {
+                        s->memory_used_count += 1;
+                        s->memory_used_size +=
+                            sizeof(ms->records[0]) * ms->record_size;
+                    }
+                    if (ms->hash_table) {
+                        s->memory_used_count += 1;
+                        s->memory_used_size +=
+                            sizeof(ms->hash_table[0]) * ms->hash_size;
+                    }
+                    for(i = 0; i < ms->record_end; i++) {
+                        mr = &ms->records[i];
+                        if (!ms->is_weak)
+                            compute_value_size(mr->key, hp);
+                        compute_value_size(mr->value, hp);
+                    }
+                }
+            }
+            break;
         case JS_CLASS_GENERATOR:         /* u.generator_data */
         case JS_CLASS_UINT8C_ARRAY:      /* u.typed_array / u.array */
         case JS_CLASS_INT8_ARRAY:        /* u.typed_array / u.array */
@@ -7309,10 +8248,6 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
         case JS_CLASS_FLOAT32_ARRAY:     /* u.typed_array / u.array */
         case JS_CLASS_FLOAT64_ARRAY:     /* u.typed_array / u.array */
         case JS_CLASS_DATAVIEW:          /* u.typed_array */
-        case JS_CLASS_MAP:               /* u.map_state */
-        case JS_CLASS_SET:               /* u.map_state */
-        case JS_CLASS_WEAKMAP:           /* u.map_state */
-        case JS_CLASS_WEAKSET:           /* u.map_state */
         case JS_CLASS_MAP_ITERATOR:      /* u.map_iterator_data */
         case JS_CLASS_SET_ITERATOR:      /* u.map_iterator_data */
         case JS_CLASS_ARRAY_ITERATOR:    /* u.array_iterator_data */
@@ -7321,10 +8256,9 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
         case JS_CLASS_PROMISE:           /* u.promise_data */
         case JS_CLASS_PROMISE_RESOLVE_FUNCTION:  /* u.promise_function_data */
         case JS_CLASS_PROMISE_REJECT_FUNCTION:   /* u.promise_function_data */
-        case JS_CLASS_ASYNC_FUNCTION_RESOLVE:    /* u.async_function_data */
-        case JS_CLASS_ASYNC_FUNCTION_REJECT:     /* u.async_function_data */
         case JS_CLASS_ASYNC_FROM_SYNC_ITERATOR:  /* u.async_from_sync_iterator_data */
         case JS_CLASS_ASYNC_GENERATOR:   /* u.async_generator_data */
+        case JS_CLASS_ARRAY_FROM_ASYNC:  /* u.array_from_async_data */
             /* TODO */
         default:
             /* XXX: class definition should have an opaque block size */
@@ -7336,23 +8270,22 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
     }
     s->obj_size += s->obj_count * sizeof(JSObject);
 
-    /* hashed shapes */
+    /* root shape hash table */
     s->memory_used_count++; /* rt->shape_hash */
-    s->memory_used_size += sizeof(rt->shape_hash[0]) * rt->shape_hash_size;
-    for(i = 0; i < rt->shape_hash_size; i++) {
-        JSShape *sh;
-        for(sh = rt->shape_hash[i]; sh != NULL; sh = sh->shape_hash_next) {
-            int hash_size = sh->prop_hash_mask + 1;
-            s->shape_count++;
-            s->shape_size += get_shape_size(hash_size, sh->prop_size);
-        }
+    s->shape_hash_size = sizeof(rt->shape_hash[0]) * rt->shape_hash_size;
+    s->memory_used_size += s->shape_hash_size;
+    list_for_each(el, &rt->shape_cache_list) {
+        JSShape *sh = list_entry(el, JSShape, header.link);
+        s->shape_count++;
+        s->shape_size += compute_shape_size(sh);
     }
 
     /* atoms */
     s->memory_used_count += 2; /* rt->atom_array, rt->atom_hash */
     s->atom_count = rt->atom_count;
+    s->atom_hash_size = sizeof(rt->atom_hash[0]) * rt->atom_hash_size;
     s->atom_size = sizeof(rt->atom_array[0]) * rt->atom_size +
-        sizeof(rt->atom_hash[0]) * rt->atom_hash_size;
+        s->atom_hash_size;
     for(i = 0; i < rt->atom_size; i++) {
         JSAtomStruct *p = rt->atom_array[i];
         if (!atom_is_free(p)) {
@@ -7360,6 +8293,26 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
                              1 - p->is_wide_char);
         }
     }
+
+    /* pending jobs */
+    if (rt->job_tab) {
+        s->memory_used_count++;
+        s->job_count = rt->job_count;
+        s->job_queue_size = sizeof(rt->job_tab[0]) * rt->job_size;
+        for(i = 0; i < rt->job_count; i++) {
+            JSJobEntry *e = &rt->job_tab[(rt->job_head + i) & (rt->job_size - 1)];
+            JSValue *argv = js_job_argv(e);
+            int j;
+            if (e->argc > JS_JOB_INLINE_ARGS) {
+                s->memory_used_count++;
+                s->job_queue_size += sizeof(argv[0]) * e->argc;
+            }
+            for(j = 0; j < e->argc; j++)
+                compute_value_size(argv[j], hp);
+        }
+        s->memory_used_size += s->job_queue_size;
+    }
+
     s->str_count = round(mem.str_count);
     s->str_size = round(mem.str_size);
     s->js_func_count = mem.js_func_count;
@@ -7376,6 +8329,62 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
         s->js_func_size + s->js_func_code_size + s->js_func_pc2line_size;
 }
 
+/* Return the realm of a function or, for the other objects, the context
+   whose Object.prototype ends the prototype chain. Return NULL if it
+   cannot be determined (e.g. null prototype or Proxy). */
+static JSContext *js_object_realm(JSRuntime *rt, JSObject *p)
+{
+    struct list_head *el;
+    JSObject *proto;
+
+    switch(p->class_id) {
+    case JS_CLASS_C_FUNCTION:
+        return p->u.cfunc.realm;
+    case JS_CLASS_BYTECODE_FUNCTION:
+    case JS_CLASS_GENERATOR_FUNCTION:
+    case JS_CLASS_ASYNC_FUNCTION:
+    case JS_CLASS_ASYNC_GENERATOR_FUNCTION:
+        return p->u.func.function_bytecode->realm;
+    default:
+        break;
+    }
+    /* the prototype chains cannot have cycles without Proxy objects,
+       which have no shape prototype */
+    while ((proto = p->shape->proto) != NULL)
+        p = proto;
+    list_for_each(el, &rt->context_list) {
+        JSContext *ctx = list_entry(el, JSContext, link);
+        if (ctx->class_proto &&
+            JS_VALUE_GET_TAG(ctx->class_proto[JS_CLASS_OBJECT]) == JS_TAG_OBJECT &&
+            JS_VALUE_GET_OBJ(ctx->class_proto[JS_CLASS_OBJECT]) == p)
+            return ctx;
+    }
+    return NULL;
+}
+
+int JS_ComputeObjectMemoryUsage(JSRuntime *rt, JSContext *realm,
+                                JSObjectMemoryUsage *tab, int tab_len)
+{
+    struct list_head *el;
+    JSObject *p;
+
+    if (tab_len > 0)
+        memset(tab, 0, sizeof(tab[0]) * tab_len);
+    list_for_each(el, &rt->gc_obj_list) {
+        JSGCObjectHeader *gp = list_entry(el, JSGCObjectHeader, link);
+        if (gp->gc_obj_type != JS_GC_OBJ_TYPE_JS_OBJECT)
+            continue;
+        p = (JSObject *)gp;
+        if (p->class_id >= tab_len)
+            continue;
+        if (realm && js_object_realm(rt, p) != realm)
+            continue;
+        tab[p->class_id].count++;
+        tab[p->class_id].size += js_object_self_size(rt, p);
+    }
+    return rt->class_count;
+}
+
 void JS_DumpMemoryUsage(FILE *fp, const JSMemoryUsage *s, JSRuntime *rt)
 {
     fprintf(fp, "QuickJS-ng memory usage -- %s version, %d-bit, %s Endian, malloc limit: %"PRId64"\n\n",
@@ -7410,6 +8419,7 @@ void JS_DumpMemoryUsage(FILE *fp, const JSMemoryUsage *s, JSRuntime *rt)
         }
         {
             int obj_classes[JS_CLASS_INIT_COUNT + 1] = { 0 };
+            int64_t obj_sizes[JS_CLASS_INIT_COUNT + 1] = { 0 };
             int class_id;
             struct list_head *el;
             list_for_each(el, &rt->gc_obj_list) {
@@ -7417,21 +8427,26 @@ void JS_DumpMemoryUsage(FILE *fp, const JSMemoryUsage *s, JSRuntime *rt)
                 JSObject *p;
                 if (gp->gc_obj_type == JS_GC_OBJ_TYPE_JS_OBJECT) {
                     p = (JSObject *)gp;
-                    obj_classes[min_uint32(p->class_id, JS_CLASS_INIT_COUNT)]++;
+                    class_id = min_uint32(p->class_id, JS_CLASS_INIT_COUNT);
+                    obj_classes[class_id]++;
+                    obj_sizes[class_id] += js_object_self_size(rt, p);
                 }
             }
             fprintf(fp, "\n" "JSObject classes\n");
             if (obj_classes[0])
-                fprintf(fp, "  %5d  %2.0d %s\n", obj_classes[0], 0, "none");
+                fprintf(fp, "  %5d %8"PRId64"  %2.0d %s\n", obj_classes[0],
+                        obj_sizes[0], 0, "none");
             for (class_id = 1; class_id < JS_CLASS_INIT_COUNT; class_id++) {
                 if (obj_classes[class_id] && class_id < rt->class_count) {
                     char buf[ATOM_GET_STR_BUF_SIZE];
-                    fprintf(fp, "  %5d  %2.0d %s\n", obj_classes[class_id], class_id,
+                    fprintf(fp, "  %5d %8"PRId64"  %2.0d %s\n", obj_classes[class_id],
+                            obj_sizes[class_id], class_id,
                             JS_AtomGetStrRT(rt, buf, sizeof(buf), rt->class_array[class_id].class_name));
                 }
             }
             if (obj_classes[JS_CLASS_INIT_COUNT])
-                fprintf(fp, "  %5d  %2.0d %s\n", obj_classes[JS_CLASS_INIT_COUNT], 0, "other");
+                fprintf(fp, "  %5d %8"PRId64"  %2.0d %s\n", obj_classes[JS_CLASS_INIT_COUNT],
+                        obj_sizes[JS_CLASS_INIT_COUNT], 0, "other");
         }
         fprintf(fp, "\n");
     }
@@ -7491,12 +8506,1026 @@ void JS_DumpMemoryUsage(FILE *fp, const JSMemoryUsage *s, JSRuntime *rt)
                     "  elements", s->fast_array_elements,
                     s->fast_array_elements * (int)sizeof(JSValue),
                     (double)s->fast_array_elements / s->fast_array_count);
+            fprintf(fp, "%-20s %8s %8"PRId64"\n",
+                    "  unused capacity", "", s->fast_array_unused_size);
         }
     }
     if (s->binary_object_count) {
         fprintf(fp, "%-20s %8"PRId64" %8"PRId64"\n",
                 "binary objects", s->binary_object_count, s->binary_object_size);
     }
+    if (s->eval_cache_hit_count || s->eval_cache_miss_count) {
+        fprintf(fp, "%-20s %8"PRId64" %8"PRId64"  (%"PRId64" hits, %"PRId64" misses)\n",
+                "eval cache", s->eval_cache_count, s->eval_cache_size,
+                s->eval_cache_hit_count, s->eval_cache_miss_count);
+    }
+    fprintf(fp, "%-20s %8s %8"PRId64"\n", "shape hash", "", s->shape_hash_size);
+    fprintf(fp, "%-20s %8s %8"PRId64"\n", "atom hash", "", s->atom_hash_size);
+    if (s->job_queue_size) {
+        fprintf(fp, "%-20s %8"PRId64" %8"PRId64"\n",
+                "job queue", s->job_count, s->job_queue_size);
+    }
+}
+
+static void *js_dbuf_realloc_rt(void *opaque, void *ptr, size_t size)
+{
+    return js_realloc_rt(opaque, ptr, size);
+}
+
+/* Heap snapshot in the V8 .heapsnapshot JSON format. The nodes are the
+   GC objects and the strings they reference. The edges are the
+   references seen by mark_children(), named when the property or
+   variable name is known. The GC objects referenced from outside the
+   GC objects (C code, stack frames) are the children of the root
+   node. The retained sizes are computed by the tools reading the
+   snapshot from the self sizes and the edges. */
+
+/* must match "node_types" and "edge_types" in the snapshot meta data */
+typedef enum {
+    JS_HEAP_NODE_HIDDEN,
+    JS_HEAP_NODE_ARRAY,
+    JS_HEAP_NODE_STRING,
+    JS_HEAP_NODE_OBJECT,
+    JS_HEAP_NODE_CODE,
+    JS_HEAP_NODE_CLOSURE,
+    JS_HEAP_NODE_REGEXP,
+    JS_HEAP_NODE_NUMBER,
+    JS_HEAP_NODE_NATIVE,
+    JS_HEAP_NODE_SYNTHETIC,
+    JS_HEAP_NODE_CONCATENATED_STRING,
+    JS_HEAP_NODE_SLICED_STRING,
+    JS_HEAP_NODE_SYMBOL,
+    JS_HEAP_NODE_BIGINT,
+    JS_HEAP_NODE_OBJECT_SHAPE,
+} JSHeapNodeTypeEnum;
+
+typedef enum {
+    JS_HEAP_EDGE_CONTEXT,
+    JS_HEAP_EDGE_ELEMENT,
+    JS_HEAP_EDGE_PROPERTY,
+    JS_HEAP_EDGE_INTERNAL,
+    JS_HEAP_EDGE_HIDDEN,
+    JS_HEAP_EDGE_SHORTCUT,
+    JS_HEAP_EDGE_WEAK,
+} JSHeapEdgeTypeEnum;
+
+/* the first strings of the snapshot */
+typedef enum {
+    JS_HEAP_STR_EMPTY,
+    JS_HEAP_STR_ROOT,
+    JS_HEAP_STR_CONCATENATED_STRING,
+    JS_HEAP_STR_FIRST,
+    JS_HEAP_STR_SECOND,
+    JS_HEAP_STR_PARENT,
+    JS_HEAP_STR_SHAPE,
+    JS_HEAP_STR_PROTO,
+    JS_HEAP_STR_CODE,
+    JS_HEAP_STR_HOME_OBJECT,
+    JS_HEAP_STR_VALUE,
+    JS_HEAP_STR_GLOBAL,
+    JS_HEAP_STR_VAR_REF,
+    JS_HEAP_STR_ASYNC_FUNCTION,
+    JS_HEAP_STR_CONTEXT,
+    JS_HEAP_STR_ANONYMOUS,
+    JS_HEAP_STR_COUNT,
+} JSHeapStringEnum;
+
+static const char * const js_heap_strings[JS_HEAP_STR_COUNT] = {
+    "",
+    "(GC roots)",
+    "(concatenated string)",
+    "first",
+    "second",
+    "parent",
+    "shape",
+    "__proto__",
+    "code",
+    "home_object",
+    "value",
+    "global",
+    "(closure variable)",
+    "(async function state)",
+    "(context)",
+    "(anonymous)",
+};
+
+typedef struct JSHeapNode {
+    void *ptr; /* GC object or string, NULL for the root */
+    uint8_t type; /* JS_HEAP_NODE_x */
+    uint32_t name; /* string index */
+    uint32_t edge_count;
+    int internal_ref_count; /* references from the other GC objects */
+    int64_t self_size;
+} JSHeapNode;
+
+typedef struct JSHeapEdge {
+    uint32_t from_node;
+    uint32_t to_node;
+    uint32_t name_or_index; /* index for the element and hidden edges */
+    uint8_t type; /* JS_HEAP_EDGE_x */
+} JSHeapEdge;
+
+typedef struct JSHeapString {
+    size_t pos, len; /* position in JSHeapSnapshot.str_buf */
+} JSHeapString;
+
+typedef struct JSHeapSnapshot {
+    JSRuntime *rt;
+    DynBuf nodes; /* JSHeapNode */
+    DynBuf edges; /* JSHeapEdge, in any order */
+    DynBuf strings; /* JSHeapString */
+    DynBuf str_buf;
+    /* 1 + index of the strings by content, 0 if empty slot */
+    uint32_t *str_hash;
+    uint32_t str_hash_size; /* power of two */
+    uint32_t *atom_strings; /* 1 + string index of each atom, 0 if none */
+    /* node index of the GC objects and strings */
+    void **hash_ptrs;
+    uint32_t *hash_nodes;
+    uint32_t hash_size; /* power of two */
+    uint32_t hash_count;
+    /* node and index of the next hidden edge found by mark_children() */
+    uint32_t cur_node;
+    uint32_t hidden_index;
+} JSHeapSnapshot;
+
+static inline JSHeapNode *js_heap_node(JSHeapSnapshot *hs, uint32_t idx)
+{
+    return (JSHeapNode *)hs->nodes.buf + idx;
+}
+
+static inline uint32_t js_heap_node_count(JSHeapSnapshot *hs)
+{
+    return hs->nodes.size / sizeof(JSHeapNode);
+}
+
+static uint32_t js_heap_str_hash(const char *str, size_t len, uint32_t size)
+{
+    uint32_t h;
+    size_t i;
+
+    h = 1;
+    for(i = 0; i < len; i++)
+        h = h * 263 + (uint8_t)str[i];
+    return h * 0x9E3779B1u & (size - 1);
+}
+
+/* return the index of the string in the snapshot. The strings are
+   unique. */
+static uint32_t js_heap_string(JSHeapSnapshot *hs, const char *str, size_t len)
+{
+    JSHeapString s, *ps;
+    uint32_t h, i, count, *new_hash, new_size;
+
+    count = hs->strings.size / sizeof(s);
+    if (2 * (count + 1) > hs->str_hash_size) {
+        new_size = max_int(hs->str_hash_size * 2, 256);
+        new_hash = js_mallocz_rt(hs->rt, sizeof(new_hash[0]) * new_size);
+        if (new_hash) {
+            for(i = 0; i < count; i++) {
+                ps = (JSHeapString *)hs->strings.buf + i;
+                h = js_heap_str_hash((char *)hs->str_buf.buf + ps->pos,
+                                     ps->len, new_size);
+                while (new_hash[h])
+                    h = (h + 1) & (new_size - 1);
+                new_hash[h] = i + 1;
+            }
+            js_free_rt(hs->rt, hs->str_hash);
+            hs->str_hash = new_hash;
+            hs->str_hash_size = new_size;
+        }
+    }
+    if (hs->str_hash) {
+        h = js_heap_str_hash(str, len, hs->str_hash_size);
+        while (hs->str_hash[h]) {
+            ps = (JSHeapString *)hs->strings.buf + hs->str_hash[h] - 1;
+            if (ps->len == len &&
+                !memcmp(hs->str_buf.buf + ps->pos, str, len))
+                return hs->str_hash[h] - 1;
+            h = (h + 1) & (hs->str_hash_size - 1);
+        }
+        /* the string table is full if out of memory */
+        if (2 * (count + 1) <= hs->str_hash_size)
+            hs->str_hash[h] = count + 1;
+    }
+    s.pos = hs->str_buf.size;
+    s.len = len;
+    dbuf_put(&hs->str_buf, (const uint8_t *)str, len);
+    dbuf_put(&hs->strings, (const uint8_t *)&s, sizeof(s));
+    return count;
+}
+
+static uint32_t js_heap_atom(JSHeapSnapshot *hs, JSAtom atom)
+{
+    char buf[ATOM_GET_STR_BUF_SIZE * 4];
+
+    if (atom == JS_ATOM_NULL)
+        return JS_HEAP_STR_ANONYMOUS;
+    if (__JS_AtomIsTaggedInt(atom)) {
+        JS_AtomGetStrRT(hs->rt, buf, sizeof(buf), atom);
+        return js_heap_string(hs, buf, strlen(buf));
+    }
+    if (hs->atom_strings[atom] == 0) {
+        JS_AtomGetStrRT(hs->rt, buf, sizeof(buf), atom);
+        hs->atom_strings[atom] = js_heap_string(hs, buf, strlen(buf)) + 1;
+    }
+    return hs->atom_strings[atom] - 1;
+}
+
+/* the name of the string nodes is their (truncated) content */
+static uint32_t js_heap_jsstring(JSHeapSnapshot *hs, JSString *p)
+{
+    char buf[256];
+    size_t len;
+
+    if (p->is_wide_char)
+        len = utf8_encode_buf16(buf, sizeof(buf), str16(p), p->len);
+    else
+        len = utf8_encode_buf8(buf, sizeof(buf), str8(p), p->len);
+    if (len >= sizeof(buf))
+        len = strlen(buf);
+    return js_heap_string(hs, buf, len);
+}
+
+static inline uint32_t js_heap_hash(const void *ptr, uint32_t hash_size)
+{
+    return (uint32_t)((uintptr_t)ptr >> 3) * 0x9E3779B1u & (hash_size - 1);
+}
+
+static int js_heap_resize_hash(JSHeapSnapshot *hs, uint32_t new_size)
+{
+    void **ptrs;
+    uint32_t *node_tab, i, h;
+
+    ptrs = js_mallocz_rt(hs->rt, sizeof(ptrs[0]) * new_size);
+    node_tab = js_malloc_rt(hs->rt, sizeof(node_tab[0]) * new_size);
+    if (!ptrs || !node_tab) {
+        js_free_rt(hs->rt, ptrs);
+        js_free_rt(hs->rt, node_tab);
+        return -1;
+    }
+    for(i = 0; i < hs->hash_size; i++) {
+        if (hs->hash_ptrs[i]) {
+            h = js_heap_hash(hs->hash_ptrs[i], new_size);
+            while (ptrs[h])
+                h = (h + 1) & (new_size - 1);
+            ptrs[h] = hs->hash_ptrs[i];
+            node_tab[h] = hs->hash_nodes[i];
+        }
+    }
+    js_free_rt(hs->rt, hs->hash_ptrs);
+    js_free_rt(hs->rt, hs->hash_nodes);
+    hs->hash_ptrs = ptrs;
+    hs->hash_nodes = node_tab;
+    hs->hash_size = new_size;
+    return 0;
+}
+
+/* return the node index of 'ptr' or -1 if none */
+static int64_t js_heap_find_node(JSHeapSnapshot *hs, const void *ptr)
+{
+    uint32_t h;
+
+    h = js_heap_hash(ptr, hs->hash_size);
+    while (hs->hash_ptrs[h]) {
+        if (hs->hash_ptrs[h] == ptr)
+            return hs->hash_nodes[h];
+        h = (h + 1) & (hs->hash_size - 1);
+    }
+    return -1;
+}
+
+/* return the node index or -1 if out of memory */
+static int64_t js_heap_add_node(JSHeapSnapshot *hs, void *ptr, int type,
+                                uint32_t name, int64_t self_size)
+{
+    JSHeapNode n;
+    uint32_t h, idx;
+
+    if (2 * (hs->hash_count + 1) > hs->hash_size &&
+        js_heap_resize_hash(hs, max_int(hs->hash_size * 2, 256)))
+        return -1;
+    memset(&n, 0, sizeof(n));
+    n.ptr = ptr;
+    n.type = type;
+    n.name = name;
+    n.self_size = self_size;
+    idx = js_heap_node_count(hs);
+    if (dbuf_put(&hs->nodes, (const uint8_t *)&n, sizeof(n)))
+        return -1;
+    if (ptr) {
+        h = js_heap_hash(ptr, hs->hash_size);
+        while (hs->hash_ptrs[h])
+            h = (h + 1) & (hs->hash_size - 1);
+        hs->hash_ptrs[h] = ptr;
+        hs->hash_nodes[h] = idx;
+        hs->hash_count++;
+    }
+    return idx;
+}
+
+static void js_heap_add_edge(JSHeapSnapshot *hs, uint32_t from_node, int type,
+                             uint32_t name_or_index, int64_t to_node)
+{
+    JSHeapEdge e;
+
+    if (to_node < 0)
+        return;
+    e.from_node = from_node;
+    e.to_node = to_node;
+    e.name_or_index = name_or_index;
+    e.type = type;
+    dbuf_put(&hs->edges, (const uint8_t *)&e, sizeof(e));
+    js_heap_node(hs, from_node)->edge_count++;
+}
+
+/* return the node of a string value, -1 if out of memory */
+static int64_t js_heap_string_node(JSHeapSnapshot *hs, JSValueConst val)
+{
+    JSStringSlice *slice;
+    JSStringRope *r;
+    JSString *p;
+    int64_t idx;
+    int type;
+    size_t size;
+
+    idx = js_heap_find_node(hs, JS_VALUE_GET_PTR(val));
+    if (idx >= 0)
+        return idx;
+    if (JS_VALUE_GET_TAG(val) == JS_TAG_STRING_ROPE) {
+        r = JS_VALUE_GET_PTR(val);
+        idx = js_heap_add_node(hs, r, JS_HEAP_NODE_CONCATENATED_STRING,
+                               JS_HEAP_STR_CONCATENATED_STRING, sizeof(*r));
+        if (idx >= 0) {
+            js_heap_add_edge(hs, idx, JS_HEAP_EDGE_INTERNAL, JS_HEAP_STR_FIRST,
+                             js_heap_string_node(hs, r->left));
+            js_heap_add_edge(hs, idx, JS_HEAP_EDGE_INTERNAL, JS_HEAP_STR_SECOND,
+                             js_heap_string_node(hs, r->right));
+        }
+        return idx;
+    }
+    p = JS_VALUE_GET_STRING(val);
+    type = JS_HEAP_NODE_STRING;
+    switch(p->kind) {
+    case JS_STRING_KIND_SLICE:
+        type = JS_HEAP_NODE_SLICED_STRING;
+        size = sizeof(*p) + sizeof(JSStringSlice);
+        break;
+    case JS_STRING_KIND_INDIRECT:
+        size = sizeof(*p) + sizeof(void *);
+        break;
+    default:
+        size = sizeof(*p) + (p->len << p->is_wide_char) + 1 - p->is_wide_char;
+        break;
+    }
+    idx = js_heap_add_node(hs, p, type, js_heap_jsstring(hs, p), size);
+    if (idx >= 0 && p->kind == JS_STRING_KIND_SLICE) {
+        slice = (void *)&p[1];
+        js_heap_add_edge(hs, idx, JS_HEAP_EDGE_INTERNAL, JS_HEAP_STR_PARENT,
+                         js_heap_string_node(hs, JS_MKPTR(JS_TAG_STRING,
+                                                          slice->parent)));
+    }
+    return idx;
+}
+
+/* add an edge to the node of 'val' if it is a GC object or a string */
+static void js_heap_add_value_edge(JSHeapSnapshot *hs, uint32_t from_node,
+                                   int type, uint32_t name_or_index,
+                                   JSValueConst val)
+{
+    switch(JS_VALUE_GET_TAG(val)) {
+    case JS_TAG_OBJECT:
+    case JS_TAG_FUNCTION_BYTECODE:
+        js_heap_add_edge(hs, from_node, type, name_or_index,
+                         js_heap_find_node(hs, JS_VALUE_GET_PTR(val)));
+        break;
+    case JS_TAG_STRING:
+    case JS_TAG_STRING_ROPE:
+        js_heap_add_edge(hs, from_node, type, name_or_index,
+                         js_heap_string_node(hs, val));
+        break;
+    default:
+        break;
+    }
+}
+
+static void js_heap_count_ref(JSRuntime *rt, JSGCObjectHeader *gp)
+{
+    JSHeapSnapshot *hs = rt->heap_snapshot;
+    int64_t idx;
+
+    idx = js_heap_find_node(hs, gp);
+    if (idx >= 0)
+        js_heap_node(hs, idx)->internal_ref_count++;
+}
+
+/* mark function adding the unnamed references of hs->cur_node */
+static void js_heap_mark_edge(JSRuntime *rt, JSGCObjectHeader *gp)
+{
+    JSHeapSnapshot *hs = rt->heap_snapshot;
+
+    js_heap_add_edge(hs, hs->cur_node, JS_HEAP_EDGE_HIDDEN,
+                     hs->hidden_index++, js_heap_find_node(hs, gp));
+}
+
+static int64_t js_bytecode_self_size(JSFunctionBytecode *b)
+{
+    int64_t size;
+
+    size = sizeof(*b) + b->byte_code_len + b->pc2line_len + b->source_len;
+    if (b->vardefs)
+        size += (b->arg_count + b->var_count) * sizeof(*b->vardefs);
+    if (b->cpool)
+        size += b->cpool_count * sizeof(*b->cpool);
+    if (b->closure_var)
+        size += b->closure_var_count * sizeof(*b->closure_var);
+    if (b->global_var_cache)
+        size += b->global_var_cache_count * sizeof(*b->global_var_cache);
+    return size;
+}
+
+static uint32_t js_heap_function_name(JSHeapSnapshot *hs, JSObject *p)
+{
+    JSShapeProperty *prs;
+    JSProperty *pr;
+
+    prs = find_own_property(&pr, p, JS_ATOM_name);
+    if (prs && (prs->flags & JS_PROP_TMASK) == JS_PROP_NORMAL &&
+        JS_VALUE_GET_TAG(pr->u.value) == JS_TAG_STRING &&
+        JS_VALUE_GET_STRING(pr->u.value)->len != 0)
+        return js_heap_jsstring(hs, JS_VALUE_GET_STRING(pr->u.value));
+    if (js_class_has_bytecode(p->class_id))
+        return js_heap_atom(hs, p->u.func.function_bytecode->func_name);
+    return JS_HEAP_STR_ANONYMOUS;
+}
+
+/* the instances of JS_CLASS_OBJECT are named after their constructor */
+static uint32_t js_heap_object_name(JSHeapSnapshot *hs, JSObject *p)
+{
+    JSShapeProperty *prs;
+    JSProperty *pr;
+    JSObject *proto;
+    int64_t idx;
+
+    proto = p->shape->proto;
+    if (proto) {
+        prs = find_own_property(&pr, proto, JS_ATOM_constructor);
+        if (prs && (prs->flags & JS_PROP_TMASK) == JS_PROP_NORMAL &&
+            JS_VALUE_GET_TAG(pr->u.value) == JS_TAG_OBJECT) {
+            idx = js_heap_find_node(hs, JS_VALUE_GET_OBJ(pr->u.value));
+            if (idx >= 0 &&
+                js_heap_node(hs, idx)->type == JS_HEAP_NODE_CLOSURE &&
+                js_heap_node(hs, idx)->name != JS_HEAP_STR_ANONYMOUS)
+                return js_heap_node(hs, idx)->name;
+        }
+    }
+    return js_heap_atom(hs, hs->rt->class_array[p->class_id].class_name);
+}
+
+static int64_t js_heap_add_gc_node(JSHeapSnapshot *hs, JSGCObjectHeader *gp)
+{
+    JSRuntime *rt = hs->rt;
+    JSObject *p;
+    JSFunctionBytecode *b;
+    JSContext *ctx;
+    int type;
+    uint32_t name;
+    int64_t size;
+
+    switch(gp->gc_obj_type) {
+    case JS_GC_OBJ_TYPE_JS_OBJECT:
+        p = (JSObject *)gp;
+        size = js_object_self_size(rt, p);
+        if (js_class_has_bytecode(p->class_id) ||
+            p->class_id == JS_CLASS_C_FUNCTION ||
+            p->class_id == JS_CLASS_BOUND_FUNCTION) {
+            type = JS_HEAP_NODE_CLOSURE;
+            name = js_heap_function_name(hs, p);
+        } else {
+            type = JS_HEAP_NODE_OBJECT;
+            if (p->class_id == JS_CLASS_REGEXP)
+                type = JS_HEAP_NODE_REGEXP;
+            /* the instances of JS_CLASS_OBJECT are renamed once the
+               nodes of their constructor exist */
+            name = js_heap_atom(hs, rt->class_array[p->class_id].class_name);
+        }
+        break;
+    case JS_GC_OBJ_TYPE_FUNCTION_BYTECODE:
+        b = (JSFunctionBytecode *)gp;
+        type = JS_HEAP_NODE_CODE;
+        name = js_heap_atom(hs, b->func_name);
+        size = js_bytecode_self_size(b);
+        break;
+    case JS_GC_OBJ_TYPE_SHAPE:
+        type = JS_HEAP_NODE_OBJECT_SHAPE;
+        name = JS_HEAP_STR_SHAPE;
+        size = compute_shape_size((JSShape *)gp);
+        break;
+    case JS_GC_OBJ_TYPE_VAR_REF:
+        type = JS_HEAP_NODE_HIDDEN;
+        name = JS_HEAP_STR_VAR_REF;
+        size = sizeof(JSVarRef);
+        break;
+    case JS_GC_OBJ_TYPE_ASYNC_FUNCTION:
+        type = JS_HEAP_NODE_HIDDEN;
+        name = JS_HEAP_STR_ASYNC_FUNCTION;
+        size = sizeof(JSAsyncFunctionData);
+        break;
+    case JS_GC_OBJ_TYPE_JS_CONTEXT:
+        ctx = (JSContext *)gp;
+        type = JS_HEAP_NODE_SYNTHETIC;
+        name = JS_HEAP_STR_CONTEXT;
+        size = sizeof(*ctx) + sizeof(ctx->class_proto[0]) * rt->class_count;
+        break;
+    default:
+        abort();
+    }
+    return js_heap_add_node(hs, gp, type, name, size);
+}
+
+/* add the edges of the JS object of node 'idx', naming the properties,
+   the elements and the closure variables */
+static void js_heap_add_object_edges(JSHeapSnapshot *hs, uint32_t idx,
+                                     JSObject *p)
+{
+    JSRuntime *rt = hs->rt;
+    JSShape *sh = p->shape;
+    JSShapeProperty *prs;
+    JSProperty *pr;
+    JSFunctionBytecode *b;
+    JSClassGCMark *gc_mark;
+    uint32_t i, name;
+    int type;
+
+    js_heap_add_edge(hs, idx, JS_HEAP_EDGE_INTERNAL, JS_HEAP_STR_SHAPE,
+                     js_heap_find_node(hs, sh));
+    for(i = 0, prs = sh->prop; i < sh->prop_count; i++, prs++) {
+        pr = &p->prop[i];
+        if (prs->atom == JS_ATOM_NULL)
+            continue;
+        if (__JS_AtomIsTaggedInt(prs->atom)) {
+            type = JS_HEAP_EDGE_ELEMENT;
+            name = __JS_AtomToUInt32(prs->atom);
+        } else {
+            type = JS_HEAP_EDGE_PROPERTY;
+            name = js_heap_atom(hs, prs->atom);
+        }
+        switch(prs->flags & JS_PROP_TMASK) {
+        case JS_PROP_NORMAL:
+            js_heap_add_value_edge(hs, idx, type, name, pr->u.value);
+            break;
+        case JS_PROP_GETSET:
+            if (pr->u.getset.getter)
+                js_heap_add_edge(hs, idx, type, name,
+                                 js_heap_find_node(hs, pr->u.getset.getter));
+            if (pr->u.getset.setter)
+                js_heap_add_edge(hs, idx, type, name,
+                                 js_heap_find_node(hs, pr->u.getset.setter));
+            break;
+        case JS_PROP_VARREF:
+            if (pr->u.var_ref->is_detached)
+                js_heap_add_edge(hs, idx, JS_HEAP_EDGE_CONTEXT, name,
+                                 js_heap_find_node(hs, pr->u.var_ref));
+            break;
+        case JS_PROP_AUTOINIT:
+            js_autoinit_mark(rt, pr, js_heap_mark_edge);
+            break;
+        }
+    }
+    if (unlikely(p->first_weak_ref)) {
+        mark_weak_map_value(rt, JS_MKPTR(JS_TAG_OBJECT, p),
+                            p->first_weak_ref, js_heap_mark_edge);
+    }
+
+    switch(p->class_id) {
+    case JS_CLASS_OBJECT:
+        break;
+    case JS_CLASS_ARRAY:
+    case JS_CLASS_ARGUMENTS:
+        for(i = 0; i < p->u.array.count; i++) {
+            js_heap_add_value_edge(hs, idx, JS_HEAP_EDGE_ELEMENT, i,
+                                   p->u.array.u.values[i]);
+        }
+        break;
+    case JS_CLASS_BYTECODE_FUNCTION:
+    case JS_CLASS_GENERATOR_FUNCTION:
+    case JS_CLASS_ASYNC_FUNCTION:
+    case JS_CLASS_ASYNC_GENERATOR_FUNCTION:
+        b = p->u.func.function_bytecode;
+        if (p->u.func.home_object) {
+            js_heap_add_edge(hs, idx, JS_HEAP_EDGE_INTERNAL,
+                             JS_HEAP_STR_HOME_OBJECT,
+                             js_heap_find_node(hs, p->u.func.home_object));
+        }
+        if (!b)
+            break;
+        if (p->u.func.var_refs) {
+            for(i = 0; i < b->closure_var_count; i++) {
+                JSVarRef *var_ref = p->u.func.var_refs[i];
+                if (var_ref && var_ref->is_detached) {
+                    js_heap_add_edge(hs, idx, JS_HEAP_EDGE_CONTEXT,
+                                     js_heap_atom(hs, b->closure_var[i].var_name),
+                                     js_heap_find_node(hs, var_ref));
+                }
+            }
+        }
+        js_heap_add_edge(hs, idx, JS_HEAP_EDGE_INTERNAL, JS_HEAP_STR_CODE,
+                         js_heap_find_node(hs, b));
+        break;
+    default:
+        gc_mark = rt->class_array[p->class_id].gc_mark;
+        if (gc_mark)
+            gc_mark(rt, JS_MKPTR(JS_TAG_OBJECT, p), js_heap_mark_edge);
+        break;
+    }
+}
+
+static void js_heap_add_gc_edges(JSHeapSnapshot *hs, uint32_t idx,
+                                 JSGCObjectHeader *gp)
+{
+    JSRuntime *rt = hs->rt;
+    JSShape *sh;
+    JSVarRef *var_ref;
+    JSContext *ctx;
+
+    hs->cur_node = idx;
+    hs->hidden_index = 0;
+    switch(gp->gc_obj_type) {
+    case JS_GC_OBJ_TYPE_JS_OBJECT:
+        js_heap_add_object_edges(hs, idx, (JSObject *)gp);
+        break;
+    case JS_GC_OBJ_TYPE_SHAPE:
+        sh = (JSShape *)gp;
+        if (sh->proto) {
+            js_heap_add_edge(hs, idx, JS_HEAP_EDGE_PROPERTY, JS_HEAP_STR_PROTO,
+                             js_heap_find_node(hs, sh->proto));
+        }
+        if (sh->parent) {
+            js_heap_add_edge(hs, idx, JS_HEAP_EDGE_INTERNAL, JS_HEAP_STR_PARENT,
+                             js_heap_find_node(hs, sh->parent));
+        }
+        break;
+    case JS_GC_OBJ_TYPE_VAR_REF:
+        var_ref = (JSVarRef *)gp;
+        js_heap_add_value_edge(hs, idx, JS_HEAP_EDGE_INTERNAL,
+                               JS_HEAP_STR_VALUE, *var_ref->pvalue);
+        break;
+    case JS_GC_OBJ_TYPE_JS_CONTEXT:
+        ctx = (JSContext *)gp;
+        js_heap_add_value_edge(hs, idx, JS_HEAP_EDGE_INTERNAL,
+                               JS_HEAP_STR_GLOBAL, ctx->global_obj);
+        mark_children(rt, gp, js_heap_mark_edge);
+        break;
+    default:
+        mark_children(rt, gp, js_heap_mark_edge);
+        break;
+    }
+}
+
+/* the strings may contain unpaired surrogates (WTF-8): they are
+   escaped so that the output is valid UTF-8 */
+static void js_put_json_string(FILE *fp, const char *str, size_t len)
+{
+    const uint8_t *p, *p_next, *p_end;
+    uint32_t c;
+
+    fputc('"', fp);
+    p = (const uint8_t *)str;
+    p_end = p + len;
+    while (p < p_end) {
+        c = *p;
+        if (c < 0x80) {
+            if (c == '"' || c == '\\') {
+                fputc('\\', fp);
+                fputc(c, fp);
+            } else if (c < 0x20) {
+                fprintf(fp, "\\u%04x", c);
+            } else {
+                fputc(c, fp);
+            }
+            p++;
+        } else {
+            c = utf8_decode_len(p, p_end - p, &p_next);
+            if (is_surrogate(c) || c == 0xFFFD)
+                fprintf(fp, "\\u%04x", c);
+            else
+                fwrite(p, 1, p_next - p, fp);
+            p = p_next;
+        }
+    }
+    fputc('"', fp);
+}
+
+static int js_heap_write(JSHeapSnapshot *hs, FILE *fp)
+{
+    JSHeapNode *n;
+    JSHeapEdge *e, *edges;
+    JSHeapString *s;
+    uint32_t i, node_count, edge_count, string_count, *pos;
+    uint64_t id;
+    int ret;
+
+    node_count = js_heap_node_count(hs);
+    edge_count = hs->edges.size / sizeof(JSHeapEdge);
+    string_count = hs->strings.size / sizeof(JSHeapString);
+
+    /* the edges are grouped by node in the snapshot */
+    ret = -1;
+    pos = js_malloc_rt(hs->rt, sizeof(pos[0]) * (node_count + 1));
+    edges = js_malloc_rt(hs->rt, sizeof(edges[0]) * (edge_count + 1));
+    if (!pos || !edges)
+        goto done;
+    pos[0] = 0;
+    for(i = 0; i < node_count; i++)
+        pos[i + 1] = pos[i] + js_heap_node(hs, i)->edge_count;
+    e = (JSHeapEdge *)hs->edges.buf;
+    for(i = 0; i < edge_count; i++)
+        edges[pos[e[i].from_node]++] = e[i];
+
+    fputs("{\"snapshot\":{\"meta\":{"
+          "\"node_fields\":[\"type\",\"name\",\"id\",\"self_size\",\"edge_count\",\"trace_node_id\"],"
+          "\"node_types\":[[\"hidden\",\"array\",\"string\",\"object\",\"code\",\"closure\",\"regexp\","
+          "\"number\",\"native\",\"synthetic\",\"concatenated string\",\"sliced string\",\"symbol\","
+          "\"bigint\",\"object shape\"],\"string\",\"number\",\"number\",\"number\",\"number\"],"
+          "\"edge_fields\":[\"type\",\"name_or_index\",\"to_node\"],"
+          "\"edge_types\":[[\"context\",\"element\",\"property\",\"internal\",\"hidden\",\"shortcut\","
+          "\"weak\"],\"string_or_number\",\"node\"],"
+          "\"trace_function_info_fields\":[\"function_id\",\"name\",\"script_name\",\"script_id\","
+          "\"line\",\"column\"],"
+          "\"trace_node_fields\":[\"id\",\"function_info_index\",\"count\",\"size\",\"children\"],"
+          "\"sample_fields\":[\"timestamp_us\",\"last_assigned_id\"],"
+          "\"location_fields\":[\"object_index\",\"script_id\",\"line\",\"column\"]},\n", fp);
+    fprintf(fp, "\"node_count\":%u,\"edge_count\":%u,\"trace_function_count\":0},\n",
+            node_count, edge_count);
+    fputs("\"nodes\":[", fp);
+    for(i = 0; i < node_count; i++) {
+        n = js_heap_node(hs, i);
+        /* odd ids derived from the address so that they are stable
+           between snapshots, 1 for the root */
+        id = n->ptr ? ((uint64_t)(uintptr_t)n->ptr >> 3) * 2 + 1 : 1;
+        fprintf(fp, "%s%u,%u,%" PRIu64 ",%" PRId64 ",%u,0", i ? ",\n" : "",
+                n->type, n->name, id, n->self_size, n->edge_count);
+    }
+    fputs("],\n\"edges\":[", fp);
+    for(i = 0; i < edge_count; i++) {
+        e = &edges[i];
+        fprintf(fp, "%s%u,%u,%u", i ? ",\n" : "", e->type, e->name_or_index,
+                e->to_node * 6);
+    }
+    fputs("],\n\"trace_function_infos\":[],\"trace_tree\":[],\"samples\":[],"
+          "\"locations\":[],\n\"strings\":[", fp);
+    for(i = 0; i < string_count; i++) {
+        s = (JSHeapString *)hs->strings.buf + i;
+        if (i)
+            fputs(",\n", fp);
+        js_put_json_string(fp, (char *)hs->str_buf.buf + s->pos, s->len);
+    }
+    fputs("]}\n", fp);
+    ret = ferror(fp) ? -1 : 0;
+ done:
+    js_free_rt(hs->rt, pos);
+    js_free_rt(hs->rt, edges);
+    return ret;
+}
+
+int JS_WriteHeapSnapshot(JSRuntime *rt, FILE *fp)
+{
+    JSHeapSnapshot hs_s, *hs = &hs_s;
+    struct list_head *el;
+    JSGCObjectHeader *gp;
+    JSHeapNode *n;
+    uint32_t i, root_index, name;
+    int ret;
+
+    /* no snapshot during a GC or from a finalizer */
+    if (rt->gc_phase != JS_GC_PHASE_NONE || rt->heap_snapshot)
+        return -1;
+    memset(hs, 0, sizeof(*hs));
+    hs->rt = rt;
+    dbuf_init2(&hs->nodes, rt, js_dbuf_realloc_rt);
+    dbuf_init2(&hs->edges, rt, js_dbuf_realloc_rt);
+    dbuf_init2(&hs->strings, rt, js_dbuf_realloc_rt);
+    dbuf_init2(&hs->str_buf, rt, js_dbuf_realloc_rt);
+    rt->heap_snapshot = hs;
+    ret = -1;
+    hs->atom_strings = js_mallocz_rt(rt, sizeof(hs->atom_strings[0]) *
+                                     rt->atom_size);
+    if (!hs->atom_strings || js_heap_resize_hash(hs, 256))
+        goto done;
+    for(i = 0; i < JS_HEAP_STR_COUNT; i++)
+        js_heap_string(hs, js_heap_strings[i], strlen(js_heap_strings[i]));
+
+    if (js_heap_add_node(hs, NULL, JS_HEAP_NODE_SYNTHETIC,
+                         JS_HEAP_STR_ROOT, 0) < 0)
+        goto done;
+    list_for_each(el, &rt->gc_obj_list) {
+        gp = list_entry(el, JSGCObjectHeader, link);
+        if (js_heap_add_gc_node(hs, gp) < 0)
+            goto done;
+    }
+    for(i = 1; i < js_heap_node_count(hs); i++) {
+        n = js_heap_node(hs, i);
+        gp = n->ptr;
+        if (gp->gc_obj_type == JS_GC_OBJ_TYPE_JS_OBJECT &&
+            ((JSObject *)gp)->class_id == JS_CLASS_OBJECT) {
+            /* 'n' is invalid if the string table grows */
+            name = js_heap_object_name(hs, (JSObject *)gp);
+            js_heap_node(hs, i)->name = name;
+        }
+    }
+    /* the GC objects with more references than the ones from the other
+       GC objects are referenced from outside */
+    list_for_each(el, &rt->gc_obj_list) {
+        gp = list_entry(el, JSGCObjectHeader, link);
+        mark_children(rt, gp, js_heap_count_ref);
+    }
+    root_index = 0;
+    for(i = 1; i < js_heap_node_count(hs); i++) {
+        n = js_heap_node(hs, i);
+        if (((JSGCObjectHeader *)n->ptr)->ref_count > n->internal_ref_count)
+            js_heap_add_edge(hs, 0, JS_HEAP_EDGE_ELEMENT, root_index++, i);
+    }
+    /* the string nodes are added while adding the edges */
+    i = 1;
+    list_for_each(el, &rt->gc_obj_list) {
+        gp = list_entry(el, JSGCObjectHeader, link);
+        js_heap_add_gc_edges(hs, i++, gp);
+    }
+    if (dbuf_error(&hs->nodes) || dbuf_error(&hs->edges) ||
+        dbuf_error(&hs->strings) || dbuf_error(&hs->str_buf))
+        goto done;
+    ret = js_heap_write(hs, fp);
+ done:
+    rt->heap_snapshot = NULL;
+    js_free_rt(rt, hs->atom_strings);
+    js_free_rt(rt, hs->str_hash);
+    js_free_rt(rt, hs->hash_ptrs);
+    js_free_rt(rt, hs->hash_nodes);
+    dbuf_free(&hs->nodes);
+    dbuf_free(&hs->edges);
+    dbuf_free(&hs->strings);
+    dbuf_free(&hs->str_buf);
+    return ret;
+}
+
+/* Event tracing: the garbage collections, compilations, module loads,
+   jobs and JS_Eval() and JS_EvalFunction() calls are recorded as
+   complete events with their start and end times in a ring buffer. */
+
+#define JS_TRACE_DEFAULT_SIZE 65536
+#define JS_TRACE_DETAIL_SIZE 39
+
+typedef struct JSTraceEvent {
+    uint64_t start, end; /* in ns */
+    int64_t arg;
+    uint8_t type; /* JSTraceEventEnum */
+    char detail[JS_TRACE_DETAIL_SIZE]; /* truncated name or file name */
+} JSTraceEvent;
+
+typedef struct JSTracer {
+    JSTraceEvent *events;
+    uint32_t size; /* number of events of the ring buffer */
+    uint32_t count; /* number of recorded events, at most 'size' */
+    uint32_t head; /* position of the next event */
+} JSTracer;
+
+static const struct {
+    const char *name, *cat;
+    const char *detail_name; /* name of the 'detail' argument, or NULL */
+    const char *arg_name; /* name of the 'arg' argument, or NULL */
+} js_trace_event_def[JS_TRACE_COUNT] = {
+    [JS_TRACE_GC] = { "gc", "gc", NULL, "freed_bytes" },
+    [JS_TRACE_GC_DECREF] = { "gc_decref", "gc", NULL, NULL },
+    [JS_TRACE_GC_SCAN] = { "gc_scan", "gc", NULL, NULL },
+    [JS_TRACE_GC_FREE_CYCLES] = { "gc_free_cycles", "gc", NULL, NULL },
+    [JS_TRACE_EVAL] = { "JS_Eval", "eval", "file", NULL },
+    [JS_TRACE_EVAL_FUNCTION] = { "JS_EvalFunction", "eval", NULL, NULL },
+    [JS_TRACE_COMPILE] = { "compile", "compile", "file", NULL },
+    [JS_TRACE_COMPILE_LAZY] = { "compile_lazy", "compile", "function", NULL },
+    [JS_TRACE_LOAD_MODULE] = { "load_module", "module", "module", NULL },
+    [JS_TRACE_RUN_JOBS] = { "run_jobs", "job", NULL, "jobs" },
+    [JS_TRACE_JOB] = { "job", "job", NULL, NULL },
+};
+
+static void js_trace_free(JSRuntime *rt)
+{
+    JSTracer *tr = rt->tracer;
+
+    rt->tracer = NULL;
+    js_free_rt(rt, tr->events);
+    js_free_rt(rt, tr);
+}
+
+/* 'start' is the value returned by js_trace_begin(). 'detail' is
+   truncated. */
+static void js_trace_end(JSRuntime *rt, JSTraceEventEnum type, uint64_t start,
+                         const char *detail, int64_t arg)
+{
+    JSTracer *tr = rt->tracer;
+    JSTraceEvent *ev;
+    size_t len;
+
+    /* the tracing may have been started or stopped since the beginning
+       of the event */
+    if (!tr || start == 0)
+        return;
+    ev = &tr->events[tr->head];
+    ev->start = start;
+    ev->end = js__hrtime_ns();
+    ev->arg = arg;
+    ev->type = type;
+    len = 0;
+    if (detail) {
+        len = strlen(detail);
+        if (len >= JS_TRACE_DETAIL_SIZE) {
+            /* do not cut a UTF-8 sequence */
+            len = JS_TRACE_DETAIL_SIZE - 1;
+            while (len > 0 && (detail[len] & 0xc0) == 0x80)
+                len--;
+        }
+        memcpy(ev->detail, detail, len);
+    }
+    ev->detail[len] = '\0';
+    if (++tr->head == tr->size)
+        tr->head = 0;
+    if (tr->count < tr->size)
+        tr->count++;
+}
+
+int JS_StartTracing(JSRuntime *rt, uint32_t max_events)
+{
+    JSTracer *tr;
+
+    if (rt->tracer)
+        return -1;
+    if (max_events == 0)
+        max_events = JS_TRACE_DEFAULT_SIZE;
+    tr = js_mallocz_rt(rt, sizeof(*tr));
+    if (!tr)
+        return -1;
+    tr->events = js_malloc_rt(rt, sizeof(tr->events[0]) * max_events);
+    if (!tr->events) {
+        js_free_rt(rt, tr);
+        return -1;
+    }
+    tr->size = max_events;
+    rt->tracer = tr;
+    return 0;
+}
+
+int JS_StopTracing(JSRuntime *rt)
+{
+    if (!rt->tracer)
+        return -1;
+    js_trace_free(rt);
+    return 0;
+}
+
+/* time in microseconds with a nanosecond precision */
+static void js_trace_put_time(FILE *fp, uint64_t ns)
+{
+    fprintf(fp, "%" PRIu64 ".%03u", ns / 1000, (unsigned)(ns % 1000));
+}
+
+int JS_WriteTrace(JSRuntime *rt, FILE *fp)
+{
+    JSTracer *tr = rt->tracer;
+    JSTraceEvent *ev;
+    const char *sep;
+    uint32_t i, pos;
+
+    if (!tr)
+        return -1;
+    fputs("{\"traceEvents\":[\n"
+          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+          "\"args\":{\"name\":\"QuickJS\"}}", fp);
+    /* from the oldest event */
+    pos = tr->head + tr->size - tr->count;
+    for(i = 0; i < tr->count; i++) {
+        ev = &tr->events[(pos + i) % tr->size];
+        fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":",
+                js_trace_event_def[ev->type].name,
+                js_trace_event_def[ev->type].cat);
+        js_trace_put_time(fp, ev->start);
+        fputs(",\"dur\":", fp);
+        js_trace_put_time(fp, ev->end - ev->start);
+        fputs(",\"pid\":1,\"tid\":1,\"args\":{", fp);
+        sep = "";
+        if (js_trace_event_def[ev->type].detail_name) {
+            fprintf(fp, "\"%s\":", js_trace_event_def[ev->type].detail_name);
+            js_put_json_string(fp, ev->detail, strlen(ev->detail));
+            sep = ",";
+        }
+        if (js_trace_event_def[ev->type].arg_name) {
+            fprintf(fp, "%s\"%s\":%" PRId64, sep,
+                    js_trace_event_def[ev->type].arg_name, ev->arg);
+        }
+        fputs("}}", fp);
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fp);
+    if (ferror(fp))
+        return -1;
+    return 0;
 }
 
 JSValue JS_GetGlobalObject(JSContext *ctx)
@@ -7583,8 +9612,7 @@ static int get_sleb128(int32_t *pval, const uint8_t *buf,
     return ret;
 }
 
-static int find_line_num(JSContext *ctx, JSFunctionBytecode *b,
-                         uint32_t pc_value, int *col)
+static int find_line_num(JSFunctionBytecode *b, uint32_t pc_value, int *col)
 {
     const uint8_t *p_end, *p;
     int new_line_num, new_col_num, line_num, col_num, pc, v, ret;
@@ -7752,7 +9780,7 @@ static void js_trace_typeerror_site(JSContext *ctx, const char *tag)
     }
     if (sf->cur_pc) {
         uint32_t pc = sf->cur_pc - b->byte_code_buf - 1;
-        line_num = find_line_num(ctx, b, pc, &col_num);
+        line_num = find_line_num(b, pc, &col_num);
     }
 
 done:
@@ -8006,7 +10034,7 @@ static void build_backtrace(JSContext *ctx, JSValueConst error_val,
                 uint32_t pc;
 
                 pc = sf->cur_pc - b->byte_code_buf - 1;
-                line_num1 = find_line_num(ctx, b, pc, &col_num1);
+                line_num1 = find_line_num(b, pc, &col_num1);
                 atom_str = b->filename ? JS_AtomToCString(ctx, b->filename) : NULL;
                 dbuf_printf(&dbuf, " (%s", atom_str ? atom_str : "<null>");
                 JS_FreeCString(ctx, atom_str);
@@ -8307,7 +10335,7 @@ static JSValue JS_ThrowTypeErrorNotAFunction(JSContext *ctx)
                 int pc = 0;
                 if (sf->cur_pc && b->byte_code_buf)
                     pc = sf->cur_pc - b->byte_code_buf - 1;
-                line_num = find_line_num(ctx, b, pc, &col_num);
+                line_num = find_line_num(b, pc, &col_num);
                 if (b->filename)
                     file_name = JS_AtomToCString(ctx, b->filename);
                 func_name = get_func_name(ctx, cur_func);
@@ -8385,16 +10413,879 @@ static JSValue JS_ThrowTypeErrorInvalidClass(JSContext *ctx, int class_id)
     return JS_ThrowTypeErrorAtom(ctx, "%s object expected", name);
 }
 
+/* CPU profiler: the stack is sampled at the first interrupt check
+   following each interval. The samples are aggregated in a tree of
+   frames rooted at the outermost call. */
+
+#define JS_PROFILE_MAX_DEPTH 128
+#define JS_PROFILE_MAX_VALUES 4
+/* the interrupt checks are more frequent when profiling. Their period
+   is random so that the samples are not biased towards some of the
+   checks of a loop. */
+#define JS_PROFILE_COUNTER_MAX 1024
+
+typedef struct JSProfileNode {
+    struct JSProfileNode *parent;
+    struct JSProfileNode *first_child;
+    struct JSProfileNode *next_sibling;
+    JSAtom func_name;
+    JSAtom filename; /* JS_ATOM_NULL for native functions */
+    int func_line, func_col; /* position of the function */
+    int line, col; /* position in the function */
+    /* values of the samples ending at this node. The first one is not
+       zero if there are samples. */
+    int64_t values[JS_PROFILE_MAX_VALUES];
+    uint32_t id; /* location id, assigned when writing the profile */
+} JSProfileNode;
+
+typedef struct JSProfiler {
+    uint64_t interval_ns;
+    uint64_t start_time;
+    uint64_t next_sample_time;
+    uint32_t random_state;
+    JSProfileNode root;
+} JSProfiler;
+
+static void js_profile_free_node(JSRuntime *rt, JSProfileNode *n)
+{
+    JSProfileNode *c, *c1;
+
+    for(c = n->first_child; c != NULL; c = c1) {
+        c1 = c->next_sibling;
+        js_profile_free_node(rt, c);
+        JS_FreeAtomRT(rt, c->func_name);
+        JS_FreeAtomRT(rt, c->filename);
+        js_free_rt(rt, c);
+    }
+}
+
+static void js_profile_free(JSRuntime *rt)
+{
+    JSProfiler *prof = rt->profiler;
+
+    js_profile_free_node(rt, &prof->root);
+    js_free_rt(rt, prof);
+    rt->profiler = NULL;
+}
+
+/* return the child of 'parent' matching 'key' or create it. The most
+   recently used child is moved first. */
+static JSProfileNode *js_profile_get_child(JSRuntime *rt,
+                                           JSProfileNode *parent,
+                                           const JSProfileNode *key)
+{
+    JSProfileNode *n, **pn;
+
+    for(pn = &parent->first_child; (n = *pn) != NULL; pn = &n->next_sibling) {
+        if (n->func_name == key->func_name && n->filename == key->filename &&
+            n->line == key->line && n->col == key->col &&
+            n->func_line == key->func_line && n->func_col == key->func_col) {
+            *pn = n->next_sibling;
+            goto found;
+        }
+    }
+    n = js_malloc_rt(rt, sizeof(*n));
+    if (!n)
+        return NULL;
+    *n = *key;
+    n->parent = parent;
+    n->first_child = NULL;
+    memset(n->values, 0, sizeof(n->values));
+    n->id = 0;
+    JS_DupAtomRT(rt, n->func_name);
+    JS_DupAtomRT(rt, n->filename);
+ found:
+    n->next_sibling = parent->first_child;
+    parent->first_child = n;
+    return n;
+}
+
+/* return the child of 'parent' for the function 'func' executing at
+   'cur_pc' (NULL if unknown). Return 'parent' if 'func' is not a
+   function and NULL if out of memory. */
+static JSProfileNode *js_profile_add_frame(JSRuntime *rt,
+                                          JSProfileNode *parent,
+                                          JSValueConst func,
+                                          const uint8_t *cur_pc)
+{
+    JSProfileNode key, *n;
+    JSFunctionBytecode *b;
+    JSObject *p;
+    JSProperty *pr;
+    JSShapeProperty *prs;
+    JSString *str;
+    JSAtom native_name;
+
+    if (JS_VALUE_GET_TAG(func) != JS_TAG_OBJECT)
+        return parent;
+    p = JS_VALUE_GET_OBJ(func);
+    memset(&key, 0, sizeof(key));
+    native_name = JS_ATOM_NULL;
+    if (js_class_has_bytecode(p->class_id)) {
+        b = p->u.func.function_bytecode;
+        key.func_name = b->func_name;
+        key.filename = b->filename;
+        key.func_line = b->line_num;
+        key.func_col = b->col_num;
+        key.line = b->line_num;
+        key.col = b->col_num;
+        if (cur_pc) {
+            key.line = find_line_num(b, cur_pc - b->byte_code_buf - 1,
+                                     &key.col);
+        }
+    } else {
+        prs = find_own_property(&pr, p, JS_ATOM_name);
+        if (prs && (prs->flags & JS_PROP_TMASK) == JS_PROP_NORMAL &&
+            JS_VALUE_GET_TAG(pr->u.value) == JS_TAG_STRING) {
+            str = JS_VALUE_GET_STRING(js_dup(pr->u.value));
+            native_name = __JS_NewAtom(rt, str, JS_ATOM_TYPE_STRING);
+            if (native_name == JS_ATOM_NULL)
+                return NULL;
+            key.func_name = native_name;
+        }
+    }
+    n = js_profile_get_child(rt, parent, &key);
+    JS_FreeAtomRT(rt, native_name);
+    return n;
+}
+
+/* 'callee' is the function about to be called, if any. Without it,
+   the functions which do not call other functions or loop would never
+   be sampled. */
+static void js_profile_sample(JSRuntime *rt, JSValueConst callee)
+{
+    JSProfiler *prof = rt->profiler;
+    JSStackFrame *frames[JS_PROFILE_MAX_DEPTH];
+    JSStackFrame *sf;
+    JSProfileNode *n;
+    int i, depth;
+
+    depth = 0;
+    for(sf = rt->current_stack_frame;
+        sf != NULL && depth < JS_PROFILE_MAX_DEPTH; sf = sf->prev_frame) {
+        frames[depth++] = sf;
+    }
+    n = &prof->root;
+    for(i = depth - 1; i >= 0 && n != NULL; i--)
+        n = js_profile_add_frame(rt, n, frames[i]->cur_func, frames[i]->cur_pc);
+    if (n != NULL)
+        n = js_profile_add_frame(rt, n, callee, NULL);
+    if (n != NULL) {
+        n->values[0]++;
+        n->values[1] += prof->interval_ns;
+    }
+    /* otherwise the sample is lost */
+}
+
+static void js_profile_poll(JSContext *ctx, JSValueConst callee)
+{
+    JSProfiler *prof = ctx->rt->profiler;
+    uint64_t now;
+
+    now = js__hrtime_ns();
+    if (now >= prof->next_sample_time) {
+        prof->next_sample_time = now + prof->interval_ns;
+        js_profile_sample(ctx->rt, callee);
+    }
+    /* xorshift32 */
+    prof->random_state ^= prof->random_state << 13;
+    prof->random_state ^= prof->random_state >> 17;
+    prof->random_state ^= prof->random_state << 5;
+    ctx->interrupt_counter = 1 + prof->random_state % JS_PROFILE_COUNTER_MAX;
+}
+
+int JS_StartProfiling(JSRuntime *rt, uint32_t interval_us)
+{
+    JSProfiler *prof;
+
+    if (rt->profiler)
+        return -1;
+    prof = js_mallocz_rt(rt, sizeof(*prof));
+    if (!prof)
+        return -1;
+    if (interval_us == 0)
+        interval_us = 1000;
+    prof->interval_ns = (uint64_t)interval_us * 1000;
+    prof->start_time = js__hrtime_ns();
+    prof->next_sample_time = prof->start_time + prof->interval_ns;
+    prof->random_state = 1;
+    rt->profiler = prof;
+    return 0;
+}
+
+static void js_profile_put_frame(JSRuntime *rt, DynBuf *dbuf,
+                                 const JSProfileNode *n)
+{
+    char buf[256];
+    const char *str;
+
+    str = "(anonymous)";
+    if (n->func_name != JS_ATOM_NULL) {
+        JS_AtomGetStrRT(rt, buf, sizeof(buf), n->func_name);
+        if (buf[0])
+            str = buf;
+    }
+    dbuf_putstr(dbuf, str);
+    if (n->filename == JS_ATOM_NULL) {
+        dbuf_putstr(dbuf, " (native)");
+    } else {
+        /* file names are often longer than atom buffers */
+        char filename[1024];
+        JS_AtomGetStrRT(rt, filename, sizeof(filename), n->filename);
+        dbuf_printf(dbuf, " (%s:%d:%d)", filename, n->func_line, n->func_col);
+    }
+}
+
+typedef struct JSProfileStack {
+    size_t pos, len; /* position of the stack in the string buffer */
+    int64_t value;
+} JSProfileStack;
+
+static void js_profile_collect_stacks(JSRuntime *rt, DynBuf *stacks,
+                                      DynBuf *strs, DynBuf *path,
+                                      const JSProfileNode *n, int value_idx)
+{
+    const JSProfileNode *c;
+    JSProfileStack st;
+    size_t len;
+
+    for(c = n->first_child; c != NULL; c = c->next_sibling) {
+        len = path->size;
+        if (len != 0)
+            dbuf_putc(path, ';');
+        js_profile_put_frame(rt, path, c);
+        if (c->values[value_idx] != 0) {
+            st.pos = strs->size;
+            st.len = path->size;
+            st.value = c->values[value_idx];
+            dbuf_put(strs, path->buf, path->size);
+            dbuf_put(stacks, &st, sizeof(st));
+        }
+        js_profile_collect_stacks(rt, stacks, strs, path, c, value_idx);
+        path->size = len;
+    }
+}
+
+static int js_profile_stack_cmp(const void *a, const void *b, void *opaque)
+{
+    const JSProfileStack *s1 = a, *s2 = b;
+    const uint8_t *strs = opaque;
+    int res;
+
+    res = memcmp(strs + s1->pos, strs + s2->pos, s1->len < s2->len ? s1->len : s2->len);
+    if (res == 0)
+        res = (s1->len > s2->len) - (s1->len < s2->len);
+    return res;
+}
+
+/* one "frame;frame;...;frame value" line per stack, from the
+   outermost frame. It is the input format of flamegraph.pl. The nodes
+   which only differ by their position in the function are merged. */
+static int js_profile_write_collapsed(JSRuntime *rt, DynBuf *out,
+                                      const JSProfileNode *root,
+                                      int value_idx)
+{
+    DynBuf stacks, strs, path;
+    JSProfileStack *tab;
+    size_t i, j, n;
+    int64_t value;
+    int ret;
+
+    dbuf_init2(&stacks, rt, js_dbuf_realloc_rt);
+    dbuf_init2(&strs, rt, js_dbuf_realloc_rt);
+    dbuf_init2(&path, rt, js_dbuf_realloc_rt);
+    js_profile_collect_stacks(rt, &stacks, &strs, &path, root, value_idx);
+    ret = -1;
+    if (dbuf_error(&stacks) || dbuf_error(&strs) || dbuf_error(&path))
+        goto done;
+    tab = (JSProfileStack *)stacks.buf;
+    n = stacks.size / sizeof(tab[0]);
+    rqsort(tab, n, sizeof(tab[0]), js_profile_stack_cmp, strs.buf);
+    for(i = 0; i < n; i = j) {
+        value = 0;
+        for(j = i; j < n && !js_profile_stack_cmp(&tab[i], &tab[j], strs.buf); j++)
+            value += tab[j].value;
+        dbuf_put(out, strs.buf + tab[i].pos, tab[i].len);
+        dbuf_printf(out, " %" PRId64 "\n", value);
+    }
+    ret = 0;
+ done:
+    dbuf_free(&stacks);
+    dbuf_free(&strs);
+    dbuf_free(&path);
+    return ret;
+}
+
+/* pprof format (profile.proto), uncompressed */
+
+static void pb_put_varint(DynBuf *s, uint64_t v)
+{
+    while (v >= 0x80) {
+        dbuf_putc(s, (v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    dbuf_putc(s, v);
+}
+
+static void pb_put_int(DynBuf *s, int field, uint64_t v)
+{
+    pb_put_varint(s, field << 3); /* varint */
+    pb_put_varint(s, v);
+}
+
+static void pb_put_bytes(DynBuf *s, int field, const void *buf, size_t len)
+{
+    pb_put_varint(s, (field << 3) | 2); /* length delimited */
+    pb_put_varint(s, len);
+    dbuf_put(s, buf, len);
+}
+
+/* write the sub-message 'm' and reset it */
+static void pb_put_message(DynBuf *s, int field, DynBuf *m)
+{
+    pb_put_bytes(s, field, m->buf, m->size);
+    m->size = 0;
+}
+
+typedef struct JSProfileFunc {
+    const JSProfileNode *node; /* first node of the function */
+    uint32_t id;
+} JSProfileFunc;
+
+typedef struct JSProfileWriter {
+    JSRuntime *rt;
+    DynBuf out;
+    DynBuf msg, msg2;
+    int value_count;
+    uint32_t string_count;
+    uint32_t *atom_strings; /* atom -> string index, 0 if none */
+    JSProfileFunc *funcs; /* hash table */
+    uint32_t funcs_size;
+    uint32_t func_count;
+} JSProfileWriter;
+
+static uint32_t js_profile_string(JSProfileWriter *w, const char *str)
+{
+    pb_put_bytes(&w->out, 6, str, strlen(str));
+    return w->string_count++;
+}
+
+static uint32_t js_profile_atom_string(JSProfileWriter *w, JSAtom atom)
+{
+    char buf[1024];
+    uint32_t idx;
+
+    if (atom == JS_ATOM_NULL)
+        return 0;
+    if (!__JS_AtomIsTaggedInt(atom) && w->atom_strings[atom] != 0)
+        return w->atom_strings[atom];
+    idx = js_profile_string(w, JS_AtomGetStrRT(w->rt, buf, sizeof(buf), atom));
+    if (!__JS_AtomIsTaggedInt(atom))
+        w->atom_strings[atom] = idx;
+    return idx;
+}
+
+/* return the id of the function of 'n' */
+static uint32_t js_profile_func_id(JSProfileWriter *w, const JSProfileNode *n)
+{
+    const JSProfileNode *f;
+    uint32_t h, id, name, filename;
+
+    h = n->func_name;
+    h = h * 263 + n->filename;
+    h = h * 263 + n->func_line;
+    h = h * 263 + n->func_col;
+    h &= w->funcs_size - 1;
+    while ((f = w->funcs[h].node) != NULL) {
+        if (f->func_name == n->func_name && f->filename == n->filename &&
+            f->func_line == n->func_line && f->func_col == n->func_col)
+            return w->funcs[h].id;
+        h = (h + 1) & (w->funcs_size - 1);
+    }
+    id = ++w->func_count;
+    w->funcs[h].node = n;
+    w->funcs[h].id = id;
+    name = js_profile_atom_string(w, n->func_name);
+    if (name == 0)
+        name = js_profile_string(w, "(anonymous)");
+    filename = js_profile_atom_string(w, n->filename);
+    pb_put_int(&w->msg, 1, id);
+    pb_put_int(&w->msg, 2, name);
+    pb_put_int(&w->msg, 4, filename);
+    pb_put_int(&w->msg, 5, n->func_line);
+    pb_put_message(&w->out, 5, &w->msg);
+    return id;
+}
+
+static uint32_t js_profile_count_nodes(const JSProfileNode *n)
+{
+    const JSProfileNode *c;
+    uint32_t count = 0;
+
+    for(c = n->first_child; c != NULL; c = c->next_sibling)
+        count += 1 + js_profile_count_nodes(c);
+    return count;
+}
+
+/* write the functions and locations of the subtree 'n'. There is one
+   location per node. */
+static void js_profile_write_locations(JSProfileWriter *w, JSProfileNode *n,
+                                       uint32_t *plocation_count)
+{
+    JSProfileNode *c;
+    uint32_t func_id;
+
+    for(c = n->first_child; c != NULL; c = c->next_sibling) {
+        func_id = js_profile_func_id(w, c);
+        c->id = ++*plocation_count;
+        pb_put_int(&w->msg2, 1, func_id);
+        pb_put_int(&w->msg2, 2, c->line);
+        pb_put_int(&w->msg2, 3, c->col);
+        pb_put_int(&w->msg, 1, c->id);
+        pb_put_message(&w->msg, 4, &w->msg2);
+        pb_put_message(&w->out, 4, &w->msg);
+        js_profile_write_locations(w, c, plocation_count);
+    }
+}
+
+static void js_profile_write_samples(JSProfileWriter *w, JSProfileNode *n)
+{
+    JSProfileNode *c, *n1;
+    int i;
+
+    for(c = n->first_child; c != NULL; c = c->next_sibling) {
+        if (c->values[0] != 0) {
+            /* location ids from the leaf */
+            for(n1 = c; n1->parent != NULL; n1 = n1->parent)
+                pb_put_varint(&w->msg2, n1->id);
+            pb_put_message(&w->msg, 1, &w->msg2);
+            for(i = 0; i < w->value_count; i++)
+                pb_put_varint(&w->msg2, c->values[i]);
+            pb_put_message(&w->msg, 2, &w->msg2);
+            pb_put_message(&w->out, 2, &w->msg);
+        }
+        js_profile_write_samples(w, c);
+    }
+}
+
+/* 'types' contains the type and the unit of the 'value_count' values
+   followed by the type and the unit of the sampling period */
+static int js_profile_write_pprof(JSRuntime *rt, DynBuf *out,
+                                  JSProfileNode *root,
+                                  const char * const *types, int value_count,
+                                  int64_t period, uint64_t duration_ns)
+{
+    JSProfileWriter w_s, *w = &w_s;
+    uint32_t type_strings[2 * (JS_PROFILE_MAX_VALUES + 1)];
+    uint32_t count, location_count;
+    int i, j, ret;
+
+    memset(w, 0, sizeof(*w));
+    w->rt = rt;
+    w->out = *out;
+    w->value_count = value_count;
+    dbuf_init2(&w->msg, rt, js_dbuf_realloc_rt);
+    dbuf_init2(&w->msg2, rt, js_dbuf_realloc_rt);
+    w->funcs_size = 16;
+    count = js_profile_count_nodes(root);
+    while (w->funcs_size < 2 * count)
+        w->funcs_size *= 2;
+    w->funcs = js_mallocz_rt(rt, sizeof(w->funcs[0]) * w->funcs_size);
+    w->atom_strings = js_mallocz_rt(rt, sizeof(w->atom_strings[0]) *
+                                    rt->atom_size);
+    ret = -1;
+    if (!w->funcs || !w->atom_strings)
+        goto done;
+
+    js_profile_string(w, "");
+    for(i = 0; i < 2 * (value_count + 1); i++) {
+        for(j = 0; j < i && strcmp(types[i], types[j]); j++)
+            continue;
+        if (j < i)
+            type_strings[i] = type_strings[j];
+        else
+            type_strings[i] = js_profile_string(w, types[i]);
+    }
+    for(i = 0; i < value_count; i++) {
+        pb_put_int(&w->msg, 1, type_strings[2 * i]);
+        pb_put_int(&w->msg, 2, type_strings[2 * i + 1]);
+        pb_put_message(&w->out, 1, &w->msg);
+    }
+    location_count = 0;
+    js_profile_write_locations(w, root, &location_count);
+    js_profile_write_samples(w, root);
+    pb_put_int(&w->out, 10, duration_ns);
+    pb_put_int(&w->msg, 1, type_strings[2 * value_count]);
+    pb_put_int(&w->msg, 2, type_strings[2 * value_count + 1]);
+    pb_put_message(&w->out, 11, &w->msg);
+    pb_put_int(&w->out, 12, period);
+    ret = 0;
+    if (dbuf_error(&w->msg) || dbuf_error(&w->msg2))
+        ret = -1;
+ done:
+    js_free_rt(rt, w->funcs);
+    js_free_rt(rt, w->atom_strings);
+    dbuf_free(&w->msg);
+    dbuf_free(&w->msg2);
+    *out = w->out;
+    return ret;
+}
+
+int JS_StopProfiling(JSRuntime *rt, FILE *fp, JSProfileFormatEnum format)
+{
+    JSProfiler *prof = rt->profiler;
+    DynBuf out;
+    int ret;
+
+    if (!prof)
+        return -1;
+    ret = 0;
+    if (fp) {
+        dbuf_init2(&out, rt, js_dbuf_realloc_rt);
+        if (format == JS_PROFILE_PPROF) {
+            static const char * const types[] = {
+                "samples", "count", "cpu", "nanoseconds", "cpu", "nanoseconds",
+            };
+            ret = js_profile_write_pprof(rt, &out, &prof->root, types, 2,
+                                         prof->interval_ns,
+                                         js__hrtime_ns() - prof->start_time);
+        } else {
+            ret = js_profile_write_collapsed(rt, &out, &prof->root, 0);
+        }
+        if (dbuf_error(&out) ||
+            fwrite(out.buf, 1, out.size, fp) != out.size)
+            ret = -1;
+        dbuf_free(&out);
+    }
+    js_profile_free(rt);
+    return ret;
+}
+
+/* Allocation profiler: one allocation is sampled every 'interval'
+   bytes on average and its stack is recorded in a tree of frames as
+   in the CPU profiler. The allocation functions are called while the
+   runtime structures are being modified, so only the stack frames are
+   saved when an allocation is sampled. They are recorded at the next
+   interrupt check. */
+
+#define JS_ALLOC_PROFILE_MAX_PENDING 16
+
+/* values of the allocation profile nodes */
+enum {
+    JS_ALLOC_PROFILE_ALLOC_OBJECTS,
+    JS_ALLOC_PROFILE_ALLOC_SPACE,
+    JS_ALLOC_PROFILE_INUSE_OBJECTS,
+    JS_ALLOC_PROFILE_INUSE_SPACE,
+    JS_ALLOC_PROFILE_VALUE_COUNT,
+};
+
+typedef struct JSAllocFrame {
+    JSValue func;
+    const uint8_t *cur_pc;
+} JSAllocFrame;
+
+typedef struct JSAllocSample {
+    void *ptr; /* NULL if freed before being recorded */
+    size_t size;
+    int frame_count;
+    JSAllocFrame frames[JS_PROFILE_MAX_DEPTH]; /* innermost frame first */
+} JSAllocSample;
+
+/* recorded sample whose allocation is not freed yet */
+typedef struct JSAllocLive {
+    void *ptr; /* NULL if the entry is empty */
+    JSProfileNode *node;
+    int64_t count, size; /* weight of the sample */
+} JSAllocLive;
+
+typedef struct JSAllocProfiler {
+    uint64_t interval; /* mean number of bytes between two samples */
+    int64_t bytes_until_sample;
+    uint32_t random_state;
+    uint64_t start_time;
+    bool recording; /* the allocations of the profiler are not sampled */
+    /* hash table of the live samples with linear probing */
+    JSAllocLive *live;
+    int live_bits;
+    uint32_t live_count;
+    int pending_count;
+    JSAllocSample pending[JS_ALLOC_PROFILE_MAX_PENDING];
+    JSProfileNode root;
+} JSAllocProfiler;
+
+static void js_alloc_profile_free(JSRuntime *rt)
+{
+    JSAllocProfiler *prof = rt->alloc_profiler;
+    JSAllocSample *s;
+    int i;
+
+    /* no more sampling while the profiler is freed */
+    rt->alloc_profiler = NULL;
+    for(s = prof->pending; s < prof->pending + prof->pending_count; s++) {
+        for(i = 0; i < s->frame_count; i++)
+            JS_FreeValueRT(rt, s->frames[i].func);
+    }
+    js_profile_free_node(rt, &prof->root);
+    js_free_rt(rt, prof->live);
+    js_free_rt(rt, prof);
+}
+
+/* the distance between two samples follows an exponential
+   distribution so that the samples are not correlated with the
+   allocation pattern */
+static int64_t js_alloc_profile_next(JSAllocProfiler *prof)
+{
+    double u;
+
+    /* xorshift32 */
+    prof->random_state ^= prof->random_state << 13;
+    prof->random_state ^= prof->random_state >> 17;
+    prof->random_state ^= prof->random_state << 5;
+    u = (prof->random_state + 1.0) / 4294967296.0; /* in (0, 1] */
+    return (int64_t)(-log(u) * prof->interval) + 1;
+}
+
+static void js_alloc_profile_sample(JSRuntime *rt, void *ptr, size_t size)
+{
+    JSAllocProfiler *prof = rt->alloc_profiler;
+    JSAllocSample *s;
+    JSStackFrame *sf;
+    JSObject *p;
+
+    if (prof->recording)
+        return;
+    prof->bytes_until_sample -= size;
+    if (likely(prof->bytes_until_sample > 0))
+        return;
+    prof->bytes_until_sample = js_alloc_profile_next(prof);
+    if (prof->pending_count >= JS_ALLOC_PROFILE_MAX_PENDING)
+        return; /* the sample is lost */
+    s = &prof->pending[prof->pending_count++];
+    s->ptr = ptr;
+    s->size = size;
+    s->frame_count = 0;
+    for(sf = rt->current_stack_frame;
+        sf != NULL && s->frame_count < JS_PROFILE_MAX_DEPTH;
+        sf = sf->prev_frame) {
+        s->frames[s->frame_count].func = js_dup(sf->cur_func);
+        s->frames[s->frame_count].cur_pc = sf->cur_pc;
+        s->frame_count++;
+    }
+    /* make the running bytecode function check the interrupts */
+    for(sf = rt->current_stack_frame; sf != NULL; sf = sf->prev_frame) {
+        if (JS_VALUE_GET_TAG(sf->cur_func) == JS_TAG_OBJECT) {
+            p = JS_VALUE_GET_OBJ(sf->cur_func);
+            if (js_class_has_bytecode(p->class_id)) {
+                p->u.func.function_bytecode->realm->interrupt_counter = 1;
+                break;
+            }
+        }
+    }
+}
+
+static inline uint32_t js_alloc_profile_hash(JSAllocProfiler *prof,
+                                             const void *ptr)
+{
+    return ((uint32_t)((uintptr_t)ptr >> 3) * 2654435761u) >>
+        (32 - prof->live_bits);
+}
+
+/* drop the sample of 'ptr' if it is sampled */
+static void js_alloc_profile_forget(JSRuntime *rt, void *ptr)
+{
+    JSAllocProfiler *prof = rt->alloc_profiler;
+    JSAllocLive *e;
+    uint32_t i, j, h, mask;
+    int k;
+
+    for(k = 0; k < prof->pending_count; k++) {
+        if (prof->pending[k].ptr == ptr) {
+            prof->pending[k].ptr = NULL;
+            return;
+        }
+    }
+    if (prof->live_count == 0)
+        return;
+    mask = ((uint32_t)1 << prof->live_bits) - 1;
+    for(i = js_alloc_profile_hash(prof, ptr);; i = (i + 1) & mask) {
+        e = &prof->live[i];
+        if (e->ptr == NULL)
+            return;
+        if (e->ptr == ptr)
+            break;
+    }
+    e->node->values[JS_ALLOC_PROFILE_INUSE_OBJECTS] -= e->count;
+    e->node->values[JS_ALLOC_PROFILE_INUSE_SPACE] -= e->size;
+    prof->live_count--;
+    /* move back the following entries of the cluster which can no
+       longer be reached */
+    for(j = (i + 1) & mask; prof->live[j].ptr != NULL; j = (j + 1) & mask) {
+        h = js_alloc_profile_hash(prof, prof->live[j].ptr);
+        if (((j - h) & mask) >= ((j - i) & mask)) {
+            prof->live[i] = prof->live[j];
+            i = j;
+        }
+    }
+    prof->live[i].ptr = NULL;
+}
+
+static void js_alloc_profile_insert(JSAllocProfiler *prof, JSAllocLive *e1)
+{
+    uint32_t i, mask;
+
+    mask = ((uint32_t)1 << prof->live_bits) - 1;
+    for(i = js_alloc_profile_hash(prof, e1->ptr); prof->live[i].ptr != NULL;
+        i = (i + 1) & mask)
+        continue;
+    prof->live[i] = *e1;
+}
+
+static int js_alloc_profile_add_live(JSRuntime *rt, JSAllocLive *e1)
+{
+    JSAllocProfiler *prof = rt->alloc_profiler;
+    JSAllocLive *old_live;
+    uint32_t i, old_size;
+
+    if (2 * (prof->live_count + 1) > ((uint32_t)1 << prof->live_bits)) {
+        old_live = prof->live;
+        old_size = (uint32_t)1 << prof->live_bits;
+        if (!old_live)
+            old_size = 0;
+        prof->live = js_mallocz_rt(rt, sizeof(prof->live[0]) * 2 *
+                                   max_int(old_size, 128));
+        if (!prof->live) {
+            prof->live = old_live;
+            return -1;
+        }
+        prof->live_bits = old_live ? prof->live_bits + 1 : 8;
+        for(i = 0; i < old_size; i++) {
+            if (old_live[i].ptr)
+                js_alloc_profile_insert(prof, &old_live[i]);
+        }
+        js_free_rt(rt, old_live);
+    }
+    js_alloc_profile_insert(prof, e1);
+    prof->live_count++;
+    return 0;
+}
+
+/* add the pending samples to the tree */
+static void js_alloc_profile_record(JSRuntime *rt)
+{
+    JSAllocProfiler *prof = rt->alloc_profiler;
+    JSAllocSample *s;
+    JSProfileNode key, *n;
+    JSAllocLive e;
+    double scale;
+    int i;
+
+    prof->recording = true;
+    for(s = prof->pending; s < prof->pending + prof->pending_count; s++) {
+        n = &prof->root;
+        for(i = s->frame_count - 1; i >= 0 && n != NULL; i--)
+            n = js_profile_add_frame(rt, n, s->frames[i].func, s->frames[i].cur_pc);
+        if (n == &prof->root) {
+            /* allocation outside of any function, e.g. by the compiler */
+            memset(&key, 0, sizeof(key));
+            n = js_profile_get_child(rt, n, &key);
+        }
+        if (n != NULL) {
+            /* an allocation of 'size' bytes is sampled with the
+               probability 1 - exp(-size / interval), so a sample
+               stands for 1 / probability allocations */
+            scale = 1.0 / (1.0 - exp(-(double)s->size / prof->interval));
+            e.ptr = s->ptr;
+            e.node = n;
+            e.count = (int64_t)(scale + 0.5);
+            e.size = (int64_t)(scale * s->size + 0.5);
+            n->values[JS_ALLOC_PROFILE_ALLOC_OBJECTS] += e.count;
+            n->values[JS_ALLOC_PROFILE_ALLOC_SPACE] += e.size;
+            if (s->ptr && !js_alloc_profile_add_live(rt, &e)) {
+                n->values[JS_ALLOC_PROFILE_INUSE_OBJECTS] += e.count;
+                n->values[JS_ALLOC_PROFILE_INUSE_SPACE] += e.size;
+            }
+        }
+        /* otherwise the sample is lost */
+        s->ptr = NULL;
+        for(i = 0; i < s->frame_count; i++)
+            JS_FreeValueRT(rt, s->frames[i].func);
+        s->frame_count = 0;
+    }
+    prof->pending_count = 0;
+    prof->recording = false;
+}
+
+int JS_StartAllocProfiling(JSRuntime *rt, size_t interval)
+{
+    JSAllocProfiler *prof;
+
+    if (rt->alloc_profiler)
+        return -1;
+    prof = js_mallocz_rt(rt, sizeof(*prof));
+    if (!prof)
+        return -1;
+    if (interval == 0)
+        interval = 512 * 1024;
+    prof->interval = interval;
+    prof->random_state = 1;
+    prof->bytes_until_sample = js_alloc_profile_next(prof);
+    prof->start_time = js__hrtime_ns();
+    rt->alloc_profiler = prof;
+    return 0;
+}
+
+int JS_StopAllocProfiling(JSRuntime *rt, FILE *fp, JSProfileFormatEnum format)
+{
+    JSAllocProfiler *prof = rt->alloc_profiler;
+    DynBuf out;
+    int ret;
+
+    if (!prof)
+        return -1;
+    js_alloc_profile_record(rt);
+    ret = 0;
+    if (fp) {
+        prof->recording = true;
+        dbuf_init2(&out, rt, js_dbuf_realloc_rt);
+        if (format == JS_PROFILE_PPROF) {
+            static const char * const types[] = {
+                "alloc_objects", "count", "alloc_space", "bytes",
+                "inuse_objects", "count", "inuse_space", "bytes",
+                "space", "bytes",
+            };
+            ret = js_profile_write_pprof(rt, &out, &prof->root, types,
+                                         JS_ALLOC_PROFILE_VALUE_COUNT,
+                                         prof->interval,
+                                         js__hrtime_ns() - prof->start_time);
+        } else {
+            ret = js_profile_write_collapsed(rt, &out, &prof->root,
+                                             JS_ALLOC_PROFILE_ALLOC_SPACE);
+        }
+        if (dbuf_error(&out) ||
+            fwrite(out.buf, 1, out.size, fp) != out.size)
+            ret = -1;
+        dbuf_free(&out);
+    }
+    js_alloc_profile_free(rt);
+    return ret;
+}
+
 static void JS_ThrowInterrupted(JSContext *ctx)
 {
     JS_ThrowInternalError(ctx, "interrupted");
     JS_SetUncatchableError(ctx, ctx->rt->current_exception);
 }
 
-static no_inline __exception int __js_poll_interrupts(JSContext *ctx)
+/* 'callee' is the function about to be called or JS_UNDEFINED */
+static no_inline __exception int __js_poll_interrupts(JSContext *ctx,
+                                                      JSValueConst callee)
 {
     JSRuntime *rt = ctx->rt;
     ctx->interrupt_counter = JS_INTERRUPT_COUNTER_INIT;
+    if (rt->profiler)
+        js_profile_poll(ctx, callee);
+    if (rt->alloc_profiler && rt->alloc_profiler->pending_count != 0)
+        js_alloc_profile_record(rt);
     if (rt->interrupt_handler) {
         if (rt->interrupt_handler(rt, rt->interrupt_opaque)) {
             JS_ThrowInterrupted(ctx);
@@ -8407,7 +11298,23 @@ static no_inline __exception int __js_poll_interrupts(JSContext *ctx)
 static inline __exception int js_poll_interrupts(JSContext *ctx)
 {
     if (unlikely(--ctx->interrupt_counter <= 0)) {
-        return __js_poll_interrupts(ctx);
+        return __js_poll_interrupts(ctx, JS_UNDEFINED);
+    } else {
+        return 0;
+    }
+}
+
+/* same as js_poll_interrupts() in the bytecode interpreter after a
+   jump: 'pc' is the next instruction. It is saved as the current
+   position for the backtraces and the profiler. */
+static inline __exception int js_poll_interrupts_pc(JSContext *ctx,
+                                                    JSStackFrame *sf,
+                                                    const uint8_t *pc)
+{
+    if (unlikely(--ctx->interrupt_counter <= 0)) {
+        /* 'cur_pc' points after the opcode */
+        sf->cur_pc = (uint8_t *)pc + 1;
+        return __js_poll_interrupts(ctx, JS_UNDEFINED);
     } else {
         return 0;
     }
@@ -8674,148 +11581,6 @@ int JS_IsInstanceOf(JSContext *ctx, JSValueConst val, JSValueConst obj)
     return JS_OrdinaryIsInstanceOf(ctx, val, obj);
 }
 
-#include "builtin-array-fromasync.h"
-#include "builtin-iterator-zip-keyed.h"
-#include "builtin-iterator-zip.h"
-
-// like Function.prototype.call but monkey patch-proof
-static JSValue js_call_function(JSContext *ctx, JSValueConst this_val,
-                                int argc, JSValueConst *argv)
-{
-    return JS_Call(ctx, argv[1], argv[0], argc-2, argv+2);
-}
-
-// returns enumerable and non-enumerable strings *and* symbols
-static JSValue js_getOwnPropertyKeys(JSContext *ctx, JSValueConst this_val,
-                                     int argc, JSValueConst *argv)
-{
-    int flags = JS_GPN_STRING_MASK|JS_GPN_SYMBOL_MASK;
-    return JS_GetOwnPropertyNames2(ctx, argv[0], flags, JS_ITERATOR_KIND_KEY);
-}
-
-static JSValue js_hasOwnEnumProperty(JSContext *ctx, JSValueConst this_val,
-                                     int argc, JSValueConst *argv)
-{
-    JSPropertyDescriptor d;
-    JSObject *p;
-    JSAtom key;
-    int flags, res;
-
-    if (JS_TAG_OBJECT != JS_VALUE_GET_TAG(argv[0]))
-        return JS_ThrowTypeErrorNotAnObject(ctx);
-    p = JS_VALUE_GET_OBJ(argv[0]);
-    key = JS_ValueToAtomInternal(ctx, argv[1], JS_TO_STRING_NO_SIDE_EFFECTS);
-    if (key == JS_ATOM_NULL)
-        return JS_EXCEPTION;
-    res = JS_GetOwnPropertyInternal(ctx, &d, p, key);
-    JS_FreeAtom(ctx, key);
-    if (res < 0)
-        return JS_EXCEPTION;
-    flags = 0;
-    if (res > 0) {
-        flags = d.flags;
-        js_free_desc(ctx, &d);
-    }
-    if (flags & JS_PROP_ENUMERABLE)
-        return JS_TRUE;
-    return JS_FALSE;
-}
-
-// note: takes ownership of |argv|
-static JSValue js_bytecode_eval(JSContext *ctx, const uint8_t *bytecode,
-                                size_t len, int argc, JSValue *argv)
-{
-    JSValue obj, fun, result;
-    int i;
-
-    obj = JS_ReadObject(ctx, bytecode, len, JS_READ_OBJ_BYTECODE);
-    if (JS_IsException(obj))
-        return JS_EXCEPTION;
-    fun = JS_EvalFunction(ctx, obj);
-    if (JS_IsException(fun))
-        return JS_EXCEPTION;
-    assert(JS_IsFunction(ctx, fun));
-    result = JS_Call(ctx, fun, JS_UNDEFINED, argc, vc(argv));
-    for (i = 0; i < argc; i++)
-        JS_FreeValue(ctx, argv[i]);
-    JS_FreeValue(ctx, fun);
-    if (JS_SetPrototypeInternal(ctx, result, ctx->function_proto,
-                                /*throw_flag*/true) < 0) {
-        JS_FreeValue(ctx, result);
-        return JS_EXCEPTION;
-    }
-    return result;
-}
-
-static JSValue js_bytecode_autoinit(JSContext *ctx, JSObject *p, JSAtom atom,
-                                    void *opaque)
-{
-    switch ((uintptr_t)opaque) {
-    default:
-        abort();
-    case JS_BUILTIN_ARRAY_FROMASYNC:
-        {
-            JSValue argv[] = {
-                JS_NewCFunction(ctx, js_array_constructor, "Array", 0),
-                JS_NewCFunctionMagic(ctx, js_error_constructor, "TypeError",
-                                     1, JS_CFUNC_constructor_or_func_magic,
-                                     JS_TYPE_ERROR),
-                JS_AtomToValue(ctx, JS_ATOM_Symbol_asyncIterator),
-                JS_NewCFunctionMagic(ctx, js_object_defineProperty,
-                                     "Object.defineProperty", 3,
-                                     JS_CFUNC_generic_magic, 0),
-                JS_AtomToValue(ctx, JS_ATOM_Symbol_iterator),
-            };
-            return js_bytecode_eval(ctx, qjsc_builtin_array_fromasync,
-                                    sizeof(qjsc_builtin_array_fromasync),
-                                    countof(argv), argv);
-        }
-    case JS_BUILTIN_ITERATOR_ZIP:
-        {
-            JSValue argv[] = {
-                js_dup(ctx->class_proto[JS_CLASS_ITERATOR_HELPER]),
-                JS_NewCFunctionMagic(ctx, js_error_constructor, "InternalError",
-                                     1, JS_CFUNC_constructor_or_func_magic,
-                                     JS_INTERNAL_ERROR),
-                JS_NewCFunctionMagic(ctx, js_error_constructor, "TypeError",
-                                     1, JS_CFUNC_constructor_or_func_magic,
-                                     JS_TYPE_ERROR),
-                JS_NewCFunction(ctx, js_call_function, "call", 2),
-                JS_AtomToValue(ctx, JS_ATOM_Symbol_iterator),
-            };
-            JSValue result = js_bytecode_eval(ctx, qjsc_builtin_iterator_zip,
-                                              sizeof(qjsc_builtin_iterator_zip),
-                                              countof(argv), argv);
-            JS_SetConstructorBit(ctx, result, false);
-            return result;
-        }
-    case JS_BUILTIN_ITERATOR_ZIP_KEYED:
-        {
-            JSValue argv[] = {
-                js_dup(ctx->class_proto[JS_CLASS_ITERATOR_HELPER]),
-                JS_NewCFunctionMagic(ctx, js_error_constructor, "InternalError",
-                                     1, JS_CFUNC_constructor_or_func_magic,
-                                     JS_INTERNAL_ERROR),
-                JS_NewCFunctionMagic(ctx, js_error_constructor, "TypeError",
-                                     1, JS_CFUNC_constructor_or_func_magic,
-                                     JS_TYPE_ERROR),
-                JS_NewCFunction(ctx, js_call_function, "call", 2),
-                JS_NewCFunction(ctx, js_hasOwnEnumProperty,
-                                "hasOwnEnumProperty", 2),
-                JS_NewCFunction(ctx, js_getOwnPropertyKeys,
-                                "getOwnPropertyKeys", 1),
-                JS_AtomToValue(ctx, JS_ATOM_Symbol_iterator),
-            };
-            JSValue result = js_bytecode_eval(ctx, qjsc_builtin_iterator_zip_keyed,
-                                              sizeof(qjsc_builtin_iterator_zip_keyed),
-                                              countof(argv), argv);
-            JS_SetConstructorBit(ctx, result, false);
-            return result;
-        }
-    }
-    return JS_UNDEFINED;
-}
-
 /* return the value associated to the autoinit property or an exception */
 typedef JSValue JSAutoInitFunc(JSContext *ctx, JSObject *p, JSAtom atom, void *opaque);
 
@@ -8823,7 +11588,6 @@ static JSAutoInitFunc *const js_autoinit_func_table[] = {
     js_instantiate_prototype, /* JS_AUTOINIT_ID_PROTOTYPE */
     js_module_ns_autoinit, /* JS_AUTOINIT_ID_MODULE_NS */
     JS_InstantiateFunctionListItem2, /* JS_AUTOINIT_ID_PROP */
-    js_bytecode_autoinit, /* JS_AUTOINIT_ID_BYTECODE */
 };
 
 /* warning: 'prs' is reallocated after it */
@@ -9435,6 +12199,78 @@ static int __exception JS_GetOwnPropertyNamesInternal(JSContext *ctx,
     return 0;
 }
 
+static int enum_cache_cmp(const void *p1, const void *p2, void *opaque)
+{
+    JSContext *ctx = opaque;
+    JSAtom atom1 = ((const JSShapeEnumEntry *)p1)->atom;
+    JSAtom atom2 = ((const JSShapeEnumEntry *)p2)->atom;
+    uint32_t v1, v2;
+
+    JS_AtomIsArrayIndex(ctx, &v1, atom1);
+    JS_AtomIsArrayIndex(ctx, &v2, atom2);
+    return (v1 > v2) - (v1 < v2);
+}
+
+/* Return the enumerable string keys of 'p' if they only depend on its
+   shape, i.e. if it is an ordinary object whose shape is in the
+   transition tree. The result is cached in the shape. Return NULL
+   otherwise or in case of memory error (no exception is raised). */
+static JSShapeEnumCache *js_get_enum_cache(JSContext *ctx, JSObject *p)
+{
+    JSShape *sh;
+    JSShapeProperty *prs;
+    JSShapeEnumCache *ec;
+    uint32_t i, num_keys_count, count, num_index, str_index, num_key;
+
+    /* exotic objects may share the shape of ordinary objects */
+    if (p->is_exotic || p->fast_array)
+        return NULL;
+    sh = p->shape;
+    if (likely(sh->enum_cache))
+        return sh->enum_cache;
+    if (!sh->is_hashed)
+        return NULL;
+    num_keys_count = 0;
+    count = 0;
+    for(i = 0, prs = sh->prop; i < sh->prop_count; i++, prs++) {
+        if (!(prs->flags & JS_PROP_ENUMERABLE) ||
+            JS_AtomGetKind(ctx, prs->atom) != JS_ATOM_KIND_STRING)
+            continue;
+        /* module name spaces may raise an exception */
+        if ((prs->flags & JS_PROP_TMASK) == JS_PROP_VARREF)
+            return NULL;
+        if (JS_AtomIsArrayIndex(ctx, &num_key, prs->atom))
+            num_keys_count++;
+        count++;
+    }
+    ec = js_malloc_rt(ctx->rt, sizeof(*ec) + sizeof(ec->tab[0]) * count);
+    if (!ec)
+        return NULL;
+    ec->count = count;
+    num_index = 0;
+    str_index = num_keys_count;
+    for(i = 0, prs = sh->prop; i < sh->prop_count; i++, prs++) {
+        if (!(prs->flags & JS_PROP_ENUMERABLE) ||
+            JS_AtomGetKind(ctx, prs->atom) != JS_ATOM_KIND_STRING)
+            continue;
+        if (JS_AtomIsArrayIndex(ctx, &num_key, prs->atom)) {
+            ec->tab[num_index].atom = prs->atom;
+            ec->tab[num_index].prop_idx = i;
+            num_index++;
+        } else {
+            ec->tab[str_index].atom = prs->atom;
+            ec->tab[str_index].prop_idx = i;
+            str_index++;
+        }
+    }
+    if (num_keys_count > 1) {
+        rqsort(ec->tab, num_keys_count, sizeof(ec->tab[0]), enum_cache_cmp,
+               ctx);
+    }
+    sh->enum_cache = ec;
+    return ec;
+}
+
 int JS_GetOwnPropertyNames(JSContext *ctx, JSPropertyEnum **ptab,
                            uint32_t *plen, JSValueConst obj, int flags)
 {
@@ -9857,33 +12693,30 @@ static JSProperty *add_property(JSContext *ctx,
     }
     sh = p->shape;
     if (sh->is_hashed) {
-        /* try to find an existing shape */
-        new_sh = find_hashed_shape_prop(ctx->rt, sh, prop, prop_flags);
-        if (new_sh) {
-            /* matching shape found: use it */
+        if (likely(sh->prop_count < JS_SHAPE_MAX_TRANSITION_PROPS)) {
+            /* follow (or create) the transition */
+            new_sh = js_shape_transition(ctx, sh, prop, prop_flags);
+            if (!new_sh)
+                return NULL;
             /*  the property array may need to be resized */
             if (new_sh->prop_size != sh->prop_size) {
                 JSProperty *new_prop;
                 new_prop = js_realloc(ctx, p->prop, sizeof(p->prop[0]) *
                                       new_sh->prop_size);
-                if (!new_prop)
+                if (!new_prop) {
+                    js_free_shape(ctx->rt, new_sh);
                     return NULL;
+                }
                 p->prop = new_prop;
             }
-            p->shape = js_dup_shape(new_sh);
+            p->shape = new_sh;
             js_free_shape(ctx->rt, sh);
             return &p->prop[new_sh->prop_count - 1];
-        } else if (sh->header.ref_count != 1) {
-            /* if the shape is shared, clone it */
-            new_sh = js_clone_shape(ctx, sh);
-            if (!new_sh)
-                return NULL;
-            /* hash the cloned shape */
-            new_sh->is_hashed = true;
-            js_shape_hash_link(ctx->rt, new_sh);
-            js_free_shape(ctx->rt, p->shape);
-            p->shape = new_sh;
         }
+        /* the object has too many properties: switch to dictionary
+           mode */
+        if (js_shape_prepare_update(ctx, p, NULL))
+            return NULL;
     }
     assert(p->shape->header.ref_count == 1);
     if (add_shape_property(ctx, &p->shape, p, prop, prop_flags))
@@ -10835,7 +13668,7 @@ static int js_shape_prepare_update(JSContext *ctx, JSObject *p,
         if (sh->header.ref_count != 1) {
             if (pprs)
                 idx = *pprs - sh->prop;
-            /* clone the shape (the resulting one is no longer hashed) */
+            /* clone the shape (the resulting one is in dictionary mode) */
             sh = js_clone_shape(ctx, sh);
             if (!sh)
                 return -1;
@@ -10844,8 +13677,9 @@ static int js_shape_prepare_update(JSContext *ctx, JSObject *p,
             if (pprs)
                 *pprs = &sh->prop[idx];
         } else {
-            js_shape_hash_unlink(ctx->rt, sh);
-            sh->is_hashed = false;
+            /* only used by this object, hence without transitions:
+               convert it in place */
+            js_shape_unlink(ctx->rt, sh);
         }
     }
     return 0;
@@ -11379,6 +14213,11 @@ static int JS_DefineGlobalVar(JSContext *ctx, JSAtom prop, int def_flags)
     if (unlikely(!pr))
         return -1;
     pr->u.value = val;
+    if (def_flags & DEFINE_GLOBAL_LEX_VAR) {
+        /* invalidate the global variable caches */
+        if (++ctx->global_var_gen == 0)
+            ctx->global_var_gen = 1;
+    }
     return 0;
 }
 
@@ -11405,27 +14244,88 @@ static int JS_DefineGlobalFunction(JSContext *ctx, JSAtom prop,
     return 0;
 }
 
-static JSValue JS_GetGlobalVar(JSContext *ctx, JSAtom prop,
-                               bool throw_ref_error)
+/* return the global variable cache entry 'idx' of 'b' or NULL */
+static inline JSGlobalVarCache *get_global_var_cache(JSContext *ctx,
+                                                     JSFunctionBytecode *b,
+                                                     int idx)
+{
+    if (unlikely(idx >= b->global_var_cache_count))
+        return NULL;
+    if (unlikely(!b->global_var_cache)) {
+        /* no exception: the accesses are just not cached if it fails */
+        b->global_var_cache = js_mallocz_rt(ctx->rt, sizeof(b->global_var_cache[0]) *
+                                            b->global_var_cache_count);
+        if (!b->global_var_cache)
+            return NULL;
+    }
+    return &b->global_var_cache[idx];
+}
+
+/* Find the own property 'prop' of global_var_obj or else of
+   global_obj. '*pis_lexical' is set to true if it is in global_var_obj.
+   'gc' is the global variable cache entry of the access or NULL. */
+static inline JSShapeProperty *find_global_var_prop(JSContext *ctx,
+                                                    JSProperty **ppr,
+                                                    JSAtom prop,
+                                                    JSGlobalVarCache *gc,
+                                                    bool *pis_lexical)
 {
     JSObject *p;
+    JSShape *sh;
     JSShapeProperty *prs;
-    JSProperty *pr;
+
+    if (gc && gc->gen == ctx->global_var_gen) {
+        if (gc->is_lexical)
+            p = JS_VALUE_GET_OBJ(ctx->global_var_obj);
+        else
+            p = JS_VALUE_GET_OBJ(ctx->global_obj);
+        sh = p->shape;
+        /* the property may have been deleted or moved */
+        if (likely(gc->prop_idx < sh->prop_count)) {
+            prs = &sh->prop[gc->prop_idx];
+            if (likely(prs->atom == prop)) {
+                *ppr = &p->prop[gc->prop_idx];
+                *pis_lexical = gc->is_lexical;
+                return prs;
+            }
+        }
+    }
 
     /* no exotic behavior is possible in global_var_obj */
     p = JS_VALUE_GET_OBJ(ctx->global_var_obj);
-    prs = find_own_property(&pr, p, prop);
-    if (prs) {
-        /* XXX: should handle JS_PROP_TMASK properties */
-        if (unlikely(JS_IsUninitialized(pr->u.value)))
-            return JS_ThrowReferenceErrorUninitialized(ctx, prs->atom);
-        return js_dup(pr->u.value);
+    prs = find_own_property(ppr, p, prop);
+    *pis_lexical = true;
+    if (!prs) {
+        p = JS_VALUE_GET_OBJ(ctx->global_obj);
+        prs = find_own_property(ppr, p, prop);
+        *pis_lexical = false;
+        if (!prs)
+            return NULL;
+    }
+    if (gc) {
+        gc->prop_idx = prs - p->shape->prop;
+        gc->is_lexical = *pis_lexical;
+        gc->gen = ctx->global_var_gen;
     }
+    return prs;
+}
 
-    /* fast path */
-    p = JS_VALUE_GET_OBJ(ctx->global_obj);
-    prs = find_own_property(&pr, p, prop);
+static JSValue JS_GetGlobalVar(JSContext *ctx, JSAtom prop,
+                               bool throw_ref_error, JSGlobalVarCache *gc)
+{
+    JSShapeProperty *prs;
+    JSProperty *pr;
+    bool is_lexical;
+
+    prs = find_global_var_prop(ctx, &pr, prop, gc, &is_lexical);
     if (prs) {
+        if (is_lexical) {
+            /* XXX: should handle JS_PROP_TMASK properties */
+            if (unlikely(JS_IsUninitialized(pr->u.value)))
+                return JS_ThrowReferenceErrorUninitialized(ctx, prs->atom);
+            return js_dup(pr->u.value);
+        }
+        /* fast path */
         if (likely((prs->flags & JS_PROP_TMASK) == 0))
             return js_dup(pr->u.value);
     }
@@ -11474,17 +14374,15 @@ static int JS_GetGlobalVarRef(JSContext *ctx, JSAtom prop, JSValue *sp)
    flag = 1: initialize lexical variable
 */
 static inline int JS_SetGlobalVar(JSContext *ctx, JSAtom prop, JSValue val,
-                                  int flag)
+                                  int flag, JSGlobalVarCache *gc)
 {
-    JSObject *p;
     JSShapeProperty *prs;
     JSProperty *pr;
+    bool is_lexical;
     int ret;
 
-    /* no exotic behavior is possible in global_var_obj */
-    p = JS_VALUE_GET_OBJ(ctx->global_var_obj);
-    prs = find_own_property(&pr, p, prop);
-    if (prs) {
+    prs = find_global_var_prop(ctx, &pr, prop, gc, &is_lexical);
+    if (prs && is_lexical) {
         /* XXX: should handle JS_PROP_AUTOINIT properties? */
         if (flag != 1) {
             if (unlikely(JS_IsUninitialized(pr->u.value))) {
@@ -11501,8 +14399,6 @@ static inline int JS_SetGlobalVar(JSContext *ctx, JSAtom prop, JSValue val,
         return 0;
     }
 
-    p = JS_VALUE_GET_OBJ(ctx->global_obj);
-    prs = find_own_property(&pr, p, prop);
     if (prs) {
         if (likely((prs->flags & (JS_PROP_TMASK | JS_PROP_WRITABLE |
                                   JS_PROP_LENGTH)) == JS_PROP_WRITABLE)) {
@@ -16361,6 +19257,19 @@ static JSValue js_build_mapped_arguments(JSContext *ctx, int argc,
     return JS_EXCEPTION;
 }
 
+/* build the arguments object of a function whose 'arguments' variable
+   is not initialized on entry (see optimize_arguments()) */
+static JSValue js_build_lazy_arguments(JSContext *ctx, JSStackFrame *sf,
+                                       JSFunctionBytecode *b,
+                                       int argc, JSValueConst *argv)
+{
+    if (b->is_strict_mode || !b->has_simple_parameter_list)
+        return js_build_arguments(ctx, argc, argv);
+    else
+        return js_build_mapped_arguments(ctx, argc, argv, sf,
+                                         min_int(argc, b->arg_count));
+}
+
 static JSValue build_for_in_iterator(JSContext *ctx, JSValue obj)
 {
     JSObject *p;
@@ -16368,6 +19277,7 @@ static JSValue build_for_in_iterator(JSContext *ctx, JSValue obj)
     int i;
     JSValue enum_obj, obj1;
     JSForInIterator *it;
+    JSShapeEnumCache *ec;
     uint32_t tag, tab_atom_count;
 
     tag = JS_VALUE_GET_TAG(obj);
@@ -16389,6 +19299,7 @@ static JSValue build_for_in_iterator(JSContext *ctx, JSValue obj)
     it->is_array = false;
     it->obj = obj;
     it->idx = 0;
+    it->shape = NULL;
     p = JS_VALUE_GET_OBJ(enum_obj);
     p->u.for_in_iterator = it;
 
@@ -16403,13 +19314,18 @@ static JSValue build_for_in_iterator(JSContext *ctx, JSValue obj)
             break;
         if (JS_IsException(obj1))
             goto fail;
-        if (JS_GetOwnPropertyNamesInternal(ctx, &tab_atom, &tab_atom_count,
-                                           JS_VALUE_GET_OBJ(obj1),
-                                           JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY)) {
-            JS_FreeValue(ctx, obj1);
-            goto fail;
+        ec = js_get_enum_cache(ctx, JS_VALUE_GET_OBJ(obj1));
+        if (ec) {
+            tab_atom_count = ec->count;
+        } else {
+            if (JS_GetOwnPropertyNamesInternal(ctx, &tab_atom, &tab_atom_count,
+                                               JS_VALUE_GET_OBJ(obj1),
+                                               JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY)) {
+                JS_FreeValue(ctx, obj1);
+                goto fail;
+            }
+            js_free_prop_enum(ctx, tab_atom, tab_atom_count);
         }
-        js_free_prop_enum(ctx, tab_atom, tab_atom_count);
         if (tab_atom_count != 0) {
             JS_FreeValue(ctx, obj1);
             goto slow_path;
@@ -16423,7 +19339,11 @@ static JSValue build_for_in_iterator(JSContext *ctx, JSValue obj)
 
     p = JS_VALUE_GET_OBJ(obj);
 
-    if (p->fast_array) {
+    ec = js_get_enum_cache(ctx, p);
+    if (ec) {
+        /* the keys only depend on the shape */
+        it->shape = js_dup_shape(p->shape);
+    } else if (p->fast_array) {
         JSShape *sh;
         JSShapeProperty *prs;
         /* check that there are no enumerable normal fields */
@@ -16515,6 +19435,16 @@ static __exception int js_for_in_next(JSContext *ctx, JSValue *sp)
                 goto done;
             prop = __JS_AtomFromUInt32(it->idx);
             it->idx++;
+        } else if (it->shape) {
+            JSShapeEnumCache *ec = it->shape->enum_cache;
+            if (it->idx >= ec->count)
+                goto done;
+            prop = ec->tab[it->idx].atom;
+            it->idx++;
+            /* the property cannot have been deleted if the object
+               still has the same shape */
+            if (JS_VALUE_GET_OBJ(it->obj)->shape == it->shape)
+                break;
         } else {
             JSShape *sh = p->shape;
             JSShapeProperty *prs;
@@ -16715,12 +19645,380 @@ static int JS_IteratorClose(JSContext *ctx, JSValueConst enum_obj,
     return res;
 }
 
-/* obj -> enum_rec (3 slots) */
+static JSValue js_create_array_iterator(JSContext *ctx, JSValueConst this_val,
+                                        int argc, JSValueConst *argv, int magic);
+static JSValue js_array_iterator_next(JSContext *ctx, JSValueConst this_val,
+                                      int argc, JSValueConst *argv,
+                                      int *pdone, int magic);
+static JSValue js_create_typed_array_iterator(JSContext *ctx, JSValueConst this_val,
+                                              int argc, JSValueConst *argv, int magic);
+static JSValue js_create_map_iterator(JSContext *ctx, JSValueConst this_val,
+                                      int argc, JSValueConst *argv, int magic);
+static JSValue js_map_iterator_next(JSContext *ctx, JSValueConst this_val,
+                                    int argc, JSValueConst *argv,
+                                    int *pdone, int magic);
+static JSValue js_string_iterator_next(JSContext *ctx, JSValueConst this_val,
+                                       int argc, JSValueConst *argv,
+                                       int *pdone, int magic);
+static void map_cursor_init(JSMapState *s, JSMapCursor *c);
+static void map_cursor_free(JSMapCursor *c);
+static JSMapRecord *map_cursor_next(JSMapState *s, JSMapCursor *c);
+
+typedef struct JSDirectEnumDef {
+    uint16_t iterator_class_id;
+    int16_t iterator_magic;
+    int16_t next_magic;
+    JSCFunctionType iterator_func; /* [Symbol.iterator] method */
+    JSCFunctionType next_func; /* 'next' method of the iterators */
+} JSDirectEnumDef;
+
+static const JSDirectEnumDef js_direct_enum_defs[JS_DIRECT_ENUM_COUNT] = {
+    [JS_DIRECT_ENUM_ARRAY] = {
+        JS_CLASS_ARRAY_ITERATOR, JS_ITERATOR_KIND_VALUE, 0,
+        { .generic_magic = js_create_array_iterator },
+        { .iterator_next = js_array_iterator_next },
+    },
+    [JS_DIRECT_ENUM_TYPED_ARRAY] = {
+        JS_CLASS_ARRAY_ITERATOR, JS_ITERATOR_KIND_VALUE, 0,
+        { .generic_magic = js_create_typed_array_iterator },
+        { .iterator_next = js_array_iterator_next },
+    },
+    [JS_DIRECT_ENUM_MAP] = {
+        JS_CLASS_MAP_ITERATOR, JS_ITERATOR_KIND_KEY_AND_VALUE << 2, 0,
+        { .generic_magic = js_create_map_iterator },
+        { .iterator_next = js_map_iterator_next },
+    },
+    [JS_DIRECT_ENUM_SET] = {
+        JS_CLASS_SET_ITERATOR, (JS_ITERATOR_KIND_KEY << 2) | MAGIC_SET, MAGIC_SET,
+        { .generic_magic = js_create_map_iterator },
+        { .iterator_next = js_map_iterator_next },
+    },
+    [JS_DIRECT_ENUM_STRING] = {
+        JS_CLASS_STRING_ITERATOR, JS_ITERATOR_KIND_VALUE | 4, 0,
+        { .generic_magic = js_create_array_iterator },
+        { .iterator_next = js_string_iterator_next },
+    },
+};
+
+/* Return true if the own property 'atom' of 'p' is a data property
+   whose value is the C function 'func' with magic 'magic' of the realm
+   'ctx'. '*pidx' caches the position of the property in the shape of
+   'p'. */
+static bool js_check_own_cfunction(JSContext *ctx, JSObject *p, JSAtom atom,
+                                   JSCFunctionType func, int magic,
+                                   uint32_t *pidx)
+{
+    JSShape *sh = p->shape;
+    JSShapeProperty *prs;
+    JSProperty *pr;
+    JSObject *f;
+    uint32_t idx;
+
+    idx = *pidx;
+    if (unlikely(idx >= sh->prop_count || sh->prop[idx].atom != atom)) {
+        prs = find_own_property(&pr, p, atom);
+        if (!prs)
+            return false;
+        idx = prs - sh->prop;
+        *pidx = idx;
+    }
+    pr = &p->prop[idx];
+    if ((sh->prop[idx].flags & JS_PROP_TMASK) != JS_PROP_NORMAL ||
+        JS_VALUE_GET_TAG(pr->u.value) != JS_TAG_OBJECT)
+        return false;
+    f = JS_VALUE_GET_OBJ(pr->u.value);
+    return f->class_id == JS_CLASS_C_FUNCTION &&
+        f->u.cfunc.c_function.generic == func.generic &&
+        f->u.cfunc.magic == magic &&
+        f->u.cfunc.realm == ctx;
+}
+
+/* Return the kind of direct enumeration of 'obj' or -1 if 'obj' must
+   be enumerated with the iterator protocol. A direct enumeration
+   reads the elements of an Array, TypedArray, Map, Set or String
+   without iterator object. It is only possible if it is not
+   observable: the [Symbol.iterator] method of 'obj' and the 'next'
+   method of its iterators have their initial value. */
+static int js_get_direct_enum(JSContext *ctx, JSValueConst obj)
+{
+    const JSDirectEnumDef *d;
+    JSObject *p, *proto;
+    int kind;
+
+    switch(JS_VALUE_GET_TAG(obj)) {
+    case JS_TAG_STRING:
+        kind = JS_DIRECT_ENUM_STRING;
+        proto = JS_VALUE_GET_OBJ(ctx->class_proto[JS_CLASS_STRING]);
+        break;
+    case JS_TAG_OBJECT:
+        p = JS_VALUE_GET_OBJ(obj);
+        switch(p->class_id) {
+        case JS_CLASS_ARRAY:
+            kind = JS_DIRECT_ENUM_ARRAY;
+            break;
+        case JS_CLASS_MAP:
+            kind = JS_DIRECT_ENUM_MAP;
+            break;
+        case JS_CLASS_SET:
+            kind = JS_DIRECT_ENUM_SET;
+            break;
+        default:
+            if (!is_typed_array(p->class_id) || typed_array_is_oob(p))
+                return -1;
+            kind = JS_DIRECT_ENUM_TYPED_ARRAY;
+            break;
+        }
+        proto = JS_VALUE_GET_OBJ(ctx->class_proto[p->class_id]);
+        if (p->shape != ctx->array_shape) {
+            if (p->shape->proto != proto ||
+                find_own_property1(p, JS_ATOM_Symbol_iterator))
+                return -1;
+        }
+        if (kind == JS_DIRECT_ENUM_TYPED_ARRAY) {
+            /* the method is inherited from %TypedArray%.prototype */
+            if (find_own_property1(proto, JS_ATOM_Symbol_iterator))
+                return -1;
+            proto = proto->shape->proto;
+            if (!proto)
+                return -1;
+        }
+        break;
+    default:
+        return -1;
+    }
+    d = &js_direct_enum_defs[kind];
+    if (!js_check_own_cfunction(ctx, proto, JS_ATOM_Symbol_iterator,
+                                d->iterator_func, d->iterator_magic,
+                                &ctx->direct_enum_iterator_idx[kind]))
+        return -1;
+    proto = JS_VALUE_GET_OBJ(ctx->class_proto[d->iterator_class_id]);
+    if (!js_check_own_cfunction(ctx, proto, JS_ATOM_next,
+                                d->next_func, d->next_magic,
+                                &ctx->direct_enum_next_idx[kind]))
+        return -1;
+    return kind;
+}
+
+/* A direct enumeration record holds the iterable instead of the
+   iterator object and the index of the next element instead of the
+   next method. Maps and Sets use their 'enum_cursor' instead of the
+   index so that it is updated when the records are compacted. */
+#define JS_DIRECT_ENUM_INDEX(idx) JS_MKVAL(JS_TAG_UNINITIALIZED, idx)
+
+static inline bool js_is_direct_enum(JSValueConst next)
+{
+    return JS_VALUE_GET_TAG(next) == JS_TAG_UNINITIALIZED;
+}
+
+static int js_direct_enum_kind(JSValueConst obj)
+{
+    JSObject *p;
+
+    if (JS_VALUE_GET_TAG(obj) == JS_TAG_STRING)
+        return JS_DIRECT_ENUM_STRING;
+    p = JS_VALUE_GET_OBJ(obj);
+    switch(p->class_id) {
+    case JS_CLASS_ARRAY:
+        return JS_DIRECT_ENUM_ARRAY;
+    case JS_CLASS_MAP:
+        return JS_DIRECT_ENUM_MAP;
+    case JS_CLASS_SET:
+        return JS_DIRECT_ENUM_SET;
+    default:
+        return JS_DIRECT_ENUM_TYPED_ARRAY;
+    }
+}
+
+/* iterable -> enum_rec (2 slots). Return false if the iterable must be
+   enumerated with the iterator protocol. */
+static bool js_direct_enum_start(JSContext *ctx, JSValue *enum_rec)
+{
+    JSMapState *s;
+    int kind;
+
+    kind = js_get_direct_enum(ctx, enum_rec[0]);
+    if (kind < 0)
+        return false;
+    if (kind == JS_DIRECT_ENUM_MAP || kind == JS_DIRECT_ENUM_SET) {
+        s = JS_VALUE_GET_OBJ(enum_rec[0])->u.map_state;
+        /* nested enumerations of the same Map use an iterator */
+        if (s->enum_cursor.link.next)
+            return false;
+        map_cursor_init(s, &s->enum_cursor);
+    }
+    enum_rec[1] = JS_DIRECT_ENUM_INDEX(0);
+    return true;
+}
+
+/* free the iterable of a direct enumeration record and replace it
+   with undefined */
+static void js_direct_enum_free(JSContext *ctx, JSValue *enum_rec)
+{
+    JSObject *p;
+
+    if (JS_VALUE_GET_TAG(enum_rec[0]) == JS_TAG_OBJECT) {
+        p = JS_VALUE_GET_OBJ(enum_rec[0]);
+        if (p->class_id == JS_CLASS_MAP || p->class_id == JS_CLASS_SET)
+            map_cursor_free(&p->u.map_state->enum_cursor);
+    }
+    JS_FreeValue(ctx, enum_rec[0]);
+    enum_rec[0] = JS_UNDEFINED;
+}
+
+/* unlink the Map and Set cursors of the direct enumerations of a
+   frame which is freed without completing them (suspended frame or
+   uncatchable error). The
+   enumeration records are followed by a zero catch offset, which only
+   appears in the operand stack. */
+static void js_direct_enum_free_frame(JSValue *buf, JSValue *sp_end)
+{
+    JSValue *sp;
+    JSObject *p;
+
+    for(sp = buf + 2; sp < sp_end; sp++) {
+        if (JS_VALUE_GET_TAG(*sp) == JS_TAG_CATCH_OFFSET &&
+            JS_VALUE_GET_INT(*sp) == 0 && js_is_direct_enum(sp[-1]) &&
+            JS_VALUE_GET_TAG(sp[-2]) == JS_TAG_OBJECT) {
+            /* class_id is reset if the object was already finalized */
+            p = JS_VALUE_GET_OBJ(sp[-2]);
+            if (p->class_id == JS_CLASS_MAP || p->class_id == JS_CLASS_SET)
+                map_cursor_free(&p->u.map_state->enum_cursor);
+        }
+    }
+}
+
+/* same as the 'next' method of the iterators for a direct enumeration
+   record */
+static JSValue js_direct_enum_next(JSContext *ctx, JSValue *enum_rec,
+                                   int *pdone)
+{
+    JSObject *p;
+    JSValue val;
+    uint32_t len, idx;
+
+    *pdone = false;
+    idx = JS_VALUE_GET_INT(enum_rec[1]);
+    if (JS_VALUE_GET_TAG(enum_rec[0]) == JS_TAG_STRING) {
+        JSString *str = JS_VALUE_GET_STRING(enum_rec[0]);
+        uint32_t c, start;
+
+        if (idx >= str->len)
+            goto done;
+        start = idx;
+        c = string_getc(str, (int *)&idx);
+        enum_rec[1] = JS_DIRECT_ENUM_INDEX(idx);
+        if (c <= 0xffff)
+            return js_new_string_char(ctx, c);
+        else
+            return js_new_string16_len(ctx, str16(str) + start, 2);
+    }
+    p = JS_VALUE_GET_OBJ(enum_rec[0]);
+    switch(p->class_id) {
+    case JS_CLASS_ARRAY:
+        if (likely(JS_VALUE_GET_TAG(p->prop[0].u.value) == JS_TAG_INT)) {
+            len = JS_VALUE_GET_INT(p->prop[0].u.value);
+        } else {
+            if (js_get_length32(ctx, &len, enum_rec[0]))
+                return JS_EXCEPTION;
+        }
+        break;
+    case JS_CLASS_MAP:
+    case JS_CLASS_SET:
+        {
+            JSMapState *s = p->u.map_state;
+            JSMapRecord *mr;
+            JSValueConst args[2];
+
+            mr = map_cursor_next(s, &s->enum_cursor);
+            if (!mr)
+                goto done;
+            if (p->class_id == JS_CLASS_SET)
+                return js_dup(mr->key);
+            args[0] = mr->key;
+            args[1] = mr->value;
+            return js_create_array(ctx, 2, args);
+        }
+    default:
+        if (typed_array_is_oob(p))
+            return JS_ThrowTypeErrorArrayBufferOOB(ctx);
+        len = p->u.array.count;
+        break;
+    }
+    if (idx >= len)
+        goto done;
+    enum_rec[1] = JS_DIRECT_ENUM_INDEX(idx + 1);
+    if (likely(js_get_fast_array_element(ctx, p, idx, &val)))
+        return val;
+    return JS_GetPropertyUint32(ctx, enum_rec[0], idx);
+ done:
+    *pdone = true;
+    return JS_UNDEFINED;
+}
+
+/* close a direct enumeration record and replace its iterable with
+   undefined. The iterator object only needs to be built if a 'return'
+   method is visible from it. */
+static int js_direct_enum_close(JSContext *ctx, JSValue *enum_rec,
+                                bool is_exception_pending)
+{
+    const JSDirectEnumDef *d;
+    JSValue iter;
+    JSObject *p;
+    int kind, res;
+
+    kind = js_direct_enum_kind(enum_rec[0]);
+    d = &js_direct_enum_defs[kind];
+    p = JS_VALUE_GET_OBJ(ctx->class_proto[d->iterator_class_id]);
+    for(;;) {
+        if (p->is_exotic || find_own_property1(p, JS_ATOM_return))
+            break;
+        p = p->shape->proto;
+        if (!p) {
+            js_direct_enum_free(ctx, enum_rec);
+            return 0;
+        }
+    }
+    /* build the iterator at the current position */
+    if (kind == JS_DIRECT_ENUM_MAP || kind == JS_DIRECT_ENUM_SET) {
+        JSMapIteratorData *it;
+        JSMapState *s;
+
+        iter = js_create_map_iterator(ctx, enum_rec[0], 0, NULL,
+                                      d->iterator_magic);
+        if (JS_IsException(iter))
+            goto fail;
+        s = JS_VALUE_GET_OBJ(enum_rec[0])->u.map_state;
+        it = JS_GetOpaque(iter, d->iterator_class_id);
+        it->cursor.idx = s->enum_cursor.idx;
+    } else {
+        JSArrayIteratorData *it;
+
+        /* no validation of the typed arrays as the iteration started */
+        iter = js_create_array_iterator(ctx, enum_rec[0], 0, NULL,
+                                        d->iterator_magic);
+        if (JS_IsException(iter))
+            goto fail;
+        it = JS_GetOpaque(iter, d->iterator_class_id);
+        it->idx = JS_VALUE_GET_INT(enum_rec[1]);
+    }
+    js_direct_enum_free(ctx, enum_rec);
+    res = JS_IteratorClose(ctx, iter, is_exception_pending);
+    JS_FreeValue(ctx, iter);
+    return res;
+ fail:
+    js_direct_enum_free(ctx, enum_rec);
+    return -1;
+}
+
+/* obj -> enum_rec (3 slots). If 'can_enum_direct' is true, a direct
+   enumeration record may be returned. */
 static __exception int js_for_of_start(JSContext *ctx, JSValue *sp,
-                                       bool is_async)
+                                       bool is_async, bool can_enum_direct)
 {
     JSValue op1, obj, method;
     op1 = sp[-1];
+    if (can_enum_direct && js_direct_enum_start(ctx, sp - 1))
+        return 0;
     obj = JS_GetIterator(ctx, op1, is_async);
     if (JS_IsException(obj))
         return -1;
@@ -16743,14 +20041,21 @@ static __exception int js_for_of_next(JSContext *ctx, JSValue *sp, int offset)
     int done = 1;
 
     if (likely(!JS_IsUndefined(sp[offset]))) {
-        value = JS_IteratorNext(ctx, sp[offset], sp[offset + 1], 0, NULL, &done);
+        if (js_is_direct_enum(sp[offset + 1]))
+            value = js_direct_enum_next(ctx, sp + offset, &done);
+        else
+            value = JS_IteratorNext(ctx, sp[offset], sp[offset + 1], 0, NULL, &done);
         if (JS_IsException(value))
             done = -1;
         if (done) {
             /* value is JS_UNDEFINED or JS_EXCEPTION */
             /* replace the iteration object with undefined */
-            JS_FreeValue(ctx, sp[offset]);
-            sp[offset] = JS_UNDEFINED;
+            if (js_is_direct_enum(sp[offset + 1])) {
+                js_direct_enum_free(ctx, sp + offset);
+            } else {
+                JS_FreeValue(ctx, sp[offset]);
+                sp[offset] = JS_UNDEFINED;
+            }
             if (done < 0) {
                 return -1;
             } else {
@@ -16824,13 +20129,6 @@ static JSValue js_create_iterator_result(JSContext *ctx,
     return obj;
 }
 
-static JSValue js_array_iterator_next(JSContext *ctx, JSValueConst this_val,
-                                      int argc, JSValueConst *argv,
-                                      int *pdone, int magic);
-
-static JSValue js_create_array_iterator(JSContext *ctx, JSValueConst this_val,
-                                        int argc, JSValueConst *argv, int magic);
-
 static bool js_is_fast_array(JSContext *ctx, JSValue obj)
 {
     /* Try and handle fast arrays explicitly */
@@ -16861,10 +20159,11 @@ static bool js_get_fast_array(JSContext *ctx, JSValue obj,
 
 static __exception int js_append_enumerate(JSContext *ctx, JSValue *sp)
 {
-    JSValue iterator, enumobj, method, value;
-    int is_array_iterator;
+    JSValue enumobj, method, value, enum_rec[2];
     JSValue *arrp;
-    uint32_t i, count32, pos;
+    JSObject *p;
+    uint32_t i, count32, pos, len;
+    int done;
 
     if (JS_VALUE_GET_TAG(sp[-2]) != JS_TAG_INT) {
         JS_ThrowInternalError(ctx, "invalid index for append");
@@ -16873,21 +20172,60 @@ static __exception int js_append_enumerate(JSContext *ctx, JSValue *sp)
 
     pos = JS_VALUE_GET_INT(sp[-2]);
 
-    /* XXX: further optimisations:
-       - use ctx->array_proto_values?
-       - check if array_iterator_prototype next method is built-in and
-         avoid constructing actual iterator object?
-       - build this into js_for_of_start and use in all `for (x of o)` loops
-     */
-    iterator = JS_GetProperty(ctx, sp[-1], JS_ATOM_Symbol_iterator);
-    if (JS_IsException(iterator))
+    enum_rec[0] = js_dup(sp[-1]);
+    if (js_direct_enum_start(ctx, enum_rec)) {
+        if (js_get_fast_array(ctx, sp[-1], &arrp, &count32)) {
+            if (js_get_length32(ctx, &len, sp[-1]))
+                goto direct_exception;
+            /* if len > count32, the elements >= count32 might be read in
+               the prototypes and might have side effects */
+            if (len == count32) {
+                /* the destination is the array built by the spread
+                   expression: copy the elements in its fast array part */
+                p = JS_VALUE_GET_OBJ(sp[-3]);
+                if (p->fast_array && p->u.array.count == pos &&
+                    count32 <= INT32_MAX - pos) {
+                    if (pos + count32 > p->u.array.u1.size) {
+                        if (expand_fast_array(ctx, p, pos + count32))
+                            goto direct_exception;
+                    }
+                    for (i = 0; i < count32; i++)
+                        p->u.array.u.values[pos + i] = js_dup(arrp[i]);
+                    pos += count32;
+                    p->u.array.count = pos;
+                    p->prop[0].u.value = js_int32(pos);
+                } else {
+                    for (i = 0; i < count32; i++) {
+                        if (JS_DefinePropertyValueUint32(ctx, sp[-3], pos++,
+                                                         js_dup(arrp[i]),
+                                                         JS_PROP_C_W_E) < 0)
+                            goto direct_exception;
+                    }
+                }
+                goto direct_done;
+            }
+        }
+        for (;;) {
+            value = js_direct_enum_next(ctx, enum_rec, &done);
+            if (JS_IsException(value))
+                goto direct_exception;
+            if (done)
+                break;
+            if (JS_DefinePropertyValueUint32(ctx, sp[-3], pos++, value,
+                                             JS_PROP_C_W_E) < 0) {
+                js_direct_enum_close(ctx, enum_rec, true);
+                return -1;
+            }
+        }
+    direct_done:
+        js_direct_enum_free(ctx, enum_rec);
+        sp[-2] = js_int32(pos);
+        return 0;
+    direct_exception:
+        js_direct_enum_free(ctx, enum_rec);
         return -1;
-    /* Used to squelch a -Wcast-function-type warning. */
-    JSCFunctionType ft = { .generic_magic = js_create_array_iterator };
-    is_array_iterator = JS_IsCFunction(ctx, iterator,
-                                       ft.generic,
-                                       JS_ITERATOR_KIND_VALUE);
-    JS_FreeValue(ctx, iterator);
+    }
+    JS_FreeValue(ctx, enum_rec[0]);
 
     enumobj = JS_GetIterator(ctx, sp[-1], false);
     if (JS_IsException(enumobj))
@@ -16897,38 +20235,16 @@ static __exception int js_append_enumerate(JSContext *ctx, JSValue *sp)
         JS_FreeValue(ctx, enumobj);
         return -1;
     }
-    /* Used to squelch a -Wcast-function-type warning. */
-    JSCFunctionType ft2 = { .iterator_next = js_array_iterator_next };
-    if (is_array_iterator
-            &&  JS_IsCFunction(ctx, method, ft2.generic, 0)
-            &&  js_get_fast_array(ctx, sp[-1], &arrp, &count32)) {
-        uint32_t len;
-        if (js_get_length32(ctx, &len, sp[-1]))
+    for (;;) {
+        value = JS_IteratorNext(ctx, enumobj, method, 0, NULL, &done);
+        if (JS_IsException(value))
             goto exception;
-        /* if len > count32, the elements >= count32 might be read in
-           the prototypes and might have side effects */
-        if (len != count32)
-            goto general_case;
-        /* Handle fast arrays explicitly */
-        for (i = 0; i < count32; i++) {
-            if (JS_DefinePropertyValueUint32(ctx, sp[-3], pos++,
-                                             js_dup(arrp[i]), JS_PROP_C_W_E) < 0)
-                goto exception;
-        }
-    } else {
-    general_case:
-        for (;;) {
-            int done;
-            value = JS_IteratorNext(ctx, enumobj, method, 0, NULL, &done);
-            if (JS_IsException(value))
-                goto exception;
-            if (done) {
-                /* value is JS_UNDEFINED */
-                break;
-            }
-            if (JS_DefinePropertyValueUint32(ctx, sp[-3], pos++, value, JS_PROP_C_W_E) < 0)
-                goto exception;
+        if (done) {
+            /* value is JS_UNDEFINED */
+            break;
         }
+        if (JS_DefinePropertyValueUint32(ctx, sp[-3], pos++, value, JS_PROP_C_W_E) < 0)
+            goto exception;
     }
     /* Note: could raise an error if too many elements */
     sp[-2] = js_int32(pos);
@@ -17033,6 +20349,7 @@ static JSVarRef *js_create_var_ref(JSContext *ctx, bool is_gc_object)
         return NULL;
     var_ref->header.ref_count = 1;
     var_ref->is_detached = true;
+    var_ref->is_in_block = false;
     var_ref->value = JS_UNDEFINED;
     var_ref->pvalue = &var_ref->value;
     if (is_gc_object)
@@ -17046,6 +20363,7 @@ static JSVarRef *get_var_ref(JSContext *ctx, JSStackFrame *sf, int var_idx,
     JSObject *p;
     JSFunctionBytecode *b;
     JSVarRef *var_ref;
+    JSVarRefBlock *block;
     JSValue *pvalue;
     int var_ref_idx;
     JSVarDef *vd;
@@ -17071,14 +20389,30 @@ static JSVarRef *get_var_ref(JSContext *ctx, JSStackFrame *sf, int var_idx,
             return var_ref;
         }
 
-        /* create a new one */
-        var_ref = js_malloc(ctx, sizeof(JSVarRef));
-        if (!var_ref)
-            return NULL;
+        /* create a new one in the block of the frame */
+        block = sf->var_ref_block;
+        if (!block) {
+            block = js_mallocz(ctx, sizeof(*block) +
+                               sizeof(block->var_refs[0]) * sf->var_ref_count);
+            if (!block)
+                return NULL;
+            block->ref_count = 1;
+            sf->var_ref_block = block;
+        }
+        var_ref = &block->var_refs[var_ref_idx];
+        if (var_ref->header.ref_count == 0) {
+            var_ref->is_in_block = true;
+        } else {
+            /* the slot is used by a variable of a previous loop
+               iteration which is still referenced */
+            var_ref = js_malloc(ctx, sizeof(JSVarRef));
+            if (!var_ref)
+                return NULL;
+            var_ref->is_in_block = false;
+        }
         var_ref->header.ref_count = 1;
+        var_ref->__gc_mark = 0;
         var_ref->is_detached = false;
-        var_ref->is_lexical = false;
-        var_ref->is_const = false;
         var_ref->var_ref_idx = var_ref_idx;
         var_ref->stack_frame = sf;
         sf->var_refs[var_ref_idx] = var_ref;
@@ -17092,6 +20426,7 @@ static JSVarRef *get_var_ref(JSContext *ctx, JSStackFrame *sf, int var_idx,
             return NULL;
         var_ref->header.ref_count = 1;
         var_ref->is_detached = true;
+        var_ref->is_in_block = false;
         var_ref->value = js_dup(*pvalue);
         var_ref->pvalue = &var_ref->value;
         add_gc_object(ctx->rt, &var_ref->header, JS_GC_OBJ_TYPE_VAR_REF);
@@ -17099,6 +20434,38 @@ static JSVarRef *get_var_ref(JSContext *ctx, JSStackFrame *sf, int var_idx,
     }
 }
 
+/* return the bytecode of a lazy function, generating it if necessary */
+static JSFunctionBytecode *js_get_lazy_bytecode(JSContext *ctx,
+                                                JSFunctionBytecode *b)
+{
+    if (!b->lazy_bytecode) {
+#ifndef QJS_DISABLE_PARSER
+        b->lazy_bytecode = js_compile_lazy_function(b->realm, b);
+#else
+        /* lazy functions are only created by the parser */
+        JS_ThrowInternalError(ctx, "lazy function without parser");
+#endif
+    }
+    return b->lazy_bytecode;
+}
+
+/* replace the bytecode of the lazy function object 'p' by the generated
+   bytecode */
+static JSFunctionBytecode *js_resolve_lazy_function(JSContext *ctx,
+                                                    JSObject *p)
+{
+    JSFunctionBytecode *b, *b1;
+
+    b = p->u.func.function_bytecode;
+    b1 = js_get_lazy_bytecode(ctx, b);
+    if (!b1)
+        return NULL;
+    b1->header.ref_count++;
+    p->u.func.function_bytecode = b1;
+    JS_FreeValue(ctx, JS_MKPTR(JS_TAG_FUNCTION_BYTECODE, b));
+    return b1;
+}
+
 static JSValue js_closure2(JSContext *ctx, JSValue func_obj,
                            JSFunctionBytecode *b,
                            JSVarRef **cur_var_refs,
@@ -17184,6 +20551,14 @@ static JSValue js_closure(JSContext *ctx, JSValue bfunc,
     JSAtom name_atom;
 
     b = JS_VALUE_GET_PTR(bfunc);
+    if (b->is_lazy && b->lazy_bytecode) {
+        /* already compiled by a previous call */
+        JSValue bfunc1 = js_dup(JS_MKPTR(JS_TAG_FUNCTION_BYTECODE,
+                                         b->lazy_bytecode));
+        JS_FreeValue(ctx, bfunc);
+        bfunc = bfunc1;
+        b = JS_VALUE_GET_PTR(bfunc);
+    }
     func_obj = JS_NewObjectClass(ctx, func_kind_to_class_id[b->func_kind]);
     if (JS_IsException(func_obj)) {
         JS_FreeValue(ctx, bfunc);
@@ -17327,10 +20702,16 @@ static int js_op_define_class(JSContext *ctx, JSValue *sp,
 
 static void close_var_ref(JSRuntime *rt, JSVarRef *var_ref)
 {
+    /* the var refs of the frame block which are no longer
+       referenced are kept for the next closures */
+    if (var_ref->header.ref_count == 0)
+        return;
     var_ref->value = js_dup(*var_ref->pvalue);
     var_ref->pvalue = &var_ref->value;
     /* the reference is no longer to a local variable */
     var_ref->is_detached = true;
+    if (var_ref->is_in_block)
+        var_ref_get_block(var_ref)->ref_count++;
     add_gc_object(rt, &var_ref->header, JS_GC_OBJ_TYPE_VAR_REF);
 }
 
@@ -17344,6 +20725,10 @@ static void close_var_refs(JSRuntime *rt, JSStackFrame *sf)
         if (var_ref)
             close_var_ref(rt, var_ref);
     }
+    if (sf->var_ref_block) {
+        free_var_ref_block(rt, sf->var_ref_block);
+        sf->var_ref_block = NULL;
+    }
 }
 
 static void close_lexical_var(JSContext *ctx, JSFunctionBytecode *b,
@@ -17538,6 +20923,243 @@ typedef enum {
     OP_SPECIAL_OBJECT_NULL_PROTO,
 } OPSpecialObjectEnum;
 
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+/* The execution counters count the executed opcodes, the calls of the
+   bytecode functions and their self time. The self time of a function
+   includes the native functions it calls. The statistics are owned by
+   the runtime so that they outlive the functions. */
+typedef struct JSExecFuncStats {
+    struct list_head link; /* rt->exec_func_list */
+    JSAtom func_name;
+    JSAtom filename;
+    int line_num;
+    int col_num;
+    uint64_t call_count;
+    uint64_t self_time; /* in ns */
+} JSExecFuncStats;
+
+static const char * const js_exec_opcode_name[OP_COUNT] = {
+#define FMT(f)
+#define DEF(id, size, n_pop, n_push, f) #id,
+#define def(id, size, n_pop, n_push, f)
+#include "quickjs-opcode.h"
+#undef def
+#undef DEF
+#undef FMT
+};
+
+static no_inline JSExecFuncStats *js_exec_new_func(JSRuntime *rt,
+                                                   JSFunctionBytecode *b)
+{
+    JSExecFuncStats *fs;
+
+    fs = js_mallocz_rt(rt, sizeof(*fs));
+    if (!fs)
+        return NULL;
+    fs->func_name = JS_DupAtomRT(rt, b->func_name);
+    fs->filename = JS_DupAtomRT(rt, b->filename);
+    fs->line_num = b->line_num;
+    fs->col_num = b->col_num;
+    list_add_tail(&fs->link, &rt->exec_func_list);
+    b->exec_stats = fs;
+    return fs;
+}
+
+/* charge the elapsed time to the running function and make 'b' the
+   running function. Return the previous running function. */
+static inline JSExecFuncStats *js_exec_enter(JSRuntime *rt,
+                                             JSFunctionBytecode *b,
+                                             bool is_call)
+{
+    JSExecFuncStats *caller, *fs;
+    uint64_t t;
+
+    t = js__hrtime_ns();
+    caller = rt->exec_cur_func;
+    if (caller)
+        caller->self_time += t - rt->exec_last_time;
+    rt->exec_last_time = t;
+    fs = b->exec_stats;
+    if (unlikely(!fs))
+        fs = js_exec_new_func(rt, b);
+    if (fs && is_call)
+        fs->call_count++;
+    rt->exec_cur_func = fs;
+    return caller;
+}
+
+static inline void js_exec_leave(JSRuntime *rt, JSExecFuncStats *caller)
+{
+    uint64_t t;
+
+    t = js__hrtime_ns();
+    if (rt->exec_cur_func)
+        rt->exec_cur_func->self_time += t - rt->exec_last_time;
+    rt->exec_last_time = t;
+    rt->exec_cur_func = caller;
+}
+
+static void js_exec_free(JSRuntime *rt)
+{
+    struct list_head *el, *el1;
+    JSExecFuncStats *fs;
+
+    list_for_each_safe(el, el1, &rt->exec_func_list) {
+        fs = list_entry(el, JSExecFuncStats, link);
+        JS_FreeAtomRT(rt, fs->func_name);
+        JS_FreeAtomRT(rt, fs->filename);
+        js_free_rt(rt, fs);
+    }
+    init_list_head(&rt->exec_func_list);
+    rt->exec_cur_func = NULL;
+}
+
+static int js_exec_opcode_cmp(const void *a, const void *b, void *opaque)
+{
+    const uint64_t *count = opaque;
+    uint64_t c1 = count[*(const uint8_t *)a];
+    uint64_t c2 = count[*(const uint8_t *)b];
+
+    return (c1 < c2) - (c1 > c2);
+}
+
+/* the functions with the same location are merged in the report
+   because each evaluation of a script creates new bytecode */
+static int js_exec_func_loc_cmp(const void *a, const void *b, void *opaque)
+{
+    const JSExecFuncStats *f1 = a, *f2 = b;
+
+    if (f1->filename != f2->filename)
+        return (f1->filename > f2->filename) - (f1->filename < f2->filename);
+    if (f1->line_num != f2->line_num)
+        return (f1->line_num > f2->line_num) - (f1->line_num < f2->line_num);
+    if (f1->col_num != f2->col_num)
+        return (f1->col_num > f2->col_num) - (f1->col_num < f2->col_num);
+    return (f1->func_name > f2->func_name) - (f1->func_name < f2->func_name);
+}
+
+static int js_exec_func_time_cmp(const void *a, const void *b, void *opaque)
+{
+    const JSExecFuncStats *f1 = a, *f2 = b;
+
+    if (f1->self_time != f2->self_time)
+        return (f1->self_time < f2->self_time) - (f1->self_time > f2->self_time);
+    return (f1->call_count < f2->call_count) - (f1->call_count > f2->call_count);
+}
+
+static void js_exec_dump_func(JSRuntime *rt, FILE *fp,
+                              const JSExecFuncStats *fs)
+{
+    char buf[256];
+    /* file names are often longer than atom buffers */
+    char filename[1024];
+    const char *str;
+
+    str = "(anonymous)";
+    if (fs->func_name != JS_ATOM_NULL) {
+        JS_AtomGetStrRT(rt, buf, sizeof(buf), fs->func_name);
+        if (buf[0])
+            str = buf;
+    }
+    JS_AtomGetStrRT(rt, filename, sizeof(filename), fs->filename);
+    fprintf(fp, "%s (%s:%d:%d)\n", str, filename, fs->line_num, fs->col_num);
+}
+
+static int js_exec_dump(JSRuntime *rt, FILE *fp)
+{
+    uint8_t ops[OP_COUNT];
+    JSExecFuncStats *tab, *fs;
+    struct list_head *el;
+    uint64_t total;
+    size_t i, n, count;
+
+    total = 0;
+    n = 0;
+    for(i = 0; i < OP_COUNT; i++) {
+        if (rt->exec_opcode_count[i] != 0) {
+            total += rt->exec_opcode_count[i];
+            ops[n++] = i;
+        }
+    }
+    rqsort(ops, n, sizeof(ops[0]), js_exec_opcode_cmp, rt->exec_opcode_count);
+    fprintf(fp, "Opcodes: %" PRIu64 " executed\n"
+            "%16s %7s  %s\n", total, "COUNT", "%", "OPCODE");
+    for(i = 0; i < n; i++) {
+        fprintf(fp, "%16" PRIu64 " %6.2f%%  %s\n",
+                rt->exec_opcode_count[ops[i]],
+                100.0 * rt->exec_opcode_count[ops[i]] / total,
+                js_exec_opcode_name[ops[i]]);
+    }
+
+    count = 0;
+    list_for_each(el, &rt->exec_func_list)
+        count++;
+    tab = js_malloc_rt(rt, sizeof(tab[0]) * (count + 1));
+    if (!tab)
+        return -1;
+    n = 0;
+    list_for_each(el, &rt->exec_func_list) {
+        fs = list_entry(el, JSExecFuncStats, link);
+        if (fs->call_count != 0 || fs->self_time != 0)
+            tab[n++] = *fs;
+    }
+    rqsort(tab, n, sizeof(tab[0]), js_exec_func_loc_cmp, NULL);
+    count = 0;
+    total = 0;
+    for(i = 0; i < n; i++) {
+        total += tab[i].self_time;
+        if (count != 0 && !js_exec_func_loc_cmp(&tab[count - 1], &tab[i], NULL)) {
+            tab[count - 1].call_count += tab[i].call_count;
+            tab[count - 1].self_time += tab[i].self_time;
+        } else {
+            tab[count++] = tab[i];
+        }
+    }
+    rqsort(tab, count, sizeof(tab[0]), js_exec_func_time_cmp, NULL);
+    fprintf(fp, "\nFunctions: %.3f ms\n"
+            "%16s %7s %12s  %s\n", total / 1e6,
+            "SELF (ms)", "%", "CALLS", "FUNCTION");
+    for(i = 0; i < count; i++) {
+        fs = &tab[i];
+        fprintf(fp, "%16.3f %6.2f%% %12" PRIu64 "  ",
+                fs->self_time / 1e6,
+                total ? 100.0 * fs->self_time / total : 0.0,
+                fs->call_count);
+        js_exec_dump_func(rt, fp, fs);
+    }
+    js_free_rt(rt, tab);
+    return ferror(fp) ? -1 : 0;
+}
+#endif /* QJS_ENABLE_EXEC_COUNTERS */
+
+int JS_DumpExecCounters(JSRuntime *rt, FILE *fp)
+{
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    return js_exec_dump(rt, fp);
+#else
+    return -1;
+#endif
+}
+
+int JS_ResetExecCounters(JSRuntime *rt)
+{
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    struct list_head *el;
+    JSExecFuncStats *fs;
+
+    memset(rt->exec_opcode_count, 0, sizeof(rt->exec_opcode_count));
+    list_for_each(el, &rt->exec_func_list) {
+        fs = list_entry(el, JSExecFuncStats, link);
+        fs->call_count = 0;
+        fs->self_time = 0;
+    }
+    rt->exec_last_time = js__hrtime_ns();
+    return 0;
+#else
+    return -1;
+#endif
+}
+
 #define FUNC_RET_AWAIT      0
 #define FUNC_RET_YIELD      1
 #define FUNC_RET_YIELD_STAR 2
@@ -17575,6 +21197,9 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
     JSValue *local_buf, *stack_buf, *var_buf, *arg_buf, *sp, ret_val, *pval;
     JSVarRef **var_refs;
     size_t alloca_size;
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    JSExecFuncStats *exec_caller;
+#endif
 
 #ifdef ENABLE_DUMPS // JS_DUMP_BYTECODE_STEP
 #define DUMP_BYTECODE_OR_DONT(pc) \
@@ -17583,8 +21208,14 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
 #define DUMP_BYTECODE_OR_DONT(pc)
 #endif
 
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+#define COUNT_OPCODE(pc) rt->exec_opcode_count[*(pc)]++;
+#else
+#define COUNT_OPCODE(pc)
+#endif
+
 #if !DIRECT_DISPATCH
-#define SWITCH(pc)      DUMP_BYTECODE_OR_DONT(pc) switch (opcode = *pc++)
+#define SWITCH(pc)      DUMP_BYTECODE_OR_DONT(pc) COUNT_OPCODE(pc) switch (opcode = *pc++)
 #define CASE(op)        case op
 #define DEFAULT         default
 #define BREAK           break
@@ -17595,13 +21226,14 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
 #include "quickjs-opcode.h"
         [ OP_COUNT ... 255 ] = &&case_default
     };
-#define SWITCH(pc)      DUMP_BYTECODE_OR_DONT(pc) __extension__ ({ goto *dispatch_table[opcode = *pc++]; });
+#define SWITCH(pc)      DUMP_BYTECODE_OR_DONT(pc) COUNT_OPCODE(pc) __extension__ ({ goto *dispatch_table[opcode = *pc++]; });
 #define CASE(op)        case_ ## op
 #define DEFAULT         case_default
 #define BREAK           SWITCH(pc)
 #endif
 
-    if (js_poll_interrupts(caller_ctx))
+    if (unlikely(--caller_ctx->interrupt_counter <= 0) &&
+        __js_poll_interrupts(caller_ctx, func_obj))
         return JS_EXCEPTION;
     if (unlikely(JS_VALUE_GET_TAG(func_obj) != JS_TAG_OBJECT)) {
         if (flags & JS_CALL_FLAG_GENERATOR) {
@@ -17621,6 +21253,9 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
             pc = sf->cur_pc;
             sf->prev_frame = rt->current_stack_frame;
             rt->current_stack_frame = sf;
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+            exec_caller = js_exec_enter(rt, b, false);
+#endif
             if (s->throw_flag)
                 goto exception;
             else
@@ -17643,6 +21278,11 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                          argv, flags);
     }
     b = p->u.func.function_bytecode;
+    if (unlikely(b->is_lazy)) {
+        b = js_resolve_lazy_function(caller_ctx, p);
+        if (!b)
+            return JS_EXCEPTION;
+    }
 
     if (unlikely(argc < b->arg_count || (flags & JS_CALL_FLAG_COPY_ARGV))) {
         arg_allocated_size = b->arg_count;
@@ -17682,6 +21322,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
     stack_buf = var_buf + b->var_count;
     sf->var_refs = (JSVarRef **)(stack_buf + b->stack_size);
     sf->var_ref_count = b->var_ref_count;
+    sf->var_ref_block = NULL;
     for(i = 0; i < b->var_ref_count; i++)
         sf->var_refs[i] = NULL;
     sp = stack_buf;
@@ -17691,6 +21332,9 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
     sf->prev_frame = rt->current_stack_frame;
     rt->current_stack_frame = sf;
     ctx = b->realm; /* set the current realm */
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    exec_caller = js_exec_enter(rt, b, true);
+#endif
 
 #ifdef ENABLE_DUMPS // JS_DUMP_BYTECODE_STEP
     if (check_dump_flag(ctx->rt, JS_DUMP_BYTECODE_STEP))
@@ -17831,6 +21475,15 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
             if (unlikely(JS_IsException(sp[-1])))
                 goto exception;
             BREAK;
+        CASE(OP_object_template):
+            {
+                uint32_t idx = get_u32(pc);
+                pc += 4;
+                *sp++ = js_create_from_object_template(ctx, b->cpool[idx]);
+                if (unlikely(JS_IsException(sp[-1])))
+                    goto exception;
+            }
+            BREAK;
         CASE(OP_special_object):
             {
                 int arg = *pc++;
@@ -18126,11 +21779,31 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
         CASE(OP_apply):
             {
                 int magic;
+                JSValue *arrp;
+                uint32_t count32;
                 magic = get_u16(pc);
                 pc += 2;
                 sf->cur_pc = pc;
 
-                ret_val = js_function_apply(ctx, sp[-3], 2, vc(&sp[-2]), magic);
+                /* the array is built by the spread expression and is not
+                   visible from the callee so its elements can be used
+                   as arguments without copying them */
+                if (js_get_fast_array(ctx, sp[-1], &arrp, &count32) &&
+                    count32 <= JS_MAX_LOCAL_VARS) {
+                    if (check_function(ctx, sp[-3]))
+                        goto exception;
+                    if (magic & 1) {
+                        ret_val = JS_CallConstructor2(ctx, sp[-3], sp[-2],
+                                                      count32, vc(arrp));
+                    } else {
+                        ret_val = JS_CallInternal(ctx, sp[-3], sp[-2],
+                                                  JS_UNDEFINED, count32,
+                                                  vc(arrp),
+                                                  JS_CALL_FLAG_COPY_ARGV);
+                    }
+                } else {
+                    ret_val = js_function_apply(ctx, sp[-3], 2, vc(&sp[-2]), magic);
+                }
                 if (unlikely(JS_IsException(ret_val)))
                     goto exception;
                 JS_FreeValue(ctx, sp[-3]);
@@ -18140,6 +21813,118 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 *sp++ = ret_val;
             }
             BREAK;
+        CASE(OP_apply_arguments):
+            {
+                /* 'arguments' is only built if it is passed to something
+                   else than Function.prototype.apply */
+                JSCFunctionType ft = { .generic_magic = js_function_apply };
+                JSValue *tab;
+                int idx;
+
+                idx = get_u16(pc);
+                pc += 2;
+                sf->cur_pc = pc;
+                if (JS_IsUndefined(sp[-1]) &&
+                    JS_IsCFunction(ctx, sp[-3], ft.generic, 0) &&
+                    JS_VALUE_GET_OBJ(sp[-3])->u.cfunc.realm == ctx) {
+                    if (argc <= b->arg_count || arg_buf == argv) {
+                        ret_val = JS_CallInternal(ctx, sp[-4], sp[-2],
+                                                  JS_UNDEFINED, argc,
+                                                  vc(arg_buf),
+                                                  JS_CALL_FLAG_COPY_ARGV);
+                    } else {
+                        /* the first arguments were copied to arg_buf */
+                        tab = js_malloc(ctx, sizeof(tab[0]) * argc);
+                        if (!tab)
+                            goto exception;
+                        memcpy(tab, arg_buf, sizeof(tab[0]) * b->arg_count);
+                        memcpy(tab + b->arg_count, argv + b->arg_count,
+                               sizeof(tab[0]) * (argc - b->arg_count));
+                        ret_val = JS_CallInternal(ctx, sp[-4], sp[-2],
+                                                  JS_UNDEFINED, argc, vc(tab),
+                                                  JS_CALL_FLAG_COPY_ARGV);
+                        js_free(ctx, tab);
+                    }
+                } else {
+                    if (JS_IsUndefined(sp[-1])) {
+                        sp[-1] = js_build_lazy_arguments(ctx, sf, b, argc, vc(argv));
+                        if (unlikely(JS_IsException(sp[-1])))
+                            goto exception;
+                        set_value(ctx, &var_buf[idx], js_dup(sp[-1]));
+                    }
+                    ret_val = JS_CallInternal(ctx, sp[-3], sp[-4],
+                                              JS_UNDEFINED, 2, vc(sp - 2), 0);
+                }
+                if (unlikely(JS_IsException(ret_val)))
+                    goto exception;
+                JS_FreeValue(ctx, sp[-4]);
+                JS_FreeValue(ctx, sp[-3]);
+                JS_FreeValue(ctx, sp[-2]);
+                JS_FreeValue(ctx, sp[-1]);
+                sp -= 4;
+                *sp++ = ret_val;
+            }
+            BREAK;
+        CASE(OP_get_arguments_length):
+            if (JS_IsUndefined(sp[-1])) {
+                sp[-1] = js_int32(argc);
+            } else {
+                JSValue val;
+                sf->cur_pc = pc;
+                val = JS_GetProperty(ctx, sp[-1], JS_ATOM_length);
+                if (unlikely(JS_IsException(val)))
+                    goto exception;
+                JS_FreeValue(ctx, sp[-1]);
+                sp[-1] = val;
+            }
+            BREAK;
+        CASE(OP_get_loc_arguments):
+            {
+                int idx;
+                idx = get_u16(pc);
+                pc += 2;
+                if (JS_IsUndefined(var_buf[idx]))
+                    *sp++ = js_int32(idx);
+                else
+                    *sp++ = js_dup(var_buf[idx]);
+            }
+            BREAK;
+        CASE(OP_get_arguments_el):
+            {
+                JSValue val;
+                int32_t i;
+
+                /* sp[-2] is the index of the 'arguments' variable if
+                   the object is not built */
+                if (JS_VALUE_GET_TAG(sp[-2]) == JS_TAG_INT &&
+                    JS_VALUE_GET_TAG(sp[-1]) == JS_TAG_INT &&
+                    (i = JS_VALUE_GET_INT(sp[-1])) >= 0 && i < argc) {
+                    if (i < b->arg_count)
+                        val = js_dup(arg_buf[i]);
+                    else
+                        val = js_dup(argv[i]);
+                } else {
+                    sf->cur_pc = pc;
+                    if (JS_VALUE_GET_TAG(sp[-2]) == JS_TAG_INT) {
+                        int idx = JS_VALUE_GET_INT(sp[-2]);
+                        sp[-2] = js_build_lazy_arguments(ctx, sf, b, argc, vc(argv));
+                        if (unlikely(JS_IsException(sp[-2])))
+                            goto exception;
+                        set_value(ctx, &var_buf[idx], js_dup(sp[-2]));
+                    }
+                    val = JS_GetPropertyValue(ctx, sp[-2], sp[-1]);
+                    JS_FreeValue(ctx, sp[-2]);
+                    sp[-2] = val;
+                    sp--;
+                    if (unlikely(JS_IsException(val)))
+                        goto exception;
+                    BREAK;
+                }
+                JS_FreeValue(ctx, sp[-2]);
+                sp[-2] = val;
+                sp--;
+            }
+            BREAK;
         CASE(OP_return):
             ret_val = *--sp;
             goto done;
@@ -18340,11 +22125,13 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
             {
                 JSValue val;
                 JSAtom atom;
+                JSGlobalVarCache *gc;
                 atom = get_u32(pc);
-                pc += 4;
+                gc = get_global_var_cache(ctx, b, get_u16(pc + 4));
+                pc += 6;
                 sf->cur_pc = pc;
 
-                val = JS_GetGlobalVar(ctx, atom, opcode - OP_get_var_undef);
+                val = JS_GetGlobalVar(ctx, atom, opcode - OP_get_var_undef, gc);
                 if (unlikely(JS_IsException(val)))
                     goto exception;
                 *sp++ = val;
@@ -18356,11 +22143,13 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
             {
                 int ret;
                 JSAtom atom;
+                JSGlobalVarCache *gc;
                 atom = get_u32(pc);
-                pc += 4;
+                gc = get_global_var_cache(ctx, b, get_u16(pc + 4));
+                pc += 6;
                 sf->cur_pc = pc;
 
-                ret = JS_SetGlobalVar(ctx, atom, sp[-1], opcode - OP_put_var);
+                ret = JS_SetGlobalVar(ctx, atom, sp[-1], opcode - OP_put_var, gc);
                 sp--;
                 if (unlikely(ret < 0))
                     goto exception;
@@ -18679,17 +22468,17 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
 
         CASE(OP_goto):
             pc += (int32_t)get_u32(pc);
-            if (unlikely(js_poll_interrupts(ctx)))
+            if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                 goto exception;
             BREAK;
         CASE(OP_goto16):
             pc += (int16_t)get_u16(pc);
-            if (unlikely(js_poll_interrupts(ctx)))
+            if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                 goto exception;
             BREAK;
         CASE(OP_goto8):
             pc += (int8_t)pc[0];
-            if (unlikely(js_poll_interrupts(ctx)))
+            if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                 goto exception;
             BREAK;
         CASE(OP_if_true):
@@ -18708,7 +22497,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 if (res) {
                     pc += (int32_t)get_u32(pc - 4) - 4;
                 }
-                if (unlikely(js_poll_interrupts(ctx)))
+                if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                     goto exception;
             }
             BREAK;
@@ -18728,7 +22517,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 if (!res) {
                     pc += (int32_t)get_u32(pc - 4) - 4;
                 }
-                if (unlikely(js_poll_interrupts(ctx)))
+                if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                     goto exception;
             }
             BREAK;
@@ -18748,7 +22537,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 if (res) {
                     pc += (int8_t)pc[-1] - 1;
                 }
-                if (unlikely(js_poll_interrupts(ctx)))
+                if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                     goto exception;
             }
             BREAK;
@@ -18768,7 +22557,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 if (!res) {
                     pc += (int8_t)pc[-1] - 1;
                 }
-                if (unlikely(js_poll_interrupts(ctx)))
+                if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                     goto exception;
             }
             BREAK;
@@ -18822,7 +22611,12 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
             BREAK;
         CASE(OP_for_of_start):
             sf->cur_pc = pc;
-            if (js_for_of_start(ctx, sp, false))
+            /* the records of 'yield*' and of the loops of async
+               generators are used by other opcodes than for_of_next
+               and iterator_close */
+            if (js_for_of_start(ctx, sp, false,
+                                b->func_kind == JS_FUNC_NORMAL ||
+                                b->func_kind == JS_FUNC_ASYNC))
                 goto exception;
             sp += 1;
             *sp++ = JS_NewCatchOffset(ctx, 0);
@@ -18839,7 +22633,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
             BREAK;
         CASE(OP_for_await_of_start):
             sf->cur_pc = pc;
-            if (js_for_of_start(ctx, sp, true))
+            if (js_for_of_start(ctx, sp, true, false))
                 goto exception;
             sp += 1;
             *sp++ = JS_NewCatchOffset(ctx, 0);
@@ -18860,15 +22654,19 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
         CASE(OP_iterator_close):
             /* iter_obj next catch_offset -> */
             sp--; /* drop the catch offset to avoid getting caught by exception */
-            JS_FreeValue(ctx, sp[-1]); /* drop the next method */
-            sp--;
-            if (!JS_IsUndefined(sp[-1])) {
+            if (!JS_IsUndefined(sp[-2])) {
                 sf->cur_pc = pc;
-                if (JS_IteratorClose(ctx, sp[-1], false))
-                    goto exception;
-                JS_FreeValue(ctx, sp[-1]);
+                if (js_is_direct_enum(sp[-1])) {
+                    if (js_direct_enum_close(ctx, sp - 2, false))
+                        goto exception;
+                } else {
+                    if (JS_IteratorClose(ctx, sp[-2], false))
+                        goto exception;
+                }
             }
-            sp--;
+            JS_FreeValue(ctx, sp[-1]); /* drop the next method */
+            JS_FreeValue(ctx, sp[-2]);
+            sp -= 2;
             BREAK;
         CASE(OP_nip_catch):
             {
@@ -19152,6 +22950,18 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
             }
             BREAK;
 
+        CASE(OP_define_field_slot):
+            {
+                /* the object comes from OP_object_template and is
+                   not yet visible: its shape cannot have changed */
+                JSObject *p = JS_VALUE_GET_OBJ(sp[-2]);
+                uint32_t idx = get_u32(pc);
+                pc += 4;
+                set_value(ctx, &p->prop[idx].u.value, sp[-1]);
+                sp--;
+            }
+            BREAK;
+
         CASE(OP_set_name):
             {
                 int ret;
@@ -20231,9 +24041,14 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 int pos = JS_VALUE_GET_INT(val);
                 if (pos == 0) {
                     /* enumerator: close it with a throw */
+                    if (js_is_direct_enum(sp[-1])) {
+                        if (!JS_IsUndefined(sp[-2]))
+                            js_direct_enum_close(ctx, sp - 2, true);
+                    } else {
+                        JS_IteratorClose(ctx, sp[-2], true);
+                    }
                     JS_FreeValue(ctx, sp[-1]); /* drop the next method */
                     sp--;
-                    JS_IteratorClose(ctx, sp[-1], true);
                 } else {
                     *sp++ = rt->current_exception;
                     rt->current_exception = JS_UNINITIALIZED;
@@ -20244,6 +24059,10 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 }
             }
         }
+    } else {
+        /* the enumerators are not closed: the Map and Set cursors must
+           not reference the freed frame */
+        js_direct_enum_free_frame(stack_buf, sp);
     }
     ret_val = JS_EXCEPTION;
     /* the local variables are freed by the caller in the generator
@@ -20264,6 +24083,9 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
             JS_FreeValue(ctx, *pval);
         }
     }
+#ifdef QJS_ENABLE_EXEC_COUNTERS
+    js_exec_leave(rt, exec_caller);
+#endif
     rt->current_stack_frame = sf->prev_frame;
     return ret_val;
 }
@@ -20359,6 +24181,57 @@ static JSValue js_create_from_ctor(JSContext *ctx, JSValueConst ctor,
     return obj;
 }
 
+/* same as js_create_from_ctor() for plain objects, but the property
+   array is sized from the instances previously created with 'ctor' as
+   new.target so that the constructor does not need to grow it */
+static JSValue js_create_object_from_ctor(JSContext *ctx, JSValueConst ctor)
+{
+    JSFunctionBytecode *b;
+    JSShape *sh;
+    JSValue proto;
+    JSObject *p;
+
+    if (JS_VALUE_GET_TAG(ctor) != JS_TAG_OBJECT)
+        goto generic;
+    p = JS_VALUE_GET_OBJ(ctor);
+    if (p->class_id != JS_CLASS_BYTECODE_FUNCTION)
+        goto generic;
+    b = p->u.func.function_bytecode;
+    if (b->ctor_prop_count <= JS_PROP_INITIAL_SIZE)
+        goto generic;
+    proto = JS_GetProperty(ctx, ctor, JS_ATOM_prototype);
+    if (JS_IsException(proto))
+        return proto;
+    if (!JS_IsObject(proto)) {
+        JS_FreeValue(ctx, proto);
+        goto generic;
+    }
+    sh = js_get_root_shape2(ctx, JS_VALUE_GET_OBJ(proto), b->ctor_prop_count);
+    JS_FreeValue(ctx, proto);
+    if (!sh)
+        return JS_EXCEPTION;
+    return JS_NewObjectFromShape(ctx, sh, JS_CLASS_OBJECT, NULL);
+ generic:
+    return js_create_from_ctor(ctx, ctor, JS_CLASS_OBJECT);
+}
+
+/* record the final property count of an instance created by 'ctor' */
+static void js_ctor_track_instance(JSFunctionBytecode *b, JSValueConst obj)
+{
+    JSObject *p;
+    int prop_count;
+
+    if (JS_VALUE_GET_TAG(obj) != JS_TAG_OBJECT)
+        return;
+    p = JS_VALUE_GET_OBJ(obj);
+    if (p->class_id != JS_CLASS_OBJECT)
+        return;
+    prop_count = min_int(p->shape->prop_count, JS_SHAPE_MAX_TRANSITION_PROPS);
+    if (prop_count > b->ctor_prop_count)
+        b->ctor_prop_count = prop_count;
+    b->ctor_instance_count++;
+}
+
 /* argv[] is modified if (flags & JS_CALL_FLAG_COPY_ARGV) = 0. */
 static JSValue JS_CallConstructorInternal(JSContext *ctx,
                                           JSValueConst func_obj,
@@ -20391,12 +24264,22 @@ static JSValue JS_CallConstructorInternal(JSContext *ctx,
     }
 
     b = p->u.func.function_bytecode;
+    if (unlikely(b->is_lazy)) {
+        b = js_resolve_lazy_function(ctx, p);
+        if (!b)
+            return JS_EXCEPTION;
+    }
     if (b->is_derived_class_constructor) {
-        return JS_CallInternal(ctx, func_obj, JS_UNDEFINED, new_target, argc, argv, flags);
+        JSValue ret;
+        ret = JS_CallInternal(ctx, func_obj, JS_UNDEFINED, new_target, argc, argv, flags);
+        if (b->ctor_instance_count < JS_CTOR_SLACK_TRACKING_COUNT &&
+            JS_VALUE_GET_PTR(func_obj) == JS_VALUE_GET_PTR(new_target))
+            js_ctor_track_instance(b, ret);
+        return ret;
     } else {
         JSValue obj, ret;
         /* legacy constructor behavior */
-        obj = js_create_from_ctor(ctx, new_target, JS_CLASS_OBJECT);
+        obj = js_create_object_from_ctor(ctx, new_target);
         if (JS_IsException(obj))
             return JS_EXCEPTION;
         ret = JS_CallInternal(ctx, func_obj, obj, new_target, argc, argv, flags);
@@ -20406,6 +24289,9 @@ static JSValue JS_CallConstructorInternal(JSContext *ctx,
             return ret;
         } else {
             JS_FreeValue(ctx, ret);
+            if (b->ctor_instance_count < JS_CTOR_SLACK_TRACKING_COUNT &&
+                JS_VALUE_GET_PTR(func_obj) == JS_VALUE_GET_PTR(new_target))
+                js_ctor_track_instance(b, obj);
             return obj;
         }
     }
@@ -20447,6 +24333,92 @@ static JSValue JS_InvokeFree(JSContext *ctx, JSValue this_val, JSAtom atom,
 }
 
 /* JSAsyncFunctionState (used by generator and async functions) */
+
+/* header of a free stack frame in JSRuntime.frame_cache */
+typedef struct JSFreeFrame {
+    struct JSFreeFrame *next;
+    uint32_t size; /* number of values */
+} JSFreeFrame;
+
+/* size class of a frame of 'n' values, -1 if it is too large to be
+   cached */
+static int js_frame_class(size_t n)
+{
+    if (n <= (1 << JS_FRAME_CACHE_MIN_BITS))
+        return 0;
+    else if (n <= (1 << (JS_FRAME_CACHE_MIN_BITS + JS_FRAME_CACHE_CLASSES - 1)))
+        return 32 - clz32(n - 1) - JS_FRAME_CACHE_MIN_BITS;
+    else
+        return -1;
+}
+
+/* allocate a stack frame of 'size' bytes. A suspended frame can live
+   long, so it is not rounded up to its size class: only a free frame
+   of the same number of values is reused. This number is stored in
+   '*psize' (0 if the frame is too large to be cached). */
+static void *js_alloc_frame(JSContext *ctx, size_t size, int *psize)
+{
+    JSRuntime *rt = ctx->rt;
+    JSFreeFrame *ff, **pff;
+    size_t n;
+    int c;
+
+    n = (size + sizeof(JSValue) - 1) / sizeof(JSValue);
+    c = js_frame_class(n);
+    if (c < 0) {
+        *psize = 0;
+        return js_malloc(ctx, size);
+    }
+    *psize = n;
+    for(pff = &rt->frame_cache[c]; (ff = *pff) != NULL; pff = &ff->next) {
+        if (ff->size == n) {
+            *pff = ff->next;
+            rt->frame_cache_count[c]--;
+            return ff;
+        }
+    }
+    return js_malloc(ctx, sizeof(JSValue) * n);
+}
+
+static void js_free_frame(JSRuntime *rt, void *ptr, int size)
+{
+    JSFreeFrame *ff, **pff;
+    int c;
+
+    if (size == 0) {
+        js_free_rt(rt, ptr);
+        return;
+    }
+    c = js_frame_class(size);
+    if (rt->frame_cache_count[c] == JS_FRAME_CACHE_SIZE) {
+        /* free the least recently freed frame */
+        for(pff = &rt->frame_cache[c]; (*pff)->next != NULL; pff = &(*pff)->next)
+            continue;
+        js_free_rt(rt, *pff);
+        *pff = NULL;
+        rt->frame_cache_count[c]--;
+    }
+    ff = ptr;
+    ff->size = size;
+    ff->next = rt->frame_cache[c];
+    rt->frame_cache[c] = ff;
+    rt->frame_cache_count[c]++;
+}
+
+static void js_frame_cache_flush(JSRuntime *rt)
+{
+    JSFreeFrame *ff;
+    int c;
+
+    for(c = 0; c < JS_FRAME_CACHE_CLASSES; c++) {
+        while ((ff = rt->frame_cache[c]) != NULL) {
+            rt->frame_cache[c] = ff->next;
+            js_free_rt(rt, ff);
+        }
+        rt->frame_cache_count[c] = 0;
+    }
+}
+
 static __exception int async_func_init(JSContext *ctx, JSAsyncFunctionState *s,
                                        JSValueConst func_obj,
                                        JSValueConst this_obj,
@@ -20455,21 +24427,27 @@ static __exception int async_func_init(JSContext *ctx, JSAsyncFunctionState *s,
     JSObject *p;
     JSFunctionBytecode *b;
     JSStackFrame *sf;
-    int local_count, i, arg_buf_len, n;
+    int local_count, i, arg_buf_len, n, frame_size;
     size_t alloc_size;
 
     sf = &s->frame;
     p = JS_VALUE_GET_OBJ(func_obj);
     b = p->u.func.function_bytecode;
+    if (unlikely(b->is_lazy)) {
+        b = js_resolve_lazy_function(ctx, p);
+        if (!b)
+            return -1;
+    }
     sf->is_strict_mode = b->is_strict_mode;
     sf->cur_pc = b->byte_code_buf;
     arg_buf_len = max_int(b->arg_count, argc);
     local_count = arg_buf_len + b->var_count + b->stack_size;
     alloc_size = sizeof(JSValue) * max_int(local_count, 1) +
         sizeof(JSVarRef *) * b->var_ref_count;
-    sf->arg_buf = js_malloc(ctx, alloc_size);
+    sf->arg_buf = js_alloc_frame(ctx, alloc_size, &frame_size);
     if (!sf->arg_buf)
         return -1;
+    s->frame_size = frame_size;
     sf->cur_func = js_dup(func_obj);
     s->this_val = js_dup(this_obj);
     s->argc = argc;
@@ -20478,6 +24456,7 @@ static __exception int async_func_init(JSContext *ctx, JSAsyncFunctionState *s,
     sf->cur_sp = sf->var_buf + b->var_count;
     sf->var_refs = (JSVarRef **)(sf->cur_sp + b->stack_size);
     sf->var_ref_count = b->var_ref_count;
+    sf->var_ref_block = NULL;
     for(i = 0; i < b->var_ref_count; i++)
         sf->var_refs[i] = NULL;
     for(i = 0; i < argc; i++)
@@ -20521,10 +24500,11 @@ static void async_func_free(JSRuntime *rt, JSAsyncFunctionState *s)
 
         /* cannot free the function if it is running */
         assert(sf->cur_sp != NULL);
+        js_direct_enum_free_frame(sf->arg_buf, sf->cur_sp);
         for(sp = sf->arg_buf; sp < sf->cur_sp; sp++) {
             JS_FreeValueRT(rt, *sp);
         }
-        js_free_rt(rt, sf->arg_buf);
+        js_free_frame(rt, sf->arg_buf, s->frame_size);
     }
     JS_FreeValueRT(rt, sf->cur_func);
     JS_FreeValueRT(rt, s->this_val);
@@ -20746,49 +24726,6 @@ static void js_async_function_free(JSRuntime *rt, JSAsyncFunctionData *s)
     }
 }
 
-static void js_async_function_resolve_finalizer(JSRuntime *rt,
-                                                JSValueConst val)
-{
-    JSObject *p = JS_VALUE_GET_OBJ(val);
-    JSAsyncFunctionData *s = p->u.async_function_data;
-    if (s) {
-        js_async_function_free(rt, s);
-    }
-}
-
-static void js_async_function_resolve_mark(JSRuntime *rt, JSValueConst val,
-                                           JS_MarkFunc *mark_func)
-{
-    JSObject *p = JS_VALUE_GET_OBJ(val);
-    JSAsyncFunctionData *s = p->u.async_function_data;
-    if (s) {
-        mark_func(rt, &s->header);
-    }
-}
-
-static int js_async_function_resolve_create(JSContext *ctx,
-                                            JSAsyncFunctionData *s,
-                                            JSValue *resolving_funcs)
-{
-    int i;
-    JSObject *p;
-
-    for(i = 0; i < 2; i++) {
-        resolving_funcs[i] =
-            JS_NewObjectProtoClass(ctx, ctx->function_proto,
-                                   JS_CLASS_ASYNC_FUNCTION_RESOLVE + i);
-        if (JS_IsException(resolving_funcs[i])) {
-            if (i == 1)
-                JS_FreeValue(ctx, resolving_funcs[0]);
-            return -1;
-        }
-        p = JS_VALUE_GET_OBJ(resolving_funcs[i]);
-        s->header.ref_count++;
-        p->u.async_function_data = s;
-    }
-    return 0;
-}
-
 static bool js_async_function_resume(JSContext *ctx, JSAsyncFunctionData *s)
 {
     bool is_success = true;
@@ -20826,31 +24763,29 @@ static bool js_async_function_resume(JSContext *ctx, JSAsyncFunctionData *s)
             JS_FreeValue(ctx, value);
             goto resolved;
         } else {
-            JSValue promise, resolving_funcs[2], resolving_funcs1[2];
-            int i, res;
+            JSValue promise;
+            int res;
 
             /* await */
             JS_FreeValue(ctx, func_ret); /* not used */
-            promise = js_promise_resolve(ctx, ctx->promise_ctor,
-                                         1, vc(&value), 0);
-            JS_FreeValue(ctx, value);
-            if (JS_IsException(promise))
-                goto fail;
-            if (js_async_function_resolve_create(ctx, s, resolving_funcs)) {
+            if (!JS_IsObject(value) && !ctx->rt->promise_hook) {
+                /* no need to create a resolved promise: the function
+                   is resumed by the next job */
+                res = js_enqueue_await_job(ctx, s, value, false);
+                JS_FreeValue(ctx, value);
+            } else {
+                promise = js_promise_resolve(ctx, ctx->promise_ctor,
+                                             1, vc(&value), 0);
+                JS_FreeValue(ctx, value);
+                if (JS_IsException(promise))
+                    goto fail;
+                /* Note: the async function is directly registered as
+                   a reaction of the promise, so there is no need to
+                   create resolving functions nor 'thrownawayCapability'
+                   as in the spec */
+                res = perform_promise_await(ctx, promise, s);
                 JS_FreeValue(ctx, promise);
-                goto fail;
             }
-
-            /* Note: no need to create 'thrownawayCapability' as in
-               the spec */
-            for(i = 0; i < 2; i++)
-                resolving_funcs1[i] = JS_UNDEFINED;
-            res = perform_promise_then(ctx, promise,
-                                       vc(resolving_funcs),
-                                       vc(resolving_funcs1));
-            JS_FreeValue(ctx, promise);
-            for(i = 0; i < 2; i++)
-                JS_FreeValue(ctx, resolving_funcs[i]);
             if (res)
                 goto fail;
         }
@@ -20858,27 +24793,18 @@ static bool js_async_function_resume(JSContext *ctx, JSAsyncFunctionData *s)
     return is_success;
 }
 
-static JSValue js_async_function_resolve_call(JSContext *ctx,
-                                              JSValueConst func_obj,
-                                              JSValueConst this_obj,
-                                              int argc, JSValueConst *argv,
-                                              int flags)
+/* resume the async function 's' suspended by 'await' */
+static JSValue js_async_function_await_resume(JSContext *ctx,
+                                              JSAsyncFunctionData *s,
+                                              JSValueConst value,
+                                              bool is_reject)
 {
-    JSObject *p = JS_VALUE_GET_OBJ(func_obj);
-    JSAsyncFunctionData *s = p->u.async_function_data;
-    bool is_reject = p->class_id - JS_CLASS_ASYNC_FUNCTION_RESOLVE;
-    JSValueConst arg;
-
-    if (argc > 0)
-        arg = argv[0];
-    else
-        arg = JS_UNDEFINED;
     s->func_state.throw_flag = is_reject;
     if (is_reject) {
-        JS_Throw(ctx, js_dup(arg));
+        JS_Throw(ctx, js_dup(value));
     } else {
         /* return value of await */
-        s->func_state.frame.cur_sp[-1] = js_dup(arg);
+        s->func_state.frame.cur_sp[-1] = js_dup(value);
     }
     if (!js_async_function_resume(ctx, s))
         return JS_EXCEPTION;
@@ -21580,6 +25506,15 @@ typedef struct JSFunctionDef {
     bool need_home_object : 1;
     bool use_short_opcodes : 1; /* true if short opcodes are used in byte_code */
     bool has_await : 1; /* true if await is used (used in module eval) */
+    bool is_lazy_compile : 1; /* true if compiled on its first call: the
+                                 closure variables are known before the
+                                 parsing */
+    bool is_iife : 1; /* true if the function is likely called immediately
+                         (function expression in parentheses) */
+    bool in_module : 1; /* true if parsed as module code */
+    bool is_lazy_resolve : 1; /* true if the variables are resolved for a
+                                 lazy function: all the references to the
+                                 enclosing functions are in the closure */
 
     JSFunctionKindEnum func_kind : 8;
     JSParseFunctionEnum func_type : 7;
@@ -21638,6 +25573,8 @@ typedef struct JSFunctionDef {
     int closure_var_size;
     JSClosureVar *closure_var;
 
+    int global_var_cache_count;
+
     JumpSlot *jump_slots;
     int jump_size;
     int jump_count;
@@ -21657,6 +25594,7 @@ typedef struct JSFunctionDef {
 
     char *source;  /* raw source, utf-8 encoded */
     int source_len;
+    int source_col_num; /* column of the start of 'source' */
 
     JSModuleDef *module; /* != NULL when parsing a module */
 } JSFunctionDef;
@@ -21706,6 +25644,7 @@ typedef struct JSParseState {
     JSFunctionDef *cur_func;
     bool is_module; /* parsing a module */
     bool allow_html_comments;
+    bool has_template_object; /* a tagged template was parsed */
 } JSParseState;
 
 typedef struct JSOpCode {
@@ -24031,6 +27970,7 @@ static __exception int js_parse_template(JSParseState *s, int call, int *argc)
     if (call) {
         /* Create a template object: an array of cooked strings */
         /* Create an array of raw strings and store it to the raw property */
+        s->has_template_object = true;
         template_object = JS_NewArray(ctx);
         if (JS_IsException(template_object))
             return -1;
@@ -24499,17 +28439,73 @@ static void set_object_name_computed(JSParseState *s)
     }
 }
 
+/* Convert an object literal whose properties are all plain fields with
+   static names: OP_object becomes OP_object_template, which creates the
+   object with its final shape, and each OP_define_field becomes an
+   OP_define_field_slot storing the value at a fixed index. */
+static __exception int js_emit_object_template(JSParseState *s, int obj_pos,
+                                               const int *field_pos,
+                                               int field_count)
+{
+    JSFunctionDef *fd = s->cur_func;
+    uint8_t *bc_buf;
+    JSAtom atom;
+    JSValue tpl;
+    JSObject *p;
+    int i, j, idx;
+
+    tpl = JS_NewObject(s->ctx);
+    if (JS_IsException(tpl))
+        return -1;
+    bc_buf = fd->byte_code.buf;
+    for(i = 0; i < field_count; i++) {
+        atom = get_u32(bc_buf + field_pos[i] + 1);
+        if (JS_DefinePropertyValue(s->ctx, tpl, atom, JS_UNDEFINED,
+                                   JS_PROP_C_W_E) < 0) {
+            JS_FreeValue(s->ctx, tpl);
+            return -1;
+        }
+    }
+    idx = cpool_add(s, tpl);
+    if (idx < 0) {
+        JS_FreeValue(s->ctx, tpl);
+        return -1;
+    }
+    bc_buf[obj_pos] = OP_object_template;
+    put_u32(bc_buf + obj_pos + 1, idx);
+    /* duplicate names share the slot of the first definition */
+    p = JS_VALUE_GET_OBJ(tpl);
+    for(i = 0; i < field_count; i++) {
+        atom = get_u32(bc_buf + field_pos[i] + 1);
+        for(j = 0; p->shape->prop[j].atom != atom; j++)
+            continue;
+        JS_FreeAtom(s->ctx, atom);
+        bc_buf[field_pos[i]] = OP_define_field_slot;
+        put_u32(bc_buf + field_pos[i] + 1, j);
+    }
+    return 0;
+}
+
 static __exception int js_parse_object_literal(JSParseState *s)
 {
+    JSFunctionDef *fd = s->cur_func;
     JSAtom name = JS_ATOM_NULL;
     const uint8_t *start_ptr;
     int start_line, start_col, prop_type;
     bool has_proto;
+    int obj_pos, field_count, i;
+    int field_pos[JS_SHAPE_MAX_TRANSITION_PROPS];
 
     if (next_token(s))
         goto fail;
-    /* XXX: add an initial length that will be patched back */
+    /* reserve room for OP_object_template: the padding is removed in
+       resolve_labels() if the literal has no template */
     emit_op(s, OP_object);
+    obj_pos = fd->last_opcode_pos;
+    for(i = 0; i < 4; i++)
+        dbuf_putc(&fd->byte_code, OP_nop);
+    /* -1 if the literal cannot use a template */
+    field_count = 0;
     has_proto = false;
     while (s->token.val != '}') {
         /* specific case for getter/setter */
@@ -24518,6 +28514,7 @@ static __exception int js_parse_object_literal(JSParseState *s)
         start_col = s->token.col_num;
 
         if (s->token.val == TOK_ELLIPSIS) {
+            field_count = -1;
             if (next_token(s))
                 return -1;
             if (js_parse_assign_expr(s))
@@ -24539,6 +28536,10 @@ static __exception int js_parse_object_literal(JSParseState *s)
             emit_op(s, OP_scope_get_var);
             emit_atom(s, name);
             emit_u16(s, s->cur_func->scope_level);
+            if (field_count >= 0 && field_count < countof(field_pos))
+                field_pos[field_count++] = fd->byte_code.size;
+            else
+                field_count = -1;
             emit_op(s, OP_define_field);
             emit_atom(s, name);
         } else if (s->token.val == '(') {
@@ -24548,6 +28549,8 @@ static __exception int js_parse_object_literal(JSParseState *s)
             JSFunctionKindEnum func_kind;
             int op_flags;
 
+            /* methods need a home object */
+            field_count = -1;
             func_kind = JS_FUNC_NORMAL;
             if (is_getset) {
                 func_type = JS_PARSE_FUNC_GETTER + prop_type - PROP_TYPE_GET;
@@ -24582,10 +28585,12 @@ static __exception int js_parse_object_literal(JSParseState *s)
             if (js_parse_assign_expr(s))
                 goto fail;
             if (name == JS_ATOM_NULL) {
+                field_count = -1;
                 set_object_name_computed(s);
                 emit_op(s, OP_define_array_el);
                 emit_op(s, OP_drop);
             } else if (name == JS_ATOM___proto__) {
+                field_count = -1;
                 if (has_proto) {
                     js_parse_error(s, "duplicate __proto__ property name");
                     goto fail;
@@ -24594,6 +28599,10 @@ static __exception int js_parse_object_literal(JSParseState *s)
                 has_proto = true;
             } else {
                 set_object_name(s, name);
+                if (field_count >= 0 && field_count < countof(field_pos))
+                    field_pos[field_count++] = fd->byte_code.size;
+                else
+                    field_count = -1;
                 emit_op(s, OP_define_field);
                 emit_atom(s, name);
             }
@@ -24608,6 +28617,10 @@ static __exception int js_parse_object_literal(JSParseState *s)
     }
     if (js_parse_expect(s, '}'))
         goto fail;
+    if (field_count > 0) {
+        if (js_emit_object_template(s, obj_pos, field_pos, field_count))
+            return -1;
+    }
     return 0;
  fail:
     JS_FreeAtom(s->ctx, name);
@@ -25649,6 +29662,10 @@ static void put_lvalue(JSParseState *s, int opcode, int scope,
         /* depth = 2 */
         if (opcode == OP_get_ref_value) {
             JS_FreeAtom(s->ctx, name);
+            /* room for OP_dup before OP_put_var if the reference is
+               a global variable (see optimize_scope_make_global_ref()) */
+            if (special == PUT_LVALUE_KEEP_TOP)
+                emit_op(s, OP_nop);
             emit_label(s, label);
         }
         switch(special) {
@@ -29496,6 +33513,7 @@ static JSModuleDef *js_host_resolve_imported_module(JSContext *ctx,
     JSModuleDef *m;
     char *cname;
     JSAtom module_name;
+    uint64_t start;
 
     if (!rt->normalize_u.module_normalize_func && !rt->normalize_u.module_normalize_func2) {
         cname = js_default_module_normalize_name(ctx, base_cname, cname1);
@@ -29536,11 +33554,13 @@ static JSModuleDef *js_host_resolve_imported_module(JSContext *ctx,
         return NULL;
     }
 
+    start = js_trace_begin(rt);
     if (rt->module_loader_has_attr) {
         m = rt->u.module_loader_func2(ctx, cname, rt->module_loader_opaque, attributes);
     } else {
         m = rt->u.module_loader_func(ctx, cname, rt->module_loader_opaque);
     }
+    js_trace_end(rt, JS_TRACE_LOAD_MODULE, start, cname, 0);
     js_free(ctx, cname);
     return m;
 }
@@ -30042,6 +34062,7 @@ static JSVarRef *js_create_module_var(JSContext *ctx, bool is_lexical)
         var_ref->value = JS_UNDEFINED;
     var_ref->pvalue = &var_ref->value;
     var_ref->is_detached = true;
+    var_ref->is_in_block = false;
     add_gc_object(ctx->rt, &var_ref->header, JS_GC_OBJ_TYPE_VAR_REF);
     return var_ref;
 }
@@ -31864,7 +35885,7 @@ static void dump_byte_code(JSContext *ctx, int pass,
         if (source) {
             if (b) {
                 int col1;
-                line1 = find_line_num(ctx, b, pos, &col1) - line_num + 1;
+                line1 = find_line_num(b, pos, &col1) - line_num + 1;
             } else if (op == OP_source_loc) {
                 line1 = get_u32(tab + pos + 1) - line_num + 1;
             }
@@ -32395,6 +36416,14 @@ static int optimize_scope_make_ref(JSContext *ctx, JSFunctionDef *s,
     return pos_next;
 }
 
+static int new_global_var_cache_idx(JSFunctionDef *s)
+{
+    /* the accesses beyond the limit are not cached */
+    if (s->global_var_cache_count >= JS_GLOBAL_VAR_CACHE_NONE)
+        return JS_GLOBAL_VAR_CACHE_NONE;
+    return s->global_var_cache_count++;
+}
+
 static int optimize_scope_make_global_ref(JSContext *ctx, JSFunctionDef *s,
                                           DynBuf *bc, uint8_t *bc_buf,
                                           LabelSlot *ls, int pos_next,
@@ -32408,6 +36437,7 @@ static int optimize_scope_make_global_ref(JSContext *ctx, JSFunctionDef *s,
     if (bc_buf[pos_next] == OP_get_ref_value) {
         dbuf_putc(bc, OP_get_var);
         dbuf_put_u32(bc, JS_DupAtom(ctx, var_name));
+        dbuf_put_u16(bc, new_global_var_cache_idx(s));
         pos_next++;
     }
     /* remove the OP_label to make room for replacement */
@@ -32418,12 +36448,17 @@ static int optimize_scope_make_global_ref(JSContext *ctx, JSFunctionDef *s,
     assert(bc_buf[pos] == OP_label);
     end_pos = label_pos + 2;
     op = bc_buf[label_pos];
-    if (op == OP_insert3)
+    if (op == OP_insert3) {
+        /* put_lvalue() emitted an OP_nop before the label */
+        pos--;
+        assert(bc_buf[pos] == OP_nop);
         bc_buf[pos++] = OP_dup;
+    }
     bc_buf[pos] = OP_put_var;
     /* XXX: need 2 extra OP_drop if destructuring an array */
     put_u32(bc_buf + pos + 1, JS_DupAtom(ctx, var_name));
-    pos += 5;
+    put_u16(bc_buf + pos + 5, new_global_var_cache_idx(s));
+    pos += 7;
     /* pad with OP_nop */
     while (pos < end_pos)
         bc_buf[pos++] = OP_nop;
@@ -32704,6 +36739,14 @@ static int resolve_scope_var(JSContext *ctx, JSFunctionDef *s,
             if (vd->var_name == var_name) {
                 if (op == OP_scope_put_var || op == OP_scope_make_ref) {
                     if (vd->is_const) {
+                        if (s->is_lazy_resolve) {
+                            /* the lazy function must find the variable
+                               in its closure when it is compiled */
+                            capture_var(fd, vd);
+                            get_closure_var(ctx, s, fd, JS_CLOSURE_LOCAL, idx,
+                                            var_name, true, vd->is_lexical,
+                                            vd->var_kind);
+                        }
                         dbuf_putc(bc, OP_throw_error);
                         dbuf_put_u32(bc, JS_DupAtom(ctx, var_name));
                         dbuf_putc(bc, JS_THROW_VAR_RO);
@@ -32776,10 +36819,11 @@ static int resolve_scope_var(JSContext *ctx, JSFunctionDef *s,
     }
 
     /* check direct eval scope (in the closure of the eval function
-       which is necessarily at the top level) */
+       which is necessarily at the top level). The closure of a lazy
+       function is resolved the same way. */
     if (!fd)
         fd = s;
-    if (var_idx < 0 && fd->is_eval) {
+    if (var_idx < 0 && (fd->is_eval || fd->is_lazy_compile)) {
         int idx1;
         for (idx1 = 0; idx1 < fd->closure_var_count; idx1++) {
             JSClosureVar *cv = &fd->closure_var[idx1];
@@ -32936,16 +36980,19 @@ static int resolve_scope_var(JSContext *ctx, JSFunctionDef *s,
         dbuf_putc(bc, OP_undefined);
         dbuf_putc(bc, OP_get_var);
         dbuf_put_u32(bc, JS_DupAtom(ctx, var_name));
+        dbuf_put_u16(bc, new_global_var_cache_idx(s));
         break;
     case OP_scope_get_var_undef:
     case OP_scope_get_var:
     case OP_scope_put_var:
         dbuf_putc(bc, OP_get_var_undef + (op - OP_scope_get_var_undef));
         dbuf_put_u32(bc, JS_DupAtom(ctx, var_name));
+        dbuf_put_u16(bc, new_global_var_cache_idx(s));
         break;
     case OP_scope_put_var_init:
         dbuf_putc(bc, OP_put_var_init);
         dbuf_put_u32(bc, JS_DupAtom(ctx, var_name));
+        dbuf_put_u16(bc, new_global_var_cache_idx(s));
         break;
     case OP_scope_delete_var:
         dbuf_putc(bc, OP_delete_var);
@@ -33666,6 +37713,7 @@ static void instantiate_hoisted_definitions(JSContext *ctx, JSFunctionDef *s, Dy
                 /* XXX: Check if variable is writable and enumerable */
                 dbuf_putc(bc, OP_put_var);
                 dbuf_put_u32(bc, JS_DupAtom(ctx, hf->var_name));
+                dbuf_put_u16(bc, new_global_var_cache_idx(s));
             }
         }
     done_global_var:
@@ -34331,6 +38379,137 @@ static void put_short_code(DynBuf *bc_out, int op, int idx)
     dbuf_put_u16(bc_out, idx);
 }
 
+/* Return the position of the get_array_el which ends the property
+   access starting at 'pos' with the object already on the stack, or
+   -1 if the property expression is not straight line code. */
+static int find_arguments_el(JSFunctionDef *s, int pos)
+{
+    const uint8_t *bc_buf = s->byte_code.buf;
+    int bc_len = s->byte_code.size;
+    int op, n_pop, depth;
+    const JSOpCode *oi;
+
+    depth = 0;
+    while (pos < bc_len) {
+        op = bc_buf[pos];
+        oi = &opcode_info[op];
+        switch(oi->fmt) {
+        case OP_FMT_label:
+        case OP_FMT_label_u16:
+        case OP_FMT_atom_label_u8:
+        case OP_FMT_atom_label_u16:
+        case OP_FMT_npop_u16:
+            return -1;
+        case OP_FMT_npop:
+            n_pop = oi->n_pop + get_u16(bc_buf + pos + 1);
+            break;
+        default:
+            n_pop = oi->n_pop;
+            break;
+        }
+        switch(op) {
+        case OP_return:
+        case OP_return_undef:
+        case OP_return_async:
+        case OP_throw:
+        case OP_throw_error:
+        case OP_ret:
+            return -1;
+        case OP_get_array_el:
+            if (depth == 1)
+                return pos;
+            break;
+        default:
+            break;
+        }
+        if (n_pop > depth)
+            return -1;
+        depth += oi->n_push - n_pop;
+        pos += oi->size;
+    }
+    return -1;
+}
+
+/* Replace the uses of the 'arguments' variable which do not let the
+   object escape ('arguments.length', 'arguments[i]' and
+   'f.apply(this_arg, arguments)') by opcodes which read the arguments
+   of the frame while the variable is still undefined. Return true if
+   the arguments object no longer needs to be built on entry: it is
+   then only built, and stored in the variable, if an access cannot be
+   done on the frame. */
+static bool optimize_arguments(JSContext *ctx, JSFunctionDef *s)
+{
+    uint8_t *bc_buf = s->byte_code.buf;
+    int bc_len = s->byte_code.size;
+    int pass, pos, pos_next, pos1, op, i, idx;
+    bool is_mapped;
+
+    idx = s->arguments_var_idx;
+    if (s->func_kind != JS_FUNC_NORMAL || s->arguments_arg_idx >= 0 ||
+        s->has_eval_call || s->var_object_idx >= 0 ||
+        s->arg_var_object_idx >= 0 || s->vars[idx].is_captured)
+        return false;
+    /* the arguments must not be modified by closures: the values are
+       read from the frame and may be passed as argv to apply targets */
+    for(i = 0; i < s->arg_count; i++) {
+        if (s->args[i].is_captured)
+            return false;
+    }
+    /* the unmapped arguments object holds the initial values of the
+       arguments, so they must not be modified at all */
+    is_mapped = !s->is_strict_mode && s->has_simple_parameter_list;
+    /* the first pass checks all the uses, the second one rewrites them */
+    for(pass = 0; pass < 2; pass++) {
+        for(pos = 0; pos < bc_len; pos = pos_next) {
+            op = bc_buf[pos];
+            pos_next = pos + opcode_info[op].size;
+            switch(opcode_info[op].fmt) {
+            case OP_FMT_arg:
+                if (!is_mapped && op != OP_get_arg)
+                    return false;
+                continue;
+            case OP_FMT_loc:
+                if (get_u16(bc_buf + pos + 1) != idx)
+                    continue;
+                break;
+            case OP_FMT_atom_u16:
+                if (op == OP_make_arg_ref && !is_mapped)
+                    return false;
+                if (op == OP_make_loc_ref && get_u16(bc_buf + pos + 5) == idx)
+                    return false;
+                continue;
+            default:
+                continue;
+            }
+            if (op != OP_get_loc)
+                return false;
+            if (bc_buf[pos_next] == OP_get_field &&
+                get_u32(bc_buf + pos_next + 1) == JS_ATOM_length) {
+                if (pass) {
+                    bc_buf[pos_next] = OP_get_arguments_length;
+                    memset(bc_buf + pos_next + 1, OP_nop, 4);
+                }
+            } else if (bc_buf[pos_next] == OP_call_method &&
+                       get_u16(bc_buf + pos_next + 1) == 2) {
+                if (pass) {
+                    bc_buf[pos_next] = OP_apply_arguments;
+                    put_u16(bc_buf + pos_next + 1, idx);
+                }
+                pos_next += opcode_info[OP_call_method].size;
+            } else {
+                pos1 = find_arguments_el(s, pos_next);
+                if (pos1 < 0)
+                    return false;
+                if (pass) {
+                    bc_buf[pos] = OP_get_loc_arguments;
+                    bc_buf[pos1] = OP_get_arguments_el;
+                }
+            }
+        }
+    }
+    return true;
+}
+
 /* peephole optimizations and resolve goto/labels */
 static __exception int resolve_labels(JSContext *ctx, JSFunctionDef *s)
 {
@@ -34398,20 +38577,27 @@ static __exception int resolve_labels(JSContext *ctx, JSFunctionDef *s)
     }
     /* initialize the 'arguments' variable if needed */
     if (s->arguments_var_idx >= 0) {
+        bool is_lazy = optimize_arguments(ctx, s);
         if (s->is_strict_mode || !s->has_simple_parameter_list) {
-            dbuf_putc(&bc_out, OP_special_object);
-            dbuf_putc(&bc_out, OP_SPECIAL_OBJECT_ARGUMENTS);
+            if (!is_lazy) {
+                dbuf_putc(&bc_out, OP_special_object);
+                dbuf_putc(&bc_out, OP_SPECIAL_OBJECT_ARGUMENTS);
+            }
         } else {
             /* mapped arguments need all args to be captured */
             for (i = 0; i < s->arg_count; i++) {
                 capture_var(s, &s->args[i]);
             }
-            dbuf_putc(&bc_out, OP_special_object);
-            dbuf_putc(&bc_out, OP_SPECIAL_OBJECT_MAPPED_ARGUMENTS);
+            if (!is_lazy) {
+                dbuf_putc(&bc_out, OP_special_object);
+                dbuf_putc(&bc_out, OP_SPECIAL_OBJECT_MAPPED_ARGUMENTS);
+            }
+        }
+        if (!is_lazy) {
+            if (s->arguments_arg_idx >= 0)
+                put_short_code(&bc_out, OP_set_loc, s->arguments_arg_idx);
+            put_short_code(&bc_out, OP_put_loc, s->arguments_var_idx);
         }
-        if (s->arguments_arg_idx >= 0)
-            put_short_code(&bc_out, OP_set_loc, s->arguments_arg_idx);
-        put_short_code(&bc_out, OP_put_loc, s->arguments_var_idx);
     }
     /* initialize a reference to the current function if needed */
     if (s->func_var_idx >= 0) {
@@ -34445,6 +38631,10 @@ static __exception int resolve_labels(JSContext *ctx, JSFunctionDef *s)
             col_num = get_u32(bc_buf + pos + 5);
             break;
 
+        case OP_nop:
+            /* remove the code erased by optimize_arguments() */
+            break;
+
         case OP_label:
             {
                 label = get_u32(bc_buf + pos + 1);
@@ -35126,6 +39316,9 @@ static __exception int resolve_labels(JSContext *ctx, JSFunctionDef *s)
             goto no_change;
 
         case OP_object:
+            /* skip the unused OP_object_template padding */
+            while (pos_next < bc_len && bc_buf[pos_next] == OP_nop)
+                pos_next++;
             if (code_match(&cc, pos_next, OP_null, OP_set_proto, -1)) {
                 if (cc.line_num >= 0) line_num = cc.line_num;
                 if (cc.col_num >= 0) col_num = cc.col_num;
@@ -35542,16 +39735,11 @@ static int add_module_variables(JSContext *ctx, JSFunctionDef *fd)
 /* create a function object from a function definition. The function
    definition is freed. All the child functions are also created. It
    must be done this way to resolve all the variables. */
-static JSValue js_create_function(JSContext *ctx, JSFunctionDef *fd)
+/* recompute scope linkage */
+static void link_scopes(JSFunctionDef *fd)
 {
-    JSValue func_obj;
-    JSFunctionBytecode *b;
-    struct list_head *el, *el1;
-    int stack_size, scope, idx;
-    int function_size, byte_code_offset, cpool_offset;
-    int closure_var_offset, vardefs_offset;
+    int scope, idx;
 
-    /* recompute scope linkage */
     for (scope = 0; scope < fd->scope_count; scope++) {
         fd->scopes[scope].first = -1;
     }
@@ -35576,6 +39764,155 @@ static JSValue js_create_function(JSContext *ctx, JSFunctionDef *fd)
             vd->scope_next = fd->scopes[scope].first;
         }
     }
+}
+
+/* return true if the function or one of its children contains a direct
+   eval call */
+static bool has_eval_call_rec(JSFunctionDef *fd)
+{
+    struct list_head *el;
+
+    if (fd->has_eval_call)
+        return true;
+    list_for_each(el, &fd->child_list) {
+        if (has_eval_call_rec(list_entry(el, JSFunctionDef, link)))
+            return true;
+    }
+    return false;
+}
+
+/* Return true if the bytecode generation of the function can be
+   deferred to its first call. The function is then parsed again as a
+   top level function whose closure variables are resolved by name, so
+   the enclosing scopes must not contain 'with' objects, direct eval
+   variable objects or private names. */
+static bool can_compile_lazily(JSFunctionDef *fd)
+{
+    JSFunctionDef *fd1;
+    JSVarDef *vd;
+    int idx, scope_level;
+
+    if (!fd->parent || fd->is_iife || !fd->source)
+        return false;
+    if (fd->func_type != JS_PARSE_FUNC_STATEMENT &&
+        fd->func_type != JS_PARSE_FUNC_VAR &&
+        fd->func_type != JS_PARSE_FUNC_EXPR)
+        return false;
+    /* 'export default function () {}' */
+    if (!fd->is_func_expr && fd->func_name == JS_ATOM_NULL)
+        return false;
+    if (has_eval_call_rec(fd))
+        return false;
+    for (fd1 = fd; fd1->parent;) {
+        scope_level = fd1->parent_scope_level;
+        fd1 = fd1->parent;
+        if (fd1->has_eval_call)
+            return false;
+        for (idx = fd1->scopes[scope_level].first; idx >= 0;
+             idx = vd->scope_next) {
+            vd = &fd1->vars[idx];
+            if (vd->var_name == JS_ATOM__with_ ||
+                vd->var_kind >= JS_VAR_PRIVATE_FIELD)
+                return false;
+        }
+    }
+    for (idx = 0; idx < fd1->closure_var_count; idx++) {
+        JSClosureVar *cv = &fd1->closure_var[idx];
+        if (cv->var_name == JS_ATOM__with_ ||
+            cv->var_name == JS_ATOM__var_ ||
+            cv->var_name == JS_ATOM__arg_var_ ||
+            cv->var_kind >= JS_VAR_PRIVATE_FIELD)
+            return false;
+    }
+    return true;
+}
+
+/* Resolve the variables of a function defined inside a lazy function so
+   that the closure variables of the lazy function are complete. No
+   bytecode is generated and 'fd' is freed. */
+static int resolve_lazy_child_variables(JSContext *ctx, JSFunctionDef *fd)
+{
+    struct list_head *el, *el1;
+    int ret;
+
+    link_scopes(fd);
+    fd->is_lazy_resolve = true;
+    ret = 0;
+    list_for_each_safe(el, el1, &fd->child_list) {
+        ret = resolve_lazy_child_variables(ctx, list_entry(el, JSFunctionDef,
+                                                           link));
+        if (ret)
+            break;
+    }
+    if (!ret)
+        ret = resolve_variables(ctx, fd);
+    js_free_function_def(ctx, fd);
+    return ret;
+}
+
+/* create the bytecode object of a lazy function: only the closure
+   variables, the source code and the properties of the function
+   objects are kept. */
+static JSValue js_create_lazy_function(JSContext *ctx, JSFunctionDef *fd)
+{
+    JSFunctionBytecode *b;
+
+    b = js_mallocz(ctx, sizeof(*b) +
+                   fd->closure_var_count * sizeof(*fd->closure_var));
+    if (!b) {
+        js_free_function_def(ctx, fd);
+        return JS_EXCEPTION;
+    }
+    b->header.ref_count = 1;
+    b->func_name = fd->func_name;
+    fd->func_name = JS_ATOM_NULL;
+    b->defined_arg_count = fd->defined_arg_count;
+    b->closure_var_count = fd->closure_var_count;
+    if (b->closure_var_count) {
+        b->closure_var = (void *)(b + 1);
+        memcpy(b->closure_var, fd->closure_var,
+               b->closure_var_count * sizeof(*b->closure_var));
+        fd->closure_var_count = 0;
+    }
+    b->filename = fd->filename;
+    fd->filename = JS_ATOM_NULL;
+    b->line_num = fd->line_num;
+    b->col_num = fd->col_num;
+    b->lazy_source_col_num = fd->source_col_num;
+    b->source = fd->source;
+    b->source_len = fd->source_len;
+    fd->source = NULL;
+
+    b->has_prototype = fd->has_prototype;
+    b->has_simple_parameter_list = fd->has_simple_parameter_list;
+    b->is_strict_mode = fd->is_strict_mode;
+    b->func_kind = fd->func_kind;
+    b->new_target_allowed = fd->new_target_allowed;
+    b->super_call_allowed = fd->super_call_allowed;
+    b->super_allowed = fd->super_allowed;
+    b->arguments_allowed = fd->arguments_allowed;
+    b->is_lazy = true;
+    b->is_lazy_func_expr = fd->is_func_expr;
+    b->is_lazy_module = fd->in_module;
+    b->realm = JS_DupContext(ctx);
+
+    add_gc_object(ctx->rt, &b->header, JS_GC_OBJ_TYPE_FUNCTION_BYTECODE);
+
+    js_free_function_def(ctx, fd);
+    return JS_MKPTR(JS_TAG_FUNCTION_BYTECODE, b);
+}
+
+static JSValue js_create_function(JSContext *ctx, JSFunctionDef *fd)
+{
+    JSValue func_obj;
+    JSFunctionBytecode *b;
+    struct list_head *el, *el1;
+    int stack_size;
+    int function_size, byte_code_offset, cpool_offset;
+    int closure_var_offset, vardefs_offset;
+    bool is_lazy;
+
+    link_scopes(fd);
 
     /* if the function contains an eval call, the closure variables
        are used to compile the eval and they must be ordered by scope,
@@ -35592,12 +39929,21 @@ static JSValue js_create_function(JSContext *ctx, JSFunctionDef *fd)
             goto fail;
     }
 
+    is_lazy = can_compile_lazily(fd);
+    fd->is_lazy_resolve = is_lazy;
+
     /* first create all the child functions */
     list_for_each_safe(el, el1, &fd->child_list) {
         JSFunctionDef *fd1;
         int cpool_idx;
 
         fd1 = list_entry(el, JSFunctionDef, link);
+        if (is_lazy) {
+            /* the children are compiled with the lazy function */
+            if (resolve_lazy_child_variables(ctx, fd1))
+                goto fail;
+            continue;
+        }
         cpool_idx = fd1->parent_cpool_idx;
         func_obj = js_create_function(ctx, fd1);
         if (JS_IsException(func_obj))
@@ -35622,6 +39968,9 @@ static JSValue js_create_function(JSContext *ctx, JSFunctionDef *fd)
     if (resolve_variables(ctx, fd))
         goto fail;
 
+    if (is_lazy)
+        return js_create_lazy_function(ctx, fd);
+
 #ifdef ENABLE_DUMPS // JS_DUMP_BYTECODE_PASS2
     if (check_dump_flag(ctx->rt, JS_DUMP_BYTECODE_PASS2)) {
         printf("pass 2\n");
@@ -35703,6 +40052,7 @@ static JSValue js_create_function(JSContext *ctx, JSFunctionDef *fd)
     if (fd->scopes != fd->def_scope_array)
         js_free(ctx, fd->scopes);
 
+    b->global_var_cache_count = fd->global_var_cache_count;
     b->closure_var_count = fd->closure_var_count;
     if (b->closure_var_count) {
         b->closure_var = (void *)((uint8_t*)b + closure_var_offset);
@@ -35767,9 +40117,12 @@ static void free_function_bytecode(JSRuntime *rt, JSFunctionBytecode *b)
     }
     if (b->realm)
         JS_FreeContext(b->realm);
+    if (b->lazy_bytecode)
+        JS_FreeValueRT(rt, JS_MKPTR(JS_TAG_FUNCTION_BYTECODE, b->lazy_bytecode));
 
     JS_FreeAtomRT(rt, b->func_name);
     JS_FreeAtomRT(rt, b->filename);
+    js_free_rt(rt, b->global_var_cache);
     js_free_rt(rt, b->pc2line_buf);
     js_free_rt(rt, b->source);
 
@@ -36095,6 +40448,18 @@ static __exception int js_parse_function_decl2(JSParseState *s,
         *pfd = fd;
     s->cur_func = fd;
     fd->func_name = func_name;
+    fd->in_module = s->is_module;
+    fd->source_col_num = ptr - s->eol;
+    if (func_type == JS_PARSE_FUNC_EXPR) {
+        /* a function expression in parentheses is usually called
+           immediately, so it is not compiled lazily */
+        const uint8_t *p = ptr;
+        while (p > s->buf_start &&
+               (p[-1] == ' ' || p[-1] == '\t' ||
+                p[-1] == '\n' || p[-1] == '\r'))
+            p--;
+        fd->is_iife = (p > s->buf_start && p[-1] == '(');
+    }
     /* XXX: test !fd->is_generator is always false */
     fd->has_prototype = (func_type == JS_PARSE_FUNC_STATEMENT ||
                          func_type == JS_PARSE_FUNC_VAR ||
@@ -36648,13 +41013,164 @@ static JSValue JS_EvalFunctionInternal(JSContext *ctx, JSValue fun_obj,
 
 JSValue JS_EvalFunction(JSContext *ctx, JSValue fun_obj)
 {
-    return JS_EvalFunctionInternal(ctx, fun_obj, ctx->global_obj, NULL, NULL);
+    JSValue ret;
+    uint64_t start;
+
+    start = js_trace_begin(ctx->rt);
+    ret = JS_EvalFunctionInternal(ctx, fun_obj, ctx->global_obj, NULL, NULL);
+    js_trace_end(ctx->rt, JS_TRACE_EVAL_FUNCTION, start, NULL, 0);
+    return ret;
 }
 
 #ifndef QJS_DISABLE_PARSER
 
+/* Generate the bytecode of a lazy function by parsing its source code
+   again. Its free variables are resolved with the closure variables of
+   the lazy function, so the function objects already created from it
+   keep valid variable references. */
+static void js_trace_lazy_end(JSRuntime *rt, JSFunctionBytecode *lb,
+                              uint64_t start)
+{
+    char buf[ATOM_GET_STR_BUF_SIZE];
+
+    if (start != 0) {
+        js_trace_end(rt, JS_TRACE_COMPILE_LAZY, start,
+                     JS_AtomGetStrRT(rt, buf, sizeof(buf), lb->func_name), 0);
+    }
+}
+
+static JSFunctionBytecode *js_compile_lazy_function(JSContext *ctx,
+                                                    JSFunctionBytecode *lb)
+{
+    JSParseState s1, *s = &s1;
+    JSFunctionDef *top, *fd;
+    JSFunctionBytecode *b;
+    JSValue func_obj;
+    const char *filename;
+    uint64_t start;
+    int i;
+
+    start = js_trace_begin(ctx->rt);
+    filename = JS_AtomToCString(ctx, lb->filename);
+    if (!filename)
+        return NULL;
+    js_parse_init(ctx, s, lb->source, lb->source_len, filename, lb->line_num);
+    /* the source code does not start at the first column: restore the
+       tokenizer state so that the same column numbers are computed */
+    s->eol = s->buf_ptr - lb->lazy_source_col_num;
+    s->mark = s->eol + lb->col_num;
+    s->is_module = lb->is_lazy_module;
+    s->allow_html_comments = !s->is_module;
+
+    /* dummy parent function */
+    top = js_new_function_def(ctx, NULL, false, false, filename,
+                              lb->line_num, lb->col_num);
+    if (!top)
+        goto fail;
+    top->is_strict_mode = lb->is_strict_mode;
+    s->cur_func = top;
+    fd = NULL;
+    if (next_token(s) ||
+        js_parse_function_decl2(s, lb->is_lazy_func_expr ?
+                                JS_PARSE_FUNC_EXPR : JS_PARSE_FUNC_STATEMENT,
+                                JS_FUNC_NORMAL, JS_ATOM_NULL, s->token.ptr,
+                                s->token.line_num, s->token.col_num,
+                                JS_PARSE_EXPORT_NONE, &fd)) {
+        free_token(s, &s->token);
+        js_free_function_def(ctx, top);
+        goto fail;
+    }
+    free_token(s, &s->token);
+
+    /* compile it as a top level function */
+    list_del(&fd->link);
+    fd->parent = NULL;
+    js_free_function_def(ctx, top);
+    fd->is_lazy_compile = true;
+    if (lb->closure_var_count) {
+        fd->closure_var = js_malloc(ctx, sizeof(fd->closure_var[0]) *
+                                    lb->closure_var_count);
+        if (!fd->closure_var) {
+            js_free_function_def(ctx, fd);
+            goto fail;
+        }
+        fd->closure_var_size = lb->closure_var_count;
+        for (i = 0; i < lb->closure_var_count; i++) {
+            fd->closure_var[i] = lb->closure_var[i];
+            JS_DupAtom(ctx, lb->closure_var[i].var_name);
+        }
+        fd->closure_var_count = lb->closure_var_count;
+    }
+    func_obj = js_create_function(ctx, fd);
+    if (JS_IsException(func_obj))
+        goto fail;
+    b = JS_VALUE_GET_PTR(func_obj);
+    if (b->closure_var_count != lb->closure_var_count) {
+        /* should never happen */
+        JS_FreeValue(ctx, func_obj);
+        JS_ThrowInternalError(ctx, "inconsistent lazy function closure");
+        goto fail;
+    }
+    JS_FreeCString(ctx, filename);
+    js_trace_lazy_end(ctx->rt, lb, start);
+    return b;
+ fail:
+    JS_FreeCString(ctx, filename);
+    js_trace_lazy_end(ctx->rt, lb, start);
+    return NULL;
+}
+
 /* 'input' must be zero terminated i.e. input[input_len] = '\0'. */
 /* `export_name` and `input` may be pure ASCII or UTF-8 encoded */
+/* The code compiled by the indirect eval and Function constructor
+   calls does not depend on the caller, so it is kept in a per context
+   cache indexed by the source. A hit only creates a new closure. The
+   code containing tagged templates is not kept because each evaluation
+   must create new template objects. */
+static JSValue js_eval_cache_find(JSContext *ctx, const char *input,
+                                  size_t input_len, int flags, uint32_t hash)
+{
+    struct list_head *el;
+    JSEvalCacheEntry *e;
+
+    list_for_each(el, &ctx->eval_cache_list) {
+        e = list_entry(el, JSEvalCacheEntry, link);
+        if (e->hash == hash && e->len == input_len && e->flags == flags &&
+            !memcmp(e->source, input, input_len)) {
+            /* move to the most recently used position */
+            list_del(&e->link);
+            list_add_tail(&e->link, &ctx->eval_cache_list);
+            ctx->eval_cache_hit_count++;
+            return js_dup(e->func_obj);
+        }
+    }
+    ctx->eval_cache_miss_count++;
+    return JS_UNDEFINED;
+}
+
+static void js_eval_cache_add(JSContext *ctx, const char *input,
+                              size_t input_len, int flags, uint32_t hash,
+                              JSValueConst func_obj)
+{
+    JSEvalCacheEntry *e;
+
+    /* no exception is raised if the entry cannot be allocated */
+    e = js_malloc_rt(ctx->rt, sizeof(*e) + input_len);
+    if (!e)
+        return;
+    e->func_obj = js_dup(func_obj);
+    e->hash = hash;
+    e->flags = flags;
+    e->len = input_len;
+    memcpy(e->source, input, input_len);
+    list_add_tail(&e->link, &ctx->eval_cache_list);
+    ctx->eval_cache_count++;
+    if (ctx->eval_cache_count > JS_EVAL_CACHE_SIZE) {
+        js_eval_cache_remove(ctx, list_entry(ctx->eval_cache_list.next,
+                                             JSEvalCacheEntry, link));
+    }
+}
+
 static JSValue __JS_EvalInternal(JSContext *ctx, JSValueConst this_obj,
                                  const char *input, size_t input_len,
                                  const char *filename, int line, int flags, int scope_idx)
@@ -36667,12 +41183,28 @@ static JSValue __JS_EvalInternal(JSContext *ctx, JSValueConst this_obj,
     JSFunctionBytecode *b;
     JSFunctionDef *fd;
     JSModuleDef *m;
-    bool is_strict_mode;
+    bool is_strict_mode, use_cache;
+    uint32_t hash;
+    uint64_t start;
 
+    eval_type = flags & JS_EVAL_TYPE_MASK;
+    use_cache = (eval_type == JS_EVAL_TYPE_INDIRECT &&
+                 input_len <= JS_EVAL_CACHE_MAX_SOURCE_LEN);
+    hash = 0;
+    if (use_cache) {
+        hash = hash_string8((const uint8_t *)input, input_len, flags);
+        fun_obj = js_eval_cache_find(ctx, input, input_len, flags, hash);
+        if (!JS_IsUndefined(fun_obj)) {
+            if (flags & JS_EVAL_FLAG_COMPILE_ONLY)
+                return fun_obj;
+            return JS_EvalFunctionInternal(ctx, fun_obj, this_obj, NULL, NULL);
+        }
+    }
+
+    start = js_trace_begin(ctx->rt);
     js_parse_init(ctx, s, input, input_len, filename, line);
     skip_shebang(&s->buf_ptr, s->buf_end);
 
-    eval_type = flags & JS_EVAL_TYPE_MASK;
     m = NULL;
     if (eval_type == JS_EVAL_TYPE_DIRECT) {
         JSObject *p;
@@ -36739,6 +41271,7 @@ static JSValue __JS_EvalInternal(JSContext *ctx, JSValueConst this_obj,
     fail:
         free_token(s, &s->token);
         js_free_function_def(ctx, fd);
+        js_trace_end(ctx->rt, JS_TRACE_COMPILE, start, filename, 0);
         goto fail1;
     }
 
@@ -36747,8 +41280,11 @@ static JSValue __JS_EvalInternal(JSContext *ctx, JSValueConst this_obj,
 
     /* create the function object and all the enclosed functions */
     fun_obj = js_create_function(ctx, fd);
+    js_trace_end(ctx->rt, JS_TRACE_COMPILE, start, filename, 0);
     if (JS_IsException(fun_obj))
         goto fail1;
+    if (use_cache && !s->has_template_object)
+        js_eval_cache_add(ctx, input, input_len, flags, hash, fun_obj);
     /* Could add a flag to avoid resolution if necessary */
     if (m) {
         m->func_obj = fun_obj;
@@ -36837,11 +41373,14 @@ JSValue JS_EvalThis2(JSContext *ctx, JSValueConst this_obj,
         eval_flags = options->eval_flags;
     }
     JSValue ret;
+    uint64_t start;
 
     assert((eval_flags & JS_EVAL_TYPE_MASK) == JS_EVAL_TYPE_GLOBAL ||
            (eval_flags & JS_EVAL_TYPE_MASK) == JS_EVAL_TYPE_MODULE);
+    start = js_trace_begin(ctx->rt);
     ret = JS_EvalInternal(ctx, this_obj, input, input_len, filename, line,
                           eval_flags, -1);
+    js_trace_end(ctx->rt, JS_TRACE_EVAL, start, filename, 0);
     return ret;
 }
 
@@ -37005,9 +41544,10 @@ typedef enum BCTagEnum {
     BC_TAG_MAP,
     BC_TAG_SET,
     BC_TAG_SYMBOL,
+    BC_TAG_LAZY_FUNCTION_BYTECODE,
 } BCTagEnum;
 
-#define BC_VERSION 23
+#define BC_VERSION 28
 
 typedef struct BCWriterState {
     JSContext *ctx;
@@ -37056,6 +41596,7 @@ static const char * const bc_tag_str[] = {
     "Map",
     "Set",
     "Symbol",
+    "lazy function",
 };
 
 static const char *bc_tag_name(uint8_t tag)
@@ -37329,12 +41870,74 @@ static int JS_WriteBigInt(BCWriterState *s, JSValueConst obj)
 
 static int JS_WriteObjectRec(BCWriterState *s, JSValueConst obj);
 
+static void JS_WriteClosureVars(BCWriterState *s, JSFunctionBytecode *b)
+{
+    uint32_t flags;
+    int idx, i;
+
+    for(i = 0; i < b->closure_var_count; i++) {
+        JSClosureVar *cv = &b->closure_var[i];
+        bc_put_atom(s, cv->var_name);
+        bc_put_leb128(s, cv->var_idx);
+        flags = idx = 0;
+        bc_set_flags(&flags, &idx, cv->closure_type, 3);
+        bc_set_flags(&flags, &idx, cv->is_const, 1);
+        bc_set_flags(&flags, &idx, cv->is_lexical, 1);
+        bc_set_flags(&flags, &idx, cv->var_kind, 4);
+        assert(idx <= 16);
+        bc_put_leb128(s, flags);
+    }
+}
+
+/* a lazy function which was not called yet is written as is: only its
+   closure variables, its properties and its source code */
+static void JS_WriteLazyFunctionTag(BCWriterState *s, JSFunctionBytecode *b)
+{
+    uint32_t flags;
+    int idx;
+
+    bc_put_u8(s, BC_TAG_LAZY_FUNCTION_BYTECODE);
+    flags = idx = 0;
+    bc_set_flags(&flags, &idx, b->has_prototype, 1);
+    bc_set_flags(&flags, &idx, b->has_simple_parameter_list, 1);
+    bc_set_flags(&flags, &idx, b->func_kind, 2);
+    bc_set_flags(&flags, &idx, b->new_target_allowed, 1);
+    bc_set_flags(&flags, &idx, b->super_call_allowed, 1);
+    bc_set_flags(&flags, &idx, b->super_allowed, 1);
+    bc_set_flags(&flags, &idx, b->arguments_allowed, 1);
+    bc_set_flags(&flags, &idx, b->is_strict_mode, 1);
+    bc_set_flags(&flags, &idx, b->is_lazy_func_expr, 1);
+    bc_set_flags(&flags, &idx, b->is_lazy_module, 1);
+    assert(idx <= 16);
+    bc_put_u16(s, flags);
+    bc_put_atom(s, b->func_name);
+    bc_put_leb128(s, b->defined_arg_count);
+    bc_put_leb128(s, b->closure_var_count);
+    JS_WriteClosureVars(s, b);
+    bc_put_atom(s, b->filename);
+    bc_put_leb128(s, b->line_num);
+    bc_put_leb128(s, b->col_num);
+    bc_put_leb128(s, b->lazy_source_col_num);
+    bc_put_leb128(s, b->source_len);
+    dbuf_put(&s->dbuf, b->source, b->source_len);
+}
+
 static int JS_WriteFunctionTag(BCWriterState *s, JSValueConst obj)
 {
     JSFunctionBytecode *b = JS_VALUE_GET_PTR(obj);
     uint32_t flags;
     int idx, i;
 
+    if (b->is_lazy) {
+        /* the source code is necessary to compile it */
+        if (!b->lazy_bytecode && s->allow_source && s->allow_debug) {
+            JS_WriteLazyFunctionTag(s, b);
+            return 0;
+        }
+        b = js_get_lazy_bytecode(s->ctx, b);
+        if (!b)
+            return -1;
+    }
     bc_put_u8(s, BC_TAG_FUNCTION_BYTECODE);
     flags = idx = 0;
     bc_set_flags(&flags, &idx, b->has_prototype, 1);
@@ -37359,6 +41962,7 @@ static int JS_WriteFunctionTag(BCWriterState *s, JSValueConst obj)
     bc_put_leb128(s, b->stack_size);
     bc_put_leb128(s, b->var_ref_count);
     bc_put_leb128(s, b->closure_var_count);
+    bc_put_leb128(s, b->global_var_cache_count);
     bc_put_leb128(s, b->cpool_count);
     bc_put_leb128(s, b->byte_code_len);
     if (b->vardefs) {
@@ -37383,18 +41987,7 @@ static int JS_WriteFunctionTag(BCWriterState *s, JSValueConst obj)
         bc_put_leb128(s, 0);
     }
 
-    for(i = 0; i < b->closure_var_count; i++) {
-        JSClosureVar *cv = &b->closure_var[i];
-        bc_put_atom(s, cv->var_name);
-        bc_put_leb128(s, cv->var_idx);
-        flags = idx = 0;
-        bc_set_flags(&flags, &idx, cv->closure_type, 3);
-        bc_set_flags(&flags, &idx, cv->is_const, 1);
-        bc_set_flags(&flags, &idx, cv->is_lexical, 1);
-        bc_set_flags(&flags, &idx, cv->var_kind, 4);
-        assert(idx <= 16);
-        bc_put_leb128(s, flags);
-    }
+    JS_WriteClosureVars(s, b);
 
     // write constant pool before code so code can be disassembled
     // on the fly at read time
@@ -38267,6 +42860,45 @@ static int BC_add_object_ref(BCReaderState *s, JSValue obj)
     return BC_add_object_ref1(s, JS_VALUE_GET_OBJ(obj));
 }
 
+static int JS_ReadClosureVars(BCReaderState *s, JSFunctionBytecode *b)
+{
+    int idx, i;
+
+    if (b->closure_var_count != 0) {
+        bc_read_trace(s, "closure vars {\n");
+        bc_read_trace(s, "off  flags idx  name\n");
+        for(i = 0; i < b->closure_var_count; i++) {
+            JSClosureVar *cv = &b->closure_var[i];
+            int var_idx, flags;
+            if (bc_get_atom(s, &cv->var_name))
+                return -1;
+            if (bc_get_leb128_int(s, &var_idx))
+                return -1;
+            cv->var_idx = var_idx;
+            if (bc_get_leb128_int(s, &flags))
+                return -1;
+            idx = 0;
+            cv->closure_type = bc_get_flags(flags, &idx, 3);
+            cv->is_const = bc_get_flags(flags, &idx, 1);
+            cv->is_lexical = bc_get_flags(flags, &idx, 1);
+            cv->var_kind = bc_get_flags(flags, &idx, 4);
+#ifdef ENABLE_DUMPS // JS_DUMP_READ_OBJECT
+            if (check_dump_flag(s->ctx->rt, JS_DUMP_READ_OBJECT)) {
+                bc_read_trace(s, "%3d  %d:%d%c%c %3d  ",
+                              i, cv->var_kind, cv->closure_type,
+                              cv->is_const ? 'C' : '.',
+                              cv->is_lexical ? 'X' : '.',
+                              cv->var_idx);
+                print_atom(s->ctx, cv->var_name);
+                printf("\n");
+            }
+#endif
+        }
+        bc_read_trace(s, "}\n");
+    }
+    return 0;
+}
+
 static JSValue JS_ReadFunctionTag(BCReaderState *s)
 {
     JSContext *ctx = s->ctx;
@@ -38313,6 +42945,8 @@ static JSValue JS_ReadFunctionTag(BCReaderState *s)
         goto fail;
     if (bc_get_leb128_u16(s, &bc.closure_var_count))
         goto fail;
+    if (bc_get_leb128_u16(s, &bc.global_var_cache_count))
+        goto fail;
     if (bc_get_leb128_int(s, &bc.cpool_count))
         goto fail;
     if (bc_get_leb128_int(s, &bc.byte_code_len))
@@ -38404,38 +43038,8 @@ static JSValue JS_ReadFunctionTag(BCReaderState *s)
         }
         bc_read_trace(s, "}\n");
     }
-    if (b->closure_var_count != 0) {
-        bc_read_trace(s, "closure vars {\n");
-        bc_read_trace(s, "off  flags idx  name\n");
-        for(i = 0; i < b->closure_var_count; i++) {
-            JSClosureVar *cv = &b->closure_var[i];
-            int var_idx, flags;
-            if (bc_get_atom(s, &cv->var_name))
-                goto fail;
-            if (bc_get_leb128_int(s, &var_idx))
-                goto fail;
-            cv->var_idx = var_idx;
-            if (bc_get_leb128_int(s, &flags))
-                goto fail;
-            idx = 0;
-            cv->closure_type = bc_get_flags(flags, &idx, 3);
-            cv->is_const = bc_get_flags(flags, &idx, 1);
-            cv->is_lexical = bc_get_flags(flags, &idx, 1);
-            cv->var_kind = bc_get_flags(flags, &idx, 4);
-#ifdef ENABLE_DUMPS // JS_DUMP_READ_OBJECT
-            if (check_dump_flag(s->ctx->rt, JS_DUMP_READ_OBJECT)) {
-                bc_read_trace(s, "%3d  %d:%d%c%c %3d  ",
-                              i, cv->var_kind, cv->closure_type,
-                              cv->is_const ? 'C' : '.',
-                              cv->is_lexical ? 'X' : '.',
-                              cv->var_idx);
-                print_atom(s->ctx, cv->var_name);
-                printf("\n");
-            }
-#endif
-        }
-        bc_read_trace(s, "}\n");
-    }
+    if (JS_ReadClosureVars(s, b))
+        goto fail;
     if (b->cpool_count != 0) {
         bc_read_trace(s, "cpool {\n");
         for(i = 0; i < b->cpool_count; i++) {
@@ -38506,6 +43110,81 @@ static JSValue JS_ReadFunctionTag(BCReaderState *s)
     return JS_EXCEPTION;
 }
 
+#ifndef QJS_DISABLE_PARSER
+static JSValue JS_ReadLazyFunctionTag(BCReaderState *s)
+{
+    JSContext *ctx = s->ctx;
+    JSFunctionBytecode bc, *b;
+    JSValue obj = JS_UNDEFINED;
+    uint16_t v16;
+    int idx;
+
+    memset(&bc, 0, sizeof(bc));
+    if (bc_get_u16(s, &v16))
+        goto fail;
+    idx = 0;
+    bc.has_prototype = bc_get_flags(v16, &idx, 1);
+    bc.has_simple_parameter_list = bc_get_flags(v16, &idx, 1);
+    bc.func_kind = bc_get_flags(v16, &idx, 2);
+    bc.new_target_allowed = bc_get_flags(v16, &idx, 1);
+    bc.super_call_allowed = bc_get_flags(v16, &idx, 1);
+    bc.super_allowed = bc_get_flags(v16, &idx, 1);
+    bc.arguments_allowed = bc_get_flags(v16, &idx, 1);
+    bc.is_strict_mode = bc_get_flags(v16, &idx, 1);
+    bc.is_lazy_func_expr = bc_get_flags(v16, &idx, 1);
+    bc.is_lazy_module = bc_get_flags(v16, &idx, 1);
+    bc.is_lazy = true;
+    if (bc_get_atom(s, &bc.func_name))
+        goto fail;
+    if (bc_get_leb128_u16(s, &bc.defined_arg_count))
+        goto fail;
+    if (bc_get_leb128_u16(s, &bc.closure_var_count))
+        goto fail;
+
+    b = js_mallocz(ctx, sizeof(*b) +
+                   bc.closure_var_count * sizeof(*b->closure_var));
+    if (!b)
+        goto fail;
+    memcpy(b, &bc, sizeof(*b));
+    bc.func_name = JS_ATOM_NULL;
+    b->header.ref_count = 1;
+    if (b->closure_var_count != 0)
+        b->closure_var = (void *)(b + 1);
+    add_gc_object(ctx->rt, &b->header, JS_GC_OBJ_TYPE_FUNCTION_BYTECODE);
+    obj = JS_MKPTR(JS_TAG_FUNCTION_BYTECODE, b);
+
+    bc_read_trace(s, "closures=%d\n", b->closure_var_count);
+    if (JS_ReadClosureVars(s, b))
+        goto fail;
+    if (bc_get_atom(s, &b->filename))
+        goto fail;
+    if (bc_get_leb128_int(s, &b->line_num))
+        goto fail;
+    if (bc_get_leb128_int(s, &b->col_num))
+        goto fail;
+    if (bc_get_leb128_int(s, &b->lazy_source_col_num))
+        goto fail;
+    if (bc_get_leb128_int(s, &b->source_len))
+        goto fail;
+    bc_read_trace(s, "source: %d bytes\n", b->source_len);
+    if (s->ptr_last)
+        s->ptr_last += b->source_len;  // omit source code hex dump
+    /* the source is parsed again: it must be null terminated */
+    b->source = js_mallocz(ctx, b->source_len + 1);
+    if (!b->source)
+        goto fail;
+    if (bc_get_buf(s, b->source, b->source_len))
+        goto fail;
+    b->realm = JS_DupContext(ctx);
+    return obj;
+
+ fail:
+    JS_FreeAtom(ctx, bc.func_name);
+    JS_FreeValue(ctx, obj);
+    return JS_EXCEPTION;
+}
+#endif // QJS_DISABLE_PARSER
+
 static JSValue JS_ReadModule(BCReaderState *s)
 {
     JSContext *ctx = s->ctx;
@@ -38981,6 +43660,15 @@ static JSValue JS_ReadObjectRec(BCReaderState *s)
             goto no_allow_bytecode;
         obj = JS_ReadFunctionTag(s);
         break;
+    case BC_TAG_LAZY_FUNCTION_BYTECODE:
+        if (!s->allow_bytecode)
+            goto no_allow_bytecode;
+#ifdef QJS_DISABLE_PARSER
+        return JS_ThrowSyntaxError(ctx, "lazy function bytecode needs the parser");
+#else
+        obj = JS_ReadLazyFunctionTag(s);
+#endif
+        break;
     case BC_TAG_MODULE:
         if (!s->allow_bytecode) {
         no_allow_bytecode:
@@ -40001,22 +44689,52 @@ static JSValue JS_GetOwnPropertyNames2(JSContext *ctx, JSValueConst obj1,
     JSValue obj, r, val, key, value;
     JSObject *p;
     JSPropertyEnum *atoms;
+    JSShapeEnumCache *ec;
+    JSShape *sh;
+    JSShapeProperty *prs;
     uint32_t len, i, j;
 
     r = JS_UNDEFINED;
     val = JS_UNDEFINED;
+    atoms = NULL;
+    len = 0;
+    sh = NULL;
     obj = JS_ToObject(ctx, obj1);
     if (JS_IsException(obj))
         return JS_EXCEPTION;
     p = JS_VALUE_GET_OBJ(obj);
-    if (JS_GetOwnPropertyNamesInternal(ctx, &atoms, &len, p, flags & ~JS_GPN_ENUM_ONLY))
-        goto exception;
+    ec = NULL;
+    if (flags == (JS_GPN_ENUM_ONLY | JS_GPN_STRING_MASK))
+        ec = js_get_enum_cache(ctx, p);
+    if (ec) {
+        /* keep the cached keys alive if the object is modified */
+        sh = js_dup_shape(p->shape);
+    } else {
+        if (JS_GetOwnPropertyNamesInternal(ctx, &atoms, &len, p,
+                                           flags & ~JS_GPN_ENUM_ONLY))
+            goto exception;
+    }
     r = JS_NewArray(ctx);
     if (JS_IsException(r))
         goto exception;
+    if (ec) {
+        len = ec->count;
+        if (len > 0 && expand_fast_array(ctx, JS_VALUE_GET_OBJ(r), len))
+            goto exception;
+    }
     for(j = i = 0; i < len; i++) {
-        JSAtom atom = atoms[i].atom;
-        if (flags & JS_GPN_ENUM_ONLY) {
+        JSAtom atom;
+        prs = NULL;
+        if (ec) {
+            atom = ec->tab[i].atom;
+            /* the shape is immutable: while the object keeps it, the
+               property exists and is enumerable */
+            if (p->shape == sh)
+                prs = &sh->prop[ec->tab[i].prop_idx];
+        } else {
+            atom = atoms[i].atom;
+        }
+        if ((flags & JS_GPN_ENUM_ONLY) && !prs) {
             JSPropertyDescriptor desc;
             int res;
 
@@ -40038,7 +44756,10 @@ static JSValue JS_GetOwnPropertyNames2(JSContext *ctx, JSValueConst obj1,
                 goto exception;
             break;
         case JS_ITERATOR_KIND_VALUE:
-            val = JS_GetProperty(ctx, obj, atom);
+            if (prs && !(prs->flags & JS_PROP_TMASK))
+                val = js_dup(p->prop[ec->tab[i].prop_idx].u.value);
+            else
+                val = JS_GetProperty(ctx, obj, atom);
             if (JS_IsException(val))
                 goto exception;
             break;
@@ -40051,7 +44772,10 @@ static JSValue JS_GetOwnPropertyNames2(JSContext *ctx, JSValueConst obj1,
                 goto exception1;
             if (JS_CreateDataPropertyUint32(ctx, val, 0, key, JS_PROP_THROW) < 0)
                 goto exception1;
-            value = JS_GetProperty(ctx, obj, atom);
+            if (prs && !(prs->flags & JS_PROP_TMASK))
+                value = js_dup(p->prop[ec->tab[i].prop_idx].u.value);
+            else
+                value = JS_GetProperty(ctx, obj, atom);
             if (JS_IsException(value))
                 goto exception1;
             if (JS_CreateDataPropertyUint32(ctx, val, 1, value, JS_PROP_THROW) < 0)
@@ -40069,7 +44793,10 @@ exception:
     JS_FreeValue(ctx, r);
     r = JS_EXCEPTION;
 done:
-    js_free_prop_enum(ctx, atoms, len);
+    if (sh)
+        js_free_shape(ctx->rt, sh);
+    else
+        js_free_prop_enum(ctx, atoms, len);
     JS_FreeValue(ctx, obj);
     return r;
 }
@@ -41517,7 +46244,7 @@ static JSValue js_array_from(JSContext *ctx, JSValueConst this_val,
         if (JS_IsException(r))
             goto exception;
         stack[0] = js_dup(items);
-        if (js_for_of_start(ctx, &stack[1], false))
+        if (js_for_of_start(ctx, &stack[1], false, false))
             goto exception;
         for (k = 0;; k++) {
             v = JS_IteratorNext(ctx, stack[0], stack[1], 0, NULL, &done);
@@ -41679,9 +46406,414 @@ static JSValue JS_ArraySpeciesCreate(JSContext *ctx, JSValueConst obj,
     }
 }
 
+/* Array.fromAsync() */
+
+typedef enum JSArrayFromAsyncStateEnum {
+    JS_ARRAY_FROM_ASYNC_START,
+    JS_ARRAY_FROM_ASYNC_NEXT,       /* awaiting the result of next() */
+    JS_ARRAY_FROM_ASYNC_MAP,        /* awaiting the result of mapfn */
+    JS_ARRAY_FROM_ASYNC_CLOSE,      /* awaiting the result of return() */
+    JS_ARRAY_FROM_ASYNC_ARRAY_LIKE_START,
+    JS_ARRAY_FROM_ASYNC_ARRAY_LIKE, /* awaiting an element of an
+                                       array-like */
+    JS_ARRAY_FROM_ASYNC_ARRAY_LIKE_MAP, /* awaiting the result of mapfn */
+} JSArrayFromAsyncStateEnum;
+
+/* The state of the async function of the specification. It is resumed
+   by 'resume_funcs' which are created once per call. */
+typedef struct JSArrayFromAsyncData {
+    JSValue resolving_funcs[2]; /* of the returned promise */
+    JSValue resume_funcs[2];
+    JSValue iter[2]; /* iterator record */
+    JSValue array_like;
+    JSValue mapfn;
+    JSValue this_arg;
+    JSValue result;
+    JSValue error; /* rethrown after return() */
+    int64_t k;
+    int64_t len; /* array-like */
+    JSArrayFromAsyncStateEnum state;
+} JSArrayFromAsyncData;
+
+static void js_array_from_async_finalizer(JSRuntime *rt, JSValueConst val)
+{
+    JSArrayFromAsyncData *s = JS_GetOpaque(val, JS_CLASS_ARRAY_FROM_ASYNC);
+    int i;
+
+    if (s) {
+        for(i = 0; i < 2; i++) {
+            JS_FreeValueRT(rt, s->resolving_funcs[i]);
+            JS_FreeValueRT(rt, s->resume_funcs[i]);
+            JS_FreeValueRT(rt, s->iter[i]);
+        }
+        JS_FreeValueRT(rt, s->array_like);
+        JS_FreeValueRT(rt, s->mapfn);
+        JS_FreeValueRT(rt, s->this_arg);
+        JS_FreeValueRT(rt, s->result);
+        JS_FreeValueRT(rt, s->error);
+        js_free_rt(rt, s);
+    }
+}
+
+static void js_array_from_async_mark(JSRuntime *rt, JSValueConst val,
+                                     JS_MarkFunc *mark_func)
+{
+    JSArrayFromAsyncData *s = JS_GetOpaque(val, JS_CLASS_ARRAY_FROM_ASYNC);
+    int i;
+
+    if (s) {
+        for(i = 0; i < 2; i++) {
+            JS_MarkValue(rt, s->resolving_funcs[i], mark_func);
+            JS_MarkValue(rt, s->resume_funcs[i], mark_func);
+            JS_MarkValue(rt, s->iter[i], mark_func);
+        }
+        JS_MarkValue(rt, s->array_like, mark_func);
+        JS_MarkValue(rt, s->mapfn, mark_func);
+        JS_MarkValue(rt, s->this_arg, mark_func);
+        JS_MarkValue(rt, s->result, mark_func);
+        JS_MarkValue(rt, s->error, mark_func);
+    }
+}
+
+/* resolve or reject the returned promise and release the state. The
+   resume functions reference the state, so freeing them breaks the
+   cycle. */
+static void js_array_from_async_settle(JSContext *ctx, JSArrayFromAsyncData *s,
+                                       JSValue value, bool is_reject)
+{
+    JSValue ret;
+    int i;
+
+    ret = JS_Call(ctx, s->resolving_funcs[is_reject], JS_UNDEFINED,
+                  1, vc(&value));
+    JS_FreeValue(ctx, ret);
+    JS_FreeValue(ctx, value);
+    for(i = 0; i < 2; i++) {
+        JS_FreeValue(ctx, s->resolving_funcs[i]);
+        JS_FreeValue(ctx, s->resume_funcs[i]);
+        JS_FreeValue(ctx, s->iter[i]);
+        s->resolving_funcs[i] = JS_UNDEFINED;
+        s->resume_funcs[i] = JS_UNDEFINED;
+        s->iter[i] = JS_UNDEFINED;
+    }
+    JS_FreeValue(ctx, s->array_like);
+    JS_FreeValue(ctx, s->mapfn);
+    JS_FreeValue(ctx, s->this_arg);
+    JS_FreeValue(ctx, s->result);
+    JS_FreeValue(ctx, s->error);
+    s->array_like = JS_UNDEFINED;
+    s->mapfn = JS_UNDEFINED;
+    s->this_arg = JS_UNDEFINED;
+    s->result = JS_UNDEFINED;
+    s->error = JS_UNDEFINED;
+}
+
+static JSValue js_array_from_async_job(JSContext *ctx, int argc,
+                                       JSValueConst *argv)
+{
+    return JS_Call(ctx, argv[0], JS_UNDEFINED, 1, &argv[1]);
+}
+
+/* Await(value): resume 's' in 'state' when 'value' is settled. */
+static int js_array_from_async_await(JSContext *ctx, JSArrayFromAsyncData *s,
+                                     JSArrayFromAsyncStateEnum state,
+                                     JSValue value)
+{
+    JSValue promise, cap[2], args[2];
+    int res;
+
+    s->state = state;
+    if (!JS_IsObject(value) && !ctx->rt->promise_hook) {
+        /* no need to create a resolved promise: 's' is resumed by the
+           next job */
+        args[0] = s->resume_funcs[0];
+        args[1] = value;
+        res = JS_EnqueueJob(ctx, js_array_from_async_job, 2, vc(args));
+        JS_FreeValue(ctx, value);
+        return res;
+    }
+    promise = js_promise_resolve(ctx, ctx->promise_ctor, 1, vc(&value), 0);
+    JS_FreeValue(ctx, value);
+    if (JS_IsException(promise))
+        return -1;
+    cap[0] = JS_UNDEFINED;
+    cap[1] = JS_UNDEFINED;
+    res = perform_promise_then(ctx, promise, vc(s->resume_funcs), vc(cap));
+    JS_FreeValue(ctx, promise);
+    return res;
+}
+
+/* run the async function until its next 'await' or its end. 'value'
+   is the result of the previous 'await'. */
+static void js_array_from_async_resume(JSContext *ctx, JSArrayFromAsyncData *s,
+                                       JSValue value, bool is_reject)
+{
+    JSValue ret, method, args[2];
+    int done;
+
+    if (is_reject) {
+        switch(s->state) {
+        case JS_ARRAY_FROM_ASYNC_MAP:
+            JS_Throw(ctx, value);
+            goto close;
+        case JS_ARRAY_FROM_ASYNC_CLOSE:
+            break;
+        default:
+            JS_Throw(ctx, value);
+            goto reject;
+        }
+    }
+    switch(s->state) {
+    case JS_ARRAY_FROM_ASYNC_START:
+        goto next;
+    case JS_ARRAY_FROM_ASYNC_NEXT:
+        if (!JS_IsObject(value)) {
+            JS_FreeValue(ctx, value);
+            JS_ThrowTypeError(ctx, "iterator must return an object");
+            goto reject;
+        }
+        ret = JS_GetProperty(ctx, value, JS_ATOM_done);
+        if (JS_IsException(ret)) {
+            JS_FreeValue(ctx, value);
+            goto reject;
+        }
+        done = JS_ToBoolFree(ctx, ret);
+        if (done) {
+            JS_FreeValue(ctx, value);
+            goto finish;
+        }
+        ret = JS_GetProperty(ctx, value, JS_ATOM_value);
+        JS_FreeValue(ctx, value);
+        if (JS_IsException(ret))
+            goto reject;
+        value = ret;
+        if (!JS_IsUndefined(s->mapfn)) {
+            args[0] = value;
+            args[1] = js_int64(s->k);
+            ret = JS_Call(ctx, s->mapfn, s->this_arg, 2, vc(args));
+            JS_FreeValue(ctx, args[0]);
+            JS_FreeValue(ctx, args[1]);
+            if (JS_IsException(ret) ||
+                js_array_from_async_await(ctx, s, JS_ARRAY_FROM_ASYNC_MAP, ret))
+                goto close;
+            return;
+        }
+        /* fall through */
+    case JS_ARRAY_FROM_ASYNC_MAP:
+        if (JS_DefinePropertyValueInt64(ctx, s->result, s->k, value,
+                                        JS_PROP_C_W_E | JS_PROP_THROW) < 0)
+            goto close;
+        s->k++;
+    next:
+        if (s->k >= MAX_SAFE_INTEGER) {
+            JS_ThrowTypeError(ctx, "too many elements");
+            goto close;
+        }
+        ret = JS_Call(ctx, s->iter[1], s->iter[0], 0, NULL);
+        if (JS_IsException(ret) ||
+            js_array_from_async_await(ctx, s, JS_ARRAY_FROM_ASYNC_NEXT, ret))
+            goto reject;
+        return;
+    case JS_ARRAY_FROM_ASYNC_CLOSE:
+        JS_FreeValue(ctx, value);
+        value = s->error;
+        s->error = JS_UNDEFINED;
+        js_array_from_async_settle(ctx, s, value, true);
+        return;
+    case JS_ARRAY_FROM_ASYNC_ARRAY_LIKE_START:
+        goto array_like_next;
+    case JS_ARRAY_FROM_ASYNC_ARRAY_LIKE:
+        if (!JS_IsUndefined(s->mapfn)) {
+            args[0] = value;
+            args[1] = js_int64(s->k);
+            ret = JS_Call(ctx, s->mapfn, s->this_arg, 2, vc(args));
+            JS_FreeValue(ctx, args[0]);
+            JS_FreeValue(ctx, args[1]);
+            if (JS_IsException(ret) ||
+                js_array_from_async_await(ctx, s,
+                                          JS_ARRAY_FROM_ASYNC_ARRAY_LIKE_MAP,
+                                          ret))
+                goto reject;
+            return;
+        }
+        /* fall through */
+    case JS_ARRAY_FROM_ASYNC_ARRAY_LIKE_MAP:
+        if (JS_DefinePropertyValueInt64(ctx, s->result, s->k, value,
+                                        JS_PROP_C_W_E | JS_PROP_THROW) < 0)
+            goto reject;
+        s->k++;
+    array_like_next:
+        if (s->k >= s->len)
+            goto finish;
+        value = JS_GetPropertyInt64(ctx, s->array_like, s->k);
+        if (JS_IsException(value) ||
+            js_array_from_async_await(ctx, s, JS_ARRAY_FROM_ASYNC_ARRAY_LIKE,
+                                      value))
+            goto reject;
+        return;
+    default:
+        abort();
+    }
+ close:
+    /* AsyncIteratorClose() with a throw completion: the result of
+       return() is awaited but the exception is kept */
+    s->error = JS_GetException(ctx);
+    method = JS_GetProperty(ctx, s->iter[0], JS_ATOM_return);
+    if (JS_IsException(method)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+    } else if (!JS_IsUndefined(method) && !JS_IsNull(method)) {
+        ret = JS_CallFree(ctx, method, s->iter[0], 0, NULL);
+        if (!JS_IsException(ret) &&
+            !js_array_from_async_await(ctx, s, JS_ARRAY_FROM_ASYNC_CLOSE, ret))
+            return;
+        JS_FreeValue(ctx, JS_GetException(ctx));
+    }
+    value = s->error;
+    s->error = JS_UNDEFINED;
+    js_array_from_async_settle(ctx, s, value, true);
+    return;
+ finish:
+    if (JS_SetProperty(ctx, s->result, JS_ATOM_length, js_int64(s->k)) < 0)
+        goto reject;
+    value = s->result;
+    s->result = JS_UNDEFINED;
+    js_array_from_async_settle(ctx, s, value, false);
+    return;
+ reject:
+    js_array_from_async_settle(ctx, s, JS_GetException(ctx), true);
+}
+
+static JSValue js_array_from_async_resume_func(JSContext *ctx,
+                                               JSValueConst this_val,
+                                               int argc, JSValueConst *argv,
+                                               int magic,
+                                               JSValueConst *func_data)
+{
+    JSArrayFromAsyncData *s;
+
+    s = JS_GetOpaque(func_data[0], JS_CLASS_ARRAY_FROM_ASYNC);
+    js_array_from_async_resume(ctx, s, js_dup(argv[0]), magic);
+    return JS_UNDEFINED;
+}
+
+/* the synchronous part of Array.fromAsync(), up to the first 'await' */
+static int js_array_from_async_start(JSContext *ctx, JSArrayFromAsyncData *s,
+                                     JSValueConst this_val, JSValueConst items)
+{
+    JSValue method, iter, v;
+
+    method = JS_GetProperty(ctx, items, JS_ATOM_Symbol_asyncIterator);
+    if (JS_IsException(method))
+        return -1;
+    if (JS_IsUndefined(method) || JS_IsNull(method)) {
+        method = JS_GetProperty(ctx, items, JS_ATOM_Symbol_iterator);
+        if (JS_IsException(method))
+            return -1;
+        if (JS_IsUndefined(method) || JS_IsNull(method))
+            goto array_like;
+        v = JS_GetIterator2(ctx, items, method);
+        JS_FreeValue(ctx, method);
+        if (JS_IsException(v))
+            return -1;
+        iter = JS_CreateAsyncFromSyncIterator(ctx, v);
+        JS_FreeValue(ctx, v);
+    } else {
+        iter = JS_GetIterator2(ctx, items, method);
+        JS_FreeValue(ctx, method);
+    }
+    if (JS_IsException(iter))
+        return -1;
+    s->iter[0] = iter;
+    s->iter[1] = JS_GetProperty(ctx, iter, JS_ATOM_next);
+    if (JS_IsException(s->iter[1]))
+        return -1;
+    if (JS_IsConstructor(ctx, this_val))
+        s->result = JS_CallConstructor(ctx, this_val, 0, NULL);
+    else
+        s->result = JS_NewArray(ctx);
+    if (JS_IsException(s->result))
+        return -1;
+    s->state = JS_ARRAY_FROM_ASYNC_START;
+    return 0;
+
+ array_like:
+    s->array_like = JS_ToObject(ctx, items);
+    if (JS_IsException(s->array_like))
+        return -1;
+    if (js_get_length64(ctx, &s->len, s->array_like) < 0)
+        return -1;
+    v = js_int64(s->len);
+    if (JS_IsConstructor(ctx, this_val))
+        s->result = JS_CallConstructor(ctx, this_val, 1, vc(&v));
+    else
+        s->result = js_array_constructor(ctx, JS_UNDEFINED, 1, vc(&v));
+    JS_FreeValue(ctx, v);
+    if (JS_IsException(s->result))
+        return -1;
+    s->state = JS_ARRAY_FROM_ASYNC_ARRAY_LIKE_START;
+    return 0;
+}
+
+static JSValue js_array_from_async(JSContext *ctx, JSValueConst this_val,
+                                   int argc, JSValueConst *argv)
+{
+    // fromAsync(items, mapfn = void 0, this_arg = void 0)
+    JSValueConst mapfn = argc > 1 ? argv[1] : JS_UNDEFINED;
+    JSArrayFromAsyncData *s;
+    JSValue promise, obj;
+    int i;
+
+    obj = JS_NewObjectProtoClass(ctx, JS_NULL, JS_CLASS_ARRAY_FROM_ASYNC);
+    if (JS_IsException(obj))
+        return JS_EXCEPTION;
+    s = js_malloc(ctx, sizeof(*s));
+    if (!s) {
+        JS_FreeValue(ctx, obj);
+        return JS_EXCEPTION;
+    }
+    for(i = 0; i < 2; i++) {
+        s->resolving_funcs[i] = JS_UNDEFINED;
+        s->resume_funcs[i] = JS_UNDEFINED;
+        s->iter[i] = JS_UNDEFINED;
+    }
+    s->array_like = JS_UNDEFINED;
+    s->mapfn = js_dup(mapfn);
+    s->this_arg = argc > 2 ? js_dup(argv[2]) : JS_UNDEFINED;
+    s->result = JS_UNDEFINED;
+    s->error = JS_UNDEFINED;
+    s->k = 0;
+    s->len = 0;
+    s->state = JS_ARRAY_FROM_ASYNC_START;
+    JS_SetOpaqueInternal(obj, s);
+
+    promise = JS_NewPromiseCapability(ctx, s->resolving_funcs);
+    if (JS_IsException(promise))
+        goto done;
+    for(i = 0; i < 2; i++) {
+        s->resume_funcs[i] = JS_NewCFunctionData(ctx,
+                                                 js_array_from_async_resume_func,
+                                                 1, i, 1, vc(&obj));
+        if (JS_IsException(s->resume_funcs[i])) {
+            JS_FreeValue(ctx, promise);
+            promise = JS_EXCEPTION;
+            goto done;
+        }
+    }
+    if ((!JS_IsUndefined(mapfn) && check_function(ctx, mapfn)) ||
+        js_array_from_async_start(ctx, s, this_val, argv[0])) {
+        js_array_from_async_settle(ctx, s, JS_GetException(ctx), true);
+    } else {
+        js_array_from_async_resume(ctx, s, JS_UNDEFINED, false);
+    }
+ done:
+    JS_FreeValue(ctx, obj);
+    return promise;
+}
+
 static const JSCFunctionListEntry js_array_funcs[] = {
     JS_CFUNC_DEF("isArray", 1, js_array_isArray ),
     JS_CFUNC_DEF("from", 1, js_array_from ),
+    JS_CFUNC_DEF("fromAsync", 1, js_array_from_async ),
     JS_CFUNC_DEF("of", 0, js_array_of ),
     JS_CGETSET_DEF("[Symbol.species]", js_get_this, NULL ),
 };
@@ -43319,12 +48451,6 @@ exception:
     return ret;
 }
 
-typedef struct JSArrayIteratorData {
-    JSValue obj;
-    JSIteratorKindEnum kind;
-    uint32_t idx;
-} JSArrayIteratorData;
-
 static void js_array_iterator_finalizer(JSRuntime *rt, JSValueConst val)
 {
     JSObject *p = JS_VALUE_GET_OBJ(val);
@@ -43804,6 +48930,7 @@ typedef struct JSIteratorHelperData {
     JSValue func; // predicate (filter) or mapper (flatMap, map)
     JSValue inner; // innerValue (flatMap)
     int64_t count; // limit (drop, take) or counter (filter, map, flatMap)
+    struct JSIteratorZipData *zip; // inputs (zip, zipKeyed)
     JSIteratorHelperKindEnum kind : 8;
     uint8_t executing : 1;
     uint8_t done : 1;
@@ -43891,6 +49018,7 @@ static JSValue js_create_iterator_helper(JSContext *ctx, JSValueConst this_val,
     it->next = method;
     it->inner = JS_UNDEFINED;
     it->count = count;
+    it->zip = NULL;
     it->executing = 0;
     it->done = 0;
     JS_SetOpaqueInternal(obj, it);
@@ -44186,6 +49314,561 @@ static JSValue js_iterator_proto_set_toStringTag(JSContext *ctx, JSValueConst th
     return JS_UNDEFINED;
 }
 
+typedef enum JSIteratorZipModeEnum {
+    JS_ITERATOR_ZIP_SHORTEST,
+    JS_ITERATOR_ZIP_LONGEST,
+    JS_ITERATOR_ZIP_STRICT,
+} JSIteratorZipModeEnum;
+
+/* Iterator.zip() and Iterator.zipKeyed(). The inputs are stored as
+   (iterator, next method) pairs or, for the Arrays and TypedArrays
+   which can be enumerated without iterator object, as direct
+   enumeration records. A closed or exhausted input is undefined. */
+typedef struct JSIteratorZipData {
+    int count;
+    int size;
+    int alive; /* number of inputs which are not exhausted */
+    JSIteratorZipModeEnum mode;
+    JSValue *iters; /* 2 * count values */
+    JSValue *pads; /* count values in the "longest" mode, NULL otherwise */
+    JSAtom *keys; /* property of each input for zipKeyed(), NULL for zip() */
+} JSIteratorZipData;
+
+static void js_iterator_zip_free(JSRuntime *rt, JSIteratorZipData *z)
+{
+    int i;
+
+    for(i = 0; i < 2 * z->count; i++)
+        JS_FreeValueRT(rt, z->iters[i]);
+    if (z->pads) {
+        for(i = 0; i < z->count; i++)
+            JS_FreeValueRT(rt, z->pads[i]);
+        js_free_rt(rt, z->pads);
+    }
+    if (z->keys) {
+        for(i = 0; i < z->count; i++)
+            JS_FreeAtomRT(rt, z->keys[i]);
+        js_free_rt(rt, z->keys);
+    }
+    js_free_rt(rt, z->iters);
+    js_free_rt(rt, z);
+}
+
+static void js_iterator_zip_mark(JSRuntime *rt, JSIteratorZipData *z,
+                                 JS_MarkFunc *mark_func)
+{
+    int i;
+
+    for(i = 0; i < 2 * z->count; i++)
+        JS_MarkValue(rt, z->iters[i], mark_func);
+    if (z->pads) {
+        for(i = 0; i < z->count; i++)
+            JS_MarkValue(rt, z->pads[i], mark_func);
+    }
+}
+
+/* GetIteratorFlattenable(obj, reject-strings). Arrays and TypedArrays
+   are enumerated directly when it is not observable. */
+static int js_zip_get_iterator(JSContext *ctx, JSValue *rec,
+                               JSValueConst obj)
+{
+    JSValue method, iter, next;
+    int kind;
+
+    if (!JS_IsObject(obj)) {
+        JS_ThrowTypeErrorNotAnObject(ctx);
+        return -1;
+    }
+    kind = js_get_direct_enum(ctx, obj);
+    if (kind == JS_DIRECT_ENUM_ARRAY || kind == JS_DIRECT_ENUM_TYPED_ARRAY) {
+        rec[0] = js_dup(obj);
+        rec[1] = JS_DIRECT_ENUM_INDEX(0);
+        return 0;
+    }
+    method = JS_GetProperty(ctx, obj, JS_ATOM_Symbol_iterator);
+    if (JS_IsException(method))
+        return -1;
+    if (JS_IsUndefined(method) || JS_IsNull(method)) {
+        iter = js_dup(obj);
+    } else {
+        iter = JS_GetIterator2(ctx, obj, method);
+        JS_FreeValue(ctx, method);
+        if (JS_IsException(iter))
+            return -1;
+    }
+    next = JS_GetProperty(ctx, iter, JS_ATOM_next);
+    if (JS_IsException(next)) {
+        JS_FreeValue(ctx, iter);
+        return -1;
+    }
+    rec[0] = iter;
+    rec[1] = next;
+    return 0;
+}
+
+/* GetIterator(obj, sync) with the same direct enumeration */
+static int js_zip_get_iterator_sync(JSContext *ctx, JSValue *rec,
+                                    JSValueConst obj)
+{
+    JSValue iter, next;
+    int kind;
+
+    kind = js_get_direct_enum(ctx, obj);
+    if (kind == JS_DIRECT_ENUM_ARRAY || kind == JS_DIRECT_ENUM_TYPED_ARRAY) {
+        rec[0] = js_dup(obj);
+        rec[1] = JS_DIRECT_ENUM_INDEX(0);
+        return 0;
+    }
+    iter = JS_GetIterator(ctx, obj, false);
+    if (JS_IsException(iter))
+        return -1;
+    next = JS_GetProperty(ctx, iter, JS_ATOM_next);
+    if (JS_IsException(next)) {
+        JS_FreeValue(ctx, iter);
+        return -1;
+    }
+    rec[0] = iter;
+    rec[1] = next;
+    return 0;
+}
+
+/* free the record without closing it */
+static void js_zip_drop(JSContext *ctx, JSValue *rec)
+{
+    JS_FreeValue(ctx, rec[0]);
+    JS_FreeValue(ctx, rec[1]);
+    rec[0] = JS_UNDEFINED;
+    rec[1] = JS_UNDEFINED;
+}
+
+/* IteratorStepValue(), or IteratorStep() if 'read_value' is false.
+   The record is left to the caller when it is done or in case of
+   exception. */
+static JSValue js_zip_step(JSContext *ctx, JSValue *rec, int *pdone,
+                           bool read_value)
+{
+    JSValue obj, val;
+    int done;
+
+    if (js_is_direct_enum(rec[1]))
+        return js_direct_enum_next(ctx, rec, pdone);
+    if (read_value)
+        return JS_IteratorNext(ctx, rec[0], rec[1], 0, NULL, pdone);
+    obj = JS_IteratorNext2(ctx, rec[0], rec[1], 0, NULL, &done);
+    if (JS_IsException(obj)) {
+        *pdone = false;
+        return JS_EXCEPTION;
+    }
+    if (done != 2) {
+        *pdone = done;
+        return obj;
+    }
+    val = JS_GetProperty(ctx, obj, JS_ATOM_done);
+    JS_FreeValue(ctx, obj);
+    if (JS_IsException(val)) {
+        *pdone = false;
+        return JS_EXCEPTION;
+    }
+    *pdone = JS_ToBoolFree(ctx, val);
+    return JS_UNDEFINED;
+}
+
+static int js_zip_close(JSContext *ctx, JSValue *rec,
+                        bool is_exception_pending)
+{
+    int res;
+
+    if (js_is_direct_enum(rec[1])) {
+        res = js_direct_enum_close(ctx, rec, is_exception_pending);
+        rec[1] = JS_UNDEFINED;
+    } else {
+        res = JS_IteratorClose(ctx, rec[0], is_exception_pending);
+        js_zip_drop(ctx, rec);
+    }
+    return res;
+}
+
+/* IteratorCloseAll(): close the open inputs in reverse order */
+static int js_zip_close_all(JSContext *ctx, JSIteratorZipData *z,
+                            bool is_exception_pending)
+{
+    JSValue *rec;
+    int i, res;
+
+    res = is_exception_pending ? -1 : 0;
+    for(i = z->count; i-- > 0;) {
+        rec = &z->iters[2 * i];
+        if (JS_IsUndefined(rec[0]))
+            continue;
+        if (js_zip_close(ctx, rec, res < 0))
+            res = -1;
+    }
+    return res;
+}
+
+/* read the 'mode' and 'padding' options */
+static int js_zip_get_options(JSContext *ctx, JSValueConst options,
+                              JSIteratorZipModeEnum *pmode,
+                              JSValue *ppadding)
+{
+    static const char mode_names[3][9] = { "shortest", "longest", "strict" };
+    JSValue val;
+    const char *str;
+    size_t len;
+    int mode;
+
+    *pmode = JS_ITERATOR_ZIP_SHORTEST;
+    *ppadding = JS_UNDEFINED;
+    if (JS_IsUndefined(options))
+        return 0;
+    if (!JS_IsObject(options)) {
+        JS_ThrowTypeErrorNotAnObject(ctx);
+        return -1;
+    }
+    val = JS_GetPropertyStr(ctx, options, "mode");
+    if (JS_IsException(val))
+        return -1;
+    if (!JS_IsUndefined(val)) {
+        mode = countof(mode_names);
+        if (JS_IsString(val)) {
+            str = JS_ToCStringLen(ctx, &len, val);
+            if (!str) {
+                JS_FreeValue(ctx, val);
+                return -1;
+            }
+            for(mode = 0; mode < countof(mode_names); mode++) {
+                if (len == strlen(mode_names[mode]) &&
+                    !memcmp(str, mode_names[mode], len))
+                    break;
+            }
+            JS_FreeCString(ctx, str);
+        }
+        JS_FreeValue(ctx, val);
+        if (mode == countof(mode_names)) {
+            JS_ThrowTypeError(ctx, "invalid mode");
+            return -1;
+        }
+        *pmode = mode;
+    }
+    if (*pmode == JS_ITERATOR_ZIP_LONGEST) {
+        val = JS_GetPropertyStr(ctx, options, "padding");
+        if (JS_IsException(val))
+            return -1;
+        if (!JS_IsUndefined(val) && !JS_IsObject(val)) {
+            JS_FreeValue(ctx, val);
+            JS_ThrowTypeError(ctx, "invalid padding");
+            return -1;
+        }
+        *ppadding = val;
+    }
+    return 0;
+}
+
+static JSIteratorZipData *js_zip_new(JSContext *ctx, JSIteratorZipModeEnum mode)
+{
+    JSIteratorZipData *z;
+
+    z = js_mallocz(ctx, sizeof(*z));
+    if (!z)
+        return NULL;
+    z->mode = mode;
+    return z;
+}
+
+/* allocate the padding values, initialized to undefined */
+static int js_zip_alloc_pads(JSContext *ctx, JSIteratorZipData *z)
+{
+    int i;
+
+    z->pads = js_malloc(ctx, sizeof(z->pads[0]) * max_int(z->count, 1));
+    if (!z->pads)
+        return -1;
+    for(i = 0; i < z->count; i++)
+        z->pads[i] = JS_UNDEFINED;
+    return 0;
+}
+
+static JSValue js_zip_create(JSContext *ctx, JSIteratorZipData *z)
+{
+    JSIteratorHelperData *it;
+    JSValue obj;
+
+    obj = JS_NewObjectClass(ctx, JS_CLASS_ITERATOR_HELPER);
+    if (JS_IsException(obj))
+        goto fail;
+    it = js_malloc(ctx, sizeof(*it));
+    if (!it) {
+        JS_FreeValue(ctx, obj);
+        goto fail;
+    }
+    it->kind = z->keys ? JS_ITERATOR_HELPER_KIND_ZIP_KEYED :
+        JS_ITERATOR_HELPER_KIND_ZIP;
+    it->obj = JS_UNDEFINED;
+    it->func = JS_UNDEFINED;
+    it->next = JS_UNDEFINED;
+    it->inner = JS_UNDEFINED;
+    it->count = 0;
+    it->executing = 0;
+    it->done = 0;
+    it->zip = z;
+    z->alive = z->count;
+    JS_SetOpaqueInternal(obj, it);
+    return obj;
+ fail:
+    js_zip_close_all(ctx, z, true);
+    js_iterator_zip_free(ctx->rt, z);
+    return JS_EXCEPTION;
+}
+
+static JSValue js_iterator_zip(JSContext *ctx, JSValueConst this_val,
+                               int argc, JSValueConst *argv)
+{
+    JSValueConst iterables = argv[0];
+    JSIteratorZipModeEnum mode;
+    JSIteratorZipData *z;
+    JSValue padding, input[2], pad_iter[2], item;
+    int i, done;
+
+    if (!JS_IsObject(iterables))
+        return JS_ThrowTypeErrorNotAnObject(ctx);
+    if (js_zip_get_options(ctx, argc > 1 ? argv[1] : JS_UNDEFINED,
+                           &mode, &padding))
+        return JS_EXCEPTION;
+    z = js_zip_new(ctx, mode);
+    if (!z)
+        goto fail1;
+    if (js_zip_get_iterator_sync(ctx, input, iterables))
+        goto fail;
+    for(;;) {
+        item = js_zip_step(ctx, input, &done, true);
+        if (JS_IsException(item)) {
+            /* the input iterator is not closed */
+            js_zip_drop(ctx, input);
+            goto fail_close;
+        }
+        if (done) {
+            js_zip_drop(ctx, input);
+            break;
+        }
+        if (js_resize_array(ctx, (void **)&z->iters, sizeof(z->iters[0]),
+                            &z->size, 2 * (z->count + 1)) ||
+            js_zip_get_iterator(ctx, &z->iters[2 * z->count], item)) {
+            JS_FreeValue(ctx, item);
+            js_zip_close_all(ctx, z, true);
+            js_zip_close(ctx, input, true);
+            goto fail;
+        }
+        JS_FreeValue(ctx, item);
+        z->count++;
+    }
+    if (mode == JS_ITERATOR_ZIP_LONGEST) {
+        if (js_zip_alloc_pads(ctx, z))
+            goto fail_close;
+        if (!JS_IsUndefined(padding)) {
+            if (js_zip_get_iterator_sync(ctx, pad_iter, padding))
+                goto fail_close;
+            for(i = 0; i < z->count; i++) {
+                item = js_zip_step(ctx, pad_iter, &done, true);
+                if (JS_IsException(item)) {
+                    js_zip_drop(ctx, pad_iter);
+                    goto fail_close;
+                }
+                if (done) {
+                    js_zip_drop(ctx, pad_iter);
+                    break;
+                }
+                z->pads[i] = item;
+            }
+            if (!JS_IsUndefined(pad_iter[0]) &&
+                js_zip_close(ctx, pad_iter, false))
+                goto fail_close;
+        }
+    }
+    JS_FreeValue(ctx, padding);
+    return js_zip_create(ctx, z);
+ fail_close:
+    js_zip_close_all(ctx, z, true);
+ fail:
+    js_iterator_zip_free(ctx->rt, z);
+ fail1:
+    JS_FreeValue(ctx, padding);
+    return JS_EXCEPTION;
+}
+
+static JSValue js_iterator_zip_keyed(JSContext *ctx, JSValueConst this_val,
+                                     int argc, JSValueConst *argv)
+{
+    JSValueConst iterables = argv[0];
+    JSIteratorZipModeEnum mode;
+    JSIteratorZipData *z;
+    JSPropertyEnum *tab;
+    JSPropertyDescriptor desc;
+    JSValue padding, val;
+    uint32_t i, len;
+    int res;
+
+    if (!JS_IsObject(iterables))
+        return JS_ThrowTypeErrorNotAnObject(ctx);
+    if (js_zip_get_options(ctx, argc > 1 ? argv[1] : JS_UNDEFINED,
+                           &mode, &padding))
+        return JS_EXCEPTION;
+    tab = NULL;
+    len = 0;
+    z = js_zip_new(ctx, mode);
+    if (!z)
+        goto fail;
+    if (JS_GetOwnPropertyNamesInternal(ctx, &tab, &len,
+                                       JS_VALUE_GET_OBJ(iterables),
+                                       JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK))
+        goto fail;
+    z->iters = js_malloc(ctx, sizeof(z->iters[0]) * 2 * max_int(len, 1));
+    z->keys = js_malloc(ctx, sizeof(z->keys[0]) * max_int(len, 1));
+    if (!z->iters || !z->keys)
+        goto fail;
+    z->size = 2 * len;
+    for(i = 0; i < len; i++) {
+        /* the enumerability is checked when the property is read
+           because the getters may modify the object */
+        res = JS_GetOwnPropertyInternal(ctx, &desc,
+                                        JS_VALUE_GET_OBJ(iterables),
+                                        tab[i].atom);
+        if (res < 0)
+            goto fail_close;
+        if (res == 0)
+            continue;
+        js_free_desc(ctx, &desc);
+        if (!(desc.flags & JS_PROP_ENUMERABLE))
+            continue;
+        val = JS_GetProperty(ctx, iterables, tab[i].atom);
+        if (JS_IsException(val))
+            goto fail_close;
+        if (JS_IsUndefined(val))
+            continue;
+        res = js_zip_get_iterator(ctx, &z->iters[2 * z->count], val);
+        JS_FreeValue(ctx, val);
+        if (res)
+            goto fail_close;
+        z->keys[z->count++] = JS_DupAtom(ctx, tab[i].atom);
+    }
+    if (mode == JS_ITERATOR_ZIP_LONGEST) {
+        if (js_zip_alloc_pads(ctx, z))
+            goto fail_close;
+        if (!JS_IsUndefined(padding)) {
+            for(i = 0; i < z->count; i++) {
+                val = JS_GetProperty(ctx, padding, z->keys[i]);
+                if (JS_IsException(val))
+                    goto fail_close;
+                z->pads[i] = val;
+            }
+        }
+    }
+    js_free_prop_enum(ctx, tab, len);
+    JS_FreeValue(ctx, padding);
+    return js_zip_create(ctx, z);
+ fail_close:
+    js_zip_close_all(ctx, z, true);
+ fail:
+    if (tab)
+        js_free_prop_enum(ctx, tab, len);
+    if (z)
+        js_iterator_zip_free(ctx->rt, z);
+    JS_FreeValue(ctx, padding);
+    return JS_EXCEPTION;
+}
+
+/* the 'next' method of the zip() and zipKeyed() iterators. '*pdone' is
+   set to true when the iterator is finished, including in case of
+   exception. */
+static JSValue js_iterator_zip_next(JSContext *ctx, JSIteratorZipData *z,
+                                    int *pdone)
+{
+    JSValue res, val, *rec;
+    JSObject *p;
+    int i, k, done;
+
+    *pdone = true;
+    if (z->count == 0)
+        return JS_UNDEFINED;
+    if (z->keys) {
+        res = JS_NewObjectProto(ctx, JS_NULL);
+        if (JS_IsException(res))
+            goto fail;
+        p = NULL;
+    } else {
+        res = JS_NewArray(ctx);
+        if (JS_IsException(res))
+            goto fail;
+        p = JS_VALUE_GET_OBJ(res);
+        if (expand_fast_array(ctx, p, z->count) < 0)
+            goto fail;
+    }
+    for(i = 0; i < z->count; i++) {
+        rec = &z->iters[2 * i];
+        if (JS_IsUndefined(rec[0])) {
+            /* exhausted input in the "longest" mode */
+            val = js_dup(z->pads[i]);
+        } else {
+            val = js_zip_step(ctx, rec, &done, true);
+            if (JS_IsException(val)) {
+                js_zip_drop(ctx, rec);
+                goto fail;
+            }
+            if (done) {
+                js_zip_drop(ctx, rec);
+                z->alive--;
+                switch(z->mode) {
+                case JS_ITERATOR_ZIP_SHORTEST:
+                    JS_FreeValue(ctx, res);
+                    if (js_zip_close_all(ctx, z, false))
+                        return JS_EXCEPTION;
+                    return JS_UNDEFINED;
+                case JS_ITERATOR_ZIP_STRICT:
+                    if (i != 0)
+                        goto mismatch;
+                    for(k = 1; k < z->count; k++) {
+                        rec = &z->iters[2 * k];
+                        val = js_zip_step(ctx, rec, &done, false);
+                        if (JS_IsException(val)) {
+                            js_zip_drop(ctx, rec);
+                            goto fail;
+                        }
+                        JS_FreeValue(ctx, val);
+                        if (!done)
+                            goto mismatch;
+                        js_zip_drop(ctx, rec);
+                    }
+                    JS_FreeValue(ctx, res);
+                    return JS_UNDEFINED;
+                default:
+                    if (z->alive == 0) {
+                        JS_FreeValue(ctx, res);
+                        return JS_UNDEFINED;
+                    }
+                    val = js_dup(z->pads[i]);
+                    break;
+                }
+            }
+        }
+        if (p) {
+            p->u.array.u.values[p->u.array.count++] = val;
+        } else {
+            if (JS_DefinePropertyValue(ctx, res, z->keys[i], val,
+                                       JS_PROP_C_W_E) < 0)
+                goto fail;
+        }
+    }
+    if (p)
+        set_value(ctx, &p->prop[0].u.value, js_int32(z->count));
+    *pdone = false;
+    return res;
+ mismatch:
+    JS_ThrowTypeError(ctx, "mismatched inputs");
+ fail:
+    JS_FreeValue(ctx, res);
+    js_zip_close_all(ctx, z, true);
+    return JS_EXCEPTION;
+}
+
 static void js_iterator_helper_finalizer(JSRuntime *rt, JSValueConst val)
 {
     JSObject *p = JS_VALUE_GET_OBJ(val);
@@ -44195,6 +49878,8 @@ static void js_iterator_helper_finalizer(JSRuntime *rt, JSValueConst val)
         JS_FreeValueRT(rt, it->func);
         JS_FreeValueRT(rt, it->next);
         JS_FreeValueRT(rt, it->inner);
+        if (it->zip)
+            js_iterator_zip_free(rt, it->zip);
         js_free_rt(rt, it);
     }
 }
@@ -44209,6 +49894,8 @@ static void js_iterator_helper_mark(JSRuntime *rt, JSValueConst val,
         JS_MarkValue(rt, it->func, mark_func);
         JS_MarkValue(rt, it->next, mark_func);
         JS_MarkValue(rt, it->inner, mark_func);
+        if (it->zip)
+            js_iterator_zip_mark(rt, it->zip, mark_func);
     }
 }
 
@@ -44449,6 +50136,18 @@ static JSValue js_iterator_helper_next(JSContext *ctx, JSValueConst this_val,
             goto done;
         }
         break;
+    case JS_ITERATOR_HELPER_KIND_ZIP:
+    case JS_ITERATOR_HELPER_KIND_ZIP_KEYED:
+        if (magic == GEN_MAGIC_NEXT) {
+            ret = js_iterator_zip_next(ctx, it->zip, pdone);
+        } else {
+            *pdone = true;
+            if (js_zip_close_all(ctx, it->zip, false))
+                ret = JS_EXCEPTION;
+            else
+                ret = JS_UNDEFINED;
+        }
+        goto done;
     default:
         abort();
     }
@@ -44467,6 +50166,8 @@ fail:
 static const JSCFunctionListEntry js_iterator_funcs[] = {
     JS_CFUNC_DEF("concat", 0, js_iterator_concat ),
     JS_CFUNC_DEF("from", 1, js_iterator_from ),
+    JS_CFUNC_DEF("zip", 1, js_iterator_zip ),
+    JS_CFUNC_DEF("zipKeyed", 1, js_iterator_zip_keyed ),
 };
 
 static const JSCFunctionListEntry js_iterator_proto_funcs[] = {
@@ -50838,9 +56539,6 @@ static const JSCFunctionListEntry js_symbol_funcs[] = {
 
 /* Set/Map/WeakSet/WeakMap */
 
-#define MAGIC_SET (1 << 0)
-#define MAGIC_WEAK (1 << 1)
-
 static JSValue js_map_constructor(JSContext *ctx, JSValueConst new_target,
                                   int argc, JSValueConst *argv, int magic)
 {
@@ -50857,15 +56555,9 @@ static JSValue js_map_constructor(JSContext *ctx, JSValueConst new_target,
     s = js_mallocz(ctx, sizeof(*s));
     if (!s)
         goto fail;
-    init_list_head(&s->records);
+    init_list_head(&s->cursors);
     s->is_weak = is_weak;
     JS_SetOpaqueInternal(obj, s);
-    s->hash_size = 1;
-    s->hash_table = js_malloc(ctx, sizeof(s->hash_table[0]) * s->hash_size);
-    if (!s->hash_table)
-        goto fail;
-    init_list_head(&s->hash_table[0]);
-    s->record_count_threshold = 4;
 
     arr = JS_UNDEFINED;
     if (argc > 0)
@@ -50979,10 +56671,11 @@ static uint32_t map_hash_key(JSContext *ctx, JSValueConst key)
         h = JS_VALUE_GET_INT(key);
         break;
     case JS_TAG_STRING:
-        h = hash_string(JS_VALUE_GET_STRING(key), 0);
+        h = js_string_hash(JS_VALUE_GET_STRING(key));
         break;
     case JS_TAG_STRING_ROPE:
-        h = hash_string_rope(key, 0);
+        h = js_string_rope_hash(key);
+        tag = JS_TAG_STRING; /* same hash as the flat string */
         break;
     case JS_TAG_OBJECT:
     case JS_TAG_SYMBOL:
@@ -51006,59 +56699,144 @@ static uint32_t map_hash_key(JSContext *ctx, JSValueConst key)
     hash_float64:
         u.d = d;
         h = (u.u32[0] ^ u.u32[1]) * 3163;
-        return h ^= JS_TAG_FLOAT64;
+        tag = JS_TAG_FLOAT64;
+        break;
     default:
         h = 0;
         break;
     }
     h ^= tag;
+    /* the low bits select the bucket: mix the high bits into them
+       (the integers converted to float64 and the pointers have many
+       low zero bits) */
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
     return h;
 }
 
+static inline bool map_record_is_deleted(const JSMapRecord *mr)
+{
+    return JS_IsUninitialized(mr->key);
+}
+
 static JSMapRecord *map_find_record(JSContext *ctx, JSMapState *s,
                                     JSValueConst key)
 {
-    struct list_head *el;
     JSMapRecord *mr;
-    uint32_t h;
-    h = map_hash_key(ctx, key) & (s->hash_size - 1);
-    list_for_each(el, &s->hash_table[h]) {
-        mr = list_entry(el, JSMapRecord, hash_link);
-        if (js_same_value_zero(ctx, mr->key, key))
+    uint32_t h, i;
+
+    if (s->hash_size == 0)
+        return NULL;
+    h = map_hash_key(ctx, key);
+    for(i = s->hash_table[h & (s->hash_size - 1)]; i != MAP_NIL;
+        i = mr->hash_next) {
+        mr = &s->records[i];
+        if (mr->hash == h && js_same_value_zero(ctx, mr->key, key))
             return mr;
     }
     return NULL;
 }
 
-static void map_hash_resize(JSContext *ctx, JSMapState *s)
+/* WeakMap/WeakSet lookup, also used by the GC: the keys are compared
+   by identity */
+static JSMapRecord *map_find_weak_record(JSMapState *s, JSValueConst key)
 {
-    uint32_t new_hash_size, i, h;
-    struct list_head *new_hash_table, *el;
     JSMapRecord *mr;
+    uint32_t h, i;
 
-    /* XXX: no reporting of memory allocation failure */
-    if (s->hash_size == 1)
-        new_hash_size = 4;
-    else
-        new_hash_size = s->hash_size * 2;
-    new_hash_table = js_realloc(ctx, s->hash_table,
-                                sizeof(new_hash_table[0]) * new_hash_size);
-    if (!new_hash_table)
-        return;
+    if (s->hash_size == 0)
+        return NULL;
+    h = map_hash_key(NULL, key);
+    for(i = s->hash_table[h & (s->hash_size - 1)]; i != MAP_NIL;
+        i = mr->hash_next) {
+        mr = &s->records[i];
+        if (JS_VALUE_GET_PTR(mr->key) == JS_VALUE_GET_PTR(key))
+            return mr;
+    }
+    return NULL;
+}
 
-    for(i = 0; i < new_hash_size; i++)
-        init_list_head(&new_hash_table[i]);
+static void map_hash_rebuild(JSMapState *s)
+{
+    JSMapRecord *mr;
+    uint32_t i, h;
+
+    for(i = 0; i < s->hash_size; i++)
+        s->hash_table[i] = MAP_NIL;
+    /* insert in reverse order so that the chains are sorted by index */
+    for(i = s->record_end; i-- > 0;) {
+        mr = &s->records[i];
+        h = mr->hash & (s->hash_size - 1);
+        mr->hash_next = s->hash_table[h];
+        s->hash_table[h] = i;
+    }
+}
 
-    list_for_each(el, &s->records) {
-        mr = list_entry(el, JSMapRecord, link);
-        if (!mr->empty) {
-            h = map_hash_key(ctx, mr->key) & (new_hash_size - 1);
-            list_add_tail(&mr->hash_link, &new_hash_table[h]);
+/* remove the tombstones. The enumeration cursors are moved to the
+   index of their next live record. The hash table must be rebuilt. */
+static void map_compact(JSMapState *s)
+{
+    struct list_head *el;
+    JSMapCursor *c;
+    uint32_t i, j, k;
+
+    list_for_each(el, &s->cursors) {
+        c = list_entry(el, JSMapCursor, link);
+        k = 0;
+        for(i = 0; i < c->idx && i < s->record_end; i++) {
+            if (!map_record_is_deleted(&s->records[i]))
+                k++;
         }
+        c->idx = k;
     }
-    s->hash_table = new_hash_table;
-    s->hash_size = new_hash_size;
-    s->record_count_threshold = new_hash_size * 2;
+    j = 0;
+    for(i = 0; i < s->record_end; i++) {
+        if (!map_record_is_deleted(&s->records[i]))
+            s->records[j++] = s->records[i];
+    }
+    s->record_end = j;
+}
+
+/* compact the records and resize the arrays so that at least one
+   record can be added */
+static int map_resize(JSContext *ctx, JSMapState *s)
+{
+    JSMapRecord *new_records;
+    uint32_t *new_hash_table;
+    uint32_t new_size, new_hash_size;
+
+    map_compact(s);
+    new_size = max_int(4, s->record_count * 2);
+    if (new_size != s->record_size) {
+        new_records = js_realloc(ctx, s->records,
+                                 sizeof(new_records[0]) * new_size);
+        if (!new_records) {
+            if (s->record_end == s->record_size) {
+                map_hash_rebuild(s);
+                return -1;
+            }
+        } else {
+            s->records = new_records;
+            s->record_size = new_size;
+        }
+    }
+    new_hash_size = 4;
+    while (new_hash_size < s->record_size)
+        new_hash_size *= 2;
+    if (new_hash_size != s->hash_size) {
+        new_hash_table = js_realloc(ctx, s->hash_table,
+                                    sizeof(new_hash_table[0]) * new_hash_size);
+        if (!new_hash_table) {
+            if (s->hash_size == 0)
+                return -1;
+        } else {
+            s->hash_table = new_hash_table;
+            s->hash_size = new_hash_size;
+        }
+    }
+    map_hash_rebuild(s);
+    return 0;
 }
 
 static JSWeakRefRecord **get_first_weak_ref(JSValueConst key)
@@ -51082,38 +56860,39 @@ static JSWeakRefRecord **get_first_weak_ref(JSValueConst key)
         return NULL; // pacify compiler
 }
 
+/* Return a pointer to the new record, valid until the next
+   modification of the map. Its value must be initialized. */
 static JSMapRecord *map_add_record(JSContext *ctx, JSMapState *s,
                                    JSValueConst key)
 {
-    uint32_t h;
+    uint32_t h, i;
     JSMapRecord *mr;
 
-    mr = js_malloc(ctx, sizeof(*mr));
-    if (!mr)
-        return NULL;
-    mr->ref_count = 1;
-    mr->map = s;
-    mr->empty = false;
+    if (s->record_end == s->record_size) {
+        if (map_resize(ctx, s))
+            return NULL;
+    }
     if (s->is_weak) {
         JSWeakRefRecord *wr = js_malloc(ctx, sizeof(*wr));
-        if (!wr) {
-            js_free(ctx, mr);
+        if (!wr)
             return NULL;
-        }
         wr->kind = JS_WEAK_REF_KIND_MAP;
-        wr->u.map_record = mr;
+        wr->u.map = s;
         insert_weakref_record(key, wr);
+    }
+    i = s->record_end++;
+    mr = &s->records[i];
+    if (s->is_weak)
         mr->key = unsafe_unconst(key);
-    } else {
+    else
         mr->key = js_dup(key);
-    }
-    h = map_hash_key(ctx, key) & (s->hash_size - 1);
-    list_add_tail(&mr->hash_link, &s->hash_table[h]);
-    list_add_tail(&mr->link, &s->records);
+    mr->value = JS_UNDEFINED;
+    h = map_hash_key(ctx, key);
+    mr->hash = h;
+    h &= s->hash_size - 1;
+    mr->hash_next = s->hash_table[h];
+    s->hash_table[h] = i;
     s->record_count++;
-    if (s->record_count >= s->record_count_threshold) {
-        map_hash_resize(ctx, s);
-    }
     return mr;
 }
 
@@ -51121,15 +56900,16 @@ static JSMapRecord *map_add_record(JSContext *ctx, JSMapState *s,
    reference list. we don't use a doubly linked list to
    save space, assuming a given object has few weak
        references to it */
-static void delete_map_weak_ref(JSRuntime *rt, JSMapRecord *mr)
+static void delete_map_weak_ref(JSRuntime *rt, JSMapState *s,
+                                JSValueConst key)
 {
     JSWeakRefRecord **pwr, *wr;
 
-    pwr = get_first_weak_ref(mr->key);
+    pwr = get_first_weak_ref(key);
     for(;;) {
         wr = *pwr;
         assert(wr != NULL);
-        if (wr->kind == JS_WEAK_REF_KIND_MAP && wr->u.map_record == mr)
+        if (wr->kind == JS_WEAK_REF_KIND_MAP && wr->u.map == s)
             break;
         pwr = &wr->next_weak_ref;
     }
@@ -51137,37 +56917,63 @@ static void delete_map_weak_ref(JSRuntime *rt, JSMapRecord *mr)
     js_free_rt(rt, wr);
 }
 
+/* remove the record from its hash chain and make it a tombstone. The
+   key and the value are not freed. */
+static void map_unlink_record(JSMapState *s, JSMapRecord *mr)
+{
+    uint32_t *pi, i;
+
+    i = mr - s->records;
+    pi = &s->hash_table[mr->hash & (s->hash_size - 1)];
+    while (*pi != i)
+        pi = &s->records[*pi].hash_next;
+    *pi = mr->hash_next;
+    mr->key = JS_UNINITIALIZED;
+    mr->value = JS_UNDEFINED;
+    s->record_count--;
+}
+
 static void map_delete_record(JSRuntime *rt, JSMapState *s, JSMapRecord *mr)
 {
-    if (mr->empty)
+    JSValue key, value;
+
+    if (map_record_is_deleted(mr))
         return;
-    list_del(&mr->hash_link);
+    key = mr->key;
+    value = mr->value;
+    map_unlink_record(s, mr);
     if (s->is_weak) {
-        delete_map_weak_ref(rt, mr);
-    } else {
-        JS_FreeValueRT(rt, mr->key);
-    }
-    JS_FreeValueRT(rt, mr->value);
-    if (--mr->ref_count == 0) {
-        list_del(&mr->link);
-        js_free_rt(rt, mr);
+        delete_map_weak_ref(rt, s, key);
     } else {
-        /* keep a zombie record for iterators */
-        mr->empty = true;
-        mr->key = JS_UNDEFINED;
-        mr->value = JS_UNDEFINED;
+        JS_FreeValueRT(rt, key);
     }
-    s->record_count--;
+    JS_FreeValueRT(rt, value);
+}
+
+static void map_cursor_init(JSMapState *s, JSMapCursor *c)
+{
+    c->idx = 0;
+    list_add_tail(&c->link, &s->cursors);
+}
+
+static void map_cursor_free(JSMapCursor *c)
+{
+    /* the link is cleared if the map was freed first */
+    if (c->link.next)
+        list_del(&c->link);
 }
 
-static void map_decref_record(JSRuntime *rt, JSMapRecord *mr)
+/* return the next live record and advance the cursor or NULL */
+static JSMapRecord *map_cursor_next(JSMapState *s, JSMapCursor *c)
 {
-    if (--mr->ref_count == 0) {
-        /* the record can be safely removed */
-        assert(mr->empty);
-        list_del(&mr->link);
-        js_free_rt(rt, mr);
+    JSMapRecord *mr;
+
+    while (c->idx < s->record_end) {
+        mr = &s->records[c->idx++];
+        if (!map_record_is_deleted(mr))
+            return mr;
     }
+    return NULL;
 }
 
 static JSValue js_map_set(JSContext *ctx, JSValueConst this_val,
@@ -51291,15 +57097,16 @@ static JSValue js_map_clear(JSContext *ctx, JSValueConst this_val,
                             int argc, JSValueConst *argv, int magic)
 {
     JSMapState *s = JS_GetOpaque2(ctx, this_val, JS_CLASS_MAP + magic);
-    struct list_head *el, *el1;
-    JSMapRecord *mr;
+    uint32_t i;
 
     if (!s)
         return JS_EXCEPTION;
-    list_for_each_safe(el, el1, &s->records) {
-        mr = list_entry(el, JSMapRecord, link);
-        map_delete_record(ctx->rt, s, mr);
-    }
+    for(i = 0; i < s->record_end; i++)
+        map_delete_record(ctx->rt, s, &s->records[i]);
+    /* the cursors restart at the beginning */
+    map_compact(s);
+    if (s->hash_size != 0)
+        map_hash_rebuild(s);
     return JS_UNDEFINED;
 }
 
@@ -51317,8 +57124,8 @@ static JSValue js_map_forEach(JSContext *ctx, JSValueConst this_val,
     JSMapState *s = JS_GetOpaque2(ctx, this_val, JS_CLASS_MAP + magic);
     JSValueConst func, this_arg;
     JSValue ret, args[3];
-    struct list_head *el;
     JSMapRecord *mr;
+    JSMapCursor c;
 
     if (!s)
         return JS_EXCEPTION;
@@ -51329,33 +57136,29 @@ static JSValue js_map_forEach(JSContext *ctx, JSValueConst this_val,
         this_arg = JS_UNDEFINED;
     if (check_function(ctx, func))
         return JS_EXCEPTION;
-    /* Note: the list can be modified while traversing it, but the
-       current element is locked */
-    el = s->records.next;
-    while (el != &s->records) {
-        mr = list_entry(el, JSMapRecord, link);
-        if (!mr->empty) {
-            mr->ref_count++;
-            /* must duplicate in case the record is deleted */
-            args[1] = js_dup(mr->key);
-            if (magic)
-                args[0] = args[1];
-            else
-                args[0] = js_dup(mr->value);
-            args[2] = unsafe_unconst(this_val);
-            ret = JS_Call(ctx, func, this_arg, 3, vc(args));
-            JS_FreeValue(ctx, args[0]);
-            if (!magic)
-                JS_FreeValue(ctx, args[1]);
-            el = el->next;
-            map_decref_record(ctx->rt, mr);
-            if (JS_IsException(ret))
-                return ret;
-            JS_FreeValue(ctx, ret);
-        } else {
-            el = el->next;
+    /* Note: the map can be modified while traversing it. The cursor
+       is updated if the records are compacted. 'this_val' keeps the
+       map alive. */
+    map_cursor_init(s, &c);
+    while ((mr = map_cursor_next(s, &c)) != NULL) {
+        /* must duplicate in case the record is deleted */
+        args[1] = js_dup(mr->key);
+        if (magic)
+            args[0] = args[1];
+        else
+            args[0] = js_dup(mr->value);
+        args[2] = unsafe_unconst(this_val);
+        ret = JS_Call(ctx, func, this_arg, 3, vc(args));
+        JS_FreeValue(ctx, args[0]);
+        if (!magic)
+            JS_FreeValue(ctx, args[1]);
+        if (JS_IsException(ret)) {
+            map_cursor_free(&c);
+            return ret;
         }
+        JS_FreeValue(ctx, ret);
     }
+    map_cursor_free(&c);
     return JS_UNDEFINED;
 }
 
@@ -51451,23 +57254,27 @@ static void js_map_finalizer(JSRuntime *rt, JSValueConst val)
     JSMapState *s;
     struct list_head *el, *el1;
     JSMapRecord *mr;
+    uint32_t i;
 
     p = JS_VALUE_GET_OBJ(val);
     s = p->u.map_state;
     if (s) {
-        /* if the object is deleted we are sure that no iterator is
-           using it */
-        list_for_each_safe(el, el1, &s->records) {
-            mr = list_entry(el, JSMapRecord, link);
-            if (!mr->empty) {
+        /* During the GC sweep phase the Map finalizer may be called
+           before the Map iterator finalizer */
+        list_for_each_safe(el, el1, &s->cursors) {
+            list_del(el);
+        }
+        for(i = 0; i < s->record_end; i++) {
+            mr = &s->records[i];
+            if (!map_record_is_deleted(mr)) {
                 if (s->is_weak)
-                    delete_map_weak_ref(rt, mr);
+                    delete_map_weak_ref(rt, s, mr->key);
                 else
                     JS_FreeValueRT(rt, mr->key);
                 JS_FreeValueRT(rt, mr->value);
             }
-            js_free_rt(rt, mr);
         }
+        js_free_rt(rt, s->records);
         js_free_rt(rt, s->hash_table);
         js_free_rt(rt, s);
     }
@@ -51478,14 +57285,14 @@ static void js_map_mark(JSRuntime *rt, JSValueConst val,
 {
     JSObject *p = JS_VALUE_GET_OBJ(val);
     JSMapState *s;
-    struct list_head *el;
     JSMapRecord *mr;
+    uint32_t i;
 
     s = p->u.map_state;
     if (s) {
         assert(!s->is_weak);
-        list_for_each(el, &s->records) {
-            mr = list_entry(el, JSMapRecord, link);
+        for(i = 0; i < s->record_end; i++) {
+            mr = &s->records[i];
             JS_MarkValue(rt, mr->key, mark_func);
             JS_MarkValue(rt, mr->value, mark_func);
         }
@@ -51494,12 +57301,6 @@ static void js_map_mark(JSRuntime *rt, JSValueConst val,
 
 /* Map Iterator */
 
-typedef struct JSMapIteratorData {
-    JSValue obj;
-    JSIteratorKindEnum kind;
-    JSMapRecord *cur_record;
-} JSMapIteratorData;
-
 static void js_map_iterator_finalizer(JSRuntime *rt, JSValueConst val)
 {
     JSObject *p;
@@ -51508,11 +57309,8 @@ static void js_map_iterator_finalizer(JSRuntime *rt, JSValueConst val)
     p = JS_VALUE_GET_OBJ(val);
     it = p->u.map_iterator_data;
     if (it) {
-        /* During the GC sweep phase the Map finalizer may be
-           called before the Map iterator finalizer */
-        if (JS_IsLiveObject(rt, it->obj) && it->cur_record) {
-            map_decref_record(rt, it->cur_record);
-        }
+        if (!JS_IsUndefined(it->obj))
+            map_cursor_free(&it->cursor);
         JS_FreeValueRT(rt, it->obj);
         js_free_rt(rt, it);
     }
@@ -51525,7 +57323,6 @@ static void js_map_iterator_mark(JSRuntime *rt, JSValueConst val,
     JSMapIteratorData *it;
     it = p->u.map_iterator_data;
     if (it) {
-        /* the record is already marked by the object */
         JS_MarkValue(rt, it->obj, mark_func);
     }
 }
@@ -51553,7 +57350,7 @@ static JSValue js_create_map_iterator(JSContext *ctx, JSValueConst this_val,
     }
     it->obj = js_dup(this_val);
     it->kind = kind;
-    it->cur_record = NULL;
+    map_cursor_init(s, &it->cursor);
     JS_SetOpaqueInternal(enum_obj, it);
     return enum_obj;
  fail:
@@ -51567,7 +57364,6 @@ static JSValue js_map_iterator_next(JSContext *ctx, JSValueConst this_val,
     JSMapIteratorData *it;
     JSMapState *s;
     JSMapRecord *mr;
-    struct list_head *el;
 
     it = JS_GetOpaque2(ctx, this_val, JS_CLASS_MAP_ITERATOR + magic);
     if (!it) {
@@ -51578,34 +57374,17 @@ static JSValue js_map_iterator_next(JSContext *ctx, JSValueConst this_val,
         goto done;
     s = JS_GetOpaque(it->obj, JS_CLASS_MAP + magic);
     assert(s != NULL);
-    if (!it->cur_record) {
-        el = s->records.next;
-    } else {
-        mr = it->cur_record;
-        el = mr->link.next;
-        map_decref_record(ctx->rt, mr); /* the record can be freed here */
-    }
-    for(;;) {
-        if (el == &s->records) {
-            /* no more record  */
-            it->cur_record = NULL;
-            JS_FreeValue(ctx, it->obj);
-            it->obj = JS_UNDEFINED;
-        done:
-            /* end of enumeration */
-            *pdone = true;
-            return JS_UNDEFINED;
-        }
-        mr = list_entry(el, JSMapRecord, link);
-        if (!mr->empty)
-            break;
-        /* get the next record */
-        el = mr->link.next;
+    mr = map_cursor_next(s, &it->cursor);
+    if (!mr) {
+        /* no more record  */
+        map_cursor_free(&it->cursor);
+        JS_FreeValue(ctx, it->obj);
+        it->obj = JS_UNDEFINED;
+    done:
+        /* end of enumeration */
+        *pdone = true;
+        return JS_UNDEFINED;
     }
-
-    /* lock the record so that it won't be freed */
-    mr->ref_count++;
-    it->cur_record = mr;
     *pdone = false;
 
     if (it->kind == JS_ITERATOR_KIND_KEY) {
@@ -51669,13 +57448,15 @@ static JSValue js_map_read(BCReaderState *s, int magic)
 static int js_map_write(BCWriterState *s, struct JSMapState *map_state,
                         int magic)
 {
-    struct list_head *el;
     JSMapRecord *mr;
+    uint32_t i;
 
     bc_put_leb128(s, map_state ? map_state->record_count : 0);
     if (map_state) {
-        list_for_each(el, &map_state->records) {
-            mr = list_entry(el, JSMapRecord, link);
+        for(i = 0; i < map_state->record_end; i++) {
+            mr = &map_state->records[i];
+            if (map_record_is_deleted(mr))
+                continue;
             if (JS_WriteObjectRec(s, mr->key))
                 return -1;
             // mr->value is always JS_UNDEFINED for sets
@@ -52129,10 +57910,10 @@ static JSValue js_set_symmetricDifference(JSContext *ctx, JSValueConst this_val,
 {
     JSValue has, item, iter, keys, newset, next;
     JSValueConst setlike;
-    struct list_head *el;
     JSMapState *s, *t;
     JSMapRecord *mr;
     uint64_t size;
+    uint32_t i;
     int done;
     bool present;
 
@@ -52151,14 +57932,12 @@ static JSValue js_set_symmetricDifference(JSContext *ctx, JSValueConst this_val,
     t = JS_GetOpaque(newset, JS_CLASS_SET);
     // can't clone this_val using js_map_constructor(),
     // test262 mandates we don't call the .add method
-    list_for_each(el, &s->records) {
-        mr = list_entry(el, JSMapRecord, link);
-        if (mr->empty)
+    for(i = 0; i < s->record_end; i++) {
+        mr = &s->records[i];
+        if (map_record_is_deleted(mr))
             continue;
-        mr = map_add_record(ctx, t, js_dup(mr->key));
-        if (!mr)
+        if (!map_add_record(ctx, t, mr->key))
             goto exception;
-        mr->value = JS_UNDEFINED;
     }
     iter = JS_Call(ctx, keys, setlike, 0, NULL);
     if (JS_IsException(iter))
@@ -52214,10 +57993,10 @@ static JSValue js_set_union(JSContext *ctx, JSValueConst this_val,
 {
     JSValue has, item, iter, keys, newset, next, rv;
     JSValueConst setlike;
-    struct list_head *el;
     JSMapState *s, *t;
     JSMapRecord *mr;
     uint64_t size;
+    uint32_t i;
     int done;
 
     iter = JS_UNDEFINED;
@@ -52234,14 +58013,12 @@ static JSValue js_set_union(JSContext *ctx, JSValueConst this_val,
     if (JS_IsException(newset))
         goto exception;
     t = JS_GetOpaque(newset, JS_CLASS_SET);
-    list_for_each(el, &s->records) {
-        mr = list_entry(el, JSMapRecord, link);
-        if (mr->empty)
+    for(i = 0; i < s->record_end; i++) {
+        mr = &s->records[i];
+        if (map_record_is_deleted(mr))
             continue;
-        mr = map_add_record(ctx, t, js_dup(mr->key));
-        if (!mr)
+        if (!map_add_record(ctx, t, mr->key))
             goto exception;
-        mr->value = JS_UNDEFINED;
     }
     iter = JS_Call(ctx, keys, setlike, 0, NULL);
     if (JS_IsException(iter))
@@ -52437,6 +58214,9 @@ typedef struct JSPromiseReactionData {
     struct list_head link; /* not used in promise_reaction_job */
     JSValue resolving_funcs[2];
     JSValue handler;
+    /* if not NULL, 'await' reaction resuming this async function. The
+       other fields are undefined. */
+    JSAsyncFunctionData *async_func;
 } JSPromiseReactionData;
 
 JSPromiseStateEnum JS_PromiseState(JSContext *ctx, JSValueConst promise)
@@ -52471,6 +58251,8 @@ static void promise_reaction_data_free(JSRuntime *rt,
     JS_FreeValueRT(rt, rd->resolving_funcs[0]);
     JS_FreeValueRT(rt, rd->resolving_funcs[1]);
     JS_FreeValueRT(rt, rd->handler);
+    if (rd->async_func)
+        js_async_function_free(rt, rd->async_func);
     js_free_rt(rt, rd);
 }
 
@@ -52574,12 +58356,16 @@ static void fulfill_or_reject_promise(JSContext *ctx, JSValueConst promise,
 
     list_for_each_safe(el, el1, &s->promise_reactions[is_reject]) {
         rd = list_entry(el, JSPromiseReactionData, link);
-        args[0] = rd->resolving_funcs[0];
-        args[1] = rd->resolving_funcs[1];
-        args[2] = rd->handler;
-        args[3] = js_bool(is_reject);
-        args[4] = value;
-        JS_EnqueueJob(ctx, promise_reaction_job, 5, args);
+        if (rd->async_func) {
+            js_enqueue_await_job(ctx, rd->async_func, value, is_reject);
+        } else {
+            args[0] = rd->resolving_funcs[0];
+            args[1] = rd->resolving_funcs[1];
+            args[2] = rd->handler;
+            args[3] = js_bool(is_reject);
+            args[4] = value;
+            JS_EnqueueJob(ctx, promise_reaction_job, 5, args);
+        }
         list_del(&rd->link);
         promise_reaction_data_free(ctx->rt, rd);
     }
@@ -52787,6 +58573,8 @@ static void js_promise_mark(JSRuntime *rt, JSValueConst val,
             JS_MarkValue(rt, rd->resolving_funcs[0], mark_func);
             JS_MarkValue(rt, rd->resolving_funcs[1], mark_func);
             JS_MarkValue(rt, rd->handler, mark_func);
+            if (rd->async_func)
+                mark_func(rt, &rd->async_func->header);
         }
     }
     JS_MarkValue(rt, s->promise_result, mark_func);
@@ -53367,6 +59155,49 @@ static __exception int perform_promise_then(JSContext *ctx,
     return 0;
 }
 
+/* 'await' on the native promise 'promise': the async function 's' is
+   resumed when it is settled. */
+static __exception int perform_promise_await(JSContext *ctx,
+                                             JSValueConst promise,
+                                             JSAsyncFunctionData *s)
+{
+    JSPromiseData *p = JS_GetOpaque(promise, JS_CLASS_PROMISE);
+    JSPromiseReactionData *rd_array[2], *rd;
+    int i;
+
+    if (p->promise_state == JS_PROMISE_PENDING) {
+        for(i = 0; i < 2; i++) {
+            rd = js_malloc(ctx, sizeof(*rd));
+            if (!rd) {
+                if (i == 1)
+                    js_free(ctx, rd_array[0]);
+                return -1;
+            }
+            rd->resolving_funcs[0] = JS_UNDEFINED;
+            rd->resolving_funcs[1] = JS_UNDEFINED;
+            rd->handler = JS_UNDEFINED;
+            rd->async_func = s;
+            rd_array[i] = rd;
+        }
+        for(i = 0; i < 2; i++) {
+            s->header.ref_count++;
+            list_add_tail(&rd_array[i]->link, &p->promise_reactions[i]);
+        }
+    } else {
+        if (p->promise_state == JS_PROMISE_REJECTED && !p->is_handled) {
+            JSRuntime *rt = ctx->rt;
+            if (rt->host_promise_rejection_tracker)
+                rt->host_promise_rejection_tracker(ctx, promise, p->promise_result,
+                                                   true, rt->host_promise_rejection_tracker_opaque);
+        }
+        if (js_enqueue_await_job(ctx, s, p->promise_result,
+                                 p->promise_state == JS_PROMISE_REJECTED))
+            return -1;
+    }
+    p->is_handled = true;
+    return 0;
+}
+
 static JSValue js_promise_then(JSContext *ctx, JSValueConst this_val,
                                int argc, JSValueConst *argv)
 {
@@ -53550,6 +59381,9 @@ static const JSCFunctionListEntry js_async_iterator_proto_funcs[] = {
 typedef struct JSAsyncFromSyncIteratorData {
     JSValue sync_iter;
     JSValue next_method;
+    /* the unwrap functions are not visible from JS code so they are
+       created once for both values of 'done' */
+    JSValue unwrap_funcs[2];
 } JSAsyncFromSyncIteratorData;
 
 static void js_async_from_sync_iterator_finalizer(JSRuntime *rt,
@@ -53560,6 +59394,8 @@ static void js_async_from_sync_iterator_finalizer(JSRuntime *rt,
     if (s) {
         JS_FreeValueRT(rt, s->sync_iter);
         JS_FreeValueRT(rt, s->next_method);
+        JS_FreeValueRT(rt, s->unwrap_funcs[0]);
+        JS_FreeValueRT(rt, s->unwrap_funcs[1]);
         js_free_rt(rt, s);
     }
 }
@@ -53572,6 +59408,8 @@ static void js_async_from_sync_iterator_mark(JSRuntime *rt, JSValueConst val,
     if (s) {
         JS_MarkValue(rt, s->sync_iter, mark_func);
         JS_MarkValue(rt, s->next_method, mark_func);
+        JS_MarkValue(rt, s->unwrap_funcs[0], mark_func);
+        JS_MarkValue(rt, s->unwrap_funcs[1], mark_func);
     }
 }
 
@@ -53597,6 +59435,8 @@ static JSValue JS_CreateAsyncFromSyncIterator(JSContext *ctx,
     }
     s->sync_iter = js_dup(sync_iter);
     s->next_method = next_method;
+    s->unwrap_funcs[0] = JS_UNDEFINED;
+    s->unwrap_funcs[1] = JS_UNDEFINED;
     JS_SetOpaqueInternal(async_iter, s);
     return async_iter;
 }
@@ -53680,19 +59520,22 @@ static JSValue js_async_from_sync_iterator_next(JSContext *ctx, JSValueConst thi
             goto reject;
         }
 
-        resolve_reject[0] =
-            js_async_from_sync_iterator_unwrap_func_create(ctx, done);
-        if (JS_IsException(resolve_reject[0])) {
-            JS_FreeValue(ctx, value_wrapper_promise);
-            goto fail;
+        if (JS_IsUndefined(s->unwrap_funcs[done])) {
+            s->unwrap_funcs[done] =
+                js_async_from_sync_iterator_unwrap_func_create(ctx, done);
+            if (JS_IsException(s->unwrap_funcs[done])) {
+                s->unwrap_funcs[done] = JS_UNDEFINED;
+                JS_FreeValue(ctx, value_wrapper_promise);
+                goto fail;
+            }
         }
         JS_FreeValue(ctx, value);
+        resolve_reject[0] = s->unwrap_funcs[done];
         resolve_reject[1] = JS_UNDEFINED;
 
         res = perform_promise_then(ctx, value_wrapper_promise,
                                    vc(resolve_reject),
                                    vc(resolving_funcs));
-        JS_FreeValue(ctx, resolve_reject[0]);
         JS_FreeValue(ctx, value_wrapper_promise);
         JS_FreeValue(ctx, resolving_funcs[0]);
         JS_FreeValue(ctx, resolving_funcs[1]);
@@ -53736,11 +59579,10 @@ static JSClassShortDef const js_async_class_def[] = {
     { JS_ATOM_PromiseResolveFunction, js_promise_resolve_function_finalizer, js_promise_resolve_function_mark }, /* JS_CLASS_PROMISE_RESOLVE_FUNCTION */
     { JS_ATOM_PromiseRejectFunction, js_promise_resolve_function_finalizer, js_promise_resolve_function_mark }, /* JS_CLASS_PROMISE_REJECT_FUNCTION */
     { JS_ATOM_AsyncFunction, js_bytecode_function_finalizer, js_bytecode_function_mark },  /* JS_CLASS_ASYNC_FUNCTION */
-    { JS_ATOM_AsyncFunctionResolve, js_async_function_resolve_finalizer, js_async_function_resolve_mark }, /* JS_CLASS_ASYNC_FUNCTION_RESOLVE */
-    { JS_ATOM_AsyncFunctionReject, js_async_function_resolve_finalizer, js_async_function_resolve_mark }, /* JS_CLASS_ASYNC_FUNCTION_REJECT */
     { JS_ATOM_empty_string, js_async_from_sync_iterator_finalizer, js_async_from_sync_iterator_mark }, /* JS_CLASS_ASYNC_FROM_SYNC_ITERATOR */
     { JS_ATOM_AsyncGeneratorFunction, js_bytecode_function_finalizer, js_bytecode_function_mark },  /* JS_CLASS_ASYNC_GENERATOR_FUNCTION */
     { JS_ATOM_AsyncGenerator, js_async_generator_finalizer, js_async_generator_mark },  /* JS_CLASS_ASYNC_GENERATOR */
+    { JS_ATOM_empty_string, js_array_from_async_finalizer, js_array_from_async_mark }, /* JS_CLASS_ARRAY_FROM_ASYNC */
 };
 
 void JS_AddIntrinsicPromise(JSContext *ctx)
@@ -53754,8 +59596,6 @@ void JS_AddIntrinsicPromise(JSContext *ctx)
         rt->class_array[JS_CLASS_PROMISE_RESOLVE_FUNCTION].call = js_promise_resolve_function_call;
         rt->class_array[JS_CLASS_PROMISE_REJECT_FUNCTION].call = js_promise_resolve_function_call;
         rt->class_array[JS_CLASS_ASYNC_FUNCTION].call = js_async_function_call;
-        rt->class_array[JS_CLASS_ASYNC_FUNCTION_RESOLVE].call = js_async_function_resolve_call;
-        rt->class_array[JS_CLASS_ASYNC_FUNCTION_REJECT].call = js_async_function_resolve_call;
         rt->class_array[JS_CLASS_ASYNC_GENERATOR_FUNCTION].call = js_async_generator_function_call;
     }
 
@@ -55507,6 +61347,7 @@ static void JS_AddIntrinsicBasicObjects(JSContext *ctx)
     ctx->class_proto[JS_CLASS_OBJECT] = JS_NewObjectProto(ctx, JS_NULL);
     ctx->global_obj = JS_NewObject(ctx);
     ctx->global_var_obj = JS_NewObjectProto(ctx, JS_NULL);
+    ctx->global_var_gen = 1;
     ctx->function_proto = JS_NewCFunction3(ctx, js_function_proto, "", 0,
                                            JS_CFUNC_generic, 0,
                                            ctx->class_proto[JS_CLASS_OBJECT]);
@@ -55649,12 +61490,6 @@ void JS_AddIntrinsicBaseObjects(JSContext *ctx)
     JS_SetPropertyFunctionList(ctx, obj,
                                js_iterator_funcs,
                                countof(js_iterator_funcs));
-    JS_DefineAutoInitProperty(ctx, obj, JS_ATOM_zip, JS_AUTOINIT_ID_BYTECODE,
-                              (void *)(uintptr_t)JS_BUILTIN_ITERATOR_ZIP,
-                              JS_PROP_WRITABLE|JS_PROP_CONFIGURABLE);
-    JS_DefineAutoInitProperty(ctx, obj, JS_ATOM_zipKeyed, JS_AUTOINIT_ID_BYTECODE,
-                              (void *)(uintptr_t)JS_BUILTIN_ITERATOR_ZIP_KEYED,
-                              JS_PROP_WRITABLE|JS_PROP_CONFIGURABLE);
 
     ctx->class_proto[JS_CLASS_ITERATOR_CONCAT] = JS_NewObjectProto(ctx, ctx->class_proto[JS_CLASS_ITERATOR]);
     JS_SetPropertyFunctionList(ctx, ctx->class_proto[JS_CLASS_ITERATOR_CONCAT],
@@ -55681,10 +61516,6 @@ void JS_AddIntrinsicBaseObjects(JSContext *ctx)
     ctx->array_ctor = js_dup(obj);
     JS_SetPropertyFunctionList(ctx, obj, js_array_funcs,
                                countof(js_array_funcs));
-    JS_DefineAutoInitProperty(ctx, obj, JS_ATOM_fromAsync,
-                              JS_AUTOINIT_ID_BYTECODE,
-                              (void *)(uintptr_t)JS_BUILTIN_ARRAY_FROMASYNC,
-                              JS_PROP_WRITABLE|JS_PROP_CONFIGURABLE);
 
     /* XXX: create auto_initializer */
     {
@@ -56984,7 +62815,7 @@ static JSValue js_typed_array_from(JSContext *ctx, JSValueConst this_val,
         if (JS_IsException(arr))
             goto exception;
         stack[0] = js_dup(items);
-        if (js_for_of_start(ctx, &stack[1], false))
+        if (js_for_of_start(ctx, &stack[1], false, false))
             goto exception;
         for (k = 0;; k++) {
             v = JS_IteratorNext(ctx, stack[0], stack[1], 0, NULL, &done);
@@ -59901,26 +65732,28 @@ void JS_AddIntrinsicWeakRef(JSContext *ctx)
     JS_NewGlobalCConstructor(ctx, "FinalizationRegistry", js_finrec_constructor, 1, ctx->class_proto[JS_CLASS_FINALIZATION_REGISTRY]);
 }
 
-static void reset_weak_ref(JSRuntime *rt, JSWeakRefRecord **first_weak_ref)
+static void reset_weak_ref(JSRuntime *rt, JSValueConst key,
+                           JSWeakRefRecord **first_weak_ref)
 {
     JSWeakRefRecord *wr, *wr_next;
     JSWeakRefData *wrd;
     JSMapRecord *mr;
     JSMapState *s;
     JSFinRecEntry *fre;
+    JSValue value;
 
     /* first pass to remove the records from the WeakMap/WeakSet
-       lists */
+       lists. The values are kept in the weak reference records. */
     for(wr = *first_weak_ref; wr != NULL; wr = wr->next_weak_ref) {
         switch(wr->kind) {
         case JS_WEAK_REF_KIND_MAP:
-            mr = wr->u.map_record;
-            s = mr->map;
+            s = wr->u.map;
             assert(s->is_weak);
-            assert(!mr->empty); /* no iterator on WeakMap/WeakSet */
-            list_del(&mr->hash_link);
-            list_del(&mr->link);
-            s->record_count--;
+            mr = map_find_weak_record(s, key);
+            assert(mr != NULL);
+            value = mr->value;
+            map_unlink_record(s, mr);
+            wr->u.map_value = value;
             break;
         case JS_WEAK_REF_KIND_WEAK_REF:
             wrd = wr->u.weak_ref_data;
@@ -59941,9 +65774,7 @@ static void reset_weak_ref(JSRuntime *rt, JSWeakRefRecord **first_weak_ref)
         wr_next = wr->next_weak_ref;
         switch(wr->kind) {
         case JS_WEAK_REF_KIND_MAP:
-            mr = wr->u.map_record;
-            JS_FreeValueRT(rt, mr->value);
-            js_free_rt(rt, mr);
+            JS_FreeValueRT(rt, wr->u.map_value);
             break;
         case JS_WEAK_REF_KIND_WEAK_REF:
             wrd = wr->u.weak_ref_data;
@@ -60100,7 +65931,7 @@ static JSValue js_callsite_build_eval_origin(JSContext *ctx, JSStackFrame *sf)
             col_num = b->col_num;
             if (caller->cur_pc) {
                 uint32_t pc = caller->cur_pc - b->byte_code_buf - 1;
-                line_num = find_line_num(ctx, b, pc, &col_num);
+                line_num = find_line_num(b, pc, &col_num);
             }
             if (b->filename != JS_ATOM_NULL)
                 filename_alloc = JS_AtomToCString(ctx, b->filename);
@@ -60254,7 +66085,7 @@ static void js_new_callsite_data(JSContext *ctx, JSCallSiteData *csd, JSStackFra
         if (sf->cur_pc) {
             uint32_t pc = sf->cur_pc - b->byte_code_buf - 1;
             csd->position = pc;
-            csd->line_num = find_line_num(ctx, b, pc, &csd->col_num);
+            csd->line_num = find_line_num(b, pc, &csd->col_num);
         } else {
             csd->line_num = b->line_num;
             csd->col_num = b->col_num;
@@ -602,10 +602,34 @@ typedef struct JSMemoryUsage {
     int64_t c_func_count, array_count;
     int64_t fast_array_count, fast_array_elements;
     int64_t binary_object_count, binary_object_size;
+    int64_t eval_cache_count, eval_cache_size;
+    int64_t eval_cache_hit_count, eval_cache_miss_count;
+    /* overhead, shape_hash_size and atom_hash_size are already
+       included in memory_used_size and atom_size */
+    int64_t shape_hash_size, atom_hash_size;
+    int64_t job_count, job_queue_size;
+    int64_t fast_array_unused_size;
 } JSMemoryUsage;
 
+typedef struct JSObjectMemoryUsage {
+    int64_t count, size;
+} JSObjectMemoryUsage;
+
 JS_EXTERN void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s);
 JS_EXTERN void JS_DumpMemoryUsage(FILE *fp, const JSMemoryUsage *s, JSRuntime *rt);
+/* fill tab[class_id] with the number and the size of the objects of
+   each class id lower than tab_len. The size includes the property
+   arrays, the fast array capacity, the ArrayBuffer data and the Map
+   tables. If realm is not NULL, only count the objects of this realm:
+   the functions created in realm and the objects whose prototype chain
+   ends at the Object.prototype of realm. Return the number of class
+   ids of the runtime. */
+JS_EXTERN int JS_ComputeObjectMemoryUsage(JSRuntime *rt, JSContext *realm,
+                                          JSObjectMemoryUsage *tab, int tab_len);
+/* write the GC objects and the strings they reference in the V8 heap
+   snapshot format (.heapsnapshot) readable by the Chrome DevTools.
+   Return -1 if out of memory, on write error or if called during a GC. */
+JS_EXTERN int JS_WriteHeapSnapshot(JSRuntime *rt, FILE *fp);
 
 /* atom support */
 #define JS_ATOM_NULL 0
@@ -1144,6 +1168,56 @@ JS_EXTERN void JS_SetHostPromiseRejectionTracker(JSRuntime *rt, JSHostPromiseRej
 /* return != 0 if the JS code needs to be interrupted */
 typedef int JSInterruptHandler(JSRuntime *rt, void *opaque);
 JS_EXTERN void JS_SetInterruptHandler(JSRuntime *rt, JSInterruptHandler *cb, void *opaque);
+
+/* Sampling CPU profiler. The JS stack is sampled every 'interval_us'
+   microseconds (1000 if 0), at the first interrupt check following the
+   interval. Time spent in native code is attributed to the next
+   sample point. */
+typedef enum JSProfileFormatEnum {
+    JS_PROFILE_COLLAPSED, // "frame;frame;...;frame count" lines (flamegraph.pl)
+    JS_PROFILE_PPROF,     // uncompressed pprof protobuf (profile.proto)
+} JSProfileFormatEnum;
+
+/* return -1 if already profiling or out of memory */
+JS_EXTERN int JS_StartProfiling(JSRuntime *rt, uint32_t interval_us);
+/* stop profiling and write the profile to 'fp' if not NULL. Return -1
+   if not profiling or if the profile could not be written. */
+JS_EXTERN int JS_StopProfiling(JSRuntime *rt, FILE *fp, JSProfileFormatEnum format);
+
+/* Sampling allocation profiler. The stack is recorded for one
+   allocation every 'interval' bytes on average (512 KiB if 0). The
+   allocated objects and bytes and the ones not yet freed are estimated
+   per stack. */
+/* return -1 if already profiling or out of memory */
+JS_EXTERN int JS_StartAllocProfiling(JSRuntime *rt, size_t interval);
+/* stop profiling and write the profile to 'fp' if not NULL: the
+   allocated bytes in the collapsed format, the allocated and live
+   objects and bytes in the pprof format. Return -1 if not profiling or
+   if the profile could not be written. */
+JS_EXTERN int JS_StopAllocProfiling(JSRuntime *rt, FILE *fp, JSProfileFormatEnum format);
+
+/* Event tracing. The garbage collections and their phases, the
+   compilations, the module loads, the jobs and the JS_Eval() and
+   JS_EvalFunction() calls are recorded with their start and end times
+   in a ring buffer keeping the last 'max_events' events (65536 if 0). */
+/* return -1 if already tracing or out of memory */
+JS_EXTERN int JS_StartTracing(JSRuntime *rt, uint32_t max_events);
+/* write the recorded events to 'fp' in the Chrome trace event JSON
+   format, which Perfetto also reads. The timestamps are in
+   microseconds of a monotonic clock. Return -1 if not tracing or if
+   the events could not be written. */
+JS_EXTERN int JS_WriteTrace(JSRuntime *rt, FILE *fp);
+/* return -1 if not tracing */
+JS_EXTERN int JS_StopTracing(JSRuntime *rt);
+
+/* Execution counters: only available if the library is built with
+   QJS_ENABLE_EXEC_COUNTERS, otherwise these functions return -1. */
+/* write the executed opcodes and the calls and self time of the
+   functions to 'fp', ranked by count and self time */
+JS_EXTERN int JS_DumpExecCounters(JSRuntime *rt, FILE *fp);
+/* reset the counters, e.g. after a warm-up */
+JS_EXTERN int JS_ResetExecCounters(JSRuntime *rt);
+
 /* if can_block is true, Atomics.wait() can be used */
 JS_EXTERN void JS_SetCanBlock(JSRuntime *rt, bool can_block);
 /* set the [IsHTMLDDA] internal slot */
@@ -1207,6 +1281,12 @@ JS_EXTERN int JS_EnqueueJob(JSContext *ctx, JSJobFunc *job_func,
 
 JS_EXTERN bool JS_IsJobPending(JSRuntime *rt);
 JS_EXTERN int JS_ExecutePendingJob(JSRuntime *rt, JSContext **pctx);
+/* Execute the pending jobs until none is left, 'max_jobs' jobs were
+   executed or 'budget_us' microseconds elapsed (no limit if negative).
+   Return the number of executed jobs (saturated to INT32_MAX) or < 0 if
+   exception. */
+JS_EXTERN int JS_ExecutePendingJobs(JSRuntime *rt, int max_jobs,
+                                    int64_t budget_us, JSContext **pctx);
 
 /* Structure to retrieve (de)serialized SharedArrayBuffer objects. */
 typedef struct JSSABTab {
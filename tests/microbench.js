@@ -518,6 +518,30 @@ function closure_var(n)
     return n * 4;
 }
 
+var parse_functions_count = 0;
+
+function parse_functions(n)
+{
+    var src, j;
+    src = "";
+    for(j = 0; j < 100; j++) {
+        src += "function f" + j + "(a, b) {\n" +
+            "    var s = 0;\n" +
+            "    for (var i = 0; i < a.length; i++) {\n" +
+            "        if (a[i] > b) s += a[i] * " + j + "; else s -= i;\n" +
+            "    }\n" +
+            "    return [s, i].map(function (v) { return v + b; });\n" +
+            "}\n";
+    }
+    /* only a few functions of a script are usually called */
+    src += "return f0([1, 2, 3], 1);\n";
+    for(j = 0; j < n; j++) {
+        /* a different source each time to avoid the eval cache */
+        new Function(src + "// " + parse_functions_count++)();
+    }
+    return n * 100;
+}
+
 function int_arith(n)
 {
     var i, j, sum;
@@ -1161,6 +1185,7 @@ function main(argc, argv, g)
         global_destruct_strict,
         func_call,
         closure_var,
+        parse_functions,
         int_arith,
         float_arith,
         map_set,
@@ -285,11 +285,11 @@ function bjson_test_bytecode()
 function bjson_test_fuzz()
 {
     var corpus = [
-        ["FxAAAAAABGA="],
-        ["F+bm5oIt"],
-        ["FwARABMGBgYGBgYGBgYGBv////8QABEALxH/vy8R/78="],
-        ["FwAIfwAK/////3//////////////////////////////3/8AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAGAAAAAAAAAAAAAAD5+fn5+fn5+fn5+fkAAAAAAAYAqw=="],
-        ["FwAOAAAAFAA=", bjson.READ_OBJ_REFERENCE],
+        ["HBAAAAAABGA="],
+        ["HObm5oIt"],
+        ["HAARABMGBgYGBgYGBgYGBv////8QABEALxH/vy8R/78="],
+        ["HAAIfwAK/////3//////////////////////////////3/8AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAGAAAAAAAAAAAAAAD5+fn5+fn5+fn5+fkAAAAAAAYAqw=="],
+        ["HAAOAAAAFAA=", bjson.READ_OBJ_REFERENCE],
     ];
     for (var [input, flags] of corpus) {
         var buf = base64decode(input);
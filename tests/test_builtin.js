@@ -227,6 +227,111 @@ function test_enum()
     assert(tab, ["1","4294967294","x","18014398509481984","9007199254740992","9007199254740991","4294967296","4294967295","y"], "keys");
 }
 
+function test_shape()
+{
+    var a, b, c, i, tab, keys;
+
+    function make() {
+        var o = {};
+        o.x = 1;
+        o.y = 2;
+        o.z = 3;
+        return o;
+    }
+    function get_y(o) {
+        return o.y;
+    }
+
+    /* objects built the same way share their shape until one of them
+       is modified */
+    a = make();
+    b = make();
+    for(i = 0; i < 10; i++)
+        assert(get_y(a) + get_y(b), 4);
+    delete a.y;
+    assert(Object.keys(a).join(), "x,z");
+    assert(Object.keys(b).join(), "x,y,z");
+    assert(get_y(a), undefined);
+    assert(get_y(b), 2);
+    a.y = 4;
+    assert(Object.keys(a).join(), "x,z,y");
+    assert([a.x, a.y, a.z].join(), "1,4,3");
+    b.w = 5;
+    assert(Object.keys(b).join(), "x,y,z,w");
+    c = make();
+    assert(Object.keys(c).join(), "x,y,z");
+    assert(c.w, undefined);
+    c.w = 6;
+    assert([b.w, c.w].join(), "5,6");
+
+    /* modified flags */
+    a = make();
+    b = make();
+    Object.defineProperty(a, "x", { enumerable: false });
+    assert(Object.keys(a).join(), "y,z");
+    assert(Object.getOwnPropertyNames(a).join(), "x,y,z");
+    assert(Object.keys(b).join(), "x,y,z");
+    Object.defineProperty(b, "y", { get() { return 7; } });
+    assert(get_y(b), 7);
+    assert(get_y(make()), 2);
+    Object.freeze(a);
+    assertThrows(TypeError, () => { a.z = 8; });
+    assert(a.z, 3);
+    c = make();
+    c.z = 8;
+    assert(c.z, 8);
+    assert(Object.isFrozen(c), false);
+    c.v = 9;
+    assert(Object.keys(c).join(), "x,y,z,v");
+
+    /* several transitions from the same shape */
+    tab = [];
+    for(i = 0; i < 20; i++) {
+        a = {};
+        a["k" + i] = i;
+        tab.push(a);
+    }
+    for(i = 0; i < 20; i++) {
+        assert(Object.keys(tab[i]).join(), "k" + i);
+        assert(tab[i]["k" + i], i);
+    }
+
+    /* too many properties: switch to dictionary mode */
+    a = {};
+    b = {};
+    keys = [];
+    for(i = 0; i < 100; i++) {
+        a["p" + i] = i;
+        b["p" + i] = -i;
+        keys.push("p" + i);
+    }
+    assert(Object.keys(a).join(), keys.join());
+    assert(Object.keys(b).join(), keys.join());
+    for(i = 0; i < 100; i++) {
+        assert(a["p" + i], i);
+        assert(b["p" + i], -i);
+    }
+    delete a.p10;
+    delete a.p80;
+    a.p10 = 10;
+    b.q = 1;
+    assert(Object.keys(a).join(),
+           keys.filter((k) => k != "p10" && k != "p80").concat("p10").join());
+    assert(Object.keys(b).join(), keys.concat("q").join());
+    assert([a.p10, a.p80, a.p99, b.p10, b.p80, b.q].join(), "10,,99,-10,-80,1");
+    /* the object with 64 properties is still shared */
+    a = {};
+    b = {};
+    for(i = 0; i < 64; i++) {
+        a["p" + i] = i;
+        b["p" + i] = i;
+    }
+    a.p64 = 64;
+    assert(Object.keys(a).length, 65);
+    assert(Object.keys(b).length, 64);
+    assert([a.p63, a.p64, b.p63, b.p64].join(), "63,64,63,");
+}
+
 function test_array()
 {
     var a, err;
@@ -996,6 +1101,50 @@ function test_map()
     });
 
     assert(a.size, 0);
+
+    /* the iterators survive the compaction of the deleted records */
+    a = new Map();
+    for(i = 0; i < 10; i++)
+        a.set(i, i);
+    o = a.keys();
+    assert(o.next().value, 0);
+    for(i = 0; i < 8; i++)
+        a.delete(i);
+    for(i = 10; i < 40; i++)
+        a.set(i, i);
+    tab = [...o];
+    assert(tab.length, 32);
+    assert(tab[0], 8);
+    assert(tab[31], 39);
+
+    o = a.entries();
+    o.next();
+    a.clear();
+    a.set("x", 1);
+    assert(o.next().value.toString(), "x,1");
+    assert(o.next().done, true);
+
+    for(i = 0; i < 10000; i++) {
+        a.set(i, i);
+        a.delete(i - 3);
+    }
+    assert([...a.keys()].toString(), "x,9997,9998,9999");
+
+    /* string keys: flat strings, slices and ropes hash the same */
+    a = new Map();
+    o = "k".repeat(2000);
+    a.set(o, 1);
+    assert(a.get("k".repeat(1000) + "k".repeat(1000)), 1);
+    assert(a.get(("x" + o).substring(1)), 1);
+    assert(a.has(o.substring(1) + "k"));
+    assert(!a.has(o.substring(1) + "j"));
+    o = "ab";
+    o += String.fromCharCode(99);
+    assert(a.has(o), false); /* caches the hash of o */
+    o += "d"; /* may be concatenated in place */
+    a.set(o, 2);
+    assert(a.get("abcd"), 2);
+    assert(a.has("abc"), false);
 }
 
 function test_weak_map()
@@ -1178,6 +1327,49 @@ function test_generator()
     assert(v.value === 6 && v.done === true);
 }
 
+function test_iterator_zip()
+{
+    var r, log, it, ta;
+
+    r = Iterator.zip([[1, 2, 3], "ab"[Symbol.iterator]()]).toArray();
+    assert(JSON.stringify(r), '[[1,"a"],[2,"b"]]');
+    r = Iterator.zip([[1, 2, 3], ["a", "b"]], { mode: "longest", padding: [0, "z"] }).toArray();
+    assert(JSON.stringify(r), '[[1,"a"],[2,"b"],[3,"z"]]');
+    assertThrows(TypeError, () => Iterator.zip([[1, 2], [1]], { mode: "strict" }).toArray());
+    assertThrows(TypeError, () => Iterator.zip([[1]], { mode: "all" }));
+    assertThrows(TypeError, () => Iterator.zip([1]));
+    assertThrows(TypeError, () => Iterator.zip(["ab"]));
+
+    ta = new Int8Array([5, 6]);
+    r = Iterator.zip([ta, new Set([7, 8])]).toArray();
+    assert(JSON.stringify(r), '[[5,7],[6,8]]');
+
+    /* the inputs which are not exhausted are closed in reverse order */
+    log = [];
+    function input(name, n) {
+        var i = 0;
+        return {
+            next() { return { value: i, done: i++ >= n }; },
+            return() { log.push(name); return {}; },
+            [Symbol.iterator]() { return this; },
+        };
+    }
+    r = Iterator.zip([input("a", 3), input("b", 1), input("c", 3)]).toArray();
+    assert(r.length, 1);
+    assert(log.join(), "c,a");
+    log = [];
+    it = Iterator.zip([input("a", 3), input("b", 3)]);
+    it.next();
+    it.return();
+    assert(log.join(), "b,a");
+
+    r = Iterator.zipKeyed({ x: [1, 2], y: ["a", "b"] }).toArray();
+    assert(JSON.stringify(r), '[{"x":1,"y":"a"},{"x":2,"y":"b"}]');
+    assert(Object.getPrototypeOf(r[0]), null);
+    r = Iterator.zipKeyed({ x: [1], y: [] }, { mode: "longest", padding: { y: 0 } }).toArray();
+    assert(JSON.stringify(r), '[{"x":1,"y":0}]');
+}
+
 function test_proxy_iter()
 {
     const p = new Proxy({}, {
@@ -1286,6 +1478,7 @@ function test_cur_pc()
 test();
 test_function();
 test_enum();
+test_shape();
 test_array();
 test_string();
 test_rope();
@@ -1302,6 +1495,7 @@ test_weak_map();
 test_set();
 test_weak_set();
 test_generator();
+test_iterator_zip();
 test_proxy_iter();
 test_proxy_is_array();
 test_finalization_registry();
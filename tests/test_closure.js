@@ -211,6 +211,54 @@ function test_eval_const()
     assert(success);
 }
 
+/* the captured variables of a frame share a block which outlives the
+   frame while closures reference some of them */
+function test_closure_block()
+{
+    var tab, g, i, r;
+
+    function f(n) {
+        var x = 0, y = 1, z = 2;
+        var tab = [];
+        [1, 2, 3].forEach((v) => { x += v; y *= v; });
+        for(let i = 0; i < n; i++) {
+            let j = i * 10;
+            if (i & 1)
+                tab.push(() => j + z);
+            else
+                (() => { x += j; })();
+        }
+        tab.push(() => x);
+        return tab;
+    }
+    tab = f(5);
+    assert(tab.length, 3);
+    assert(tab[0](), 12);
+    assert(tab[1](), 32);
+    assert(tab[2](), 66);
+
+    function* gen() {
+        var a = 1;
+        var inc = () => a++;
+        yield inc;
+        inc();
+        yield a;
+    }
+    g = gen();
+    r = g.next().value;
+    r();
+    assert(g.next().value, 3);
+    assert(r(), 3);
+
+    tab = [];
+    for(i = 0; i < 100; i++)
+        tab.push(f(i & 3));
+    r = 0;
+    for(i = 0; i < tab.length; i++)
+        r += tab[i][tab[i].length - 1]();
+    assert(r, 1100);
+}
+
 test_closure1();
 test_closure2();
 test_closure3();
@@ -218,3 +266,4 @@ test_arrow_function();
 test_with();
 test_eval_closure();
 test_eval_const();
+test_closure_block();
@@ -0,0 +1,144 @@
+import * as std from "qjs:std";
+import * as os from "qjs:os";
+import { assert } from "./assert.js";
+
+const isWin = os.platform === 'win32';
+
+/* the test may be run by qjs or by run-test262 from the same directory */
+function qjs_path()
+{
+    var exe = os.exePath();
+    if (!exe)
+        return null;
+    return exe.replace(/[^\/]*$/, "qjs");
+}
+
+function run(qjs, args)
+{
+    var fds, pid, f, out, ret, status;
+
+    fds = os.pipe();
+    pid = os.exec([qjs, ...args], { stdout: fds[1], block: false });
+    assert(pid >= 0);
+    os.close(fds[1]);
+    f = std.fdopen(fds[0], "r");
+    out = f.readAsString();
+    f.close();
+    [ret, status] = os.waitpid(pid, 0);
+    assert(ret, pid);
+    assert(status, 0);
+    return out.trim().split("\n");
+}
+
+/* main -> a, b; a -> c, d; b -> d, e; d -> c; e -> a (cycle);
+   c -> sub/f. Each module records when it is evaluated. */
+const modules = {
+    "main.js": `
+        import { a } from "./a.js";
+        import { b, gen, twice } from "./b.js";
+        import { order } from "./order.js";
+        console.log(order.join());
+        console.log(a(1), b(2), [...gen(3)].join());
+        try {
+            b(-1);
+        } catch (e) {
+            console.log(e.message, e.stack.split("\\n")[0].trim());
+        }
+        twice(21).then((v) => console.log("twice", v));
+    `,
+    "order.js": `
+        export const order = [];
+    `,
+    "a.js": `
+        import { order } from "./order.js";
+        import { c } from "./c.js";
+        import { d } from "./d.js";
+        order.push("a");
+        export function a(x) {
+            function inner(y) { return c(x) + d(y); }
+            return inner(x + 1);
+        }
+    `,
+    "b.js": `
+        import { order } from "./order.js";
+        import { d } from "./d.js";
+        import { e } from "./e.js";
+        order.push("b");
+        export function b(x) {
+            if (x < 0)
+                throw new Error("negative");
+            return d(x) * e();
+        }
+        export function *gen(n) {
+            for (let i = 0; i < n; i++)
+                yield d(i);
+        }
+        export async function twice(x) {
+            await null;
+            return x * 2;
+        }
+    `,
+    "c.js": `
+        import { order } from "./order.js";
+        import { f } from "./sub/f.js";
+        order.push("c");
+        export function c(x) { return x * f(); }
+    `,
+    "d.js": `
+        import { order } from "./order.js";
+        import { c } from "./c.js";
+        order.push("d");
+        export function d(x) { return c(x) + 1; }
+    `,
+    "e.js": `
+        import { order } from "./order.js";
+        import { a } from "./a.js";
+        order.push("e");
+        export function e() { return a(0); }
+    `,
+    "sub/f.js": `
+        import { order } from "../order.js";
+        order.push("f");
+        export function f() { return 10; }
+    `,
+};
+
+function test_compile_threads(qjs)
+{
+    var dir, err, name, expected, trace;
+
+    [dir, err] = os.mkdtemp();
+    assert(err, 0);
+    assert(os.mkdir(dir + "/sub"), 0);
+    for (name in modules)
+        std.writeFile(dir + "/" + name, modules[name]);
+
+    expected = [
+        "f,c,d,a,e,b",
+        "31 231 1,11,21",
+        "negative at b (" + dir + "/b.js:8:27)",
+        "twice 42",
+    ];
+    assert(run(qjs, [dir + "/main.js"]).join("|"), expected.join("|"));
+    for (var n of [1, 2, 4]) {
+        assert(run(qjs, ["--compile-threads", String(n), dir + "/main.js"]).join("|"),
+               expected.join("|"));
+    }
+
+    /* no module, including the main one, is compiled by the main thread */
+    trace = dir + "/trace.json";
+    assert(run(qjs, ["--compile-threads", "2", "--trace-events", trace,
+                     dir + "/main.js"]).join("|"), expected.join("|"));
+    assert(std.loadFile(trace).includes('{"name":"load_module",'));
+    assert(!std.loadFile(trace).includes('{"name":"compile",'));
+    os.remove(trace);
+
+    for (name in modules)
+        os.remove(dir + "/" + name);
+    os.remove(dir + "/sub");
+    os.remove(dir);
+}
+
+const qjs = qjs_path();
+if (!isWin && qjs)
+    test_compile_threads(qjs);
@@ -287,6 +287,100 @@ function test_arguments()
         assert(arguments[1], 3, "arguments");
     }
     f2(1, 3);
+
+    /* accesses which do not need the arguments object */
+    function sum() {
+        var s = 0;
+        for (var i = 0; i < arguments.length; i++)
+            s += arguments[i];
+        return s;
+    }
+    assert(sum(), 0);
+    assert(sum(1, 2, 3), 6);
+    assert(sum.apply(null, [4, 5]), 9);
+
+    function f3(a, b) {
+        a = 10;
+        return [arguments.length, arguments[0], arguments[1], arguments[2],
+                arguments[-1], arguments["0"], typeof arguments[arguments.length]];
+    }
+    assert(f3(1).join(), "1,10,,,,10,undefined");
+    assert(f3(1, 2, 3).join(), "3,10,2,3,,10,undefined");
+
+    function f4(a) {
+        "use strict";
+        return [arguments.length, arguments[0], arguments[1]];
+    }
+    assert(f4(1, 2).join(), "2,1,2");
+    assert(f4().join(), "0,,");
+    function f5(a) {
+        "use strict";
+        a = 10;
+        return arguments[0];
+    }
+    assert(f5(1), 1);
+    function f6() {
+        "use strict";
+        return arguments.callee;
+    }
+    assert_throws(TypeError, f6);
+
+    /* forwarding with Function.prototype.apply */
+    function g() {
+        return [this, arguments.length].concat(Array.prototype.slice.call(arguments));
+    }
+    function fwd(a) {
+        a = 7;
+        return g.apply(this, arguments);
+    }
+    assert(fwd.call(1, 2, 3).join(), "1,2,7,3");
+    assert(fwd.call(1).join(), "1,0");
+    assert(fwd.apply(1, [2, 3, 4]).join(), "1,3,7,3,4");
+    function fwd_strict(a) {
+        "use strict";
+        a = 7;
+        return g.apply(this, arguments);
+    }
+    assert(fwd_strict.call(1, 2, 3).join(), "1,2,2,3");
+    function fwd_other(a) {
+        var r = { apply(t, args) { args[0] = 5; return args; } }.apply(this, arguments);
+        return [r === arguments, a, arguments[0], arguments.length];
+    }
+    assert(fwd_other(1, 2).join(), "true,5,5,2");
+    function fwd_not_a_function() {
+        return (1).apply(this, arguments);
+    }
+    assert_throws(TypeError, fwd_not_a_function);
+    var set_a;
+    function fwd_captured(a) {
+        set_a = function() { a = 5; };
+        return get_first.apply(this, arguments);
+    }
+    function get_first() {
+        set_a();
+        return arguments[0];
+    }
+    assert(fwd_captured(1), 1);
+
+    /* an access which is not done on the frame builds the object once */
+    var self = Symbol("self");
+    Object.defineProperty(Object.prototype, self, {
+        get() { return this; }, configurable: true });
+    function same(a) {
+        var o = arguments[self];
+        o.x = 1;
+        a = 9;
+        return [o === arguments[self], arguments[self].x, arguments[0],
+                arguments[1], arguments.length];
+    }
+    assert(same(1, 2).join(), "true,1,9,2,2");
+    function same_strict(a) {
+        "use strict";
+        var o = arguments[self];
+        return [o === arguments[self], arguments[0], arguments.length];
+    }
+    assert(same_strict(1).join(), "true,1,1");
+    delete Object.prototype[self];
 }
 
 function test_class()
@@ -369,6 +463,28 @@ function test_class()
     assert(new P().set(), "456");
     assert(new P().async(), "789");
     assert(new P().static(), 42);
+
+    /* instances pre-sized from the previous ones */
+    class M {
+        constructor(n) {
+            for(var i = 0; i < n; i++)
+                this["p" + i] = i;
+        }
+    }
+    class N extends M {
+        constructor(n) {
+            super(n);
+            this.last = n;
+        }
+    }
+    for(var i = 0; i < 20; i++) {
+        o = new M(i % 10);
+        assert(Object.keys(o).length, i % 10);
+        o = new N(20 - i);
+        assert(Object.keys(o).length, 21 - i);
+        assert(o["p" + (19 - i)], 19 - i);
+        assert(o.last, 20 - i);
+    }
 };
 
 function test_template()
@@ -402,6 +518,13 @@ function test_object_literal()
 
     a = { x, get, set, async };
     assert(JSON.stringify(a), '{"x":0,"get":1,"set":2,"async":3}');
+
+    a = { x: 1, y: 2, x: 3, 1: 4 };
+    assert(JSON.stringify(a), '{"1":4,"x":3,"y":2}');
+    a.z = 5;
+    delete a.y;
+    assert(JSON.stringify({ x: 1, y: 2, x: 3, 1: 4 }), '{"1":4,"x":3,"y":2}');
+    assert(JSON.stringify(a), '{"1":4,"x":3,"z":5}');
 }
 
 function test_regexp_skip()
@@ -442,6 +565,202 @@ function test_spread()
     assert(Object.getOwnPropertyNames(x).toString(), "0,length");
 }
 
+/* the iteration of arrays is done without iterator object while it is
+   not observable */
+function test_array_iteration()
+{
+    var a, x, y, v, log, saved, array_iterator_proto;
+
+    function sum() {
+        var s = 0;
+        for (var i = 0; i < arguments.length; i++)
+            s += arguments[i];
+        return s;
+    }
+    function C(a, b) { this.v = a + b; }
+    a = [1, 2, 3];
+    assert(sum(...a), 6);
+    assert(sum(0, ...a, ...a), 12);
+    assert(new C(...a).v, 3);
+    assert([...a, ...a].toString(), "1,2,3,1,2,3");
+    [x, y] = a;
+    assert(x + y, 3);
+    assert_throws(TypeError, () => (1)(...a));
+    assert_throws(TypeError, () => new (() => 1)(...a));
+
+    a = [1, 2];
+    a.length = 4;
+    assert([...a].length, 4);
+    a.length = 2;
+
+    /* modifications during the iteration */
+    x = [];
+    a = [1, 2, 3];
+    for (v of a) {
+        x.push(v);
+        if (v == 1)
+            a.push(4);
+        if (v == 3)
+            a.length = 0;
+    }
+    assert(x.toString(), "1,2,3");
+
+    /* redefined iterators */
+    a = [1, 2, 3];
+    a[Symbol.iterator] = function* () { yield 5; };
+    assert([...a].toString(), "5");
+    [x] = a;
+    assert(x, 5);
+
+    saved = Array.prototype[Symbol.iterator];
+    Array.prototype[Symbol.iterator] = function* () { yield 6; };
+    try {
+        assert([...[1, 2]].toString(), "6");
+        assert(sum(...[1, 2]), 6);
+        [x] = [1];
+        assert(x, 6);
+    } finally {
+        Array.prototype[Symbol.iterator] = saved;
+    }
+    assert([...[1, 2]].toString(), "1,2");
+
+    array_iterator_proto = Object.getPrototypeOf([][Symbol.iterator]());
+    saved = array_iterator_proto.next;
+    array_iterator_proto.next = function () {
+        return this.done7 ? { done: true } : { value: 7, done: !(this.done7 = true) };
+    };
+    try {
+        assert([...[1, 2]].toString(), "7");
+        x = [];
+        for (v of [1, 2])
+            x.push(v);
+        assert(x.toString(), "7");
+    } finally {
+        array_iterator_proto.next = saved;
+    }
+
+    /* a 'return' method is called when the iteration is not finished */
+    log = [];
+    array_iterator_proto.return = function () {
+        log.push(Object.prototype.toString.call(this));
+        return {};
+    };
+    try {
+        [x] = [1, 2];
+        for (v of [1, 2])
+            break;
+        try {
+            for (v of [1, 2])
+                throw 1;
+        } catch (e) {
+        }
+        [x, y] = [1];
+    } finally {
+        delete array_iterator_proto.return;
+    }
+    assert(log.length, 3);
+    assert(log[0], "[object Array Iterator]");
+}
+
+/* same for the other built-in iterables */
+function test_builtin_iteration()
+{
+    var m, s, ta, x, v, k, saved, map_iterator_proto;
+
+    ta = new Int16Array([1, -2, 3]);
+    assert([...ta].toString(), "1,-2,3");
+    x = 0;
+    for (v of ta)
+        x += v;
+    assert(x, 2);
+    ta = new Uint8Array(new ArrayBuffer(4, { maxByteLength: 8 }), 0, 4);
+    x = [];
+    assert_throws(TypeError, () => {
+        for (v of ta) {
+            x.push(v);
+            ta.buffer.resize(0);
+        }
+    });
+    assert(x.length, 1);
+
+    x = [];
+    for (v of "a\u{1F600}b")
+        x.push(v.length);
+    assert(x.toString(), "1,2,1");
+    assert([..."abc"].toString(), "a,b,c");
+
+    s = new Set([1, 2, 3]);
+    assert([...s].toString(), "1,2,3");
+    m = new Map([[1, "a"], [2, "b"]]);
+    x = [];
+    for ([k, v] of m)
+        x.push(k + v);
+    assert(x.toString(), "1a,2b");
+
+    /* modifications and nested enumerations */
+    s = new Set();
+    for (v = 0; v < 20; v++)
+        s.add(v);
+    x = [];
+    for (v of s) {
+        x.push(v);
+        if (v < 10)
+            s.delete(v + 1);
+        if (v == 19)
+            s.add(20);
+    }
+    assert(x.length, 16);
+    assert(x[x.length - 1], 20);
+    x = 0;
+    s = new Set([1, 2, 3]);
+    for (v of s) {
+        for (k of s)
+            x += k;
+    }
+    assert(x, 18);
+    for (v of s)
+        break;
+    assert([...s].toString(), "1,2,3");
+
+    /* redefined iterators */
+    saved = Map.prototype[Symbol.iterator];
+    Map.prototype[Symbol.iterator] = Map.prototype.keys;
+    try {
+        assert([...m].toString(), "1,2");
+    } finally {
+        Map.prototype[Symbol.iterator] = saved;
+    }
+    saved = String.prototype[Symbol.iterator];
+    String.prototype[Symbol.iterator] = function* () { yield 1; };
+    try {
+        assert([..."abc"].toString(), "1");
+    } finally {
+        String.prototype[Symbol.iterator] = saved;
+    }
+    Uint8Array.prototype[Symbol.iterator] = function* () { yield 2; };
+    try {
+        assert([...new Uint8Array(3)].toString(), "2");
+        assert([...new Int8Array(3)].toString(), "0,0,0");
+    } finally {
+        delete Uint8Array.prototype[Symbol.iterator];
+    }
+
+    /* a 'return' method sees the position of the iteration */
+    map_iterator_proto = Object.getPrototypeOf(m[Symbol.iterator]());
+    map_iterator_proto.return = function () {
+        x = [...this];
+        return {};
+    };
+    try {
+        m.set(3, "c");
+        for (v of m)
+            break;
+    } finally {
+        delete map_iterator_proto.return;
+    }
+    assert(x.toString(), "2,b,3,c");
+}
+
 function test_function_length()
 {
     assert( ((a, b = 1, c) => {}).length, 1);
@@ -654,6 +973,64 @@ function test_number_literals()
     test_expr('09_0', SyntaxError);
 }
 
+/* inner functions are compiled on their first call */
+function test_lazy_function()
+{
+    var x = 1, fs = [], g;
+    const c = 2;
+    function f(a) { return a + x + c; }
+    function set_c() { c = 3; }
+    function get_later() { return later; }
+    function make(n) {
+        return function inner() { return function () { return n + x; }; };
+    }
+
+    assert(get_later.toString(), "function get_later() { return later; }");
+    assert_throws(ReferenceError, get_later);
+    let later = 4;
+    assert(get_later(), 4);
+    x = 10;
+    assert(f(1), 13);
+    assert(f.length, 1);
+    assert_throws(TypeError, set_c);
+    for (let i = 0; i < 3; i++)
+        fs.push(function () { return i; });
+    assert(fs.map((f) => f()).join(), "0,1,2");
+    g = make(5);
+    assert(g()(), 15);
+    x = 20;
+    assert(make(6)()(), 26);
+    assert(g()(), 25);
+    /* syntax errors are still reported when the function is never called */
+    assert_throws(SyntaxError, "function never_called() { return 1 + ; }");
+}
+
+/* the code of indirect eval and new Function is cached */
+function test_eval_cache()
+{
+    var geval = eval, f1, f2, t1, t2, i;
+
+    f1 = new Function("a", "return a + 1");
+    f2 = new Function("a", "return a + 1");
+    assert(f1 !== f2);
+    assert(f1(1), 2);
+    assert(f2.toString(), f1.toString());
+    /* global declarations are evaluated each time */
+    for(i = 0; i < 2; i++)
+        geval("var eval_cache_count = (typeof eval_cache_count == 'number' ? eval_cache_count : 0) + 1;");
+    assert(geval("eval_cache_count"), 2);
+    /* each evaluation creates new template objects */
+    t1 = geval("(s => s)`a`");
+    t2 = geval("(s => s)`a`");
+    assert(t1 !== t2);
+    f1 = new Function("return () => (s => s)`b`")();
+    f2 = new Function("return () => (s => s)`b`")();
+    assert(f1() !== f2());
+    assert(f1() === f1());
+    assert_throws(SyntaxError, () => new Function("return 1 +"));
+    assert_throws(SyntaxError, () => new Function("return 1 +"));
+}
+
 function test_syntax()
 {
     assert_throws(SyntaxError, "do");
@@ -721,6 +1098,70 @@ function test_parse_semicolon()
     }
 }
 
+function test_global_var()
+{
+    var i, r, err;
+
+    function get() { return test_global_v; }
+    function set(v) { test_global_v = v; }
+
+    globalThis.test_global_v = 1;
+    for(i = 0; i < 3; i++)
+        assert(get(), 1);
+    set(2);
+    assert(globalThis.test_global_v, 2);
+
+    /* the cached property is deleted and added again */
+    delete globalThis.test_global_v;
+    globalThis.test_global_w = 0;
+    globalThis.test_global_v = 3;
+    assert(get(), 3);
+
+    /* converted to an accessor */
+    r = 0;
+    Object.defineProperty(globalThis, "test_global_v",
+                          { get() { return 4; }, set(v) { r = v; },
+                            configurable: true });
+    assert(get(), 4);
+    set(5);
+    assert(r, 5);
+
+    /* made read-only */
+    Object.defineProperty(globalThis, "test_global_v",
+                          { value: 6, writable: false, configurable: true });
+    set(7);
+    assert(get(), 6);
+    delete globalThis.test_global_v;
+
+    err = false;
+    try {
+        get();
+    } catch(e) {
+        err = (e instanceof ReferenceError);
+    }
+    assert(err, true);
+
+    /* shadowed by a global lexical variable of another script */
+    globalThis.test_global_v = 8;
+    assert(get(), 8);
+    $262.evalScript("let test_global_v = 9;");
+    assert(get(), 9);
+    set(10);
+    assert(get(), 10);
+    assert(globalThis.test_global_v, 8);
+    $262.evalScript("const test_global_c = 11;");
+    assert(test_global_c, 11);
+    err = false;
+    try {
+        test_global_c = 12;
+    } catch(e) {
+        err = (e instanceof TypeError);
+    }
+    assert(err, true);
+    delete globalThis.test_global_v;
+    delete globalThis.test_global_w;
+}
+
 test_op1();
 test_cvt();
 test_eq();
@@ -738,11 +1179,16 @@ test_regexp_skip();
 test_labels();
 test_destructuring();
 test_spread();
+test_array_iteration();
+test_builtin_iteration();
 test_function_length();
 test_argument_scope();
 test_function_expr_name();
+test_lazy_function();
+test_eval_cache();
 test_reserved_names();
 test_number_literals();
 test_syntax();
 test_optional_chaining();
 test_parse_semicolon();
+test_global_var();
@@ -144,6 +144,24 @@ function test_for_in()
         tab.push(k);
     }
     assert(tab.toString(), "x,y", "for_in");
+
+    /* objects sharing the same shape */
+    for(j = 0; j < 3; j++) {
+        a = {x:1, y:2, z:3, "2": 4};
+        tab = [];
+        for(i in a) {
+            tab.push(i);
+            if (j == 1 && i == "x")
+                delete a.y;
+            if (j == 2 && i == "x")
+                Object.defineProperty(a, "z", { enumerable: false });
+        }
+        assert(tab.toString(), ["2,x,y,z", "2,x,z", "2,x,y,z"][j], "for_in");
+        assert(Object.keys(a).toString(), ["2,x,y,z", "2,x,z", "2,x,y"][j]);
+    }
+    a = {x:1, get y() { delete this.z; return 2; }, z:3};
+    assert(Object.values(a).toString(), "1,2");
+    assert(Object.keys(a).toString(), "x,y");
 }
 
 function test_for_in2()
@@ -0,0 +1,158 @@
+import * as std from "qjs:std";
+import * as os from "qjs:os";
+import { assert } from "./assert.js";
+
+const isWin = os.platform === 'win32';
+
+/* the test may be run by qjs or by run-test262 from the same directory */
+function qjs_path()
+{
+    var exe = os.exePath();
+    if (!exe)
+        return null;
+    return exe.replace(/[^\/]*$/, "qjs");
+}
+
+function run(qjs, args)
+{
+    var fds, pid, f, out, ret, status;
+
+    fds = os.pipe();
+    pid = os.exec([qjs, ...args], { stdout: fds[1], block: false });
+    assert(pid >= 0);
+    os.close(fds[1]);
+    f = std.fdopen(fds[0], "r");
+    out = f.readAsString();
+    f.close();
+    [ret, status] = os.waitpid(pid, 0);
+    assert(ret, pid);
+    assert(status, 0);
+    return out.trim();
+}
+
+function mtime(filename)
+{
+    var [st, err] = os.stat(filename);
+    assert(err, 0);
+    return st.mtime;
+}
+
+function size(filename)
+{
+    var [st, err] = os.stat(filename);
+    assert(err, 0);
+    return st.size;
+}
+
+const OLD_TIME = 1000000000; /* in ms */
+
+function test_module_cache(qjs)
+{
+    var dir, err, cache_dir, main, cached, out, buf, names;
+
+    [dir, err] = os.mkdtemp();
+    assert(err, 0);
+    cache_dir = dir + "/cache";
+    assert(os.mkdir(cache_dir), 0);
+    main = dir + "/main.js";
+    std.writeFile(main, 'import { a } from "./a.js";\n' +
+                        'import { b } from "./b.js";\n' +
+                        'console.log(a(), b());\n');
+    std.writeFile(dir + "/a.js", 'export function a() { return "a1"; }\n');
+    std.writeFile(dir + "/b.js", 'export function b() { return "b1"; }\n');
+
+    function run_main() {
+        return run(qjs, ["--module-cache", cache_dir, main]);
+    }
+
+    /* return the cache file of each imported module */
+    function cache_files() {
+        var [names, err] = os.readdir(cache_dir);
+        var files = {};
+        assert(err, 0);
+        for (var name of names) {
+            if (!name.endsWith(".qbc"))
+                continue;
+            var filename = cache_dir + "/" + name;
+            var s = std.loadFile(filename);
+            if (s.includes(dir + "/a.js"))
+                files.a = filename;
+            else if (s.includes(dir + "/b.js"))
+                files.b = filename;
+        }
+        return files;
+    }
+
+    /* mark the cache files to detect when they are written again */
+    function age_cache() {
+        os.utimes(cached.a, OLD_TIME, OLD_TIME);
+        os.utimes(cached.b, OLD_TIME, OLD_TIME);
+    }
+
+    /* the first run fills the cache */
+    out = run_main();
+    assert(out, "a1 b1");
+    cached = cache_files();
+    assert(typeof cached.a, "string");
+    assert(typeof cached.b, "string");
+    [names] = os.readdir(cache_dir);
+    assert(names.filter((n) => n.endsWith(".qbc")).length, 2);
+
+    /* cache hit: the bytecode is loaded and the files are not written */
+    age_cache();
+    out = run_main();
+    assert(out, "a1 b1");
+    assert(mtime(cached.a), OLD_TIME);
+    assert(mtime(cached.b), OLD_TIME);
+
+    /* the modification time of the source changes: recompiled */
+    os.utimes(dir + "/a.js", OLD_TIME + 5000, OLD_TIME + 5000);
+    out = run_main();
+    assert(out, "a1 b1");
+    assert(mtime(cached.a) != OLD_TIME);
+    assert(mtime(cached.b), OLD_TIME);
+
+    /* the size of the source changes: recompiled */
+    age_cache();
+    std.writeFile(dir + "/b.js", 'export function b() { return "b22"; }\n');
+    out = run_main();
+    assert(out, "a1 b22");
+    assert(mtime(cached.a), OLD_TIME);
+    assert(mtime(cached.b) != OLD_TIME);
+
+    /* a truncated cache file is ignored and written again */
+    buf = std.loadFile(cached.a, { binary: true });
+    std.writeFile(cached.a, buf.slice(0, buf.length >> 1));
+    age_cache();
+    out = run_main();
+    assert(out, "a1 b22");
+    assert(size(cached.a), buf.length);
+    assert(mtime(cached.a) != OLD_TIME);
+    assert(mtime(cached.b), OLD_TIME);
+
+    /* same for a corrupted bytecode */
+    buf = std.loadFile(cached.a, { binary: true });
+    buf[buf.length - 2] ^= 0x55;
+    std.writeFile(cached.a, buf);
+    age_cache();
+    out = run_main();
+    assert(out, "a1 b22");
+    assert(mtime(cached.a) != OLD_TIME);
+    assert(mtime(cached.b), OLD_TIME);
+    buf[buf.length - 2] ^= 0x55;
+    assert(std.loadFile(cached.a, { binary: true }).join(), buf.join());
+
+    for (var name of os.readdir(cache_dir)[0]) {
+        if (name != "." && name != "..")
+            os.remove(cache_dir + "/" + name);
+    }
+    os.remove(cache_dir);
+    os.remove(main);
+    os.remove(dir + "/a.js");
+    os.remove(dir + "/b.js");
+    os.remove(dir);
+}
+
+const qjs = qjs_path();
+if (!isWin && qjs)
+    test_module_cache(qjs);
@@ -33,7 +33,52 @@ function test_async_order() {
   });
 }
 
+function test_await_order() {
+  const happenings = [];
+  let resolve;
+  class MyPromise extends Promise {}
+  async function f(x, name) {
+    try {
+      await x;
+      happenings.push(name);
+    } catch (e) {
+      happenings.push("catch " + name);
+    }
+  }
+  f(1, "value");
+  f(Promise.resolve(), "resolved");
+  f(new Promise(r => resolve = r), "pending");
+  f(Promise.reject(), "rejected");
+  f({ then(r) { r(); } }, "thenable");
+  f(MyPromise.resolve(), "subclass");
+  Promise.resolve().then(() => happenings.push("a"))
+                   .then(() => happenings.push("b"))
+                   .then(() => happenings.push("c"));
+  resolve(); // after the reaction of the first then()
+  Promise.resolve().then(() => Promise.resolve()).then(() => {
+    assertArrayEquals(happenings, ["value", "resolved", "catch rejected",
+                                   "a", "pending", "thenable", "b",
+                                   "subclass", "c"]);
+  });
+}
+
+function test_from_async_order() {
+  const happenings = [];
+  let p = Promise.resolve();
+  for (let i = 1; i <= 12; i++)
+    p = p.then(() => happenings.push(i));
+  Array.fromAsync([1, 2, 3]).then(() => happenings.push("array"));
+  Array.fromAsync({ length: 2, 0: 1, 1: 2 }).then(() => happenings.push("array-like"));
+  Array.fromAsync((function* () { yield 1; yield 2; })()).then(() => happenings.push("generator"));
+  p.then(() => {
+    assertArrayEquals(happenings, [1, 2, 3, "array-like", 4, 5, 6, 7, "generator",
+                                   8, 9, "array", 10, 11, 12]);
+  });
+}
+
 test_types();
 test_async();
 test_arguments();
 test_async_order();
+test_await_order();
+test_from_async_order();